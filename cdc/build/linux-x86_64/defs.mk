@@ -0,0 +1,45 @@
+#
+# Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+# DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+# 
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License version
+# 2 only, as published by the Free Software Foundation. 
+# 
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License version 2 for more details (a copy is
+# included at /legal/license.txt). 
+# 
+# You should have received a copy of the GNU General Public License
+# version 2 along with this work; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+# 02110-1301 USA 
+# 
+# Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+# Clara, CA 95054 or visit www.sun.com if you need additional
+# information or have any questions. 
+#
+#
+
+#
+# defs for linux-x86_64 target
+#
+
+CVM_TARGETOBJS_SPEED +=	\
+    x86_64_float_cpu.o
+
+CVM_TARGETOBJS_OTHER += \
+    invokeNative_x86_64.o
+
+ifeq ($(CVM_MP_SAFE), true)
+CVM_TARGETOBJS_OTHER += \
+        x86_64_membar.o
+endif
+
+CVM_SRCDIRS   += \
+	$(CVM_TOP)/src/$(TARGET_OS)-$(TARGET_CPU_FAMILY)/javavm/runtime \
+
+CVM_INCLUDE_DIRS  += \
+	$(CVM_TOP)/src/$(TARGET_OS)-$(TARGET_CPU_FAMILY)
@@ -37,6 +37,15 @@ ifeq ($(LINUX_ENABLE_SET_AFFINITY), true)
 CVM_DEFINES += -DLINUX_ENABLE_SET_AFFINITY
 endif
 
+# read zip/jar files through a read-only mapping instead of lseek/read
+CVM_ZIP_MMAP ?= true
+CVM_FLAGS	+= CVM_ZIP_MMAP
+CVM_ZIP_MMAP_CLEANUP_ACTION = \
+	rm -rf $(CVM_OBJDIR)/zip_util.o $(CVM_OBJDIR)/ZipFile.o
+ifeq ($(CVM_ZIP_MMAP), true)
+CVM_DEFINES += -DCVM_ZIP_MMAP
+endif
+
 CVM_TARGETROOT	= $(CVM_TOP)/src/$(TARGET_OS)
 
 #
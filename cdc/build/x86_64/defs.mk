@@ -0,0 +1,54 @@
+#
+# Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+# DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+# 
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License version
+# 2 only, as published by the Free Software Foundation. 
+# 
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License version 2 for more details (a copy is
+# included at /legal/license.txt). 
+# 
+# You should have received a copy of the GNU General Public License
+# version 2 along with this work; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+# 02110-1301 USA 
+# 
+# Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+# Clara, CA 95054 or visit www.sun.com if you need additional
+# information or have any questions. 
+#
+#
+
+#
+# defs for x86_64 targets
+#
+
+CVM_SRCDIRS   += \
+	$(CVM_TOP)/src/$(TARGET_CPU_FAMILY)/javavm/runtime
+
+CVM_INCLUDE_DIRS  += \
+	$(CVM_TOP)/src/$(TARGET_CPU_FAMILY) \
+
+# The VM is built LP64: CVMAddr, stack slots and object references are
+# 64 bits wide. See src/portlibs/gcc_32_bit/defs.h.
+CVM_DEFINES	+= -DCVM_64
+
+ifeq ($(CVM_AOT), true)
+$(error AOT is not supported for x86_64)
+endif
+
+# There is no dynamic compiler backend for x86_64 yet. The 32-bit x86
+# emitter, register manager and grammar rules assume the 8 register
+# IA-32 file and 32-bit addressing, and are not reusable here.
+# IMPL NOTE: a backend needs src/x86_64/javavm/runtime/jit with at least
+# jitemitter_cpu.c, a register manager for the 16 register file, the .jcs
+# grammar rules and the CCM glue (ccmglue_cpu.S, ccminvokers_cpu.S).
+ifeq ($(CVM_JIT), true)
+$(error JIT is not supported for x86_64 yet. Build with CVM_JIT=false)
+endif
+
+ASM_FLAGS       += -traditional
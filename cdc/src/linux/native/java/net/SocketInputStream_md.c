@@ -35,6 +35,8 @@
 #include "jni_util.h"
 #include "net_util.h"
 
+#include "javavm/include/interpreter.h"
+
 #include "java_net_SocketInputStream.h"
 
 
@@ -68,6 +70,7 @@ Java_java_net_SocketInputStream_socketRead0(JNIEnv *env, jobject this,
     char BUF[MAX_BUFFER_LEN];
     char *bufP;
     jint fd, nread;
+    CVMExecEnv *ee = CVMjniEnv2ExecEnv(env);
 
     if (IS_NULL(fdObj)) {
 	/* should't this be a NullPointerException? -br */
@@ -86,9 +89,10 @@ Java_java_net_SocketInputStream_socketRead0(JNIEnv *env, jobject this,
     }
 
     /* If requested amount to be read is > MAX_BUFFER_LEN then
-     * we allocate a buffer from the heap (up to the limit
-     * specified by MAX_HEAP_BUFFER_LEN). If memory is exhausted
-     * we always use the stack buffer.
+     * we read into the per-thread EE-buffer (up to the limit
+     * specified by MAX_HEAP_BUFFER_LEN). The EE-buffer is kept
+     * between calls, so this does not cost a malloc per read.
+     * If memory is exhausted we always use the stack buffer.
      */
     if (len <= MAX_BUFFER_LEN) {
         bufP = BUF;
@@ -96,11 +100,13 @@ Java_java_net_SocketInputStream_socketRead0(JNIEnv *env, jobject this,
         if (len > MAX_HEAP_BUFFER_LEN) {
             len = MAX_HEAP_BUFFER_LEN;
         }
-        bufP = (char *)malloc((size_t)len);
+        CVMCstackGetBufferOfSize(ee, bufP, len);	/* Lock EE-buffer */
         if (bufP == NULL) {
             /* allocation failed so use stack buffer */
             bufP = BUF;
             len = MAX_BUFFER_LEN;
+        } else if (len > (jint)CVMCstackBufferSize(ee)) {
+            len = CVMCstackBufferSize(ee);
         }
     }
 
@@ -124,7 +130,7 @@ Java_java_net_SocketInputStream_socketRead0(JNIEnv *env, jobject this,
 			    "Operation interrupted");
     	    }
             if (bufP != BUF) {
-                free(bufP);
+                CVMCstackReleaseBuffer(ee);	/* Unlock EE-buffer */
             }
             return -1;
         }
@@ -162,7 +168,7 @@ Java_java_net_SocketInputStream_socketRead0(JNIEnv *env, jobject this,
     }
 
     if (bufP != BUF) {
-	free(bufP);
+	CVMCstackReleaseBuffer(ee);	/* Unlock EE-buffer */
     }
     return nread;
 }					   
@@ -35,6 +35,8 @@
 #include "jvm.h"
 #include "net_util.h"
 
+#include "javavm/include/interpreter.h"
+
 #include "java_net_SocketOutputStream.h"
 
 #define min(a, b)       ((a) < (b) ? (a) : (b))
@@ -66,12 +68,17 @@ Java_java_net_SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
 					     jobject fdObj, jbyteArray data, 
 					     jint off, jint len) {
     /*
-     * We allocate a static buffer on the stack, copy successive
-     * chunks of the buffer to be written into it, then write that. It
-     * is believed that this is faster that doing a malloc and copy.  
+     * We copy successive chunks of the buffer to be written into the
+     * per-thread EE-buffer, then write that. The EE-buffer holds up to
+     * MAX_HEAP_BUFFER_LEN bytes and is kept between calls, so large
+     * writes take fewer sends without a malloc per call. If it cannot
+     * be had, a small static buffer on the stack is used instead.
      */
     char BUF[MAX_BUFFER_LEN];
+    char *bufP;
+    int bufLen;
     int fd;
+    CVMExecEnv *ee = CVMjniEnv2ExecEnv(env);
 
     if (IS_NULL(fdObj)) {
 	JNU_ThrowByName(env, "java/net/SocketException", "Socket closed");
@@ -87,15 +94,27 @@ Java_java_net_SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
         }
 
     }
+
+    bufP = BUF;
+    bufLen = MAX_BUFFER_LEN;
+    if (len > MAX_BUFFER_LEN) {
+	CVMCstackGetBufferOfSize(ee, bufP,
+				 min(MAX_HEAP_BUFFER_LEN, len));
+	if (bufP == NULL) {
+	    bufP = BUF;
+	} else {			/* Locked EE-buffer */
+	    bufLen = CVMCstackBufferSize(ee);
+	}
+    }
    
     while(len > 0) {
 	int loff = 0;
-	int chunkLen = min(MAX_BUFFER_LEN, len);
+	int chunkLen = min(bufLen, len);
 	int llen = chunkLen;
-	(*env)->GetByteArrayRegion(env, data, off, chunkLen, (jbyte *)BUF);
+	(*env)->GetByteArrayRegion(env, data, off, chunkLen, (jbyte *)bufP);
       
 	while(llen > 0) {
-	    int n = NET_Send(fd, BUF + loff, llen, 0);
+	    int n = NET_Send(fd, bufP + loff, llen, 0);
 	    if (n > 0) {
 		llen -= n;
 		loff += n;
@@ -112,11 +131,15 @@ Java_java_net_SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
                                                  "Write failed");
 		}
 	    }
-	    return;
+	    goto done;
 	}
 	len -= chunkLen;
 	off += chunkLen;
     }
+ done:
+    if (bufP != BUF) {
+	CVMCstackReleaseBuffer(ee);	/* Unlock EE-buffer */
+    }
 }
 
 
@@ -130,6 +130,7 @@ setupRequest(JNIEnv*env, int argc, char** argv, CVMInt32 clientId)
 }
 
 static void child(int sig);
+static CVMBool poolRemove(int pid);
 
 /*
  * Task management 
@@ -355,6 +356,12 @@ doReapChildren(ServerState* state, int options)
     while ((cpid = wait3(&status, options, &ru)) > 0) {
 	int exitcodefd;
 
+	/* Idle and retired pool children never ran a task */
+	if (poolRemove(cpid)) {
+	    fprintf(stderr, "Reaping pool child process %d\n", cpid);
+	    continue;
+	}
+
         /* Notify the executive about the isolate termination */
 	if (cpid != executivePid) {
            notifyTermination(cpid);
@@ -934,6 +941,367 @@ prepareJNative(char *procName, char *soLibName)
     return symbol;
 }
 
+/*
+ * Warm task pool.
+ *
+ * Forking on demand puts the fork() and the copying of the parent's
+ * page tables on the critical path of every launch. With the
+ * "warmPoolSize=<n>" server sub-option the server keeps up to <n>
+ * children forked ahead of time. Each idle child blocks reading its
+ * request pipe. A launch request is handed to an idle child by
+ * writing the arguments down the pipe, and the pool is refilled after
+ * the requester has been answered.
+ *
+ * Only plain Java launches go through the pool. JNATIVE and JDETACH
+ * still fork on demand. Idle children are retired whenever the state
+ * they were forked from becomes stale (SETENV, or a sourced command
+ * that ran in the server). A retired child sees EOF on its pipe and
+ * exits, and is reaped like any other child.
+ */
+
+#define MTASK_MAX_POOL_SIZE	16
+#define MTASK_POOL_SLOTS	(2 * MTASK_MAX_POOL_SIZE)
+
+typedef enum _PoolChildState {
+    POOL_FREE = 0,	/* slot unused */
+    POOL_IDLE,		/* forked, waiting for a request */
+    POOL_RETIRED	/* told to exit, waiting to be reaped */
+} PoolChildState;
+
+typedef struct _PoolChild {
+    PoolChildState state;
+    int pid;
+    int requestFd;	/* write end of the child's request pipe */
+} PoolChild;
+
+/* Header of a launch request sent to an idle pool child */
+typedef struct _PoolRequest {
+    int argc;
+    int executiveId;
+    int prefixLen;	/* testing mode prefix length, -1 if none */
+} PoolRequest;
+
+static PoolChild pool[MTASK_POOL_SLOTS];
+static int poolSize = 0;	/* requested number of idle children */
+static int poolIdle = 0;	/* current number of idle children */
+
+/* The server ignores SIGPIPE while the pool is enabled, so that handing
+   a request to a child that just died fails instead of killing the
+   server. Children get the original disposition back. */
+static struct sigaction poolSavedSigpipe;
+
+/*
+ * Common set up of a freshly launched child process. executiveId is
+ * the pid of the executive the new task belongs to, and prefix is the
+ * testing mode file prefix, or NULL if testing mode is off.
+ */
+static void
+initializeChild(JNIEnv* env, int mypid, int executiveId, char* prefix)
+{
+    /* Remember the pid of our process for compatibility
+       with non-Posix compliant systems on which getpid()
+       returns a thread id. */
+    jumpProcessSetId(mypid);
+    jumpProcessSetExecutiveId(executiveId);
+
+#ifdef CVM_TIMESTAMPING
+    if (!CVMmtaskTimeStampReinitialize(env)) {
+	fprintf(stderr, 
+		"Could not reinitialize timestamping, exiting\n");
+	exit(1);
+    }
+#endif		
+    /* Make sure all the fd's we inherit from the parent
+       get freed up */
+    closeAllFdsExcept(-1);
+
+    if (poolSize > 0) {
+	sigaction(SIGPIPE, &poolSavedSigpipe, NULL);
+    }
+
+    if (prefix != NULL) {
+	/* We want to open files for stdout and stderr */
+	int outfd = createLogFile(prefix, "stdout", mypid);
+	int errfd = createLogFile(prefix, "stderr", mypid);
+	if ((outfd == -1) || (errfd == -1)) {
+	    /* Due to some error that was reported in
+	       createLogFile() */
+	    fprintf(stderr, "MTASK: Could not set debug mode\n");
+	} else {
+	    /* Hook up stdout and stderr in the child process
+	       to the right files */
+	    dup2(outfd, 1);
+	    dup2(errfd, 2);
+	    close(outfd);
+	    close(errfd);
+	}
+    } 
+}
+
+static int
+writeFully(int fd, const void* buf, int len)
+{
+    const char* p = (const char*)buf;
+    while (len > 0) {
+	int n = write(fd, p, len);
+	if (n == -1) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return -1;
+	}
+	p += n;
+	len -= n;
+    }
+    return 0;
+}
+
+static int
+readFully(int fd, void* buf, int len)
+{
+    char* p = (char*)buf;
+    while (len > 0) {
+	int n = read(fd, p, len);
+	if (n == -1) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return -1;
+	}
+	if (n == 0) {
+	    return -1; /* EOF */
+	}
+	p += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/*
+ * Close the request pipes of all pool children except keepFd. Children
+ * must not hold on to each other's pipes, or a retired child would
+ * never see EOF.
+ */
+static void
+poolCloseFds(int keepFd)
+{
+    int i;
+    for (i = 0; i < MTASK_POOL_SLOTS; i++) {
+	if (pool[i].state == POOL_IDLE && pool[i].requestFd != keepFd) {
+	    close(pool[i].requestFd);
+	    pool[i].requestFd = -1;
+	}
+    }
+}
+
+static PoolChild*
+poolFind(int pid)
+{
+    int i;
+    for (i = 0; i < MTASK_POOL_SLOTS; i++) {
+	if (pool[i].state != POOL_FREE && pool[i].pid == pid) {
+	    return &pool[i];
+	}
+    }
+    return NULL;
+}
+
+static PoolChild*
+poolFindFree()
+{
+    int i;
+    for (i = 0; i < MTASK_POOL_SLOTS; i++) {
+	if (pool[i].state == POOL_FREE) {
+	    return &pool[i];
+	}
+    }
+    return NULL;
+}
+
+/*
+ * Forget about a pool child that has exited. Returns CVM_TRUE if pid
+ * was one of the idle or retired pool children.
+ */
+static CVMBool
+poolRemove(int pid)
+{
+    PoolChild* pc = poolFind(pid);
+    if (pc == NULL) {
+	return CVM_FALSE;
+    }
+    if (pc->state == POOL_IDLE) {
+	close(pc->requestFd);
+	poolIdle--;
+    }
+    pc->state = POOL_FREE;
+    pc->pid = 0;
+    pc->requestFd = -1;
+    return CVM_TRUE;
+}
+
+/*
+ * Retire all idle children, e.g. because the server state they were
+ * forked from changed. They exit on their own.
+ */
+static void
+poolRetireAll()
+{
+    int i;
+    for (i = 0; i < MTASK_POOL_SLOTS; i++) {
+	if (pool[i].state == POOL_IDLE) {
+	    close(pool[i].requestFd);
+	    pool[i].requestFd = -1;
+	    pool[i].state = POOL_RETIRED;
+	}
+    }
+    poolIdle = 0;
+}
+
+/*
+ * Executed by an idle pool child. Wait for a launch request and set
+ * it up. Exits if the server retires this child.
+ */
+static void
+poolChildWaitForRequest(JNIEnv* env, ServerState* state, int requestFd)
+{
+    PoolRequest req;
+    char* prefix = NULL;
+    char** argv;
+    int i;
+
+    if (readFully(requestFd, &req, sizeof(req)) == -1) {
+	/* The server closed the pipe: we have been retired */
+	exit(0);
+    }
+    if (req.prefixLen >= 0) {
+	prefix = (char*)malloc(req.prefixLen + 1);
+	if (prefix == NULL ||
+	    readFully(requestFd, prefix, req.prefixLen) == -1) {
+	    exit(1);
+	}
+	prefix[req.prefixLen] = '\0';
+    }
+    argv = (char**)calloc(req.argc, sizeof(char*));
+    if (argv == NULL) {
+	exit(1);
+    }
+    for (i = 0; i < req.argc; i++) {
+	int len;
+	if (readFully(requestFd, &len, sizeof(len)) == -1) {
+	    exit(1);
+	}
+	argv[i] = (char*)malloc(len + 1);
+	if (argv[i] == NULL || readFully(requestFd, argv[i], len) == -1) {
+	    exit(1);
+	}
+	argv[i][len] = '\0';
+    }
+    close(requestFd);
+
+    initializeChild(env, getpid(), req.executiveId, prefix);
+    if (prefix != NULL) {
+	free(prefix);
+    }
+
+    /* We need these threads in the child */
+    if (!restartSystemThreads(env, state)) {
+	exit(1);
+    }
+    setupRequest(env, req.argc, argv, getpid());
+}
+
+/*
+ * Fork idle children until the pool is full. Returns JNI_TRUE in a
+ * pool child that has received its launch request, which must then
+ * return to the caller of waitForNextRequest() to execute it.
+ */
+static jboolean
+poolFill(JNIEnv* env, ServerState* state)
+{
+    while (poolIdle < poolSize) {
+	PoolChild* pc = poolFindFree();
+	int pipes[2];
+	int pid;
+
+	if (pc == NULL) {
+	    /* Too many retired children still around */
+	    return JNI_FALSE;
+	}
+	if (pipe(pipes) == -1) {
+	    perror("pool pipe");
+	    return JNI_FALSE;
+	}
+	if ((pid = fork()) == 0) {
+	    close(pipes[1]);
+	    poolCloseFds(-1);
+	    poolChildWaitForRequest(env, state, pipes[0]);
+	    return JNI_TRUE;
+	} else if (pid == -1) {
+	    perror("pool fork");
+	    close(pipes[0]);
+	    close(pipes[1]);
+	    return JNI_FALSE;
+	}
+	close(pipes[0]);
+	pc->state = POOL_IDLE;
+	pc->pid = pid;
+	pc->requestFd = pipes[1];
+	poolIdle++;
+    }
+    return JNI_FALSE;
+}
+
+/*
+ * Hand a launch request to an idle pool child. Returns the pid of the
+ * child now executing it, or -1 if the request must be forked on
+ * demand instead.
+ */
+static int
+poolDispatch(ServerState* state, int argc, char** argv)
+{
+    PoolRequest req;
+    int i;
+
+    for (i = 0; i < MTASK_POOL_SLOTS; i++) {
+	PoolChild* pc = &pool[i];
+	CVMBool ok;
+	int j;
+
+	if (pc->state != POOL_IDLE) {
+	    continue;
+	}
+	req.argc = argc;
+	req.executiveId = executivePid;
+	req.prefixLen = state->isTestingMode ?
+	    strlen(state->testingModeFilePrefix) : -1;
+
+	ok = (writeFully(pc->requestFd, &req, sizeof(req)) == 0);
+	if (ok && req.prefixLen >= 0) {
+	    ok = (writeFully(pc->requestFd, state->testingModeFilePrefix,
+			     req.prefixLen) == 0);
+	}
+	for (j = 0; ok && j < argc; j++) {
+	    int len = strlen(argv[j]);
+	    ok = (writeFully(pc->requestFd, &len, sizeof(len)) == 0 &&
+		  writeFully(pc->requestFd, argv[j], len) == 0);
+	}
+
+	/* Either way, this child is no longer idle */
+	close(pc->requestFd);
+	pc->requestFd = -1;
+	poolIdle--;
+	if (ok) {
+	    int pid = pc->pid;
+	    pc->state = POOL_FREE;
+	    pc->pid = 0;
+	    return pid;
+	}
+	/* The child died under us. Leave it for the reaper. */
+	pc->state = POOL_RETIRED;
+    }
+    return -1;
+}
+
 /*
  * A JVM server. Sleep waiting for new requests. As new ones come in,
  * fork off a process to handle each and go back to sleep. 
@@ -955,6 +1323,11 @@ waitForNextRequest(JNIEnv* env, ServerState* state)
      * touch the fd that was passed in.
      */
     assert(state->initialized);
+
+    /* Top up the warm pool before going to sleep */
+    if (poolFill(env, state)) {
+	return JNI_FALSE;
+    }
     
     while (!done) {
 	int argc;
@@ -977,6 +1350,10 @@ waitForNextRequest(JNIEnv* env, ServerState* state)
 		childrenExited = 1; 
 		reapChildren(state);
 	    }
+	    /* Replace any pool children that died while idle */
+	    if (poolFill(env, state)) {
+		return JNI_FALSE;
+	    }
 	    if (command == (JUMPMessage) -1) {
 		/* There was no message, just a child notification. */
 		command = readRequestMessage();
@@ -1041,6 +1418,9 @@ waitForNextRequest(JNIEnv* env, ServerState* state)
 			}
 		    }
 		}
+		/* Idle pool children were forked with the old
+		   environment */
+		poolRetireAll();
 		/* The man page does not say whether setenv
 		   makes a copy of the arguments. So I don't know
 		   whether I can free the strdup'ed argv[1].
@@ -1162,6 +1542,9 @@ waitForNextRequest(JNIEnv* env, ServerState* state)
 		dumpMessage(command, "SOURCING:");
 		jumpMessageFree(command);
 		command = NULL;
+		/* The sourced command changes the server state, so idle
+		   pool children forked from the old state are stale */
+		poolRetireAll();
 		/* In the parent process, setup request and return to caller */
 		setupRequest(env, argc, argv, 0);
 		/* Make sure */
@@ -1247,57 +1630,36 @@ waitForNextRequest(JNIEnv* env, ServerState* state)
 	    }
 #endif
 
+	    /* Hand plain Java launches to a pre-forked child if we can */
+	    if (strcmp(argv[0], "JNATIVE") && strcmp(argv[0], "JDETACH") &&
+		(pid = poolDispatch(state, argc, argv)) != -1) {
+		fprintf(stderr, "DISPATCHED TO POOL PID=%d\n", pid);
+		respondWith2(command, "CHILD PID=%d", pid);
+		addTask(env, state, pid, oneString(command), PROCTYPE_JAVA);
+		jumpMessageFree(command);
+		freeArgs(argc, argv);
+		/* Replace the child we just used */
+		if (poolFill(env, state)) {
+		    return JNI_FALSE;
+		}
+		command = readRequestMessage();
+		continue;
+	    }
+
 	    /* Fork off a process, and handle the request */
 	    if ((pid = fork()) == 0) {
 		int mypid = getpid();
 
-		/* Remember the pid of our process for compatibility
-		   with non-Posix compliant systems on which getpid()
-		   returns a thread id. */
-		jumpProcessSetId(mypid);
-
 		/* Make sure each launched process knows the id of the
 		   executive */
-                if (amExecutive) {
-                    jumpProcessSetExecutiveId(mypid);
-                } else {
-                    jumpProcessSetExecutiveId(executivePid);
-                }
-		
-		/* Child process */
-#ifdef CVM_TIMESTAMPING
-		if (!CVMmtaskTimeStampReinitialize(env)) {
-		    fprintf(stderr, 
-			    "Could not reinitialize timestamping, exiting\n");
-		    exit(1);
-		}
-#endif		
-		/* Make sure all the fd's we inherit from the parent
-		   get freed up */
-		closeAllFdsExcept(-1);
-		
-		if (state->isTestingMode) {
-		    char* prefix = state->testingModeFilePrefix;
-		    /* We want to open files for stdout and stderr */
-		    int outfd = createLogFile(prefix, "stdout", mypid);
-		    int errfd = createLogFile(prefix, "stderr", mypid);
-		    if ((outfd == -1) || (errfd == -1)) {
-			/* Due to some error that was reported in
-			   createLogFile() */
-			fprintf(stderr, "MTASK: Could not set debug mode\n");
-		    } else {
-			/* Hook up stdout and stderr in the child process
-			   to the right files */
-			dup2(outfd, 1);
-			dup2(errfd, 2);
-			close(outfd);
-			close(errfd);
-		    }
-		} 
-		
+		poolCloseFds(-1);
+		initializeChild(env, mypid,
+				amExecutive ? mypid : executivePid,
+				state->isTestingMode ?
+				    state->testingModeFilePrefix : NULL);
 #if 0
 		/* how to do sync? */
-                else if (isSync) {
+                if (isSync) {
 		    /* If we are in JSYNC execution, route stdout
 		       and stderr back where the request came from */
 		    dup2(connfd, 1);
@@ -1442,6 +1804,7 @@ MTASKserverInitialize(ServerState* state,
 {    
     const char* clist = CVMgetParsedSubOption(serverOpts, "initClasses");
     const char* mlist = CVMgetParsedSubOption(serverOpts, "precompileMethods");
+    const char* plist = CVMgetParsedSubOption(serverOpts, "warmPoolSize");
 
     /* Remember the pid of our process for compatibility with
        non-Posix compliant systems on which getpid() returns a thread id. */
@@ -1525,6 +1888,23 @@ MTASKserverInitialize(ServerState* state,
     
     fprintf(stderr, "Starting mTASK server at pid=%d  .... ", getpid());
 
+    if (plist != NULL) {
+	CVMInt32 size = CVMoptionToInt32(plist);
+	if (size < 0 || size > MTASK_MAX_POOL_SIZE) {
+	    fprintf(stderr, "warmPoolSize must be between 0 and %d\n",
+		    MTASK_MAX_POOL_SIZE);
+	    goto error;
+	}
+	poolSize = size;
+    }
+    if (poolSize > 0) {
+	struct sigaction sa;
+	sa.sa_handler = SIG_IGN;
+	sa.sa_flags = 0;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGPIPE, &sa, &poolSavedSigpipe);
+    }
+
     state->env = env;
     state->cvmClass = cvmClass;
     state->initialized = JNI_TRUE;
@@ -1770,6 +1770,42 @@ CVMBool
 CVMloaderNeedsVerify(CVMExecEnv* ee, CVMClassLoaderICell* loader,
                      CVMBool verifyTrusted);
 
+#ifndef CVM_TRUSTED_CLASSLOADERS
+/*
+ * Persistent verification cache (-Xopt:verifyCache=<file>).
+ *
+ * CVMclassVerifyCacheLookup - called when an application class has
+ * been created from classBytes. Digests the bytes for a later check.
+ * CVMclassVerifyCacheCheck - called once the supertypes of cb are
+ * linked, just before it would be verified. Marks cb VERIFIED if an
+ * identical class with identical supertypes passed verification in an
+ * earlier run.
+ * CVMclassVerifyCacheAdd - records that cb has just passed verification.
+ * CVMclassVerifyCacheForget - drops the record for cb when it is freed.
+ * CVMclassVerifyCacheSave - writes the cache file and reports the hit
+ * statistics. Called on every VM exit path from CVMprepareToExit().
+ * CVMclassVerifyCacheDestroy - frees the cache.
+ */
+extern void
+CVMclassVerifyCacheLookup(CVMExecEnv* ee, CVMClassBlock* cb,
+			  const CVMUint8* classBytes, CVMUint32 classSize);
+
+extern void
+CVMclassVerifyCacheCheck(CVMExecEnv* ee, CVMClassBlock* cb);
+
+extern void
+CVMclassVerifyCacheAdd(CVMExecEnv* ee, CVMClassBlock* cb);
+
+extern void
+CVMclassVerifyCacheForget(CVMExecEnv* ee, CVMClassBlock* cb);
+
+extern void
+CVMclassVerifyCacheSave(CVMExecEnv* ee);
+
+extern void
+CVMclassVerifyCacheDestroy(CVMExecEnv* ee);
+#endif
+
 #endif /* CVM_CLASSLOADING */
 
 /*
@@ -1904,6 +1940,14 @@ CVMloaderCacheLookupWithProtectionDomain(CVMExecEnv* ee,
 					 CVMClassLoaderICell* loader,
 					 CVMObjectICell* pd);
 
+/*
+ * Same as CVMloaderCacheLookup(), but does not require the loaderCacheLock.
+ * Must be called while gc safe and without holding the loaderCacheLock.
+ */
+extern CVMClassBlock*
+CVMloaderCacheLookupNoLock(CVMExecEnv* ee, CVMClassTypeID classID,
+			   CVMClassLoaderICell* loader);
+
 extern CVMBool
 CVMloaderCacheAdd(CVMExecEnv* ee, CVMClassBlock* cb,
 		  CVMClassLoaderICell* loader);
@@ -2020,6 +2064,13 @@ CVMclassBootClassPathDestroy(CVMExecEnv* ee);
 extern void
 CVMclassClassPathDestroy(CVMExecEnv* ee);
 
+/*
+ * Write the list of dynamically loaded boot and application classes
+ * in sun.misc.Warmup format (-Xopt:dumpClassList=<file>).
+ */
+extern void
+CVMclassDumpClassList(CVMExecEnv* ee, const char* fileName);
+
 /*
  * Find file that contains the class bytes
  */
@@ -2037,6 +2088,13 @@ extern CVMBool
 CVMclassPathInit(JNIEnv* env, CVMClassPath* path, char* additionalPathString,
 	      CVMBool doNotFailWhenPathNotFound, CVMBool initJavaSide);
 
+/*
+ * Checksum the contents of a class path. Returns CVM_FALSE if it
+ * cannot be done cheaply (the path has a directory entry).
+ */
+extern CVMBool
+CVMclassPathFingerprint(CVMClassPath* path, CVMUint32* crc);
+
 /*
  * Obtain the system class loader (initialize the cache if not yet done)
  */
@@ -98,6 +98,7 @@ struct CVMGCGlobalState {
     CVMUint8* cardTableEnd;
     struct {
 	CVMUint32 youngGenSize;
+	CVMBool   dedupStrings;	/* -Xgc:dedupStrings */
     } genGCAttributes;
     CVMInt8* objectHeaderTable;
     CVMGenSummaryTableEntry* summaryTable;
@@ -180,7 +181,7 @@ struct CVMGCGlobalState {
     CVMBool hasYoungGenClassesOrLoaders;
 };
 
-#define CVM_GCIMPL_GC_OPTIONS "[,youngGen=<youngSemispaceSize>]"
+#define CVM_GCIMPL_GC_OPTIONS "[,youngGen=<youngSemispaceSize>][,dedupStrings]"
 
 #define CVM_GC_GENERATIONAL 222
 #define CVM_GCCHOICE CVM_GC_GENERATIONAL
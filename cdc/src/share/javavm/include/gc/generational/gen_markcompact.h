@@ -62,6 +62,11 @@ struct CVMGenMarkCompactGeneration {
     volatile int          gcPhase;
     CVMObject *           lastProcessedRef;
     jmp_buf               errorContext;
+
+    /* String value table used by -Xgc:dedupStrings during the mark
+       phase, or NULL when deduplication is off for this GC: */
+    CVMArrayOfChar**      dedupTable;
+    CVMUint32             dedupLoad;
 };
 
 typedef struct CVMGenMarkCompactGeneration CVMGenMarkCompactGeneration;
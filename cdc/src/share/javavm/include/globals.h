@@ -232,6 +232,14 @@ struct CVMGlobalState {
      * by the loaderCache lock.
      */
     CVMLoaderCacheEntry** loaderCache;
+#ifdef CVM_CLASSLOADING
+    /*
+     * Entries unlinked by the last class unloading pass. They are freed
+     * by the next one so that unlocked lookups never see freed memory.
+     * Protected by the loaderCache lock.
+     */
+    CVMLoaderCacheEntry* loaderCacheRetired;
+#endif
 
     /*
      * Database of loader constraints. See loaderconstraints.c for details.
@@ -440,6 +448,28 @@ struct CVMGlobalState {
     CVMUint16            classVerificationLevel;
 #ifdef CVM_SPLIT_VERIFY
     CVMBool              splitVerify;
+#endif
+#ifndef CVM_TRUSTED_CLASSLOADERS
+    /*
+     * Persistent verification cache (-Xopt:verifyCache=<file>): keys
+     * of application classes that passed verification in an earlier run
+     * with the same class path. All fields but extDirs are protected by
+     * lock. extDirs is the -Djava.ext.dirs value, if one was given.
+     */
+    struct {
+	CVMSysMutex                       lock;
+	CVMBool                           initialized;
+	CVMBool                           enabled;
+	CVMBool                           dirty;
+	CVMUint32                         fingerprint;
+	struct CVMVerifyCacheDigest*      table;
+	CVMUint32                         tableSize;
+	CVMUint32                         count;
+	struct CVMVerifyCacheClass**      classes;
+	char*                             extDirs;
+	CVMUint32                         hits;
+	CVMUint32                         misses;
+    } verifyCache;
 #endif
     void*                cvmDynHandle;
     
@@ -529,6 +559,13 @@ struct CVMGlobalState {
 	CVMUint32 javaStackMinSize;
 	CVMUint32 javaStackMaxSize;
 	CVMUint32 javaStackChunkSize;
+#ifdef CVM_CLASSLOADING
+	char*     dumpClassList;
+#ifndef CVM_TRUSTED_CLASSLOADERS
+	char*     verifyCache;
+	CVMBool   verifyCacheStats;
+#endif
+#endif
     } config;
 
     /*
@@ -633,6 +670,8 @@ struct CVMGlobalState {
     CVMInt64 totalGCTime;
     CVMInt64 startGCTime;
     CVMInt64 initFreeMemory;
+    CVMUint32 dedupStringCount;	/* Strings redirected by -Xgc:dedupStrings */
+    CVMUint32 dedupCharBytes;	/* char[] bytes no longer referenced by them */
 
 #ifndef CDC_10
     /* java assertion related globals */
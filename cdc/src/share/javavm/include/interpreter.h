@@ -74,8 +74,11 @@ typedef enum {
 #define CVM_CSTACK_BUF_SIZE     8192    /* Fixed size of the EE buffer used by
                                          * ZipFile and RandomAccess IO read 
 				 	 * and write operation. */
+#define CVM_CSTACK_BUF_MAX_SIZE 65536   /* Largest size the EE buffer grows
+					 * to for bulk stream IO. */
 
 #define CVMCstackBuffer(ee)              ((ee)->cstackBuffer)
+#define CVMCstackBufferSize(ee)          ((ee)->cstackBufferSize)
 #define CVMCstackBufferFlag(ee)          ((ee)->cstackBufferFlag)
 #define CVMCstackBufferIsNull(ee)        ((ee)->cstackBuffer == NULL)
 #define CVMCstackBufferIsSet(ee)         ((ee)->cstackBufferFlag)
@@ -99,6 +102,7 @@ typedef enum {
     CVMassert(!CVMCstackBufferIsSet(ee));				\
     if (CVMCstackBufferIsNull(ee)) {					\
         CVMCstackBuffer(ee) = (char *)malloc(CVM_CSTACK_BUF_SIZE); 	\
+        CVMCstackBufferSize(ee) = CVM_CSTACK_BUF_SIZE;			\
     }									\
     buf = CVMCstackBuffer(ee);						\
     if (buf != NULL) {							\
@@ -106,6 +110,34 @@ typedef enum {
     }									\
  }
 
+/*
+ * Like CVMCstackGetBuffer(), but first try to grow the EE-buffer to
+ * hold 'size' bytes (at most CVM_CSTACK_BUF_MAX_SIZE). The grown buffer
+ * is kept until the thread exits, so bulk IO does not malloc and free
+ * a buffer on every call. If growing fails the old buffer is returned,
+ * so callers must use CVMCstackBufferSize(ee) as the usable size.
+ */
+#define CVMCstackGetBufferOfSize(ee, buf, size) {			\
+    CVMUint32 wanted_ = (CVMUint32)(size);				\
+    CVMassert(wanted_ <= CVM_CSTACK_BUF_MAX_SIZE);			\
+    if (!CVMCstackBufferIsNull(ee) &&					\
+	wanted_ > CVMCstackBufferSize(ee)) {				\
+        char *newBuf_ = (char *)malloc(wanted_);			\
+        if (newBuf_ != NULL) {						\
+            free(CVMCstackBuffer(ee));					\
+            CVMCstackBuffer(ee) = newBuf_;				\
+            CVMCstackBufferSize(ee) = wanted_;				\
+        }								\
+    } else if (CVMCstackBufferIsNull(ee) &&				\
+	       wanted_ > CVM_CSTACK_BUF_SIZE) {				\
+        CVMCstackBuffer(ee) = (char *)malloc(wanted_);			\
+        if (!CVMCstackBufferIsNull(ee)) {				\
+            CVMCstackBufferSize(ee) = wanted_;				\
+        }								\
+    }									\
+    CVMCstackGetBuffer(ee, buf);					\
+ }
+
 /* 
  * Deallocate the EE-buffer when a thread is killed.
  * Assert that the flag is not set before freeing the EE-buffer.
@@ -182,6 +214,7 @@ struct CVMExecEnv {
 				 * input stream into a global pool for
 				 * Java_java_io_FileInputStream_readBytes
 				 * Java_java_io_RandomAccessFile_readBytes */
+    CVMUint32 cstackBufferSize;	/* current size of cstackBuffer */
 
     void * nativeRunInfo;	/* for "system" threads */
 
@@ -352,11 +352,44 @@ typedef struct CVMCCMCodeCacheCopyEntry {
    NOTE: CVM_MAX_INVOKE_VIRTUAL_HINTS and CVM_MAX_INVOKE_INTERFACE_HINTS must
          be a number equal to some power of 2.
 */
-#define CVM_MAX_INVOKE_VIRTUAL_HINTS    128
-#define CVM_MAX_INVOKE_INTERFACE_HINTS  64
+#define CVM_MAX_INVOKE_VIRTUAL_HINTS    256
+#define CVM_MAX_INVOKE_INTERFACE_HINTS  128
 #define CVM_VHINT_MASK                  (CVM_MAX_INVOKE_VIRTUAL_HINTS - 1)
 #define CVM_IHINT_MASK                  (CVM_MAX_INVOKE_INTERFACE_HINTS - 1)
 
+/* Bytecode pcs of call sites are at least 1 byte apart, but an invoke
+   is 3 or 5 bytes long, so drop the low bit when hashing the pc. */
+#define CVM_HINT_HASH(pc)               (((CVMAddr)(pc)) >> 1)
+
+/* Saturation limit for the confidence count of a receiver hint, and the
+   minimum confidence the JIT requires before it trusts a hint. */
+#define CVM_HINT_MAX_COUNT              15
+#define CVM_HINT_MIN_COUNT              2
+
+/*
+ * CVMJITInvokeHint - per call site receiver profile collected by the
+ * interpreter for invokevirtual and invokeinterface.
+ *
+ * Each entry is tagged with the pc of the call site that owns it, so a
+ * hash collision never hands the JIT another site's receiver. The
+ * receiver is chosen by majority vote: a hit on the recorded mb bumps
+ * the count, any other mb (or another call site mapping to the same
+ * entry) decrements it, and the entry is only replaced once the count
+ * drops to zero. A polymorphic site therefore keeps its dominant target
+ * instead of whichever receiver happened to be seen last, and a
+ * megamorphic site never builds enough confidence to be inlined.
+ *
+ * The entries are updated without locking. A torn read can at worst
+ * pair a pc with a stale mb, which the JIT rejects when it checks the
+ * hint against the method table of the prototype.
+ */
+typedef struct CVMJITInvokeHint CVMJITInvokeHint;
+struct CVMJITInvokeHint {
+    const CVMUint8 *pc;         /* call site owning this entry */
+    CVMMethodBlock *mb;         /* dominant target seen at pc */
+    CVMUint32 count;            /* confidence in mb */
+};
+
 /*********************************************************************
  * CVMJITGlobalState - where all the jit globals go.
  *********************************************************************/
@@ -507,8 +540,8 @@ typedef struct {
 #endif /* CVMJIT_INTRINSICS */
 
     /* Cache of inlining hints: */
-    CVMMethodBlock *invokevirtualMBTargets[CVM_MAX_INVOKE_VIRTUAL_HINTS];
-    CVMMethodBlock *invokeinterfaceMBTargets[CVM_MAX_INVOKE_INTERFACE_HINTS];
+    CVMJITInvokeHint invokevirtualMBTargets[CVM_MAX_INVOKE_VIRTUAL_HINTS];
+    CVMJITInvokeHint invokeinterfaceMBTargets[CVM_MAX_INVOKE_INTERFACE_HINTS];
 
 #ifdef CVM_DEBUG_ASSERTS
     /* Memory Fence Blocks list for the JIT long lived memory: */
@@ -618,47 +651,73 @@ extern void
 CVMjitPrintUsage();
 
 
+/* Purpose: Records one observation of mb as the target invoked from pc
+            in the given hint entry. */
+#define CVMjitRecordInvokeHint(hint, pc_, mb_) {			\
+    CVMJITInvokeHint *hint_ = (hint);					\
+    if (hint_->pc == (pc_) && hint_->mb == (mb_)) {			\
+        if (hint_->count < CVM_HINT_MAX_COUNT) {			\
+            hint_->count++;						\
+        }								\
+    } else if (hint_->count > 0) {					\
+        hint_->count--;							\
+    } else {								\
+        hint_->pc = (pc_);						\
+        hint_->mb = (mb_);						\
+        hint_->count = 1;						\
+    }									\
+}
+
+/* Purpose: Returns the dominant target recorded for pc in the given hint
+            entry, or NULL if the entry belongs to another call site or
+            the site has not shown a dominant target yet. */
+#define CVMjitLookupInvokeHint(hint, pc_)				\
+    (((hint)->pc == (pc_) && (hint)->count >= CVM_HINT_MIN_COUNT)	\
+     ? (hint)->mb : NULL)
+
 /* Purpose: Records the mb that was actually invoked from the specified pc. */
 extern void
 CVMjitSetInvokeVirtualHint(CVMExecEnv *ee, const CVMUint8 *pc,
                            CVMMethodBlock *mb);
-#define CVMjitSetInvokeVirtualHint(ee, pc, mb) \
-    (CVMglobals.jit.invokevirtualMBTargets[(CVMUint32)(pc) & CVM_VHINT_MASK] \
-         = (mb))
+#define CVMjitSetInvokeVirtualHint(ee, pc, mb)				\
+    CVMjitRecordInvokeHint(&CVMglobals.jit.invokevirtualMBTargets[	\
+        CVM_HINT_HASH(pc) & CVM_VHINT_MASK], (pc), (mb))
 
-/* Purpose: Gets the mb that was actually invoked from the specified pc. */
+/* Purpose: Gets the mb that was mostly invoked from the specified pc. */
 extern CVMMethodBlock *
 CVMjitGetInvokeVirtualHint(CVMExecEnv *ee, const CVMUint8 *pc);
-#define CVMjitGetInvokeVirtualHint(ee, pc) \
-    (CVMglobals.jit.invokevirtualMBTargets[(CVMUint32)(pc) & CVM_VHINT_MASK])
+#define CVMjitGetInvokeVirtualHint(ee, pc)				\
+    CVMjitLookupInvokeHint(&CVMglobals.jit.invokevirtualMBTargets[	\
+        CVM_HINT_HASH(pc) & CVM_VHINT_MASK], (pc))
 
 /* Purpose: Invalidates all mbs in the hint table. */
 extern void
 CVMjitInvalidateInvokeVirtualHints(CVMClassBlock *cb);
 #define CVMjitInvalidateInvokeVirtualHints(cb) \
     memset(CVMglobals.jit.invokevirtualMBTargets, 0, \
-           (sizeof(CVMMethodBlock *) * CVM_MAX_INVOKE_VIRTUAL_HINTS))
+           (sizeof(CVMJITInvokeHint) * CVM_MAX_INVOKE_VIRTUAL_HINTS))
 
 /* Purpose: Records the mb that was actually invoked from the specified pc. */
 extern void
 CVMjitSetInvokeInterfaceHint(CVMExecEnv *ee, const CVMUint8 *pc,
                              CVMMethodBlock *mb);
-#define CVMjitSetInvokeInterfaceHint(ee, pc, mb) \
-    (CVMglobals.jit.invokeinterfaceMBTargets[(CVMUint32)(pc) & CVM_IHINT_MASK]\
-         = (mb))
+#define CVMjitSetInvokeInterfaceHint(ee, pc, mb)			\
+    CVMjitRecordInvokeHint(&CVMglobals.jit.invokeinterfaceMBTargets[	\
+        CVM_HINT_HASH(pc) & CVM_IHINT_MASK], (pc), (mb))
 
-/* Purpose: Gets the mb that was actually invoked from the specified pc. */
+/* Purpose: Gets the mb that was mostly invoked from the specified pc. */
 extern CVMMethodBlock *
 CVMjitGetInvokeInterfaceHint(CVMExecEnv *ee, const CVMUint8 *pc);
-#define CVMjitGetInvokeInterfaceHint(ee, pc) \
-    (CVMglobals.jit.invokeinterfaceMBTargets[(CVMUint32)(pc) & CVM_IHINT_MASK])
+#define CVMjitGetInvokeInterfaceHint(ee, pc)				\
+    CVMjitLookupInvokeHint(&CVMglobals.jit.invokeinterfaceMBTargets[	\
+        CVM_HINT_HASH(pc) & CVM_IHINT_MASK], (pc))
 
 /* Purpose: Invalidates all mbs in the hint table. */
 extern void
 CVMjitInvalidateInvokeInterfaceHints(CVMClassBlock *cb);
 #define CVMjitInvalidateInvokeInterfaceHints(cb) \
     memset(CVMglobals.jit.invokeinterfaceMBTargets, 0, \
-           (sizeof(CVMMethodBlock *) * CVM_MAX_INVOKE_INTERFACE_HINTS))
+           (sizeof(CVMJITInvokeHint) * CVM_MAX_INVOKE_INTERFACE_HINTS))
 
 
 #ifdef CVM_JIT_ESTIMATE_COMPILATION_SPEED
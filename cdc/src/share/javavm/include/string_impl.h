@@ -107,9 +107,15 @@ struct java_lang_String_compressed {
  * 	CVMStringICell	data[capacity];
  * 	CVMUint8	refCount[capacity];
  *	struct CVMInternSegment * next;
+ *	CVMUint32	hash[capacity];
  * } CVMInternSegment;
  * except that read-only segments, of course, have a next cell
- * separate from the data.
+ * separate from the data, and have no hash array.
+ *
+ * The hash array holds the hash value of the String in the
+ * corresponding data slot, so that probes can skip most mismatches
+ * without touching the String object. It is only present in
+ * dynamically allocated segments (even maxLoad).
  *
  * Access to the variable-offset part is through macros.
  */
@@ -127,6 +133,8 @@ typedef struct CVMInternSegment {
 
 #define CVMInternRefCount(hp) ( (CVMUint8*)(&((hp)->data[(hp)->capacity])) )
 #define CVMInternNext(hp) ( *(hp->nextp) )
+#define CVMInternHashes(hp) \
+	( ((hp)->maxLoad & 1) ? NULL : (CVMUint32*)((hp)->nextp + 1) )
 
 #define CVMInternUnused		255
 #define CVMInternSticky		254
@@ -683,9 +683,7 @@ CVMclassCreateMultiArrayClass(CVMExecEnv* ee, CVMClassTypeID arrayTypeId,
     		elemCb = CVMpreloaderLookupFromType(ee, elemTypeID, NULL);
 	    }
 	    if (elemCb == NULL) {
-		CVM_LOADERCACHE_LOCK(ee);
-		elemCb = CVMloaderCacheLookup(ee, elemTypeID, loader);
-		CVM_LOADERCACHE_UNLOCK(ee);
+		elemCb = CVMloaderCacheLookupNoLock(ee, elemTypeID, loader);
 	    }
 
 	    /* If we've found the element cb, then we're done because we can
@@ -1564,6 +1562,14 @@ CVMclassCreateInternalClass(CVMExecEnv* ee,
 	    }
 	}
     }
+
+#ifndef CVM_TRUSTED_CLASSLOADERS
+    /* Skip bytecode verification if it passed in an earlier run. */
+    if (context->needsVerify && !isRedefine) {
+	CVMclassVerifyCacheLookup(ee, cb, buffer, bufferLength);
+    }
+#endif
+
     /* 
      * The class is loaded and verified to be structually correct.
      * From this point on the responsibility of freeing malloc'ed
@@ -2619,6 +2625,10 @@ CVMclassFree(CVMExecEnv* ee, CVMClassBlock* cb)
     /* Free the class table slot */
     CVMclassTableFreeSlot(ee, CVMcbClassTableSlotPtr(cb));
 
+#ifndef CVM_TRUSTED_CLASSLOADERS
+    CVMclassVerifyCacheForget(ee, cb);
+#endif
+
 #ifdef CVM_DEBUG
     CVMassert(!CVMcbIsInROM(cb));
     if (CVMcbClassNameString(cb) != NULL) {
@@ -62,9 +62,7 @@ CVMclassGetArrayOfWithNoClassCreation(CVMExecEnv* ee, CVMClassBlock* elemCb)
 	CVMClassBlock* arrayCb = NULL;
 
 	if (arrayCb == NULL) {
-	    CVM_LOADERCACHE_LOCK(ee);
-	    arrayCb = CVMloaderCacheLookup(ee, arrayID, loader);
-	    CVM_LOADERCACHE_UNLOCK(ee);
+	    arrayCb = CVMloaderCacheLookupNoLock(ee, arrayID, loader);
 	}
 
 	CVMtypeidDisposeClassID(ee, arrayID);
@@ -189,8 +189,16 @@ CVMclassLink(CVMExecEnv* ee, CVMClassBlock* cb, CVMBool isRedefine)
 
     /* Verify the class if necessary. */
     if (CVMloaderNeedsVerify(ee, CVMcbClassLoader(cb), CVM_TRUE)) {
-	CVMBool verified = CVM_FALSE;
+	CVMBool verified;
         CVMBool isMidletClass = CVM_FALSE;
+#ifndef CVM_TRUSTED_CLASSLOADERS
+	/* The supertypes are linked, so the verification cache can
+	 * tell if cb passed verification in an earlier run. */
+	if (!isRedefine) {
+	    CVMclassVerifyCacheCheck(ee, cb);
+	}
+#endif
+	verified = CVMcbCheckRuntimeFlag(cb, VERIFIED);
 #ifdef CVM_DUAL_STACK
         CVMD_gcUnsafeExec(ee, {
             isMidletClass = CVMclassloaderIsMIDPClassLoader(
@@ -207,7 +215,11 @@ CVMclassLink(CVMExecEnv* ee, CVMClassBlock* cb, CVMBool isRedefine)
          * Redefined classes use full verifier since Netbeans doesn't
          * copy stackmaps to new methods.
 	 */
-	if (CVMglobals.splitVerify && !isRedefine &&
+	if (verified) {
+	    if (CVMsplitVerifyClassHasMaps(ee, cb)) {
+		CVMsplitVerifyClassDeleteMaps(cb);
+	    }
+	} else if (CVMglobals.splitVerify && !isRedefine &&
             (CVMsplitVerifyClassHasMaps(ee, cb) ||
              isMidletClass ||
              cb->major_version >= 50))
@@ -238,6 +250,9 @@ CVMclassLink(CVMExecEnv* ee, CVMClassBlock* cb, CVMBool isRedefine)
 	    success = CVM_FALSE;
 	    goto unlock;
 	}
+#ifndef CVM_TRUSTED_CLASSLOADERS
+	CVMclassVerifyCacheAdd(ee, cb);
+#endif
     }
 
     /* The verification process may have (recursively) prepared cb. */
@@ -46,6 +46,7 @@
 #include "javavm/include/porting/io.h"
 #include "javavm/include/porting/path.h"
 #include "native/java/util/zip/zip_util.h"
+#include "zlib.h"
 #include "native/common/jni_util.h"
 
 #ifdef __cplusplus
@@ -1624,4 +1625,133 @@ CVMclassloaderIsMIDPClassLoader(CVMExecEnv *ee,
 }
 #endif
 
+
+/*
+ * Write the names of the initialized classes that were dynamically loaded
+ * by the boot and application class loaders to fileName, in the format
+ * read by sun.misc.Warmup -initClasses. Feeding the list back to an mtask
+ * server preloads these classes in the server process, so every task
+ * forked from it shares the parsed and linked class data instead of
+ * loading it again.
+ */
+typedef struct {
+    CVMInt32 fd;
+    CVMBool  appLoader;	 /* dump AppClassLoader classes, else boot ones */
+    CVMBool  failed;
+} CVMClassListDumpData;
+
+static void
+CVMclassDumpClassListCallback(CVMExecEnv* ee, CVMClassBlock* cb, void* data)
+{
+    CVMClassListDumpData* dump = (CVMClassListDumpData*)data;
+    CVMClassLoaderICell* loader = CVMcbClassLoader(cb);
+    char buf[1024];
+    CVMInt32 len;
+
+    if (dump->failed || CVMisArrayClass(cb) ||
+	!CVMcbInitializationDoneFlag(ee, cb)) {
+	return;
+    }
+    if (loader == NULL) {
+	if (dump->appLoader) {
+	    return;
+	}
+    } else {
+	CVMClassBlock* loaderCb;
+	if (!dump->appLoader) {
+	    return;
+	}
+	CVMID_objectGetClass(ee, loader, loaderCb);
+	if (loaderCb != CVMsystemClass(sun_misc_Launcher_AppClassLoader)) {
+	    return;
+	}
+    }
+
+    CVMformatString(buf, sizeof(buf), "%C\n", cb);
+    len = (CVMInt32)strlen(buf);
+    if (CVMioWrite(dump->fd, buf, len) != len) {
+	dump->failed = CVM_TRUE;
+    }
+}
+
+void
+CVMclassDumpClassList(CVMExecEnv* ee, const char* fileName)
+{
+    static const char bootHeader[] =
+	"# Classes loaded by the boot and application class loaders.\n"
+	"# Use with sun.misc.Warmup -initClasses.\n"
+	"CLASSLOADER=\n";
+    static const char appHeader[] =
+	"CLASSLOADER=sun.misc.Launcher$AppClassLoader\n";
+    CVMClassListDumpData dump;
+
+    dump.fd = CVMioOpen(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dump.fd < 0) {
+	CVMconsolePrintf("Cannot open class list file \"%s\"\n", fileName);
+	return;
+    }
+    dump.failed = CVM_FALSE;
+
+    CVM_CLASSTABLE_LOCK(ee);
+    if (CVMioWrite(dump.fd, bootHeader, sizeof(bootHeader) - 1) !=
+	sizeof(bootHeader) - 1) {
+	dump.failed = CVM_TRUE;
+    }
+    dump.appLoader = CVM_FALSE;
+    CVMclassIterateDynamicallyLoadedClasses(ee,
+	CVMclassDumpClassListCallback, &dump);
+    if (!dump.failed &&
+	CVMioWrite(dump.fd, appHeader, sizeof(appHeader) - 1) !=
+	sizeof(appHeader) - 1) {
+	dump.failed = CVM_TRUE;
+    }
+    dump.appLoader = CVM_TRUE;
+    CVMclassIterateDynamicallyLoadedClasses(ee,
+	CVMclassDumpClassListCallback, &dump);
+    CVM_CLASSTABLE_UNLOCK(ee);
+
+    CVMioClose(dump.fd);
+    if (dump.failed) {
+	CVMconsolePrintf("Error writing class list file \"%s\"\n", fileName);
+    }
+}
+
+
+/*
+ * Fold everything that identifies the classes reachable through path
+ * into *crc: the path string, the kind of each entry, and the size and
+ * CRC of every member of each zip/jar file (straight from the central
+ * directory, so nothing is inflated). Used by the verification cache to
+ * notice a changed class path. Returns CVM_FALSE if the path contains a
+ * directory, since there is no cheap way to tell if its files changed.
+ */
+CVMBool
+CVMclassPathFingerprint(CVMClassPath* path, CVMUint32* crc)
+{
+    CVMUint16 i;
+
+    if (path->pathString != NULL) {
+	*crc = crc32(*crc, (const Bytef*)path->pathString,
+		     strlen(path->pathString));
+    }
+    for (i = 0; i < path->numEntries; i++) {
+	CVMClassPathEntry* entry = &path->entries[i];
+	CVMUint32 type = entry->type;
+	*crc = crc32(*crc, (const Bytef*)&type, sizeof(type));
+	if (entry->type == CVM_CPE_DIR) {
+	    return CVM_FALSE;
+	}
+	if (entry->type == CVM_CPE_ZIP) {
+	    jzfile* zip = entry->zip;
+	    jint j;
+	    for (j = 0; j < zip->total; j++) {
+		jzcell* ze = &zip->entries[j];
+		*crc = crc32(*crc, (const Bytef*)&ze->size, sizeof(ze->size));
+		*crc = crc32(*crc, (const Bytef*)&ze->crc, sizeof(ze->crc));
+	    }
+	}
+    }
+    return CVM_TRUE;
+}
+
 #endif /* CVM_CLASSLOADING */
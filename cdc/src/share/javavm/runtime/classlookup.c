@@ -81,9 +81,7 @@ CVMclassLookupClassWithoutLoading(CVMExecEnv* ee, CVMClassTypeID typeID,
     }
 
     /* See if it is in the loader cache */
-    CVM_LOADERCACHE_LOCK(ee);
-    cb = CVMloaderCacheLookup(ee, typeID, loader);
-    CVM_LOADERCACHE_UNLOCK(ee);
+    cb = CVMloaderCacheLookupNoLock(ee, typeID, loader);
 
     return cb;
 }
@@ -259,9 +257,7 @@ CVMclassLookupFromClassLoader(CVMExecEnv* ee,
     /* 
      * See if the class is already in the loader cache.
      */
-    CVM_LOADERCACHE_LOCK(ee);
-    cb = CVMloaderCacheLookup(ee, typeID, loader);
-    CVM_LOADERCACHE_UNLOCK(ee);
+    cb = CVMloaderCacheLookupNoLock(ee, typeID, loader);
 
     /*
      * If the class isn't already in the loader cache then load it if
@@ -39,6 +39,10 @@
 #include "javavm/export/jvm.h"
 #include "javavm/export/jni.h"
 #include "generated/offsets/java_lang_ClassLoader.h"
+#include "javavm/include/preloader.h"
+#include "javavm/include/porting/io.h"
+#include "javavm/include/porting/path.h"
+#include "zlib.h"
 
 /*
  * Returns one of the VERIFY options.
@@ -189,4 +193,515 @@ CVMclassVerify(CVMExecEnv* ee, CVMClassBlock* cb, CVMBool isRedefine)
 #endif /* CVM_TRUSTED_CLASSLOADERS */
 }
 
+
+#ifndef CVM_TRUSTED_CLASSLOADERS
+
+/*
+ * Persistent verification cache.
+ *
+ * With -Xopt:verifyCache=<file>, classes defined by the application
+ * class loader are identified by a key made of a digest of their class
+ * file bytes (length, CRC-32 and Adler-32), their defining loader, and
+ * a digest of their direct supertypes: the name of each one defined by
+ * the boot loader, and the full key of each one defined by the
+ * application loader. The supertypes are only known once they are
+ * linked, so the bytes are digested when the class is created and the
+ * key is finished and looked up just before the class would be
+ * verified. The keys of classes that passed verification are written
+ * to the file at exit, and in a later run a class with a matching key
+ * is marked VERIFIED, so neither verifier runs on it. A class with a
+ * supertype from any other loader is not cached.
+ *
+ * The file is tagged with a fingerprint of this VM build, of the
+ * contents of the boot and application class paths and of the
+ * extension directories, and is discarded if any of them changed. The
+ * cache is not used at all if a class path has a directory entry, or
+ * if an extension directory exists, since there is no cheap way to
+ * tell if the files in a directory changed. The digest is not a
+ * cryptographic hash; like the class path itself, the cache file has
+ * to be trusted.
+ */
+
+#define CVM_VERIFY_CACHE_MAGIC		0x43564d56	/* "CVMV" */
+#define CVM_VERIFY_CACHE_VERSION	2
+#define CVM_VERIFY_CACHE_MIN_SIZE	256	/* power of 2 */
+#define CVM_VERIFY_CACHE_IO_CHUNK	64
+#define CVM_VERIFY_CACHE_CLASS_BUCKETS	256	/* power of 2 */
+
+/* Defining loaders, as recorded in keys and supertype digests */
+#define CVM_VERIFY_CACHE_BOOT_LOADER	0
+#define CVM_VERIFY_CACHE_APP_LOADER	1
+
+typedef struct CVMVerifyCacheDigest {
+    CVMUint32 length;		/* 0 for an empty table slot */
+    CVMUint32 crc;
+    CVMUint32 adler;
+    CVMUint32 loader;
+    CVMUint32 supers;		/* digest of the direct supertypes */
+} CVMVerifyCacheDigest;
+
+/*
+ * An application class created while the cache is enabled. The record
+ * lives as long as the class does, since the keys of its subclasses
+ * are made from its key.
+ */
+typedef struct CVMVerifyCacheClass {
+    CVMClassBlock*              cb;
+    CVMVerifyCacheDigest        digest;
+    CVMBool                     resolved;   /* digest.supers is set */
+    struct CVMVerifyCacheClass* next;
+} CVMVerifyCacheClass;
+
+static CVMBool
+CVMverifyCacheIsAppClass(CVMExecEnv* ee, CVMClassBlock* cb)
+{
+    CVMClassLoaderICell* loader = CVMcbClassLoader(cb);
+    CVMClassBlock* loaderCb;
+
+    if (loader == NULL) {
+	return CVM_FALSE;
+    }
+    CVMID_objectGetClass(ee, loader, loaderCb);
+    return loaderCb == CVMsystemClass(sun_misc_Launcher_AppClassLoader);
+}
+
+/*
+ * Return the slot holding d, or the empty slot where it would go.
+ */
+static CVMVerifyCacheDigest*
+CVMverifyCacheFind(CVMVerifyCacheDigest* table, CVMUint32 size,
+		   const CVMVerifyCacheDigest* d)
+{
+    CVMUint32 i = (d->crc ^ d->adler ^ d->supers) & (size - 1);
+
+    while (table[i].length != 0) {
+	if (table[i].length == d->length && table[i].crc == d->crc &&
+	    table[i].adler == d->adler && table[i].loader == d->loader &&
+	    table[i].supers == d->supers) {
+	    break;
+	}
+	i = (i + 1) & (size - 1);
+    }
+    return &table[i];
+}
+
+static CVMBool
+CVMverifyCacheInsert(const CVMVerifyCacheDigest* d)
+{
+    CVMVerifyCacheDigest* slot;
+
+    if ((CVMglobals.verifyCache.count + 1) * 2 >
+	CVMglobals.verifyCache.tableSize) {
+	CVMVerifyCacheDigest* oldTable = CVMglobals.verifyCache.table;
+	CVMUint32 oldSize = CVMglobals.verifyCache.tableSize;
+	CVMUint32 newSize = (oldSize == 0) ?
+	    CVM_VERIFY_CACHE_MIN_SIZE : oldSize * 2;
+	CVMVerifyCacheDigest* newTable = (CVMVerifyCacheDigest*)
+	    calloc(newSize, sizeof(CVMVerifyCacheDigest));
+	CVMUint32 i;
+
+	if (newTable == NULL) {
+	    return CVM_FALSE;
+	}
+	for (i = 0; i < oldSize; i++) {
+	    if (oldTable[i].length != 0) {
+		*CVMverifyCacheFind(newTable, newSize, &oldTable[i]) =
+		    oldTable[i];
+	    }
+	}
+	free(oldTable);
+	CVMglobals.verifyCache.table = newTable;
+	CVMglobals.verifyCache.tableSize = newSize;
+    }
+
+    slot = CVMverifyCacheFind(CVMglobals.verifyCache.table,
+			      CVMglobals.verifyCache.tableSize, d);
+    if (slot->length == 0) {
+	*slot = *d;
+	CVMglobals.verifyCache.count++;
+	CVMglobals.verifyCache.dirty = CVM_TRUE;
+    }
+    return CVM_TRUE;
+}
+
+/*
+ * Return the link that points to the record for cb, or to the NULL at
+ * the end of its bucket.
+ */
+static CVMVerifyCacheClass**
+CVMverifyCacheFindClass(CVMClassBlock* cb)
+{
+    CVMVerifyCacheClass** pp = &CVMglobals.verifyCache.classes[
+	((CVMAddr)cb >> 4) & (CVM_VERIFY_CACHE_CLASS_BUCKETS - 1)];
+
+    while (*pp != NULL && (*pp)->cb != cb) {
+	pp = &(*pp)->next;
+    }
+    return pp;
+}
+
+/*
+ * Fold the extension directories into *crc. Returns CVM_FALSE if one
+ * of them exists, since the extension class loader defines a class for
+ * every file in it and there is no portable way to list them here.
+ */
+static CVMBool
+CVMverifyCacheExtDirsFingerprint(CVMUint32* crc)
+{
+    const char* extDirs = CVMglobals.verifyCache.extDirs;
+    const char* sep = CVM_PATH_CLASSPATH_SEPARATOR;
+    CVMBool result = CVM_TRUE;
+    char* dirs;
+    char* dir;
+
+    if (extDirs == NULL) {
+	extDirs = CVMgetProperties()->ext_dirs;
+    }
+    if (extDirs == NULL || *extDirs == '\0') {
+	return CVM_TRUE;
+    }
+    *crc = crc32(*crc, (const Bytef*)extDirs, strlen(extDirs));
+
+    dirs = strdup(extDirs);
+    if (dirs == NULL) {
+	return CVM_FALSE;
+    }
+    for (dir = dirs; result && dir != NULL; ) {
+	char* end = strstr(dir, sep);
+	if (end != NULL) {
+	    *end = '\0';
+	}
+	if (*dir != '\0' && CVMioFileType(dir) >= 0) {
+	    result = CVM_FALSE;
+	}
+	dir = (end != NULL) ? end + strlen(sep) : NULL;
+    }
+    free(dirs);
+    return result;
+}
+
+/*
+ * Compute the fingerprint and read the cache file if it matches.
+ * Called with the verify cache lock held.
+ */
+static void
+CVMverifyCacheInit()
+{
+    static const char buildStamp[] = __DATE__ " " __TIME__;
+    CVMVerifyCacheDigest buf[CVM_VERIFY_CACHE_IO_CHUNK];
+    CVMUint32 header[4];
+    CVMUint32 fingerprint;
+    CVMUint32 remaining;
+    CVMInt32 fd;
+
+    CVMglobals.verifyCache.initialized = CVM_TRUE;
+
+    fingerprint = crc32(0L, Z_NULL, 0);
+    fingerprint = crc32(fingerprint, (const Bytef*)buildStamp,
+			sizeof(buildStamp) - 1);
+    if (!CVMclassPathFingerprint(&CVMglobals.bootClassPath, &fingerprint) ||
+	!CVMclassPathFingerprint(&CVMglobals.appClassPath, &fingerprint)) {
+	CVMtraceClassLoading(("CL: Verify cache disabled, "
+			      "class path has a directory\n"));
+	return;
+    }
+    if (!CVMverifyCacheExtDirsFingerprint(&fingerprint)) {
+	CVMtraceClassLoading(("CL: Verify cache disabled, "
+			      "extension directory exists\n"));
+	return;
+    }
+    CVMglobals.verifyCache.classes = (CVMVerifyCacheClass**)
+	calloc(CVM_VERIFY_CACHE_CLASS_BUCKETS, sizeof(CVMVerifyCacheClass*));
+    if (CVMglobals.verifyCache.classes == NULL) {
+	return;
+    }
+    CVMglobals.verifyCache.fingerprint = fingerprint;
+    CVMglobals.verifyCache.enabled = CVM_TRUE;
+
+    fd = CVMioOpen(CVMglobals.config.verifyCache, O_RDONLY, 0);
+    if (fd < 0) {
+	return;
+    }
+    if (CVMioRead(fd, header, sizeof(header)) != sizeof(header) ||
+	header[0] != CVM_VERIFY_CACHE_MAGIC ||
+	header[1] != CVM_VERIFY_CACHE_VERSION ||
+	header[2] != fingerprint) {
+	CVMtraceClassLoading(("CL: Verify cache file is stale, ignored\n"));
+	CVMioClose(fd);
+	return;
+    }
+    remaining = header[3];
+    while (remaining > 0) {
+	CVMUint32 n = (remaining < CVM_VERIFY_CACHE_IO_CHUNK) ?
+	    remaining : CVM_VERIFY_CACHE_IO_CHUNK;
+	CVMUint32 i;
+	if (CVMioRead(fd, buf, n * sizeof(buf[0])) !=
+	    (CVMInt32)(n * sizeof(buf[0]))) {
+	    break;
+	}
+	for (i = 0; i < n; i++) {
+	    if (buf[i].length == 0 || !CVMverifyCacheInsert(&buf[i])) {
+		break;
+	    }
+	}
+	if (i < n) {
+	    break;
+	}
+	remaining -= n;
+    }
+    CVMioClose(fd);
+    /* Only rewrite the file if it was short or new keys get added */
+    CVMglobals.verifyCache.dirty = (remaining > 0);
+}
+
+void
+CVMclassVerifyCacheLookup(CVMExecEnv* ee, CVMClassBlock* cb,
+			  const CVMUint8* classBytes, CVMUint32 classSize)
+{
+    CVMVerifyCacheClass* c;
+
+    if (CVMglobals.config.verifyCache == NULL || classSize == 0 ||
+	!CVMverifyCacheIsAppClass(ee, cb)) {
+	return;
+    }
+    /* If we are out of memory, the class just won't be cached */
+    c = (CVMVerifyCacheClass*)malloc(sizeof(CVMVerifyCacheClass));
+    if (c == NULL) {
+	return;
+    }
+    c->cb = cb;
+    c->digest.length = classSize;
+    c->digest.crc = crc32(crc32(0L, Z_NULL, 0), classBytes, classSize);
+    c->digest.adler = adler32(adler32(0L, Z_NULL, 0), classBytes,
+			      classSize);
+    c->digest.loader = CVM_VERIFY_CACHE_APP_LOADER;
+    c->digest.supers = 0;
+    c->resolved = CVM_FALSE;
+
+    CVMsysMutexLock(ee, &CVMglobals.verifyCache.lock);
+    if (!CVMglobals.verifyCache.initialized) {
+	CVMverifyCacheInit();
+    }
+    if (CVMglobals.verifyCache.enabled) {
+	CVMVerifyCacheClass** pp = CVMverifyCacheFindClass(cb);
+	CVMassert(*pp == NULL);
+	c->next = NULL;
+	*pp = c;
+	c = NULL;
+    }
+    CVMsysMutexUnlock(ee, &CVMglobals.verifyCache.lock);
+    free(c);
+}
+
+/*
+ * Fold the identity of the supertype superCb into *crc. Returns
+ * CVM_FALSE if it was not defined by the boot loader or by the
+ * application loader while the cache was enabled. Called with the
+ * verify cache lock held.
+ */
+static CVMBool
+CVMverifyCacheFoldSuper(CVMClassBlock* superCb, CVMUint32* crc)
+{
+    CVMUint32 loader;
+
+    if (CVMcbClassLoader(superCb) == NULL) {
+	char* name =
+	    CVMtypeidClassNameToAllocatedCString(CVMcbClassName(superCb));
+	if (name == NULL) {
+	    return CVM_FALSE;
+	}
+	loader = CVM_VERIFY_CACHE_BOOT_LOADER;
+	*crc = crc32(*crc, (const Bytef*)&loader, sizeof(loader));
+	*crc = crc32(*crc, (const Bytef*)name, strlen(name));
+	free(name);
+    } else {
+	CVMVerifyCacheClass* s = *CVMverifyCacheFindClass(superCb);
+	if (s == NULL || !s->resolved) {
+	    return CVM_FALSE;
+	}
+	*crc = crc32(*crc, (const Bytef*)&s->digest, sizeof(s->digest));
+    }
+    return CVM_TRUE;
+}
+
+void
+CVMclassVerifyCacheCheck(CVMExecEnv* ee, CVMClassBlock* cb)
+{
+    CVMVerifyCacheClass** pp;
+    CVMVerifyCacheClass* c;
+    CVMBool hit = CVM_FALSE;
+
+    if (CVMglobals.verifyCache.classes == NULL) {
+	return;
+    }
+
+    CVMsysMutexLock(ee, &CVMglobals.verifyCache.lock);
+    pp = CVMverifyCacheFindClass(cb);
+    c = *pp;
+    if (c != NULL && !c->resolved) {
+	CVMUint32 supers = crc32(0L, Z_NULL, 0);
+	CVMBool cacheable = CVM_TRUE;
+	CVMUint16 i;
+
+	if (CVMcbSuperclass(cb) != NULL) {
+	    cacheable = CVMverifyCacheFoldSuper(CVMcbSuperclass(cb), &supers);
+	}
+	for (i = 0; cacheable && i < CVMcbImplementsCount(cb); i++) {
+	    cacheable = CVMverifyCacheFoldSuper(CVMcbInterfacecb(cb, i),
+						&supers);
+	}
+	if (!cacheable) {
+	    *pp = c->next;
+	    free(c);
+	} else {
+	    c->digest.supers = supers;
+	    c->resolved = CVM_TRUE;
+	    if (CVMglobals.verifyCache.tableSize != 0 &&
+		CVMverifyCacheFind(CVMglobals.verifyCache.table,
+				   CVMglobals.verifyCache.tableSize,
+				   &c->digest)->length != 0) {
+		hit = CVM_TRUE;
+		CVMglobals.verifyCache.hits++;
+	    } else {
+		CVMglobals.verifyCache.misses++;
+	    }
+	}
+    }
+    CVMsysMutexUnlock(ee, &CVMglobals.verifyCache.lock);
+
+    if (hit) {
+	CVMcbSetRuntimeFlag(cb, ee, VERIFIED);
+	CVMtraceClassLoading(("CL: Class %C found in verify cache.\n", cb));
+    }
+}
+
+void
+CVMclassVerifyCacheAdd(CVMExecEnv* ee, CVMClassBlock* cb)
+{
+    CVMVerifyCacheClass* c;
+
+    if (CVMglobals.verifyCache.classes == NULL) {
+	return;
+    }
+    CVMsysMutexLock(ee, &CVMglobals.verifyCache.lock);
+    c = *CVMverifyCacheFindClass(cb);
+    if (c != NULL && c->resolved) {
+	(void)CVMverifyCacheInsert(&c->digest);
+    }
+    CVMsysMutexUnlock(ee, &CVMglobals.verifyCache.lock);
+}
+
+void
+CVMclassVerifyCacheForget(CVMExecEnv* ee, CVMClassBlock* cb)
+{
+    CVMVerifyCacheClass** pp;
+    CVMVerifyCacheClass* c;
+
+    if (CVMglobals.verifyCache.classes == NULL) {
+	return;
+    }
+    CVMsysMutexLock(ee, &CVMglobals.verifyCache.lock);
+    pp = CVMverifyCacheFindClass(cb);
+    c = *pp;
+    if (c != NULL) {
+	*pp = c->next;
+	free(c);
+    }
+    CVMsysMutexUnlock(ee, &CVMglobals.verifyCache.lock);
+}
+
+void
+CVMclassVerifyCacheSave(CVMExecEnv* ee)
+{
+    if (CVMglobals.config.verifyCache == NULL) {
+	return;
+    }
+
+    CVMsysMutexLock(ee, &CVMglobals.verifyCache.lock);
+    if (CVMglobals.verifyCache.enabled && CVMglobals.verifyCache.dirty) {
+	const char* fileName = CVMglobals.config.verifyCache;
+	CVMVerifyCacheDigest buf[CVM_VERIFY_CACHE_IO_CHUNK];
+	CVMUint32 header[4];
+	CVMBool failed = CVM_FALSE;
+	CVMInt32 fd;
+
+	fd = CVMioOpen(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+	    CVMconsolePrintf("Cannot open verify cache file \"%s\"\n",
+			     fileName);
+	} else {
+	    CVMUint32 i, n = 0;
+	    header[0] = CVM_VERIFY_CACHE_MAGIC;
+	    header[1] = CVM_VERIFY_CACHE_VERSION;
+	    header[2] = CVMglobals.verifyCache.fingerprint;
+	    header[3] = CVMglobals.verifyCache.count;
+	    if (CVMioWrite(fd, header, sizeof(header)) != sizeof(header)) {
+		failed = CVM_TRUE;
+	    }
+	    for (i = 0; !failed && i <= CVMglobals.verifyCache.tableSize;
+		 i++) {
+		if (n == CVM_VERIFY_CACHE_IO_CHUNK ||
+		    (i == CVMglobals.verifyCache.tableSize && n > 0)) {
+		    if (CVMioWrite(fd, buf, n * sizeof(buf[0])) !=
+			(CVMInt32)(n * sizeof(buf[0]))) {
+			failed = CVM_TRUE;
+		    }
+		    n = 0;
+		}
+		if (i < CVMglobals.verifyCache.tableSize &&
+		    CVMglobals.verifyCache.table[i].length != 0) {
+		    buf[n++] = CVMglobals.verifyCache.table[i];
+		}
+	    }
+	    CVMioClose(fd);
+	    if (failed) {
+		CVMconsolePrintf("Error writing verify cache file \"%s\"\n",
+				 fileName);
+	    }
+	}
+    }
+
+    if (CVMglobals.config.verifyCacheStats) {
+	CVMconsolePrintf("Verify cache: %d hits, %d misses, %d entries%s\n",
+			 CVMglobals.verifyCache.hits,
+			 CVMglobals.verifyCache.misses,
+			 CVMglobals.verifyCache.count,
+			 CVMglobals.verifyCache.enabled ? "" : " (disabled)");
+    }
+    CVMglobals.verifyCache.dirty = CVM_FALSE;
+    CVMsysMutexUnlock(ee, &CVMglobals.verifyCache.lock);
+}
+
+void
+CVMclassVerifyCacheDestroy(CVMExecEnv* ee)
+{
+    if (CVMglobals.config.verifyCache == NULL) {
+	return;
+    }
+
+    CVMsysMutexLock(ee, &CVMglobals.verifyCache.lock);
+    if (CVMglobals.verifyCache.classes != NULL) {
+	CVMUint32 i;
+	for (i = 0; i < CVM_VERIFY_CACHE_CLASS_BUCKETS; i++) {
+	    CVMVerifyCacheClass* c;
+	    while ((c = CVMglobals.verifyCache.classes[i]) != NULL) {
+		CVMglobals.verifyCache.classes[i] = c->next;
+		free(c);
+	    }
+	}
+	free(CVMglobals.verifyCache.classes);
+	CVMglobals.verifyCache.classes = NULL;
+    }
+    free(CVMglobals.verifyCache.table);
+    CVMglobals.verifyCache.table = NULL;
+    CVMglobals.verifyCache.tableSize = 0;
+    CVMglobals.verifyCache.count = 0;
+    CVMglobals.verifyCache.enabled = CVM_FALSE;
+    free(CVMglobals.verifyCache.extDirs);
+    CVMglobals.verifyCache.extDirs = NULL;
+    CVMsysMutexUnlock(ee, &CVMglobals.verifyCache.lock);
+}
+
+#endif /* !CVM_TRUSTED_CLASSLOADERS */
+
 #endif /* CVM_CLASSLOADING */
@@ -386,6 +386,35 @@ CVMdumpStats()
 #define CVM_LOSSLESS_OPCODES
 #endif
 
+/*
+ * CVM_TOS_CACHING - if defined, the int on top of the operand stack is
+ * kept in a local variable (cachedTos) rather than in memory while
+ * straight-line int code runs. The interpreter then has two states:
+ *
+ *   uncached - the normal state, dispatched through opclabels.
+ *
+ *   int cached - entered by the int loads and constants (iload,
+ *	iload_<n>, iconst_<n>, bipush and sipush). The top of stack is
+ *	cachedTos and topOfStack does not include it. Dispatched through
+ *	opclabels_tos, which only has handlers for the int loads and
+ *	constants, the unary and binary int arithmetic and logic opcodes
+ *	that cannot throw, and istore. Any other opcode goes to
+ *	tos_spill, which pushes cachedTos and dispatches the opcode
+ *	again in the uncached state.
+ *
+ * So "iload; iload; iadd; istore" only touches the operand stack
+ * once, to spill the first value. None of the int cached handlers can
+ * throw, reach a GC point or change frames, so the rest of the
+ * interpreter never sees a cached value.
+ *
+ * This needs gcc labels. It is not used in lossless mode, where each
+ * bytecode must be dispatched on its own, or when counting instructions.
+ */
+#if defined(CVM_USELABELS) && !defined(CVM_LOSSLESS_OPCODES) && \
+    !defined(CVM_INSTRUCTION_COUNTING)
+#define CVM_TOS_CACHING
+#endif
+
 #ifdef CVM_JVMTI_ENABLED
 
 #define CVM_EXECUTE_JAVA_METHOD CVMgcUnsafeExecuteJavaMethodJVMTI
@@ -662,6 +691,21 @@ CVMdumpStats()
         DISPATCH_OPCODE();					\
     }
 
+/*
+ * TOS_LOAD - Macro used by the int loads and constants in the uncached
+ * state to cache value and switch to the int cached state.
+ */
+#undef TOS_LOAD
+#ifdef CVM_TOS_CACHING
+#define TOS_LOAD(opsize, value) {				\
+	const void* nextLabel = opclabels_tos[pc[opsize]];	\
+	cachedTos = (value);					\
+	TRACE(("\t%s %d =>\n", CVMopnames[pc[0]], cachedTos));	\
+	pc += opsize;						\
+	goto *nextLabel;					\
+    }
+#endif
+
 /*
  * CHECK_PENDING_REQUESTS - Macro for checking pending requests which need
  * to be checked periodically in the interpreter loop.
@@ -1543,6 +1587,9 @@ CVM_EXECUTE_JAVA_METHOD(CVMExecEnv* volatile ee, /* see note above */
     CVMUint8*         pc = NULL;
 #ifndef CVM_USELABELS
     CVMUint32         opcode;
+#endif
+#ifdef CVM_TOS_CACHING
+    CVMJavaInt        cachedTos = 0; /* top of stack in int cached state */
 #endif
     CVMConstantPool*  cp = NULL;
     CVMTransitionConstantPool   transitioncp;
@@ -1608,6 +1655,44 @@ CVM_EXECUTE_JAVA_METHOD(CVMExecEnv* volatile ee, /* see note above */
     };
     const void* const *opclabels = &opclabels_data[0];
 #endif /* CVM_USELABELS */
+#ifdef CVM_TOS_CACHING
+    /* Dispatch table for the int cached state. See CVM_TOS_CACHING. */
+    static const void* const opclabels_tos[256] = {
+	[0 ... 255] = &&tos_spill,
+	[opc_iload] = &&tos_iload,
+	[opc_iload_0] = &&tos_iload_0,
+	[opc_iload_1] = &&tos_iload_1,
+	[opc_iload_2] = &&tos_iload_2,
+	[opc_iload_3] = &&tos_iload_3,
+	[opc_iconst_m1] = &&tos_iconst_m1,
+	[opc_iconst_0] = &&tos_iconst_0,
+	[opc_iconst_1] = &&tos_iconst_1,
+	[opc_iconst_2] = &&tos_iconst_2,
+	[opc_iconst_3] = &&tos_iconst_3,
+	[opc_iconst_4] = &&tos_iconst_4,
+	[opc_iconst_5] = &&tos_iconst_5,
+	[opc_bipush] = &&tos_bipush,
+	[opc_sipush] = &&tos_sipush,
+	[opc_iadd] = &&tos_iadd,
+	[opc_isub] = &&tos_isub,
+	[opc_imul] = &&tos_imul,
+	[opc_iand] = &&tos_iand,
+	[opc_ior] = &&tos_ior,
+	[opc_ixor] = &&tos_ixor,
+	[opc_ishl] = &&tos_ishl,
+	[opc_ishr] = &&tos_ishr,
+	[opc_iushr] = &&tos_iushr,
+	[opc_ineg] = &&tos_ineg,
+	[opc_i2b] = &&tos_i2b,
+	[opc_i2c] = &&tos_i2c,
+	[opc_i2s] = &&tos_i2s,
+	[opc_istore] = &&tos_istore,
+	[opc_istore_0] = &&tos_istore_0,
+	[opc_istore_1] = &&tos_istore_1,
+	[opc_istore_2] = &&tos_istore_2,
+	[opc_istore_3] = &&tos_istore_3,
+    };
+#endif /* CVM_TOS_CACHING */
   
     /* C stack redzone check */
     if (!CVMCstackCheckSize(ee, CVM_REDZONE_ILOOP, 
@@ -1727,13 +1812,25 @@ new_transition:
 	    TRACE(("\t%s\n", CVMopnames[pc[0]]));			  \
             UPDATE_PC_AND_TOS_AND_CONTINUE(1, 2);
 
-	    OPC_CONST_n(opc_iconst_m1,   i,       -1);
-	    OPC_CONST_n(opc_iconst_0,    i,        0);
-	    OPC_CONST_n(opc_iconst_1,    i,        1);
-	    OPC_CONST_n(opc_iconst_2,    i,        2);
-	    OPC_CONST_n(opc_iconst_3,    i,        3);
-	    OPC_CONST_n(opc_iconst_4,    i,        4);
-	    OPC_CONST_n(opc_iconst_5,    i,        5);
+#ifdef CVM_TOS_CACHING
+	    /* Int constants and loads enter the int cached state. */
+#undef  OPC_ICONST_n
+#define OPC_ICONST_n(opcode, value)					\
+	CASE_ND(opcode)							\
+	    TOS_LOAD(1, value);
+#else
+#undef  OPC_ICONST_n
+#define OPC_ICONST_n(opcode, value)					\
+	    OPC_CONST_n(opcode, i, value)
+#endif
+
+	    OPC_ICONST_n(opc_iconst_m1, -1);
+	    OPC_ICONST_n(opc_iconst_0,   0);
+	    OPC_ICONST_n(opc_iconst_1,   1);
+	    OPC_ICONST_n(opc_iconst_2,   2);
+	    OPC_ICONST_n(opc_iconst_3,   3);
+	    OPC_ICONST_n(opc_iconst_4,   4);
+	    OPC_ICONST_n(opc_iconst_5,   5);
 
 	    OPC_CONST2_n(lconst_0, Zero, long);
 	    OPC_CONST2_n(lconst_1, One,  long);
@@ -1745,6 +1842,16 @@ new_transition:
 	    OPC_CONST2_n(dconst_0, Zero, double);
 	    OPC_CONST2_n(dconst_1, One,  double);
 
+#ifdef CVM_TOS_CACHING
+	CASE_ND(opc_bipush)
+	    TOS_LOAD(2, (CVMInt8)(pc[1]));
+
+	CASE_ND(opc_sipush)
+	    TOS_LOAD(3, CVMgetInt16(pc + 1));
+
+	CASE_ND(opc_iload)
+	    TOS_LOAD(2, locals[pc[1]].j.i);
+#else
 	    /* Push a 1-byte signed integer value onto the stack. */
 	CASE(opc_bipush, 2)
 	    STACK_INT(0) = (CVMInt8)(pc[1]);
@@ -1756,11 +1863,14 @@ new_transition:
 	    STACK_INT(0) = CVMgetInt16(pc + 1);
 	    TRACE(("\tsipush %d\n", STACK_INT(0)));
 	    UPDATE_PC_AND_TOS_AND_CONTINUE(3, 1);
+#endif
 
 	/* load from local variable */
 
 	CASE_ND(opc_aload)
+#ifndef CVM_TOS_CACHING
 	CASE_ND(opc_iload)
+#endif
 	CASE(opc_fload, 2) {
 	    CVMUint32    localNo = pc[1]; 
             CVMSlotVal32 l = locals[localNo];
@@ -1785,9 +1895,19 @@ new_transition:
 	    UPDATE_PC_AND_TOS_AND_CONTINUE(2, 2);
 	}
 
+#undef  OPC_ILOAD1_n
+#ifdef CVM_TOS_CACHING
+#define OPC_ILOAD1_n(num)						\
+	CASE_ND(opc_iload_##num)					\
+	    TOS_LOAD(1, locals[num].j.i);
+#else
+#define OPC_ILOAD1_n(num)						\
+	CASE_ND(opc_iload_##num)
+#endif
+
 #undef  OPC_LOAD1_n
 #define OPC_LOAD1_n(num)						\
-	CASE_ND(opc_iload_##num)					\
+	OPC_ILOAD1_n(num)						\
 	CASE_ND(opc_aload_##num)					\
 	CASE(opc_fload_##num, 1) {					\
             CVMSlotVal32 l;						\
@@ -1832,6 +1952,106 @@ new_transition:
 	OPC_LOAD2_n(2);
 	OPC_LOAD2_n(3);
 
+#ifdef CVM_TOS_CACHING
+	/*
+	 * Handlers for the int cached state, reached only through
+	 * opclabels_tos. See CVM_TOS_CACHING.
+	 */
+
+    tos_spill:
+	ASMLABEL(tos_spill);
+	STACK_INT(0) = cachedTos;
+	topOfStack += 1;
+	goto *opclabels[pc[0]];
+
+	/* Push the cached value and cache the new one. */
+#undef  TOS_PUSH_AND_LOAD
+#define TOS_PUSH_AND_LOAD(label, opsize, value)				\
+    label: {								\
+	const void* nextLabel = opclabels_tos[pc[opsize]];		\
+	ASMLABEL(label);						\
+	STACK_INT(0) = cachedTos;					\
+	topOfStack += 1;						\
+	cachedTos = (value);						\
+	TRACE(("\t%s %d =>\n", CVMopnames[pc[0]], cachedTos));	\
+	pc += opsize;							\
+	goto *nextLabel;						\
+    }
+
+	TOS_PUSH_AND_LOAD(tos_iload, 2, locals[pc[1]].j.i);
+	TOS_PUSH_AND_LOAD(tos_iload_0, 1, locals[0].j.i);
+	TOS_PUSH_AND_LOAD(tos_iload_1, 1, locals[1].j.i);
+	TOS_PUSH_AND_LOAD(tos_iload_2, 1, locals[2].j.i);
+	TOS_PUSH_AND_LOAD(tos_iload_3, 1, locals[3].j.i);
+	TOS_PUSH_AND_LOAD(tos_iconst_m1, 1, -1);
+	TOS_PUSH_AND_LOAD(tos_iconst_0, 1, 0);
+	TOS_PUSH_AND_LOAD(tos_iconst_1, 1, 1);
+	TOS_PUSH_AND_LOAD(tos_iconst_2, 1, 2);
+	TOS_PUSH_AND_LOAD(tos_iconst_3, 1, 3);
+	TOS_PUSH_AND_LOAD(tos_iconst_4, 1, 4);
+	TOS_PUSH_AND_LOAD(tos_iconst_5, 1, 5);
+	TOS_PUSH_AND_LOAD(tos_bipush, 2, (CVMInt8)(pc[1]));
+	TOS_PUSH_AND_LOAD(tos_sipush, 3, CVMgetInt16(pc + 1));
+
+	/* The result stays cached. */
+#undef  TOS_INT_BINARY
+#define TOS_INT_BINARY(opcname, opname)					\
+    tos_i##opcname: {							\
+	const void* nextLabel = opclabels_tos[pc[1]];			\
+	ASMLABEL(tos_i##opcname);					\
+	cachedTos = CVMint##opname(STACK_INT(-1), cachedTos);		\
+	topOfStack -= 1;						\
+	TRACE(("\t%s => %d\n", CVMopnames[pc[0]], cachedTos));	\
+	pc += 1;							\
+	goto *nextLabel;						\
+    }
+
+	TOS_INT_BINARY(add, Add);
+	TOS_INT_BINARY(sub, Sub);
+	TOS_INT_BINARY(mul, Mul);
+	TOS_INT_BINARY(and, And);
+	TOS_INT_BINARY(or, Or);
+	TOS_INT_BINARY(xor, Xor);
+	TOS_INT_BINARY(shl, Shl);
+	TOS_INT_BINARY(shr, Shr);
+	TOS_INT_BINARY(ushr, Ushr);
+
+#undef  TOS_INT_UNARY
+#define TOS_INT_UNARY(label, operation)					\
+    label: {								\
+	const void* nextLabel = opclabels_tos[pc[1]];			\
+	ASMLABEL(label);						\
+	cachedTos = operation(cachedTos);				\
+	TRACE(("\t%s => %d\n", CVMopnames[pc[0]], cachedTos));	\
+	pc += 1;							\
+	goto *nextLabel;						\
+    }
+
+	TOS_INT_UNARY(tos_ineg, CVMintNeg);
+	TOS_INT_UNARY(tos_i2b, CVMint2Byte);
+	TOS_INT_UNARY(tos_i2c, CVMint2Char);
+	TOS_INT_UNARY(tos_i2s, CVMint2Short);
+
+	/* Store the cached value and go back to the uncached state. */
+#undef  TOS_ISTORE
+#define TOS_ISTORE(label, opsize, localNo)				\
+    label: {								\
+	const void* nextLabel = opclabels[pc[opsize]];			\
+	ASMLABEL(label);						\
+	locals[localNo].j.i = cachedTos;				\
+	TRACE(("\t%s %d => locals[%d]\n", CVMopnames[pc[0]],		\
+	       cachedTos, localNo));					\
+	pc += opsize;							\
+	goto *nextLabel;						\
+    }
+
+	TOS_ISTORE(tos_istore, 2, pc[1]);
+	TOS_ISTORE(tos_istore_0, 1, 0);
+	TOS_ISTORE(tos_istore_1, 1, 1);
+	TOS_ISTORE(tos_istore_2, 1, 2);
+	TOS_ISTORE(tos_istore_3, 1, 3);
+#endif /* CVM_TOS_CACHING */
+
 	/* Array load opcodes */
 
 	/* Every array load and store opcodes starts out like this */
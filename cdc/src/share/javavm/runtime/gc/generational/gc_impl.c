@@ -988,6 +988,10 @@ CVMgcimplInitHeap(CVMGCGlobalState* gc,
 	gc->genGCAttributes.youngGenSize = size;
     }
 
+    /* Share equal String values in the oldGen during full GCs: */
+    gc->genGCAttributes.dedupStrings =
+	(CVMgcGetGCAttributeVal("dedupStrings") != NULL);
+
     /*
      * At this point, we might find that the total size of the heap is
      * smaller than the stated size of the young generation. Make the
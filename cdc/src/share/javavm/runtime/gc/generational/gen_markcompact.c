@@ -47,6 +47,7 @@
 
 #include "javavm/include/porting/system.h"
 #include "javavm/include/porting/ansi/setjmp.h"
+#include "generated/offsets/java_lang_String.h"
 #ifdef CVM_JVMTI
 #include "javavm/include/jvmtiExport.h"
 #endif
@@ -1187,6 +1188,111 @@ typedef struct CVMGenMarkCompactTransitiveScanData {
     CVMGenMarkCompactGeneration* thisGen;
 } CVMGenMarkCompactTransitiveScanData;
 
+/*
+ * String deduplication (-Xgc:dedupStrings).
+ *
+ * Equal Strings that were built separately (parsed from files, read
+ * from streams, etc.) each have their own char[]. When a String in the
+ * oldGen is blackened, we look its value up in a table of the values of
+ * the Strings blackened before it in this GC. If an equal char[] is
+ * found, the String is pointed at that one instead. Its own char[] is
+ * then no longer reached through it, and is compacted away unless
+ * something else still refers to it.
+ *
+ * Only Strings that use their whole char[] (offset 0, count == length)
+ * take part, both as candidates and as table entries, so a shared
+ * array always holds exactly the String's value. Both the String and
+ * the char[] must be in the oldGen: youngGen Strings are still likely
+ * to die, and we don't want to create new old-to-young pointers.
+ *
+ * The table is a fixed-size open addressed hash table allocated for
+ * the duration of the mark phase. When it fills up, we stop adding to
+ * it. If it cannot be allocated, this GC simply does not deduplicate.
+ */
+#define CVM_GEN_DEDUP_TABLE_SIZE	4096	/* must be a power of 2 */
+#define CVM_GEN_DEDUP_MAX_LOAD		(CVM_GEN_DEDUP_TABLE_SIZE / 4 * 3)
+#define CVM_GEN_DEDUP_MAX_LENGTH	1024	/* bounds the time per String */
+
+static void
+CVMgenMarkCompactDedupBegin(CVMGenMarkCompactGeneration* thisGen)
+{
+    CVMassert(thisGen->dedupTable == NULL);
+    if (CVMglobals.gc.genGCAttributes.dedupStrings) {
+	thisGen->dedupTable = (CVMArrayOfChar**)
+	    calloc(CVM_GEN_DEDUP_TABLE_SIZE, sizeof(CVMArrayOfChar*));
+	thisGen->dedupLoad = 0;
+    }
+}
+
+static void
+CVMgenMarkCompactDedupEnd(CVMGenMarkCompactGeneration* thisGen)
+{
+    if (thisGen->dedupTable != NULL) {
+	free(thisGen->dedupTable);
+	thisGen->dedupTable = NULL;
+    }
+}
+
+static void
+CVMgenMarkCompactDedupString(CVMGenMarkCompactGeneration* thisGen,
+			     CVMObject* stringObj)
+{
+    CVMObject* valueObj;
+    CVMArrayOfChar* value;
+    CVMJavaInt offset;
+    CVMJavaInt count;
+    CVMUint32 length;
+    CVMUint32 hash;
+    CVMUint32 i;
+
+    if (!CVMgenMarkCompactInGeneration(thisGen, stringObj)) {
+	return;
+    }
+    CVMD_fieldReadRef(stringObj, CVMoffsetOfjava_lang_String_value, valueObj);
+    if (valueObj == NULL ||
+	!CVMgenMarkCompactInGeneration(thisGen, valueObj)) {
+	return;
+    }
+    value = (CVMArrayOfChar*)valueObj;
+    length = CVMD_arrayGetLength(value);
+    CVMD_fieldReadInt(stringObj, CVMoffsetOfjava_lang_String_offset, offset);
+    CVMD_fieldReadInt(stringObj, CVMoffsetOfjava_lang_String_count, count);
+    if (offset != 0 || (CVMUint32)count != length || length == 0 ||
+	length > CVM_GEN_DEDUP_MAX_LENGTH) {
+	return;
+    }
+
+    hash = 0;
+    for (i = 0; i < length; i++) {
+	hash = hash * 31 + value->elems[i];
+    }
+
+    i = hash & (CVM_GEN_DEDUP_TABLE_SIZE - 1);
+    while (thisGen->dedupTable[i] != NULL) {
+	CVMArrayOfChar* canonical = thisGen->dedupTable[i];
+	if (canonical == value) {
+	    return;
+	}
+	if (CVMD_arrayGetLength(canonical) == length &&
+	    memcmp(canonical->elems, value->elems,
+		   length * sizeof(CVMJavaChar)) == 0) {
+	    /* The canonical array was reached through the String that
+	       entered it in the table, so it is already marked. */
+	    CVMassert(CVMobjectMarked((CVMObject*)canonical));
+	    CVMD_fieldWriteRef(stringObj, CVMoffsetOfjava_lang_String_value,
+			       (CVMObject*)canonical);
+	    CVMglobals.dedupStringCount++;
+	    CVMglobals.dedupCharBytes += length * sizeof(CVMJavaChar);
+	    return;
+	}
+	i = (i + 1) & (CVM_GEN_DEDUP_TABLE_SIZE - 1);
+    }
+    if (thisGen->dedupLoad < CVM_GEN_DEDUP_MAX_LOAD) {
+	thisGen->dedupTable[i] = value;
+	thisGen->dedupLoad++;
+    }
+}
+
 /* Scan and mark the references within an object and add them to the todo
    list if necessary. */
 static void
@@ -1206,6 +1312,11 @@ CVMgenMarkCompactBlackenObject(CVMGenMarkCompactTransitiveScanData* tsd,
      */
     CVMassert(CVMobjectMarked(ref));
 
+    if (thisGen->dedupTable != NULL &&
+	refCb == CVMsystemClass(java_lang_String)) {
+	CVMgenMarkCompactDedupString(thisGen, ref);
+    }
+
     /*
      * Queue up all non-null object references. Handle the class as well.
      */
@@ -1338,6 +1449,7 @@ CVMgenMarkCompactCollect(CVMGeneration* gen,
     /* The mark phase */
     thisGen->gcPhase = GC_PHASE_MARK;
     gcOpts->discoverWeakReferences = CVM_TRUE;
+    CVMgenMarkCompactDedupBegin(thisGen);
 
     /*
      * Scan all roots that point to this generation. The root callback is
@@ -1385,6 +1497,9 @@ CVMgenMarkCompactCollect(CVMGeneration* gen,
 					&tsd);
     gcOpts->isUpdatingObjectPointers = CVM_TRUE;
 
+    /* No more objects will be blackened: */
+    CVMgenMarkCompactDedupEnd(thisGen);
+
     /* Reset the data structure that preserves original second header
        words. We are done with the TODO stack, so we can re-use extraSpace. */
     thisGen->preservedItems = (CVMMCPreservedItem*)extraSpace->allocBase;
@@ -1475,6 +1590,10 @@ handleError:
     /* Undo side-effects of work done before error was detected: */
     if (thisGen->gcPhase == GC_PHASE_MARK) {
 
+        /* Strings already pointed at a shared char[] are left that way.
+           Their values are unchanged, so there is nothing to undo. */
+        CVMgenMarkCompactDedupEnd(thisGen);
+
         /* Undo the effects of the mark phase: */
         /* Restore all the headerwords in the todoList: */
         while (!todoListIsEmpty(thisGen)) {
@@ -50,6 +50,11 @@ CVMgcstatPrintGCStat(CVMInt64 curGCTime)
 		     CVMlong2Int(CVMgcFreeMemory(ee)));
     CVMconsolePrintf("Total memory: %d bytes\n", 
 		     CVMlong2Int(CVMgcTotalMemory(ee)));
+    if (CVMglobals.dedupStringCount != 0) {
+	CVMconsolePrintf("Deduplicated Strings: %d (%d char[] bytes)\n",
+			 CVMglobals.dedupStringCount,
+			 CVMglobals.dedupCharBytes);
+    }
     CVMconsolePrintf("\n");
     
 }
@@ -217,6 +217,9 @@ static const CVMGlobalSysMutexEntry globalSysMutexes[] = {
     CVM_SYSMUTEX_ENTRY(typeidLock, "typeid lock"),
     CVM_SYSMUTEX_ENTRY(syncLock, "fast sync lock"),
     CVM_SYSMUTEX_ENTRY(internLock, "intern table lock"),
+#if defined(CVM_CLASSLOADING) && !defined(CVM_TRUSTED_CLASSLOADERS)
+    CVM_SYSMUTEX_ENTRY(verifyCache.lock, "verify cache lock"),
+#endif
 #if defined(CVM_INSPECTOR) || defined(CVM_JVMPI) || defined(CVM_JVMTI)
     CVM_SYSMUTEX_ENTRY(gcLockerLock, "gc locker lock"),
 #endif
@@ -677,6 +680,23 @@ static const CVMSubOptionData knownOptSubOptions[] = {
 	{{1024, 1 * 1024 * 1024, 128 * 1024}},
 	&CVMglobals.config.javaStackMaxSize},
 
+#ifdef CVM_CLASSLOADING
+    {"dumpClassList", "Write loaded classes to a warmup list at exit",
+	CVM_STRING_OPTION,
+	{{0, (CVMAddr)"<filename>", 0}},
+	&CVMglobals.config.dumpClassList},
+#ifndef CVM_TRUSTED_CLASSLOADERS
+    {"verifyCache", "Skip verifying application classes recorded in file",
+	CVM_STRING_OPTION,
+	{{0, (CVMAddr)"<filename>", 0}},
+	&CVMglobals.config.verifyCache},
+    {"verifyCacheStats", "Print verification cache statistics at exit",
+	CVM_BOOLEAN_OPTION,
+	{{CVM_FALSE, CVM_TRUE, CVM_FALSE}},
+	&CVMglobals.config.verifyCacheStats},
+#endif
+#endif
+
     {NULL, NULL, CVM_NULL_OPTION, {{0, 0, 0}}, NULL}
 };
 
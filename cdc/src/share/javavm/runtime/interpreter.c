@@ -3326,10 +3326,27 @@ CVMshutdown()
     return 0;
 }
 
+/*
+ * Called on every exit path, System.exit() and Runtime.halt() included,
+ * before the process goes away.
+ */
 int
 CVMprepareToExit(void)
 {
     struct exit_proc *pExit;
+#ifdef CVM_CLASSLOADING
+    CVMExecEnv *ee = CVMgetEE();
+
+    if (ee != NULL) {
+	/* Write the class list and verify cache files */
+	if (CVMglobals.config.dumpClassList != NULL) {
+	    CVMclassDumpClassList(ee, CVMglobals.config.dumpClassList);
+	}
+#ifndef CVM_TRUSTED_CLASSLOADERS
+	CVMclassVerifyCacheSave(ee);
+#endif
+    }
+#endif
 
     pExit = CVMglobals.exit_procs;
     while (pExit != NULL) {
@@ -4259,6 +4259,16 @@ JNI_CreateJavaVM(JavaVM **p_jvm, void **p_env, void *args)
             ++numUnrecognizedOptions;
             continue;
          }
+#ifndef CVM_TRUSTED_CLASSLOADERS
+        else if (!strncmp(str, "-Djava.ext.dirs=", 16)) {
+            /* Record it for the verification cache fingerprint, and
+               pass it on to CVM.java, which sets the property. */
+            free(CVMglobals.verifyCache.extDirs);
+            CVMglobals.verifyCache.extDirs = strdup(str + 16);
+            ++numUnrecognizedOptions;
+            continue;
+        }
+#endif
         else if (!strncmp(str, "-Xcp=", 5)) {
             options.appclasspathStr = str + 5;
 
@@ -4827,6 +4837,10 @@ CVMjniDestroyJavaVM(JavaVM *vm)
 
     CVMprepareToExit();
 
+#if defined(CVM_CLASSLOADING) && !defined(CVM_TRUSTED_CLASSLOADERS)
+    CVMclassVerifyCacheDestroy(ee);
+#endif
+
     CVMpostThreadExitEvents(ee);
 #ifdef CVM_JVMTI
     if (CVMjvmtiIsEnabled()) {
@@ -3829,9 +3829,7 @@ JVM_FindLoadedClass(JNIEnv *env, jobject loader, jstring name)
 	    CVMthrowOutOfMemoryError(ee, NULL);
 	    cb = NULL;
 	} else {
-	    CVM_LOADERCACHE_LOCK(ee);
-	    cb = CVMloaderCacheLookup(ee, classTypeID, loader);
-	    CVM_LOADERCACHE_UNLOCK(ee);
+	    cb = CVMloaderCacheLookupNoLock(ee, classTypeID, loader);
 	    
 	    success = CVMgcSafeObjectUnlock(ee, loader);
 	    CVMassert(success);
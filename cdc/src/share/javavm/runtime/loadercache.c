@@ -78,6 +78,9 @@
 
 struct CVMLoaderCacheEntry {
     CVMLoaderCacheEntry* next;      /* next entry in hash bucket */
+#ifdef CVM_CLASSLOADING
+    CVMLoaderCacheEntry* retiredNext; /* next entry on the retired list */
+#endif
     CVMClassBlock*       cb;
     CVMClassLoaderICell* loader;    /* initiating loader */
     int num_pds;
@@ -762,31 +765,23 @@ CVMloaderCacheCheckPackageAccess(CVMExecEnv *ee, CVMClassLoaderICell* loader,
 #endif
 
 /*
- * Look for an entry with the specified typeID, class loader
- * and protection domain.
+ * Find the first usable entry with the specified typeID and class loader.
+ * Entries marked for purging and classes whose superclasses failed to
+ * load are skipped.
+ *
+ * This does not require the loaderCacheLock as long as the caller is gc
+ * unsafe for the duration of the walk and does not hold on to the entry
+ * afterwards. New entries are only ever published at the head of a
+ * chain, and unlinked entries are not freed until the next class
+ * unloading pass, which cannot happen until every thread has passed a
+ * gc safe point. See CVMloaderCacheLookupNoLock().
  */
-CVMClassBlock*
-CVMloaderCacheLookupWithProtectionDomain(CVMExecEnv* ee, 
-					 CVMClassTypeID classID,
-					 CVMClassLoaderICell* loader,
-					 CVMObjectICell* pd)
+static CVMLoaderCacheEntry*
+CVMloaderCacheFindEntry(CVMExecEnv* ee, CVMClassTypeID classID,
+			CVMClassLoaderICell* loader)
 {
     CVMLoaderCacheEntry* entry;
 
-    loader = CVMloaderCacheGetGlobalRootFromLoader(ee, loader);
-
-    CVMtraceClassLookup(("LC: loader cache lookup <0x%x,%!C>\n",
-			 loader, classID));
-
-    {
-	CVMClassBlock *cb = CVMpreloaderLookupFromType(ee, classID, loader);
-	if (cb != NULL) {
-	    return cb;
-	}
-    }
-
-    CVM_LOADERCACHE_ASSERT_LOCKED(ee);
-
     entry  = CVMglobals.loaderCache[HASH_INDEX(classID, loader)];
 
     while (entry) {
@@ -827,43 +822,104 @@ CVMloaderCacheLookupWithProtectionDomain(CVMExecEnv* ee,
 	     *
 	     * See c09/11/2000 in classcreate.c for more details.
 	     */
-	    if (CVMcbCheckErrorFlag(ee, cb) && 
-		!CVMcbCheckRuntimeFlag(cb, SUPERCLASS_LOADED)) {
-		goto next_entry;
+	    if (!CVMcbCheckErrorFlag(ee, cb) ||
+		CVMcbCheckRuntimeFlag(cb, SUPERCLASS_LOADED)) {
+		return entry;
 	    }
+	}
+	entry = entry->next;
+    }
+    return NULL;
+}
 
-	    /*
-	     * If necessary, make sure protection domain matches.
-	     */
-	    if (pd != NULL) {
-		CVMBool found = CVM_FALSE;
-		int i;
-		for (i = 0; i < entry->num_pds; i++) {
-		    CVMBool isSamePD;
-		    CVMID_icellSameObject(ee, entry->pds[i], pd, isSamePD);
-		    if (isSamePD) {
-			found = CVM_TRUE;
-			break;
-		    }
-		}
-		if (!found) {
-		    break; /* don't search anymore */
+/*
+ * Look for an entry with the specified typeID, class loader
+ * and protection domain.
+ */
+CVMClassBlock*
+CVMloaderCacheLookupWithProtectionDomain(CVMExecEnv* ee, 
+					 CVMClassTypeID classID,
+					 CVMClassLoaderICell* loader,
+					 CVMObjectICell* pd)
+{
+    CVMLoaderCacheEntry* entry;
+
+    loader = CVMloaderCacheGetGlobalRootFromLoader(ee, loader);
+
+    CVMtraceClassLookup(("LC: loader cache lookup <0x%x,%!C>\n",
+			 loader, classID));
+
+    {
+	CVMClassBlock *cb = CVMpreloaderLookupFromType(ee, classID, loader);
+	if (cb != NULL) {
+	    return cb;
+	}
+    }
+
+    CVM_LOADERCACHE_ASSERT_LOCKED(ee);
+
+    entry = CVMloaderCacheFindEntry(ee, classID, loader);
+    if (entry != NULL) {
+	/*
+	 * If necessary, make sure protection domain matches.
+	 */
+	if (pd != NULL) {
+	    CVMBool found = CVM_FALSE;
+	    int i;
+	    for (i = 0; i < entry->num_pds; i++) {
+		CVMBool isSamePD;
+		CVMID_icellSameObject(ee, entry->pds[i], pd, isSamePD);
+		if (isSamePD) {
+		    found = CVM_TRUE;
+		    break;
 		}
 	    }
-	    
-	    CVMtraceClassLookup(("LC: Found <0x%x,%C> cb=0x%x\n",
-				 loader, cb, cb));
-	    return cb;
+	    if (!found) {
+		entry = NULL;
+	    }
 	}
-    next_entry:
-	entry = entry->next;
     }
-    
+
+    if (entry != NULL) {
+	CVMtraceClassLookup(("LC: Found <0x%x,%C> cb=0x%x\n",
+			     loader, entry->cb, entry->cb));
+	return entry->cb;
+    }
     CVMtraceClassLookup(("LC: not found <0x%x,%!C>\n",
 			 loader, classID));
     return NULL;
 }
 
+/*
+ * Look for an entry with the specified typeID and class loader without
+ * acquiring the loaderCacheLock. Must be called while gc safe. The chain
+ * walk itself is done gc unsafe, which is what keeps unlinked entries
+ * from being freed underneath us (see CVMloaderCacheFindEntry()).
+ */
+CVMClassBlock*
+CVMloaderCacheLookupNoLock(CVMExecEnv* ee, CVMClassTypeID classID,
+			   CVMClassLoaderICell* loader)
+{
+    CVMClassBlock* cb;
+
+    loader = CVMloaderCacheGetGlobalRootFromLoader(ee, loader);
+
+    cb = CVMpreloaderLookupFromType(ee, classID, loader);
+    if (cb != NULL) {
+	return cb;
+    }
+
+    CVMD_gcUnsafeExec(ee, {
+	CVMLoaderCacheEntry* entry =
+	    CVMloaderCacheFindEntry(ee, classID, loader);
+	cb = (entry != NULL) ? entry->cb : NULL;
+    });
+
+    CVMtraceClassLookup(("LC: unlocked lookup <0x%x,%!C> cb=0x%x\n",
+			 loader, classID, cb));
+    return cb;
+}
+
 /*
  * Add a class to the loader cache. The loading of "cb" has been initiated
  * by "loader". This function ensures that cb meets the constraints already.
@@ -952,6 +1008,10 @@ CVMloaderCacheAdd(CVMExecEnv* ee, CVMClassBlock* cb,
 	entry->loader = loader;
 	entry->num_pds = 0;
 	entry->pds = NULL;
+#ifdef CVM_MP_SAFE
+	/* Unlocked readers must see a fully initialized entry: */
+	CVMmemoryBarrier();
+#endif
 	CVMglobals.loaderCache[index] = entry;
     }
 
@@ -1075,8 +1135,10 @@ CVMloaderCachePurgeUnscannedClassesAndLoaders(CVMExecEnv* ee)
 		    }
 		    currEntry = currEntry->next;
                     /* Put this entry on the entriesToFree list to be freed
-                       later below: */
-		    entryToFree->next = entriesToFree;
+                       later below. Leave its next field alone: an unlocked
+                       lookup standing on it must still reach the rest of
+                       this bucket. */
+		    entryToFree->retiredNext = entriesToFree;
 		    entriesToFree = entryToFree;
 		    CVMtraceClassLookup(("LC: Loader cache removed #%i\n", i));
 		} else {
@@ -1086,6 +1148,19 @@ CVMloaderCachePurgeUnscannedClassesAndLoaders(CVMExecEnv* ee)
 	    }
 	}
     });
+
+    /*
+     * A CVMloaderCacheLookupNoLock() that started before the entries
+     * were unlinked above may still be walking them. Hold on to them
+     * until the next purge; a gc has to happen before then, and every
+     * unlocked lookup is done before its thread reaches a gc safe point.
+     * Free the entries retired by the previous purge instead.
+     */
+    {
+	CVMLoaderCacheEntry* retired = CVMglobals.loaderCacheRetired;
+	CVMglobals.loaderCacheRetired = entriesToFree;
+	entriesToFree = retired;
+    }
     CVM_LOADERCACHE_UNLOCK(ee);
     
     /*
@@ -1095,7 +1170,7 @@ CVMloaderCachePurgeUnscannedClassesAndLoaders(CVMExecEnv* ee)
      */
     while (entriesToFree != NULL) {
 	CVMLoaderCacheEntry* currEntry = entriesToFree;
-	entriesToFree = currEntry->next;
+	entriesToFree = currEntry->retiredNext;
 	CVMloaderCacheFreeEntry(ee, currEntry);
     }
 }
@@ -1217,6 +1292,14 @@ CVMloaderCacheDestroy(CVMExecEnv* ee)
     }
     free(CVMglobals.loaderCache);
 
+#ifdef CVM_CLASSLOADING
+    while (CVMglobals.loaderCacheRetired != NULL) {
+	CVMLoaderCacheEntry* entry = CVMglobals.loaderCacheRetired;
+	CVMglobals.loaderCacheRetired = entry->retiredNext;
+	CVMloaderCacheFreeEntry(ee, entry);
+    }
+#endif
+
 #if defined(CVM_CLASSLOADING) && !defined(CVM_TRUSTED_CLASSLOADERS)
     for (i = 0; i < CVM_LOADER_CONSTRAINT_TABLE_SIZE; i++) {
 	CVMLoaderConstraint* entry = CVMglobals.loaderConstraints[i];
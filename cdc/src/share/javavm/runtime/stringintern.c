@@ -34,6 +34,7 @@
 #include "javavm/include/string_impl.h"
 #include "javavm/include/common_exceptions.h"
 #include "javavm/include/globals.h"
+#include "javavm/include/jni_impl.h"
 
 #undef MIN
 #define MIN(a,b) (((a)<(b))?(a):(b))
@@ -269,6 +270,7 @@ typedef void    (*consumerFunction)( CVMExecEnv* ee,  CVMStringICell * stringCel
 
 /* all our forwards for all our helper functions here */
 static CVMInternSegment * allocateNewSegment();
+static CVMUint32 internHash( const CVMJavaChar buffer[], CVMSize bufferLength );
 
 static CVMBool
 internJavaCompare( CVMExecEnv* ee,  CVMStringICell * candidate, void * stuff);
@@ -344,29 +346,19 @@ internInner(
 ){
 
     CVMUint32		h, h1;
-    CVMSize 		i, j, n;
+    CVMSize 		i, j;
     CVMSize		slotWithOpening=0;
     CVMSize		capacity;
     CVMUint8		refCount;
     CVMUint8*		refArray;
+    CVMUint32*		hashArray;
     CVMInternSegment*   curSeg,
 		    *	nextSeg,
 		    *   segWithOpening = NULL;
     CVMStringICell  *	candidate;
 
 
-    /* calculate hash code.
-     * This is similar to the one in java.lang.String, but this
-     * is just a coincidence. Make sure that the ROMizer uses the
-     * same one! (in order to make this easier, we will mask off
-     * the high order bit.)
-     */
-    n = MIN(bufferLength, MAX_HASH_LENGTH);
-    h = 0;
-    for ( i = 0; i < n; i++ ){
-	h = (h*37) + buffer[i];
-    }
-    h &= ~0x80000000;
+    h = internHash( buffer, bufferLength );
     h1 = (h&15)+1;
 
     /*
@@ -384,6 +376,7 @@ internInner(
 	curSeg = nextSeg;
 	capacity = curSeg->capacity;
 	refArray = CVMInternRefCount(curSeg);
+	hashArray = CVMInternHashes(curSeg);
 	i = h % capacity; /* this is where we start looking */
 
 	while ( (refCount=refArray[i]) != CVMInternUnused ){
@@ -392,7 +385,7 @@ internInner(
 		    segWithOpening = curSeg;
 		    slotWithOpening = i;
 		}
-	    } else {
+	    } else if ( hashArray == NULL || hashArray[i] == h ){
 		CVMJavaInt candidateLength;	
 		CVMJavaChar candidateData[PREFIX_BUFFER_SIZE];
 
@@ -467,13 +460,18 @@ internInner(
 	/* insert in current segment */
 	if ( curSeg->load > curSeg->maxLoad ){
 	    CVMInternSegment * newSeg;
-	    if ( (CVMInternNext(curSeg) = newSeg = allocateNewSegment()) == NULL ){
+	    if ( (newSeg = allocateNewSegment()) == NULL ){
 		/*
 		 * running out of memory. fail here by returning NULL
 		 */
 		candidate = NULL;
 		goto failure;
 	    }
+#ifdef CVM_MP_SAFE
+	    /* Unlocked readers must see an initialized segment: */
+	    CVMmemoryBarrier();
+#endif
+	    CVMInternNext(curSeg) = newSeg;
 	    curSeg = newSeg;
 	    i = h % curSeg->capacity;
 	}
@@ -494,7 +492,15 @@ internInner(
      */
     CVMInternRefCount(curSeg)[i] = 0;
     candidate = &(curSeg->data[i]);
+    hashArray = CVMInternHashes(curSeg);
+    if ( hashArray != NULL ){
+	hashArray[i] = h;
+    }
 
+    /*
+     * produce fills in the cell last, after a memory barrier, because
+     * internLookupNoLockUnsafe may be reading this slot without the lock.
+     */
     (*produce)( ee, candidate, callbackData );
 
 found:
@@ -509,6 +515,104 @@ failure:
 
 }
 
+/*
+ * calculate hash code.
+ * This is similar to the one in java.lang.String, but this
+ * is just a coincidence. Make sure that the ROMizer uses the
+ * same one! (in order to make this easier, we will mask off
+ * the high order bit.)
+ */
+static CVMUint32
+internHash( const CVMJavaChar buffer[], CVMSize bufferLength ){
+    CVMUint32	h = 0;
+    CVMSize	i, n;
+
+    n = MIN(bufferLength, MAX_HASH_LENGTH);
+    for ( i = 0; i < n; i++ ){
+	h = (h*37) + buffer[i];
+    }
+    return h & ~0x80000000;
+}
+
+/*
+ * Probe the table for a String equal to the length characters in
+ * buffer, without taking internLock. Must be called gc-unsafe: that
+ * keeps the GC from deleting or moving entries while we look.
+ * Concurrent inserters only turn unused or deleted slots into used ones,
+ * and store the String into the cell after everything else (see
+ * internInner), so a reader either sees a complete entry, a null cell,
+ * or nothing. Only strings short enough to be held entirely in the
+ * prefix buffer are looked up here, so no compare callback is needed.
+ *
+ * A miss is not authoritative. The caller must retry under the lock.
+ */
+static CVMBool
+internLookupNoLockUnsafe(
+    CVMExecEnv *	ee,
+    const CVMJavaChar	buffer[],
+    CVMSize		length,
+    CVMUint32		h,
+    CVMObjectICell *	result
+){
+    CVMUint32		h1 = (h&15)+1;
+    CVMInternSegment*	curSeg = (CVMInternSegment*)&CVMInternTable;
+
+    CVMassert( length <= PREFIX_BUFFER_SIZE );
+    do {
+	CVMSize		capacity  = curSeg->capacity;
+	CVMUint8*	refArray  = CVMInternRefCount(curSeg);
+	CVMUint32*	hashArray = CVMInternHashes(curSeg);
+	CVMSize		i = h % capacity;
+	CVMUint8	refCount;
+
+	while ( (refCount=refArray[i]) != CVMInternUnused ){
+	    if ( refCount != CVMInternDeleted &&
+		 ( hashArray == NULL || hashArray[i] == h ) ){
+		CVMObject *	stringDirect;
+		CVMObject *	theChars;
+		CVMJavaInt	candidateLength;
+		CVMJavaInt	offset;
+		CVMJavaChar	candidateData[PREFIX_BUFFER_SIZE];
+		CVMSize		j;
+
+		stringDirect = CVMID_icellDirect(ee, &(curSeg->data[i]));
+		if ( stringDirect == NULL ){
+		    /* being inserted right now */
+		    goto next;
+		}
+		CVMD_fieldReadInt( stringDirect,
+		    CVMoffsetOfjava_lang_String_count,
+		    candidateLength );
+		if ( (CVMSize)candidateLength != length ){
+		    goto next;
+		}
+		if ( length > 0 ){
+		    CVMD_fieldReadInt( stringDirect,
+			CVMoffsetOfjava_lang_String_offset,
+			offset );
+		    CVMD_fieldReadRef( stringDirect,
+			CVMoffsetOfjava_lang_String_value,
+			theChars );
+		    CVMD_arrayReadBodyChar( candidateData,
+			(CVMArrayOfChar*)theChars, offset, length );
+		    for ( j = 0; j < length; j++ ){
+			if ( candidateData[j] != buffer[j] )
+			    goto next;
+		    }
+		}
+		CVMID_icellSetDirect( ee, result, stringDirect );
+		return CVM_TRUE;
+	    }
+	next:
+	    i += h1;
+	    if ( i >= capacity )
+		i -= capacity;
+	}
+	curSeg = CVMInternNext(curSeg);
+    } while ( curSeg != NULL );
+    return CVM_FALSE;
+}
+
 static CVMInternSegment *
 allocateNewSegment(){
     CVMInternSegment *	seg;
@@ -521,10 +625,11 @@ allocateNewSegment(){
      */
     roundedRefSize = (dataSize+(sizeof(void*)-1))&~(sizeof(void*)-1);
     allocationBytes = sizeof(CVMInternSegment)+(dataSize*sizeof(CVMStringICell))
-		      + roundedRefSize;
+		      + roundedRefSize + (dataSize*sizeof(CVMUint32));
     /*
      * since sizeof CVMInternSegment had 1 CVMStringICell in it, I don't think
      * we need to account for the extra next pointer cell as well!
+     * The hash array follows the next pointer cell.
      */
 
     seg = (CVMInternSegment *)calloc( allocationBytes, 1 );
@@ -616,11 +721,33 @@ CVMstringIntern(JNIEnv *env, jstring thisString){
 	     }
 	*/
 
+	/*
+	 * Short strings are first looked up without the lock. Most
+	 * calls to intern() are for strings already in the table.
+	 */
+	if ( d.length == d.bufferLength ){
+	    CVMObjectICell * resultCell = CVMjniCreateLocalRef( ee );
+	    CVMBool	     found;
+	    if ( resultCell == NULL ){
+		goto done; /* exception already thrown */
+	    }
+	    CVMD_gcUnsafeExec(ee, {
+		found = internLookupNoLockUnsafe( ee, d.buffer, d.bufferLength,
+		    internHash( d.buffer, d.bufferLength ), resultCell );
+	    });
+	    if ( found ){
+		d.result = resultCell;
+		goto done;
+	    }
+	    (*env)->DeleteLocalRef( env, resultCell );
+	}
+
 	/*
 	 * need the local root to the char array live across this call.
 	 */
 	internInner( ee,  d.buffer, d.bufferLength, d.length,
 			internJavaCompare, internJavaProduce, internJavaConsume, &d );
+    done: ;
     } CVMID_localrootEnd();
     /*DEBUG CVMconsolePrintf("... at cell %x\n", d.result );*/
     /*
@@ -706,6 +833,10 @@ internJavaCompare( CVMExecEnv* ee,  CVMStringICell * candidate, void * stuff){
 static CVMBool
 internJavaProduce( CVMExecEnv *ee, CVMStringICell * target, void * stuff ){
     struct stringInternData* dp = (struct stringInternData *)stuff;
+#ifdef CVM_MP_SAFE
+    /* Unlocked readers must see a fully initialized String: */
+    CVMmemoryBarrier();
+#endif
     CVMID_icellAssign( ee, target, dp->srcString );
     return CVM_TRUE;
 }
@@ -929,6 +1060,10 @@ internUTFProduce( CVMExecEnv *ee, CVMStringICell * target, void * stuff ){
      * Finally, assign reference to the String object to the
      * result location.
      */
+#ifdef CVM_MP_SAFE
+    /* Unlocked readers must see a fully initialized String: */
+    CVMmemoryBarrier();
+#endif
     CVMID_icellAssign( ee, target, dp->allocatedString );
 
     return CVM_TRUE;
@@ -60,7 +60,6 @@ readBytes(JNIEnv *env, jobject thisObj, jbyteArray bytes,
 	  jint off, jint len, jfieldID fid) {
     jint fd, nread, datalen;
     char *buf = NULL;
-    char *tmp_buf = NULL;
     CVMExecEnv *ee = CVMjniEnv2ExecEnv(env);
 
     if (IS_NULL(bytes)) {
@@ -77,18 +76,18 @@ readBytes(JNIEnv *env, jobject thisObj, jbyteArray bytes,
 
     if (len == 0) {
 	return 0;
-    } else if (len > CVM_CSTACK_BUF_SIZE) {
-        buf = tmp_buf = malloc(len);
-        if (buf == NULL) {
-            JNU_ThrowOutOfMemoryError(env, 0);
-            return 0;
-        }
-    } else {
-        CVMCstackGetBuffer(ee, buf);	/* Lock EE-buffer */
-        if (buf == NULL) {
-            JNU_ThrowOutOfMemoryError(env, 0);
-            return 0;
-        }
+    } else if (len > CVM_CSTACK_BUF_MAX_SIZE) {
+	/* A short read is allowed, so don't buffer more than this: */
+	len = CVM_CSTACK_BUF_MAX_SIZE;
+    }
+
+    CVMCstackGetBufferOfSize(ee, buf, len);	/* Lock EE-buffer */
+    if (buf == NULL) {
+        JNU_ThrowOutOfMemoryError(env, 0);
+        return 0;
+    }
+    if (len > (jint)CVMCstackBufferSize(ee)) {
+	len = CVMCstackBufferSize(ee);
     }
 
     fd = GET_FD(fid);
@@ -103,10 +102,7 @@ readBytes(JNIEnv *env, jobject thisObj, jbyteArray bytes,
 	nread = -1;
     }
 
-    if (tmp_buf != NULL)
-	free(tmp_buf);	/* malloc buffer was in-use */
-    else
-	CVMCstackReleaseBuffer(ee); /* Unlock EE-buffer */
+    CVMCstackReleaseBuffer(ee); /* Unlock EE-buffer */
     return nread;
 }
 
@@ -128,9 +124,8 @@ void
 writeBytes(JNIEnv *env, jobject thisObj, jbyteArray bytes,
 	  jint off, jint len, jfieldID fid) {
 
-    jint fd, n, datalen;
+    jint fd, n, datalen, bufLen;
     char *buf = NULL;
-    char *tmp_buf = NULL;
     CVMExecEnv *ee = CVMjniEnv2ExecEnv(env);
 
     if (IS_NULL(bytes)) {
@@ -147,42 +142,43 @@ writeBytes(JNIEnv *env, jobject thisObj, jbyteArray bytes,
 
     if (len == 0) {
         return;
-    } else if (len > CVM_CSTACK_BUF_SIZE) {
-        buf = tmp_buf = malloc(len);
-        if (buf == NULL) {
-            JNU_ThrowOutOfMemoryError(env, 0);
-            return;
-        }
-    } else {
-        CVMCstackGetBuffer(ee, buf);	/* Lock EE-buffer */
-        if (buf == NULL) {
-            JNU_ThrowOutOfMemoryError(env, 0);
-            return;
-        }
     }
 
+    CVMCstackGetBufferOfSize(ee, buf,
+	len < CVM_CSTACK_BUF_MAX_SIZE ? len : CVM_CSTACK_BUF_MAX_SIZE);
+    if (buf == NULL) {		/* Lock EE-buffer */
+        JNU_ThrowOutOfMemoryError(env, 0);
+        return;
+    }
+    bufLen = CVMCstackBufferSize(ee);
+
     fd = GET_FD(fid);
-    (*env)->GetByteArrayRegion(env, bytes, off, len, (jbyte *)buf);
 
-    if (!(*env)->ExceptionOccurred(env)) {
-        off = 0;
-	while (len > 0) {
-	    n = JVM_Write(fd, buf+off, len);
+    /* Requests larger than the EE-buffer are written a chunk at a time: */
+    while (len > 0) {
+	jint chunkLen = (len < bufLen) ? len : bufLen;
+	jint chunkOff = 0;
+
+	(*env)->GetByteArrayRegion(env, bytes, off, chunkLen, (jbyte *)buf);
+	if ((*env)->ExceptionOccurred(env)) {
+	    goto done;
+	}
+	while (chunkOff < chunkLen) {
+	    n = JVM_Write(fd, buf+chunkOff, chunkLen-chunkOff);
 	    if (n == JVM_IO_ERR) {
 	        JNU_ThrowIOExceptionWithLastError(env, "Write error");
-		break;
+		goto done;
 	    } else if (n == JVM_IO_INTR) {
 	        JNU_ThrowByName(env, "java/io/InterruptedIOException", 0);
-		break;
+		goto done;
 	    }
-	    off += n;
-	    len -= n;
+	    chunkOff += n;
 	}
+	off += chunkLen;
+	len -= chunkLen;
     }
-    if (tmp_buf != NULL)
-	free (tmp_buf);
-    else
-	CVMCstackReleaseBuffer(ee);	/* Unlock EE-buffer */
+ done:
+    CVMCstackReleaseBuffer(ee);	/* Unlock EE-buffer */
 }
 
 
@@ -236,10 +236,16 @@ Java_java_util_zip_ZipFile_read(JNIEnv *env, jclass cls, jlong zfile,
         return 0;
     }
 
-    ZIP_Lock(zip);
-    len = ZIP_Read(zip, (jzentry *)jlong_to_ptr(zentry), pos, buf, len);
-    msg = zip->msg;
-    ZIP_Unlock(zip);
+    if (ZIP_IsMapped(zip)) {
+	/* Mapped zip files can be read concurrently */
+	len = ZIP_Read(zip, (jzentry *)jlong_to_ptr(zentry), pos, buf, len);
+	msg = zip->msg;
+    } else {
+	ZIP_Lock(zip);
+	len = ZIP_Read(zip, (jzentry *)jlong_to_ptr(zentry), pos, buf, len);
+	msg = zip->msg;
+	ZIP_Unlock(zip);
+    }
     if (len == -1) {
 	if (msg != 0) {
 	    ThrowZipException(env, msg);
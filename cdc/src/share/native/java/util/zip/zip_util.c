@@ -37,6 +37,10 @@
 #include "javavm/include/ansi2cvm.h"
 #include "javavm/include/porting/path.h"
 
+#ifdef CVM_ZIP_MMAP
+#include <sys/mman.h>
+#endif
+
 #define MAXREFS 0xFFFF	/* max number of open zip file references */
 #define MAXSIZE INT_MAX	/* max size of zip file or zip entry */
 
@@ -99,6 +103,30 @@ static jint readFully(jint fd, void *buf, jint len)
     return 0;
 }
 
+/*
+ * Reads len bytes of data at file position pos into buf. Returns 0 if
+ * all bytes could be read, otherwise returns -1. A mapped zip file is
+ * read without touching the file position, so the caller only needs to
+ * hold the ZIP lock if the file is not mapped.
+ */
+static jint readFullyAt(jzfile *zip, jint pos, void *buf, jint len)
+{
+#ifdef CVM_ZIP_MMAP
+    if (ZIP_IsMapped(zip)) {
+	if (pos < 0 || len < 0 || pos > zip->mlen - len) {
+	    return -1;
+	}
+	memcpy(buf, zip->maddr + pos, len);
+	return 0;
+    }
+#endif
+    if (jlong_to_jint(JVM_Lseek(zip->fd, jint_to_jlong(pos), SEEK_SET))
+	== -1) {
+	return -1;
+    }
+    return readFully(zip->fd, buf, len);
+}
+
 /*
  * Allocates a new zip file object for the specified file name.
  * Returns the zip file object or NULL if not enough memory.
@@ -135,6 +163,11 @@ static void freeZip(jzfile *zip)
     if (zip->name != 0) {
 	free(zip->name);
     }
+#ifdef CVM_ZIP_MMAP
+    if (zip->maddr != 0) {
+	munmap((void *)zip->maddr, zip->mlen);
+    }
+#endif
     if (zip->lock != 0) {
 	MDESTROY(zip->lock);
     }
@@ -396,6 +429,15 @@ addEntryComment(jzfile *zip, int index, char *comment)
     }
 }
 
+/*
+ * The central directory buffer is only allocated if the zip file is not
+ * mapped.
+ */
+#define FREE_CENBUF(zip, cenbuf) \
+    if (!ZIP_IsMapped(zip)) {    \
+	free(cenbuf);            \
+    }
+
 /*
  * Reads zip file central directory. Returns the file position of first
  * CEN header, otherwise returns 0 if central directory not found or -1
@@ -451,26 +493,34 @@ static jint readCEN(jzfile *zip)
 	zip->msg = "too many entries in ZIP file";
 	return -1;
     }
-    /* Seek to first CEN header */
-    if (jlong_to_jint(JVM_Lseek(zip->fd, jint_to_jlong(cenpos), SEEK_SET))
-	== -1) {
-	return -1;
-    }
+#ifdef CVM_ZIP_MMAP
+    if (ZIP_IsMapped(zip)) {
+	/* Parse the central directory in place */
+	cenbuf = zip->maddr + cenpos;
+    } else
+#endif
+    {
+	/* Seek to first CEN header */
+	if (jlong_to_jint(JVM_Lseek(zip->fd, jint_to_jlong(cenpos), SEEK_SET))
+	    == -1) {
+	    return -1;
+	}
 
-    /* Allocate temporary buffer for central directory bytes */
-    cenbuf = (unsigned char *)malloc(cenlen);
-    if (cenbuf == 0) {
-	return -1;
-    }
-    /* Read central directory */
-    if (readFully(zip->fd, cenbuf, cenlen) == -1) {
-	free(cenbuf);
-	return -1;
+	/* Allocate temporary buffer for central directory bytes */
+	cenbuf = (unsigned char *)malloc(cenlen);
+	if (cenbuf == 0) {
+	    return -1;
+	}
+	/* Read central directory */
+	if (readFully(zip->fd, cenbuf, cenlen) == -1) {
+	    free(cenbuf);
+	    return -1;
+	}
     }
     /* Allocate array for item descriptors */
     entries = zip->entries = (jzcell *)calloc(total, sizeof(jzcell));
     if (entries == 0) {
-	free(cenbuf);
+	FREE_CENBUF(zip, cenbuf);
 	return -1;
     }
     /* Allocate hash table */
@@ -478,7 +528,7 @@ static jint readCEN(jzfile *zip)
     tablelen = zip->tablelen = (tmplen > 0 ? tmplen : 1);
     table = zip->table = (unsigned short *)calloc(tablelen, sizeof(unsigned short));
     if (table == 0) {
-	free(cenbuf);
+	FREE_CENBUF(zip, cenbuf);
 	free(entries);
 	zip->entries = 0;
 	return -1;
@@ -542,7 +592,7 @@ static jint readCEN(jzfile *zip)
                 free(name);
             name = (char *)malloc(namelen);
 	    if (name == 0) {
-		free(cenbuf);
+		FREE_CENBUF(zip, cenbuf);
 		free(entries);
 		zip->entries = 0;
 		return -1;
@@ -596,7 +646,7 @@ static jint readCEN(jzfile *zip)
     }
     /* Free up temporary buffers */
 error:
-    free(cenbuf);
+    FREE_CENBUF(zip, cenbuf);
     if (name != namebuf)
         free(name);
 
@@ -695,6 +745,20 @@ ZIP_Open_Generic(const char *name, char **pmsg, int mode, jlong lastModified)
 	    freeZip(zip);
 	    return 0;
 	}
+#ifdef CVM_ZIP_MMAP
+	/*
+	 * Map read-only zip files. If the mapping fails we silently fall
+	 * back to reading through the file descriptor.
+	 */
+	if ((mode & O_ACCMODE) == O_RDONLY && CVMlongGt(len, jlong_zero)) {
+	    void *maddr = mmap(0, (size_t)jlong_to_jint(len), PROT_READ,
+			       MAP_SHARED, zip->fd, 0);
+	    if (maddr != MAP_FAILED) {
+		zip->maddr = (unsigned char *)maddr;
+		zip->mlen = jlong_to_jint(len);
+	    }
+	}
+#endif
 	if (readCEN(zip) <= 0) {
 	    /* An error occurred while trying to read the zip file */
 	    if (pmsg != 0) {
@@ -819,7 +883,7 @@ void ZIP_Close(jzfile *zip)
 /*
  * Read a LOC corresponding to a given hash cell and
  * create a corrresponding jzentry entry descriptor
- * The ZIP lock should be held here.
+ * The ZIP lock should be held here unless the zip file is mapped.
  */
 static jzentry *
 readLOC(jzfile *zip, jzcell *zc)
@@ -828,13 +892,6 @@ readLOC(jzfile *zip, jzcell *zc)
     jint nlen, elen;
     jzentry *ze = 0;
 
-    /* Seek to beginning of LOC header */
-    if (jlong_to_jint(JVM_Lseek(zip->fd, jint_to_jlong(zc->pos), SEEK_SET))
-	== -1) {
-	zip->msg = "seek failed";
-	return NULL;
-    }
-
     /* Allocate buffer for LOC header only */
     locbuf = (unsigned char *)malloc(LOCHDR);
     if (locbuf == 0) {
@@ -843,7 +900,7 @@ readLOC(jzfile *zip, jzcell *zc)
     }
 
     /* Try to read in the LOC header */
-    if (readFully(zip->fd, locbuf, LOCHDR) == -1) {
+    if (readFullyAt(zip, zc->pos, locbuf, LOCHDR) == -1) {
 	zip->msg = "couldn't read LOC header";
 	goto FREE_AND_RETURN_NULL;
     }
@@ -879,7 +936,7 @@ readLOC(jzfile *zip, jzcell *zc)
     }
 
     /* Read in the entry name and zero terminate it */
-    if (readFully(zip->fd, ze->name, nlen) == -1) {
+    if (readFullyAt(zip, zc->pos + LOCHDR, ze->name, nlen) == -1) {
 	zip->msg = "couldn't read name";
         goto FREE_AND_RETURN_NULL;
     }
@@ -896,13 +953,8 @@ readLOC(jzfile *zip, jzcell *zc)
 	ze->extra[0] = (unsigned char)elen;
 	ze->extra[1] = (unsigned char)(elen >> 8);
 
-	/* Seek to begin of CEN header extra field */
-        if (jlong_to_jint(JVM_Lseek(zip->fd, jint_to_jlong(off), SEEK_SET)) == -1) {
-	    zip->msg = "seek failed";
-            goto FREE_AND_RETURN_NULL;
-	}
 	/* Try to read in the CEN Extra */
-	if (readFully(zip->fd, &ze->extra[2], elen) == -1) {
+	if (readFullyAt(zip, off, &ze->extra[2], elen) == -1) {
 	    zip->msg = "couldn't read CEN extra";
             goto FREE_AND_RETURN_NULL;
 	}
@@ -919,7 +971,8 @@ readLOC(jzfile *zip, jzcell *zc)
 	ze->extra[1] = (unsigned char)(elen >> 8);
 
        	/* Try to read in the extra data */
-	if (readFully(zip->fd, &ze->extra[2], elen) == -1) {
+	if (readFullyAt(zip, zc->pos + LOCHDR + nlen,
+			&ze->extra[2], elen) == -1) {
 	    zip->msg = "couldn't read extra";
             goto FREE_AND_RETURN_NULL;
 	}
@@ -1000,6 +1053,7 @@ jzentry * ZIP_GetEntry(jzfile *zip, const char *name)
     unsigned int hsh = hash(name);
     int idx = zip->table[hsh % zip->tablelen];
     jzentry *ze;
+    jboolean locked;
 
     ZIP_Lock(zip);
 
@@ -1013,6 +1067,12 @@ jzentry * ZIP_GetEntry(jzfile *zip, const char *name)
     }
     ze = 0;
 
+    /* The LOC headers of a mapped zip file can be read without the lock */
+    locked = !ZIP_IsMapped(zip);
+    if (!locked) {
+	ZIP_Unlock(zip);
+    }
+
     /*
      * Search down the target hash chain for a cell who's
      * 32 bit hash matches the hashed name.
@@ -1036,15 +1096,21 @@ jzentry * ZIP_GetEntry(jzfile *zip, const char *name)
 	    }
 	    if (ze != 0) {
 		/* We need to relese the lock across the free call */
-	        ZIP_Unlock(zip);
+		if (locked) {
+		    ZIP_Unlock(zip);
+		}
 		ZIP_FreeEntry(zip, ze);
-	        ZIP_Lock(zip);
+		if (locked) {
+		    ZIP_Lock(zip);
+		}
 	    }
 	    ze = 0;
 	}
 	idx = zc->next;
     }
-    ZIP_Unlock(zip);
+    if (locked) {
+	ZIP_Unlock(zip);
+    }
     return ze;
 }
 
@@ -1059,6 +1125,9 @@ ZIP_GetNextEntry(jzfile *zip, jint n)
     if (n < 0 || n >= zip->total) {
 	return 0;
     }
+    if (ZIP_IsMapped(zip)) {
+	return readLOC(zip, &zip->entries[n]);
+    }
     ZIP_Lock(zip);
     result = readLOC(zip, &zip->entries[n]);
     ZIP_Unlock(zip);
@@ -1084,15 +1153,21 @@ void ZIP_Unlock(jzfile *zip)
 
 /*
  * Reads bytes from the specified zip entry. Assumes that the zip
- * file had been previously locked with ZIP_Lock(). Returns the
- * number of bytes read, or -1 if an error occurred. If err->msg != 0
- * then a zip error occurred and err->msg contains the error text.
+ * file had been previously locked with ZIP_Lock(), unless the zip
+ * file is mapped. Returns the number of bytes read, or -1 if an error
+ * occurred. If err->msg != 0 then a zip error occurred and err->msg
+ * contains the error text.
  */
 jint ZIP_Read(jzfile *zip, jzentry *entry, jint pos, void *buf, jint len)
 {
     jint n, avail, size;
-    /* Clear previous zip error */
-    zip->msg = 0;
+    /*
+     * Clear previous zip error. Unlocked readers of a mapped zip file
+     * leave it alone so that they don't clear each other's errors.
+     */
+    if (!ZIP_IsMapped(zip)) {
+	zip->msg = 0;
+    }
     /* Check specified position */
     size = entry->csize != 0 ? entry->csize : entry->size;
     if (pos < 0 || pos > size - 1) {
@@ -1108,6 +1183,17 @@ jint ZIP_Read(jzfile *zip, jzentry *entry, jint pos, void *buf, jint len)
 	len = avail;
     }
 
+#ifdef CVM_ZIP_MMAP
+    if (ZIP_IsMapped(zip)) {
+	if (entry->pos + pos > zip->mlen - len) {
+	    zip->msg = "ZIP_Read: entry extends beyond end of file";
+	    return -1;
+	}
+	memcpy(buf, zip->maddr + entry->pos + pos, len);
+	return len;
+    }
+#endif
+
     /* Seek to beginning of entry data and read bytes */
     n = jlong_to_jint(JVM_Lseek(zip->fd, jint_to_jlong(entry->pos + pos),
 				SEEK_SET));
@@ -1142,6 +1228,64 @@ jint ZIP_DosToUnixTime(jint dtime)
  */
 #define BUF_SIZE 4096
 
+#ifdef CVM_ZIP_MMAP
+/*
+ * Inflates an entry of a mapped zip file straight from the mapping into
+ * the destination buffer. No lock is needed and the compressed data is
+ * not copied.
+ */
+static jboolean
+inflateMapped(jzfile *zip, jzentry *entry, z_stream *strm, char **msg)
+{
+    jboolean result = JNI_TRUE;
+    jint avail;
+
+    if (entry->pos < 0 || entry->pos > zip->mlen - entry->csize) {
+	inflateEnd(strm);
+	*msg = "inflateFully: entry extends beyond end of file";
+	return JNI_FALSE;
+    }
+    /*
+     * Inflating raw deflate data may need one byte past the end of the
+     * compressed data to complete. Hand it the next byte of the file if
+     * there is one; it is never consumed.
+     */
+    avail = entry->csize;
+    if (entry->pos + avail < zip->mlen) {
+	avail++;
+    }
+    strm->next_in = (Bytef *)(zip->maddr + entry->pos);
+    strm->avail_in = avail;
+
+    for (;;) {
+	int status = inflate(strm, Z_PARTIAL_FLUSH);
+	if (status == Z_STREAM_END) {
+	    if (strm->total_out != (uLong)entry->size) {
+		*msg = "inflateFully: Unexpected end of stream";
+		result = JNI_FALSE;
+	    }
+	    break;
+	}
+	if (status == Z_MEM_ERROR) {
+	    *msg = "inflateFully: Out of memory";
+	    result = JNI_FALSE;
+	    break;
+	}
+	if (status != Z_OK) {
+	    /* No more progress can be made */
+	    if (strm->total_out != (uLong)entry->size) {
+		*msg = "inflateFully: Unexpected end of file";
+		result = JNI_FALSE;
+	    }
+	    break;
+	}
+    }
+    inflateEnd(strm);
+
+    return result;
+}
+#endif
+
 /*
  * This function is used by the runtime system to load compressed entries
  * from ZIP/JAR files specified in the class path. It is defined here
@@ -1175,6 +1319,12 @@ InflateFully(jzfile *zip, jzentry *entry, void *buf, char **msg)
     strm.next_out = (Bytef *)buf;
     strm.avail_out = entry->size;
 
+#ifdef CVM_ZIP_MMAP
+    if (ZIP_IsMapped(zip)) {
+	return inflateMapped(zip, entry, &strm, msg);
+    }
+#endif
+
     while (count > 0) {
 	jint n = count > (jint)sizeof(tmp) ? (jint)sizeof(tmp) : count;
 	ZIP_Lock(zip);
@@ -1245,10 +1395,15 @@ ZIP_ReadEntry(jzfile *zip, jzentry *entry, unsigned char *buf, char *entryname)
 	jint pos = 0, count = entry->size;
 	while (count > 0) {
 	    jint n;
-	    ZIP_Lock(zip);
-	    n = ZIP_Read(zip, entry, pos, buf, count);
-	    msg = zip->msg;
-	    ZIP_Unlock(zip);
+	    if (ZIP_IsMapped(zip)) {
+		n = ZIP_Read(zip, entry, pos, buf, count);
+		msg = zip->msg;
+	    } else {
+		ZIP_Lock(zip);
+		n = ZIP_Read(zip, entry, pos, buf, count);
+		msg = zip->msg;
+		ZIP_Unlock(zip);
+	    }
 	    if (n == -1) {
 		jio_fprintf(stderr, "%s: %s\n", zip->name,
 			    msg != 0 ? msg : strerror(errno));
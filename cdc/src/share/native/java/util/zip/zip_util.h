@@ -167,11 +167,10 @@ typedef struct jzfile {   /* Zip file */
     char *name;	  	  /* zip file name */
     jint mode;            /* zip file mode */
     jint refs;		  /* number of active references */
-#ifdef USE_MMAP
-    unsigned char *maddr; /* beginning address of mapped file */
-    jint len;		  /* length (in bytes) of mapped file */
-#else
     jint fd;		  /* open file descriptor */
+#ifdef CVM_ZIP_MMAP
+    unsigned char *maddr; /* beginning address of mapped file, or NULL */
+    jint mlen;		  /* length (in bytes) of mapped file */
 #endif
     void *lock;		  /* read lock */
     char *comment; 	  /* zip file comment */
@@ -206,6 +205,17 @@ typedef struct jzfile {   /* Zip file */
  */
 #define ZIP_ENDCHAIN 0xFFFF
 
+/*
+ * A mapped zip file is read straight from memory. Reads, LOC parsing and
+ * inflation need no ZIP_Lock() and no file position; only the per-zip
+ * jzentry cache is still protected by the lock.
+ */
+#ifdef CVM_ZIP_MMAP
+#define ZIP_IsMapped(zip)	((zip)->maddr != NULL)
+#else
+#define ZIP_IsMapped(zip)	JNI_FALSE
+#endif
+
 jzentry * JNICALL
 ZIP_FindEntry(jzfile *zip, const char *name, jint *sizeP, jint *nameLenP);
 
@@ -0,0 +1,112 @@
+/*
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.  
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER  
+ *   
+ * This program is free software; you can redistribute it and/or  
+ * modify it under the terms of the GNU General Public License version  
+ * 2 only, as published by the Free Software Foundation.   
+ *   
+ * This program is distributed in the hope that it will be useful, but  
+ * WITHOUT ANY WARRANTY; without even the implied warranty of  
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU  
+ * General Public License version 2 for more details (a copy is  
+ * included at /legal/license.txt).   
+ *   
+ * You should have received a copy of the GNU General Public License  
+ * version 2 along with this work; if not, write to the Free Software  
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  
+ * 02110-1301 USA   
+ *   
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa  
+ * Clara, CA 95054 or visit www.sun.com if you need additional  
+ * information or have any questions. 
+ *
+ */
+
+
+#include "javavm/include/porting/float.h"
+#include "javavm/include/porting/doubleword.h"
+
+/*
+ * The SSE2 truncating conversions (cvttss2si, cvttsd2si) return the
+ * "integer indefinite" value, i.e. the most negative integer, for NaN
+ * and for any value that does not fit. Java wants 0 for NaN and the
+ * nearest representable value otherwise, so fix up those cases here.
+ */
+
+#if (!defined(JAVA_COMPLIANT_f2i) && !defined(NAN_CHECK_f2i))
+
+CVMJavaInt
+float2Int(CVMJavaFloat f)
+{
+    if (f != f) {
+	return 0;
+    }
+    if (f >= 2147483648.0f) {
+	return 0x7fffffff;
+    }
+    if (f <= -2147483648.0f) {
+	return (CVMJavaInt)0x80000000;
+    }
+    return (CVMJavaInt)f;
+}
+
+#endif  /* (!defined(JAVA_COMPLIANT_f2i) && !defined(NAN_CHECK_f2i)) */
+
+
+#if (!defined(JAVA_COMPLIANT_f2l) && !defined(NAN_CHECK_f2l))
+
+CVMJavaLong
+float2Long(CVMJavaFloat f)
+{
+    if (f != f) {
+	return 0;
+    }
+    if (f >= 9223372036854775808.0f) {
+	return longMax;
+    }
+    if (f <= -9223372036854775808.0f) {
+	return longMin;
+    }
+    return (CVMJavaLong)f;
+}
+
+#endif /* (!defined(JAVA_COMPLIANT_f2l) && !defined(NAN_CHECK_f2l)) */
+
+#if (!defined(JAVA_COMPLIANT_d2i) && !defined(NAN_CHECK_d2i))
+
+CVMJavaInt
+double2Int(CVMJavaDouble d)
+{
+    if (d != d) {
+	return 0;
+    }
+    if (d >= 2147483647.0) {
+	return 0x7fffffff;
+    }
+    if (d <= -2147483648.0) {
+	return (CVMJavaInt)0x80000000;
+    }
+    return (CVMJavaInt)d;
+}
+
+#endif /* (!defined(JAVA_COMPLIANT_d2i) && !defined(NAN_CHECK_d2i)) */
+
+#if (!defined(JAVA_COMPLIANT_d2l) && !defined(NAN_CHECK_d2l))
+
+CVMJavaLong
+double2Long(CVMJavaDouble d)
+{
+    if (d != d) {
+	return 0;
+    }
+    if (d >= 9223372036854775808.0) {
+	return longMax;
+    }
+    if (d <= -9223372036854775808.0) {
+	return longMin;
+    }
+    return (CVMJavaLong)d;
+}
+
+#endif /* (!defined(JAVA_COMPLIANT_d2l) && !defined(NAN_CHECK_d2l)) */
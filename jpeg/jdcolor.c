@@ -83,6 +83,10 @@ typedef my_color_deconverter * my_cconvert_ptr;
 #define ONE_HALF	((INT32) 1 << (SCALEBITS-1))
 #define FIX(x)		((INT32) ((x) * (1L<<SCALEBITS) + 0.5))
 
+/* Pack 8 bit R, G and B samples into one 5/6/5 pixel */
+#define PACK_RGB565(r,g,b)  ((unsigned short) \
+	((((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | ((b) >> 3)))
+
 
 /*
  * Initialize tables for YCC->RGB colorspace conversion.
@@ -259,6 +263,51 @@ ycc_bgrx_convert (j_decompress_ptr cinfo,
 }
 
 
+/*
+ * 16 bit RGB565.
+ * The samples are packed as they are converted, so no 24 bit row has to
+ * be written and read back.  Each output row holds one native unsigned
+ * short per pixel and must be aligned accordingly.
+ */
+METHODDEF(void)
+ycc_rgb565_convert (j_decompress_ptr cinfo,
+		    JSAMPIMAGE input_buf, JDIMENSION input_row,
+		    JSAMPARRAY output_buf, int num_rows)
+{
+    my_cconvert_ptr cconvert = (my_cconvert_ptr) cinfo->cconvert;
+    register int y, cb, cr;
+    register unsigned short * outptr;
+    register JSAMPROW inptr0, inptr1, inptr2;
+    register JDIMENSION col;
+    JDIMENSION num_cols = cinfo->output_width;
+    /* copy these pointers into registers if possible */
+    register JSAMPLE * range_limit = cinfo->sample_range_limit;
+    register int * Crrtab = cconvert->Cr_r_tab;
+    register int * Cbbtab = cconvert->Cb_b_tab;
+    register INT32 * Crgtab = cconvert->Cr_g_tab;
+    register INT32 * Cbgtab = cconvert->Cb_g_tab;
+    SHIFT_TEMPS
+
+    while (--num_rows >= 0) {
+	inptr0 = input_buf[0][input_row];
+	inptr1 = input_buf[1][input_row];
+	inptr2 = input_buf[2][input_row];
+	input_row++;
+	outptr = (unsigned short *) *output_buf++;
+	for (col = 0; col < num_cols; col++) {
+	    y  = GETJSAMPLE(inptr0[col]);
+	    cb = GETJSAMPLE(inptr1[col]);
+	    cr = GETJSAMPLE(inptr2[col]);
+	    outptr[col] = PACK_RGB565(
+		range_limit[y + Crrtab[cr]],
+		range_limit[y + ((int) RIGHT_SHIFT(Cbgtab[cb] + Crgtab[cr],
+						   SCALEBITS))],
+		range_limit[y + Cbbtab[cb]]);
+	}
+    }
+}
+
+
 /**************** Cases other than YCbCr -> RGB **************/
 
 
@@ -336,6 +385,61 @@ gray_rgb_convert (j_decompress_ptr cinfo,
 }
 
 
+/*
+ * Convert grayscale to RGB565.
+ */
+
+METHODDEF(void)
+gray_rgb565_convert (j_decompress_ptr cinfo,
+		     JSAMPIMAGE input_buf, JDIMENSION input_row,
+		     JSAMPARRAY output_buf, int num_rows)
+{
+  register JSAMPROW inptr;
+  register unsigned short * outptr;
+  register JDIMENSION col;
+  register int g;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  while (--num_rows >= 0) {
+    inptr = input_buf[0][input_row++];
+    outptr = (unsigned short *) *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      g = GETJSAMPLE(inptr[col]);
+      outptr[col] = PACK_RGB565(g, g, g);
+    }
+  }
+}
+
+
+/*
+ * Convert RGB (as stored in the file) to RGB565.
+ */
+
+METHODDEF(void)
+rgb_rgb565_convert (j_decompress_ptr cinfo,
+		    JSAMPIMAGE input_buf, JDIMENSION input_row,
+		    JSAMPARRAY output_buf, int num_rows)
+{
+  register JSAMPROW inptr0, inptr1, inptr2;
+  register unsigned short * outptr;
+  register JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = (unsigned short *) *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      outptr[col] = PACK_RGB565(GETJSAMPLE(inptr0[col]),
+				GETJSAMPLE(inptr1[col]),
+				GETJSAMPLE(inptr2[col]));
+    }
+  }
+}
+
+
 /*
  * Adobe-style YCCK->CMYK conversion.
  * We convert YCbCr to R=1-C, G=1-M, and B=1-Y using the same
@@ -536,6 +640,22 @@ jm_jinit_color_deconverter (j_decompress_ptr cinfo)
       ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
     break;
 
+  case JCS_RGB565:
+    /* two JSAMPLEs hold one packed pixel */
+    cinfo->out_color_components = 2;
+    if (cinfo->quantize_colors)
+      ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+    if (cinfo->jpeg_color_space == JCS_YCbCr) {
+      cconvert->pub.color_convert = ycc_rgb565_convert;
+      build_ycc_rgb_table(cinfo);
+    } else if (cinfo->jpeg_color_space == JCS_GRAYSCALE) {
+      cconvert->pub.color_convert = gray_rgb565_convert;
+    } else if (cinfo->jpeg_color_space == JCS_RGB) {
+      cconvert->pub.color_convert = rgb_rgb565_convert;
+    } else
+      ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+    break;
+
   case JCS_CMYK:
     cinfo->out_color_components = 4;
     if (cinfo->jpeg_color_space == JCS_YCCK) {
@@ -69,10 +69,14 @@ use_merged_upsample (j_decompress_ptr cinfo)
   /* Merging is the equivalent of plain box-filter upsampling */
   if (cinfo->do_fancy_upsampling || cinfo->CCIR601_sampling)
     return FALSE;
-  /* jdmerge.c only supports YCC=>RGB color conversion */
-  if (cinfo->jpeg_color_space != JCS_YCbCr || cinfo->num_components != 3 ||
-      cinfo->out_color_space != JCS_RGB ||
-      cinfo->out_color_components != RGB_PIXELSIZE)
+  /* jdmerge.c only supports YCC=>RGB and YCC=>RGB565 color conversion */
+  if (cinfo->jpeg_color_space != JCS_YCbCr || cinfo->num_components != 3)
+    return FALSE;
+  if (cinfo->out_color_space == JCS_RGB565) {
+    if (cinfo->quantize_colors)
+      return FALSE;
+  } else if (cinfo->out_color_space != JCS_RGB ||
+	     cinfo->out_color_components != RGB_PIXELSIZE)
     return FALSE;
   /* and it only handles 2h1v or 2h2v sampling ratios */
   if (cinfo->comp_info[0].h_samp_factor != 2 ||
@@ -204,6 +208,9 @@ jm_jpeg_calc_output_dimensions (j_decompress_ptr cinfo)
   case JCS_YCbCr:
     cinfo->out_color_components = 3;
     break;
+  case JCS_RGB565:
+    cinfo->out_color_components = 2; /* two JSAMPLEs per packed pixel */
+    break;
   case JCS_CMYK:
   case JCS_YCCK:
     cinfo->out_color_components = 4;
@@ -182,6 +182,307 @@
 #endif
 
 
+/*
+ * Vector version of the routine below, selected at compile time from the
+ * instruction set the toolchain targets (SSE2 on x86-64, NEON on ARMv7-A
+ * and ARMv8).  Four columns (pass 1) or four rows (pass 2) are carried
+ * through the same 32 bit integer operations as the scalar code in the
+ * lanes of one vector, so the output is identical.
+ */
+
+#if BITS_IN_JSAMPLE == 8 && !defined(RIGHT_SHIFT_IS_UNSIGNED) && \
+    !defined(USE_ACCURATE_ROUNDING)
+#if defined(__SSE2__)
+#define IDCT_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define IDCT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(IDCT_SIMD_SSE2)
+
+typedef __m128i ivec;
+
+#define IV_SET1(c)	_mm_set1_epi32(c)
+#define IV_ADD(a,b)	_mm_add_epi32(a, b)
+#define IV_SUB(a,b)	_mm_sub_epi32(a, b)
+#define IV_SRA(a,n)	_mm_srai_epi32(a, n)
+#define IV_SLL(a,n)	_mm_slli_epi32(a, n)
+
+LOCAL(ivec)
+iv_mul (ivec a, ivec b)
+{
+  /* SSE2 has no 32x32->32 multiply; combine two 32x32->64 ones */
+  ivec even = _mm_mul_epu32(a, b);
+  ivec odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+			    _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+
+#define IV_MULC(a,c)	iv_mul(a, _mm_set1_epi32(c))
+
+LOCAL(ivec)
+iv_load_coef (JCOEFPTR p)
+{
+  ivec v = _mm_loadl_epi64((const __m128i *) p);
+
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+LOCAL(ivec)
+iv_load_quant (IFAST_MULT_TYPE * p)
+{
+  if (SIZEOF(IFAST_MULT_TYPE) == 4)
+    return _mm_loadu_si128((const __m128i *) p);
+  return _mm_set_epi32((int) p[3], (int) p[2], (int) p[1], (int) p[0]);
+}
+
+#define IV_TRANSPOSE(a,b,c,d)  {			\
+    ivec t0_ = _mm_unpacklo_epi32(a, b);		\
+    ivec t1_ = _mm_unpacklo_epi32(c, d);		\
+    ivec t2_ = _mm_unpackhi_epi32(a, b);		\
+    ivec t3_ = _mm_unpackhi_epi32(c, d);		\
+    (a) = _mm_unpacklo_epi64(t0_, t1_);			\
+    (b) = _mm_unpackhi_epi64(t0_, t1_);			\
+    (c) = _mm_unpacklo_epi64(t2_, t3_);			\
+    (d) = _mm_unpackhi_epi64(t2_, t3_);			\
+  }
+
+/* Saturate two vectors of samples to 0..255 and store them as 8 bytes */
+LOCAL(void)
+iv_store8 (JSAMPROW outptr, ivec lo, ivec hi)
+{
+  ivec v = _mm_packs_epi32(lo, hi);
+
+  _mm_storel_epi64((__m128i *) outptr, _mm_packus_epi16(v, v));
+}
+
+/* Check if all AC terms of a coefficient block are zero */
+LOCAL(boolean)
+iv_ac_zero (JCOEFPTR p)
+{
+  ivec acc = _mm_insert_epi16(_mm_loadu_si128((const __m128i *) p), 0, 0);
+  int row;
+
+  for (row = 1; row < DCTSIZE; row++)
+    acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *)
+					    (p + row * DCTSIZE)));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128()))
+	 == 0xFFFF;
+}
+
+#elif defined(IDCT_SIMD_NEON)
+
+typedef int32x4_t ivec;
+
+#define IV_SET1(c)	vdupq_n_s32(c)
+#define IV_ADD(a,b)	vaddq_s32(a, b)
+#define IV_SUB(a,b)	vsubq_s32(a, b)
+#define IV_SRA(a,n)	vshrq_n_s32(a, n)
+#define IV_SLL(a,n)	vshlq_n_s32(a, n)
+#define iv_mul(a,b)	vmulq_s32(a, b)
+#define IV_MULC(a,c)	vmulq_n_s32(a, c)
+
+#define iv_load_coef(p)	vmovl_s16(vld1_s16(p))
+
+LOCAL(ivec)
+iv_load_quant (IFAST_MULT_TYPE * p)
+{
+  int32_t q[4];
+
+  if (SIZEOF(IFAST_MULT_TYPE) == 4)
+    return vld1q_s32((const int32_t *) p);
+  q[0] = p[0]; q[1] = p[1]; q[2] = p[2]; q[3] = p[3];
+  return vld1q_s32(q);
+}
+
+#define IV_TRANSPOSE(a,b,c,d)  {				\
+    int32x4x2_t t01_ = vtrnq_s32(a, b);				\
+    int32x4x2_t t23_ = vtrnq_s32(c, d);				\
+    (a) = vcombine_s32(vget_low_s32(t01_.val[0]), vget_low_s32(t23_.val[0]));   \
+    (b) = vcombine_s32(vget_low_s32(t01_.val[1]), vget_low_s32(t23_.val[1]));   \
+    (c) = vcombine_s32(vget_high_s32(t01_.val[0]), vget_high_s32(t23_.val[0])); \
+    (d) = vcombine_s32(vget_high_s32(t01_.val[1]), vget_high_s32(t23_.val[1])); \
+  }
+
+/* Saturate two vectors of samples to 0..255 and store them as 8 bytes */
+LOCAL(void)
+iv_store8 (JSAMPROW outptr, ivec lo, ivec hi)
+{
+  int16x8_t v = vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+
+  vst1_u8(outptr, vqmovun_s16(v));
+}
+
+/* Check if all AC terms of a coefficient block are zero */
+LOCAL(boolean)
+iv_ac_zero (JCOEFPTR p)
+{
+  int16x8_t acc = vsetq_lane_s16(0, vld1q_s16(p), 0);
+  int64x2_t acc64;
+  int row;
+
+  for (row = 1; row < DCTSIZE; row++)
+    acc = vorrq_s16(acc, vld1q_s16(p + row * DCTSIZE));
+  acc64 = vreinterpretq_s64_s16(acc);
+  return (vgetq_lane_s64(acc64, 0) | vgetq_lane_s64(acc64, 1)) == 0;
+}
+
+#endif
+
+#if defined(IDCT_SIMD_SSE2) || defined(IDCT_SIMD_NEON)
+
+/* MULTIPLY() on every lane */
+#define IV_MULTIPLY(a,c)  IV_SRA(IV_MULC(a, c), CONST_BITS)
+
+/*
+ * Lane-wise range_limit[IDESCALE(x, PASS1_BITS+3) & RANGE_MASK].
+ * The table maps the masked value, read as a signed 10 bit number, to
+ * that number plus CENTERJSAMPLE clamped to 0..MAXJSAMPLE; the sign
+ * extension is done here and the clamp by the saturation in iv_store8.
+ */
+#define IV_RANGE_LIMIT(x)  \
+  IV_ADD(IV_SRA(IV_SLL(x, 22 - (PASS1_BITS+3)), 22), IV_SET1(CENTERJSAMPLE))
+
+/*
+ * One 1-D pass over eight vectors, in place.  The statements are those
+ * of the scalar passes below.
+ */
+
+LOCAL(void)
+iv_idct_1d (ivec * v)
+{
+  ivec tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+  ivec tmp10, tmp11, tmp12, tmp13;
+  ivec z5, z10, z11, z12, z13;
+
+  /* Even part */
+
+  tmp10 = IV_ADD(v[0], v[4]);	/* phase 3 */
+  tmp11 = IV_SUB(v[0], v[4]);
+
+  tmp13 = IV_ADD(v[2], v[6]);	/* phases 5-3 */
+  tmp12 = IV_SUB(IV_MULTIPLY(IV_SUB(v[2], v[6]), FIX_1_414213562), tmp13);
+
+  tmp0 = IV_ADD(tmp10, tmp13);	/* phase 2 */
+  tmp3 = IV_SUB(tmp10, tmp13);
+  tmp1 = IV_ADD(tmp11, tmp12);
+  tmp2 = IV_SUB(tmp11, tmp12);
+
+  /* Odd part */
+
+  z13 = IV_ADD(v[5], v[3]);	/* phase 6 */
+  z10 = IV_SUB(v[5], v[3]);
+  z11 = IV_ADD(v[1], v[7]);
+  z12 = IV_SUB(v[1], v[7]);
+
+  tmp7 = IV_ADD(z11, z13);	/* phase 5 */
+  tmp11 = IV_MULTIPLY(IV_SUB(z11, z13), FIX_1_414213562);
+
+  z5 = IV_MULTIPLY(IV_ADD(z10, z12), FIX_1_847759065);
+  tmp10 = IV_SUB(IV_MULTIPLY(z12, FIX_1_082392200), z5);
+  tmp12 = IV_ADD(IV_MULTIPLY(z10, - FIX_2_613125930), z5);
+
+  tmp6 = IV_SUB(tmp12, tmp7);	/* phase 2 */
+  tmp5 = IV_SUB(tmp11, tmp6);
+  tmp4 = IV_ADD(tmp10, tmp5);
+
+  v[0] = IV_ADD(tmp0, tmp7);
+  v[7] = IV_SUB(tmp0, tmp7);
+  v[1] = IV_ADD(tmp1, tmp6);
+  v[6] = IV_SUB(tmp1, tmp6);
+  v[2] = IV_ADD(tmp2, tmp5);
+  v[5] = IV_SUB(tmp2, tmp5);
+  v[4] = IV_ADD(tmp3, tmp4);
+  v[3] = IV_SUB(tmp3, tmp4);
+}
+
+
+/*
+ * Perform dequantization and inverse DCT on one block of coefficients.
+ */
+
+GLOBAL(void)
+jm_jpeg_idct_ifast (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		 JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  IFAST_MULT_TYPE * quantptr = (IFAST_MULT_TYPE *) compptr->dct_table;
+  ivec lo[DCTSIZE];		/* columns 0..3, or rows 0..3 */
+  ivec hi[DCTSIZE];		/* columns 4..7, or rows 4..7 */
+  int ctr;
+
+  /* Blocks without AC terms are common enough to be worth a check;
+   * every output sample is then the descaled DC term.
+   */
+  if (iv_ac_zero(coef_block)) {
+    JSAMPLE *range_limit = IDCT_range_limit(cinfo);
+    JSAMPLE dcval = range_limit[IDESCALE((int) DEQUANTIZE(coef_block[0],
+							   quantptr[0]),
+					 PASS1_BITS+3) & RANGE_MASK];
+
+    JSAMPROW outptr;
+    int col;
+
+    for (ctr = 0; ctr < DCTSIZE; ctr++) {
+      outptr = output_buf[ctr] + output_col;
+      for (col = 0; col < DCTSIZE; col++)
+	outptr[col] = dcval;
+    }
+    return;
+  }
+
+  /* Pass 1: process columns from input, four at a time. */
+
+  for (ctr = 0; ctr < DCTSIZE; ctr++) {
+    lo[ctr] = iv_mul(iv_load_coef(coef_block + ctr*DCTSIZE),
+		     iv_load_quant(quantptr + ctr*DCTSIZE));
+    hi[ctr] = iv_mul(iv_load_coef(coef_block + ctr*DCTSIZE + 4),
+		     iv_load_quant(quantptr + ctr*DCTSIZE + 4));
+  }
+  iv_idct_1d(lo);
+  iv_idct_1d(hi);
+
+  /* Turn the work array around so that each vector holds one column of
+   * four rows, i.e. lo[] gets rows 0..3 and hi[] rows 4..7.
+   */
+  IV_TRANSPOSE(lo[0], lo[1], lo[2], lo[3]);
+  IV_TRANSPOSE(lo[4], lo[5], lo[6], lo[7]);
+  IV_TRANSPOSE(hi[0], hi[1], hi[2], hi[3]);
+  IV_TRANSPOSE(hi[4], hi[5], hi[6], hi[7]);
+  {
+    ivec t;
+    for (ctr = 0; ctr < 4; ctr++) {
+      t = lo[4 + ctr]; lo[4 + ctr] = hi[ctr]; hi[ctr] = t;
+    }
+  }
+
+  /* Pass 2: process rows, four at a time, and range-limit. */
+
+  iv_idct_1d(lo);
+  iv_idct_1d(hi);
+  for (ctr = 0; ctr < DCTSIZE; ctr++) {
+    lo[ctr] = IV_RANGE_LIMIT(lo[ctr]);
+    hi[ctr] = IV_RANGE_LIMIT(hi[ctr]);
+  }
+
+  /* Back to one vector per half row, and out. */
+
+  IV_TRANSPOSE(lo[0], lo[1], lo[2], lo[3]);
+  IV_TRANSPOSE(lo[4], lo[5], lo[6], lo[7]);
+  IV_TRANSPOSE(hi[0], hi[1], hi[2], hi[3]);
+  IV_TRANSPOSE(hi[4], hi[5], hi[6], hi[7]);
+  for (ctr = 0; ctr < 4; ctr++) {
+    iv_store8(output_buf[ctr] + output_col, lo[ctr], lo[4 + ctr]);
+    iv_store8(output_buf[4 + ctr] + output_col, hi[ctr], hi[4 + ctr]);
+  }
+}
+
+#else /* !IDCT_SIMD */
+
 /*
  * Perform dequantization and inverse DCT on one block of coefficients.
  */
@@ -387,4 +688,6 @@ jm_jpeg_idct_ifast (j_decompress_ptr cinfo, jpeg_component_info * compptr,
   }
 }
 
+#endif /* IDCT_SIMD */
+
 #endif /* DCT_IFAST_SUPPORTED */
@@ -414,6 +414,7 @@ JPEG_To_RGB_decodeHeader(void *info,
         return 0;
     }
     jm_jpeg_read_header(cinfo, TRUE);
+    jm_jpeg_calc_output_dimensions(cinfo);
     
     *width = cinfo->output_width;
     *height = cinfo->output_height;
@@ -421,6 +422,55 @@ JPEG_To_RGB_decodeHeader(void *info,
     return 1;
 }
 
+int
+JPEG_To_RGB_decodeHeaderScaled(void *info, 
+    char *inData, int inDataLen, int targetWidth, int targetHeight,
+    int* width, int* height)
+{
+    struct jpeg_decompress_struct *cinfo =
+	(struct jpeg_decompress_struct*) info;
+    struct jmf_error_mgr2 *jerr;
+    unsigned int denom = 1;
+
+    if (JPEG_To_RGB_decodeHeader(info, inData, inDataLen,
+                                 width, height) == 0) {
+        return 0;
+    }
+
+    jerr = (struct jmf_error_mgr2 *) cinfo->err;
+    if (setjmp(jerr->setjmp_buffer)) {
+        /* If we get here, the JPEG code has signaled an error. */
+        return 0;
+    }
+
+    /*
+     * Pick the largest 1/2^n reduction the IDCT can do that still covers
+     * the target, so that the caller only ever needs to shrink further.
+     */
+    if (targetWidth > 0 && targetHeight > 0) {
+        while (denom < 8 &&
+               (cinfo->image_width + 2 * denom - 1) / (2 * denom) >=
+                   (unsigned int)targetWidth &&
+               (cinfo->image_height + 2 * denom - 1) / (2 * denom) >=
+                   (unsigned int)targetHeight) {
+            denom *= 2;
+        }
+    }
+
+    cinfo->scale_num = 1;
+    cinfo->scale_denom = denom;
+    if (denom > 1) {
+        /* box filter the chroma: lets upsampling merge with color conversion */
+        cinfo->do_fancy_upsampling = FALSE;
+    }
+    jm_jpeg_calc_output_dimensions(cinfo);
+
+    *width = cinfo->output_width;
+    *height = cinfo->output_height;
+
+    return 1;
+}
+
 int
 JPEG_To_RGB_decodeData(void *info, char *outData)
 {
@@ -467,9 +517,13 @@ int JPEG_To_RGB_decodeData2(void *info, char *outData, int outPixelSize,
     struct jpeg_decompress_struct *cinfo =
 	(struct jpeg_decompress_struct*) info;
     struct jmf_error_mgr2 *jerr = (struct jmf_error_mgr2 *) cinfo->err;
-    JSAMPROW row_pointer[1];	/* pointer to JSAMPLE row[s] */
+    JSAMPROW row_pointer[MAX_SAMP_FACTOR];	/* pointers to JSAMPLE rows */
+    JSAMPLE *rowBuf;		/* rows that do not go to outData directly */
     int rowStride;		/* physical row width in image buffer */
+    int rowBytes;		/* decoded bytes per row */
     int pixelSize;
+    int numRows;		/* rows asked for per jm_jpeg_read_scanlines */
+    int direct;			/* decode straight into outData */
 
     /*
      * Comment out unused variables.
@@ -477,14 +531,15 @@ int JPEG_To_RGB_decodeData2(void *info, char *outData, int outPixelSize,
     /* jmf_source_mgr *jmf_src = (jmf_source_mgr *) cinfo->src; */
     /* jmf_src_data *clientData = (jmf_src_data *) cinfo->client_data; */
 
-    unsigned char *outDataPtr;
     unsigned int i;
+    int j;
+    JDIMENSION y, rowsRead;
 
     if ((outPixelSize != 2) && (outPixelSize != 4)) {
         return 0;
     }
 
-    row_pointer[0] = NULL;
+    rowBuf = NULL;
 
     /* Establish the setjmp return context for jmf_error_exit to use. */
     if (setjmp(jerr->setjmp_buffer)) {
@@ -492,9 +547,14 @@ int JPEG_To_RGB_decodeData2(void *info, char *outData, int outPixelSize,
     	return 0;
     }
 
-    /* currently we support only one output format = 24-bit RGB */
-    pixelSize = 3;
-    cinfo->out_color_space = JCS_RGB;
+    if (2 == outPixelSize) {
+        /* color conversion packs the pixels to RGB565 itself */
+        pixelSize = 2;
+        cinfo->out_color_space = JCS_RGB565;
+    } else {
+        pixelSize = 3;
+        cinfo->out_color_space = JCS_RGB;
+    }
     
     jm_jpeg_start_decompress(cinfo);
 
@@ -505,54 +565,88 @@ int JPEG_To_RGB_decodeData2(void *info, char *outData, int outPixelSize,
     }
     
     /* JSAMPLEs per row in image_buffer */
-    /*rowStride = cinfo->output_width * pixelSize;*/
     rowStride = (right - left) * outPixelSize;
-    row_pointer[0] = (unsigned char *)pcsl_mem_malloc(cinfo->output_width * pixelSize);
+    rowBytes = cinfo->output_width * pixelSize;
+
+    /*
+     * The merged upsampler emits two rows at a time; asking for fewer
+     * makes it go through its spare row.
+     */
+    numRows = cinfo->rec_outbuf_height;
+    if (numRows > MAX_SAMP_FACTOR) {
+        numRows = MAX_SAMP_FACTOR;
+    }
+
+    /* full width RGB565 rows need no conversion and no copying */
+    direct = (pixelSize == outPixelSize) && (left == 0) &&
+             ((unsigned)right >= cinfo->output_width);
+
+    rowBuf = (JSAMPLE *)pcsl_mem_malloc(rowBytes * numRows);
+    if (rowBuf == NULL) {
+        jm_jpeg_abort_decompress(cinfo);
+        return 0;
+    }
 
     /* Establish the setjmp return context for jmf_error_exit to use. */
     if (setjmp(jerr->setjmp_buffer)) {
         /* If we get here, the JPEG code has signaled an error. */
-        pcsl_mem_free(row_pointer[-
-        0]);
+        pcsl_mem_free(rowBuf);
         return 0;
     }
-    outDataPtr = (unsigned char *)outData;
 
     while (cinfo->output_scanline < cinfo->output_height) {
-        /* all lines are scanned regardlessofthe needed rectangle */
-        (void) jm_jpeg_read_scanlines(cinfo, row_pointer, 1);
-        /* 
-         * after call to jm_jpeg_read_scanlines() 
-         * cinfo->output_scanline is increased by 1.
-         */
-
-        if ((cinfo->output_scanline > (unsigned)top) && 
-            (cinfo->output_scanline <= (unsigned)bottom)) {
-            /* convert pixels of the line to RGB565 format */
+        /* all lines are scanned regardless of the needed rectangle */
+        y = cinfo->output_scanline;
+        for (j = 0; j < numRows; j++) {
+            if (direct && (y + j >= (unsigned)top) &&
+                (y + j < (unsigned)bottom)) {
+                row_pointer[j] = (JSAMPROW)&outData[(y + j) * rowStride];
+            } else {
+                row_pointer[j] = rowBuf + j * rowBytes;
+            }
+        }
+
+        rowsRead = jm_jpeg_read_scanlines(cinfo, row_pointer, numRows);
+        if (direct) {
+            continue;
+        }
+
+        for (j = 0; (JDIMENSION)j < rowsRead; j++, y++) {
+            unsigned char *src = row_pointer[j];
+            unsigned char *outDataPtr;
+
+            if ((y < (unsigned)top) || (y >= (unsigned)bottom)) {
+                continue;
+            }
+
+            outDataPtr = (unsigned char *)&outData[y * rowStride];
+            if (2 == outPixelSize) {
+                /* already RGB565, copy the needed columns */
+                unsigned int end = cinfo->output_width;
+                if ((unsigned)right < end) {
+                    end = right;
+                }
+                if ((unsigned)left < end) {
+                    memcpy(outDataPtr, src + left * 2, (end - left) * 2);
+                }
+                continue;
+            }
+
             for (i = 0; i < cinfo->output_width; i++) {
                 if ((i >= (unsigned)left) && (i < (unsigned)right)) {
-                    unsigned int r = row_pointer[0][i * 3 + 0] & 0xFF;
-                    unsigned int g = row_pointer[0][i * 3 + 1] & 0xFF;
-                    unsigned int b = row_pointer[0][i * 3 + 2] & 0xFF;
-                    if (2 == outPixelSize) {
-                        ((unsigned short*)outDataPtr)[i-(unsigned)left] =
-                            ((b & 0xF8) >> 3) + ((g & 0xFC) << 3) + ((r & 0xF8) << 8);
-                    } else /* if (4 == outPixelSize) */ {
-                        ((unsigned long*)outDataPtr)[i-(unsigned)left] =
-                            (b & 0xFF) + ((g & 0xFF) << 8) + ((r & 0xFF) << 16);
-                    }
+                    unsigned int r = src[i * 3 + 0] & 0xFF;
+                    unsigned int g = src[i * 3 + 1] & 0xFF;
+                    unsigned int b = src[i * 3 + 2] & 0xFF;
+                    ((unsigned long*)outDataPtr)[i-(unsigned)left] =
+                        (b & 0xFF) + ((g & 0xFF) << 8) + ((r & 0xFF) << 16);
                 }
             }
         }
-
-        outDataPtr += rowStride;
     }
 
     jm_jpeg_finish_decompress(cinfo);
 
-    if (row_pointer[0] != NULL) {
-        pcsl_mem_free(row_pointer[0]);
-    }
+    pcsl_mem_free(rowBuf);
 
     return cinfo->output_width * cinfo->output_height * outPixelSize;
 }
@@ -46,6 +46,27 @@ void * JPEG_To_RGB_init();
 int JPEG_To_RGB_decodeHeader(void *info, char *inData, int inDataLen, 
     int* width, int* height);
 
+/**
+ * Decodes a jpeg header like JPEG_To_RGB_decodeHeader() does, and
+ * sets the decoder up to produce an image scaled down by 1/2, 1/4 or
+ * 1/8 if that still covers the target size. The scaling is done by
+ * the inverse DCT, so a reduced image costs a fraction of a full one.
+ * Chroma of a reduced image is upsampled with a box filter.
+ * JPEG_To_RGB_decodeData2() then decodes at the returned size.
+ *
+ * @param info handle returned from JPEG_To_RGB_init
+ * @param inData JPEG data
+ * @param inDataLen length of inData
+ * @param targetWidth width the image will be displayed at, 0 for any
+ * @param targetHeight height the image will be displayed at, 0 for any
+ * @param width pointer where to store decoded image width
+ * @param height pointer where to store decoded image height
+ *
+ * @return non-zero on success, zero on failure
+ */
+int JPEG_To_RGB_decodeHeaderScaled(void *info, char *inData, int inDataLen,
+    int targetWidth, int targetHeight, int* width, int* height);
+
 /**
  * Decodes a jpeg data to the provided buffer.
  * Assumes that JPEG_To_RGB_decodeHeader() has been called before,
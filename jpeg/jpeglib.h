@@ -235,7 +235,7 @@ typedef enum {
 	JCS_RGBX,		/* red/green/blue */
 	JCS_BGRX,		/* red/green/blue */
 	JCS_RGB555,		/* red/green/blue */
-	JCS_RGB565,		/* red/green/blue */
+	JCS_RGB565,		/* native 16 bit 5/6/5 red/green/blue */
 	JCS_YCbCr,		/* Y/Cb/Cr (also known as YUV) */
 	JCS_CMYK,		/* C/M/Y/K */
 	JCS_YCCK		/* Y/Cb/Cr/K */
@@ -54,6 +54,22 @@ extern "C" {
 int loadImageFromCache(SuiteIdType suiteID, const pcsl_string * resName,
                        unsigned char **bufPtr);
 
+/**
+ * Returns a native image from cache in place, without copying it.
+ * Only available where the platform maps the suite's image pack.
+ *
+ * @param suiteID   Suite id
+ * @param resName   Name of the image resource
+ * @param bufPtr    Pointer where the address of the image is stored.
+ *                  The image is read-only, stays valid for the life of
+ *                  the process, and must not be freed.
+ *
+ * @return length of the image, or -1 if the image is not cached or
+ *         the image pack cannot be mapped
+ */
+int mapImageFromCache(SuiteIdType suiteID, const pcsl_string * resName,
+                      unsigned char **bufPtr);
+
 
 /**
  * Creates a cache of natives images by iterating over all png images in the jar
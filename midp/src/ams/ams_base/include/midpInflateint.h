@@ -133,6 +133,13 @@ typedef struct _InflaterState {
     int outBufferIsAHandle; /* non-zero if decompBuffer is mem handle that
                        must be given to heapObj.addrFromHandle before using */
 
+    /* Streaming output, see inflateDataStream. sink is NULL otherwise */
+    InflateSinkFunction sink;
+    void* sinkState;
+    unsigned long outFlushed;   /* output before this offset went to sink */
+    unsigned long outDiscarded; /* output of the earlier laps of the ring */
+    unsigned long outTotal;     /* expected length of all the output */
+
     int inflateBufferIndex;
     int inflateBufferCount;
     unsigned char inflateBuffer[INFLATEBUFFERSIZE];
@@ -25,6 +25,15 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
+
+#if ENABLE_IMAGE_CACHE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <kni.h>
 
@@ -38,6 +47,7 @@
 #include <img_image.h>
 #include <midpUtilKni.h>
 #include <fileCache.h>
+#include <imageCache.h>
 
 /**
  * @file
@@ -45,20 +55,101 @@
  * Implements a cache for native images.
  * <p>
  * All images are loaded from the Jar file, converted to the native platform
- * representation, and stored as files. When an ImmutableImage is created then
- * loadCachedImage() is called to check if that particular image has been
- * cached, and if yes the native representation is loaded from the file. This
- * significantly reduce the time spent instantiating an ImmutableImage.
+ * representation, and stored in one pack file per suite. When an
+ * ImmutableImage is created then loadAndCreateImmutableImageDataFromCache0()
+ * looks the image up in the pack, and if it is there the native
+ * representation is used directly. This significantly reduce the time spent
+ * instantiating an ImmutableImage.
  * <p>
- * Each cached image is stored with the following naming conventions:
+ * The pack is stored with the following naming conventions:
  * <blockquote>
- *   <suite Id><image resource name>".tmp"
+ *   <suite Id>"images.pack.tmp"
  * </blockquote>
+ * and has the following layout:
+ * <pre>
+ *   raw image 0          (page aligned if it is a page or longer)
+ *   ...
+ *   raw image N-1
+ *   name table           (UTF-16 names of the Jar entries)
+ *   index                (ImagePackEntry[N], sorted by name hash)
+ *   trailer              (ImagePackTrailer, ends with the magic)
+ * </pre>
+ * The index is at the end so the pack can be written in one pass over the
+ * Jar. Where the platform supports it (ENABLE_IMAGE_CACHE_MMAP) the pack is
+ * mapped read-only once per process and shared by all isolates, and
+ * ImageData refers to the mapped pixels instead of copying them into the
+ * Java heap. Otherwise only the index is kept in memory and each image is
+ * read from the pack on demand.
+ * <p>
  * All cache files are deleted when a suite is updated or removed.
  * <p>
  * Note: Currently, only png and jpeg images are supported.
  */
 
+/** Magic at the very end of a pack; the last byte is the format version. */
+static const unsigned char imagePackMagic[4] = {'M', 'I', 'P', '1'};
+
+/**
+ * Images at least this long start on a boundary of this size, so that
+ * their pixels occupy whole pages of the mapping. Smaller images are only
+ * word aligned to keep the pack compact for icon-heavy suites.
+ */
+#define IMAGE_PACK_PAGE_SIZE 4096
+
+/** Alignment of small images and of the index within the pack. */
+#define IMAGE_PACK_WORD_SIZE 8
+
+/** Initial number of index entries allocated while writing a pack. */
+#define IMAGE_PACK_INITIAL_ENTRIES 32
+
+/**
+ * Describes one image in the pack. All offsets are from the start of
+ * the pack file, except nameOffset which is in jchars from the start of
+ * the name table.
+ */
+typedef struct _ImagePackEntry {
+    jint hash;
+    jint nameOffset;
+    jint nameLength;
+    jint dataOffset;
+    jint dataLength;
+} ImagePackEntry;
+
+/** The last bytes of a pack file. */
+typedef struct _ImagePackTrailer {
+    jint count;
+    jint indexOffset;
+    jint namesOffset;
+    jint namesLength;
+    unsigned char magic[4];
+} ImagePackTrailer;
+
+/** An opened pack of one suite. */
+typedef struct _ImagePack {
+    SuiteIdType suiteId;
+    /** The mapped pack, NULL if images are read from the file on demand */
+    unsigned char *base;
+    long size;
+    int count;
+    const ImagePackEntry *index;
+    const jchar *names;
+    /** Length of the name table in jchars */
+    jint namesLength;
+    /** Holds index and names if the pack is not mapped */
+    unsigned char *indexBuffer;
+    struct _ImagePack *next;
+} ImagePack;
+
+PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(IMAGE_PACK_NAME)
+    {'i', 'm', 'a', 'g', 'e', 's', '.', 'p', 'a', 'c', 'k', '\0'}
+PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_END(IMAGE_PACK_NAME);
+
+/**
+ * Packs opened in this process. Native code is shared by all isolates,
+ * so each suite's pack is opened at most once.
+ */
+static ImagePack *openedPacks = NULL;
+
 /**
  * Holds the suite ID. It is initialized during createImageCache() call
  * and used in image_cache_action() to avoid passing an additional parameter to it
@@ -80,19 +171,34 @@ static StorageIdType globalStorageId;
 static void *handle;
 
 /**
- * Holds the amount of free space in the storage. It is initialized during
- * createImageCache() call and used in image_cache_action() to avoid passing
- * an additional parameter to it.
+ * Holds the amount of free space in the storage before the pack is written.
+ * It is initialized during createImageCache() call and used in
+ * image_cache_action() to avoid passing an additional parameter to it.
  */
 static jlong remainingSpace;
 
 /**
- * Holds the amount of cached data placed into the storage. It is initialized
+ * Holds the amount of cached data placed into the storage, which is also
+ * the current length of the pack being written. It is initialized
  * during createImageCache() call and used in image_cache_action() to avoid
  * passing an additional parameter to it.
  */
 static long cachedDataSize;
 
+/**
+ * Storage handle of the pack being written by createImageCache(), and the
+ * index and name table collected for it. Like the variables above they
+ * are used by image_cache_action().
+ */
+static int packHandle = -1;
+static jboolean packFailed;
+static ImagePackEntry *packIndex;
+static int packCount;
+static int packCapacity;
+static jchar *packNames;
+static int packNamesLength;
+static int packNamesCapacity;
+
 PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(PNG_EXT1)
     {'.', 'p', 'n', 'g', '\0'}
 PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_END(PNG_EXT1);
@@ -118,6 +224,478 @@ PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(JPEG_EXT4)
 PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_END(JPEG_EXT4);
 
 
+/**
+ * Hashes an image name, the same way String.hashCode() does.
+ */
+static jint image_pack_hash(const jchar *name, int length) {
+    jint hash = 0;
+    int i;
+
+    for (i = 0; i < length; i++) {
+        hash = 31 * hash + name[i];
+    }
+
+    return hash;
+}
+
+/**
+ * Returns the offset where an image of the given length is placed if the
+ * pack currently ends at the given offset.
+ */
+static long image_pack_align(long offset, long length) {
+    long align = (length >= IMAGE_PACK_PAGE_SIZE) ?
+        IMAGE_PACK_PAGE_SIZE : IMAGE_PACK_WORD_SIZE;
+
+    return (offset + align - 1) & ~(align - 1);
+}
+
+/**
+ * Writes data to the pack being created, remembering any failure.
+ */
+static void image_pack_write(char *data, long length) {
+    char *errmsg = NULL;
+
+    if (packFailed || length <= 0) {
+        return;
+    }
+
+    storageWrite(&errmsg, packHandle, data, length);
+    if (errmsg != NULL) {
+        REPORT_WARN1(LC_LOWUI, "Warning: could not write image cache; %s\n",
+                     errmsg);
+        storageFreeError(errmsg);
+        packFailed = KNI_TRUE;
+        return;
+    }
+
+    cachedDataSize += length;
+}
+
+/**
+ * Pads the pack being created with zeros up to the given offset.
+ */
+static void image_pack_pad(long offset) {
+    static char zeros[256];
+
+    while (cachedDataSize < offset && !packFailed) {
+        long n = offset - cachedDataSize;
+        image_pack_write(zeros, n < (long)sizeof(zeros) ? n : sizeof(zeros));
+    }
+}
+
+/**
+ * Appends an image to the pack being created and records it in the index.
+ *
+ * @param entry name of the Jar entry the image was decoded from
+ * @param data the raw image
+ * @param length length of the raw image
+ * @return KNI_TRUE if the image was added
+ */
+static jboolean image_pack_append(const pcsl_string *entry,
+                                  unsigned char *data, int length) {
+    const jchar *name;
+    jsize nameLength = pcsl_string_utf16_length(entry);
+    ImagePackEntry *e;
+
+    if (packCount == packCapacity) {
+        int capacity = (packCapacity == 0) ?
+            IMAGE_PACK_INITIAL_ENTRIES : packCapacity * 2;
+        ImagePackEntry *newIndex =
+            midpRealloc(packIndex, capacity * sizeof(ImagePackEntry));
+        if (newIndex == NULL) {
+            return KNI_FALSE;
+        }
+        packIndex = newIndex;
+        packCapacity = capacity;
+    }
+
+    if (packNamesLength + nameLength > packNamesCapacity) {
+        int capacity = (packNamesCapacity + nameLength) * 2;
+        jchar *newNames = midpRealloc(packNames, capacity * sizeof(jchar));
+        if (newNames == NULL) {
+            return KNI_FALSE;
+        }
+        packNames = newNames;
+        packNamesCapacity = capacity;
+    }
+
+    name = pcsl_string_get_utf16_data(entry);
+    if (name == NULL) {
+        return KNI_FALSE;
+    }
+
+    image_pack_pad(image_pack_align(cachedDataSize, length));
+
+    e = &packIndex[packCount];
+    e->hash = image_pack_hash(name, nameLength);
+    e->nameOffset = packNamesLength;
+    e->nameLength = nameLength;
+    e->dataOffset = cachedDataSize;
+    e->dataLength = length;
+
+    image_pack_write((char*)data, length);
+
+    if (!packFailed) {
+        memcpy(packNames + packNamesLength, name, nameLength * sizeof(jchar));
+        packNamesLength += nameLength;
+        packCount++;
+    }
+
+    pcsl_string_release_utf16_data(name, entry);
+
+    return !packFailed;
+}
+
+/**
+ * Orders index entries by name hash.
+ */
+static int image_pack_compare(const void *a, const void *b) {
+    jint ha = ((const ImagePackEntry*)a)->hash;
+    jint hb = ((const ImagePackEntry*)b)->hash;
+
+    return (ha < hb) ? -1 : (ha > hb) ? 1 : 0;
+}
+
+/**
+ * Writes the name table, the index and the trailer of the pack being
+ * created.
+ */
+static void image_pack_finish() {
+    ImagePackTrailer trailer;
+
+    qsort(packIndex, packCount, sizeof(ImagePackEntry), image_pack_compare);
+
+    image_pack_pad(image_pack_align(cachedDataSize, 0));
+    trailer.namesOffset = cachedDataSize;
+    trailer.namesLength = packNamesLength;
+    image_pack_write((char*)packNames, packNamesLength * sizeof(jchar));
+
+    image_pack_pad(image_pack_align(cachedDataSize, 0));
+    trailer.indexOffset = cachedDataSize;
+    trailer.count = packCount;
+    image_pack_write((char*)packIndex, packCount * sizeof(ImagePackEntry));
+
+    memcpy(trailer.magic, imagePackMagic, sizeof(trailer.magic));
+    image_pack_write((char*)&trailer, sizeof(trailer));
+}
+
+/**
+ * Frees the index collected while writing a pack.
+ */
+static void image_pack_free_index() {
+    midpFree(packIndex);
+    midpFree(packNames);
+    packIndex = NULL;
+    packNames = NULL;
+    packCount = packCapacity = 0;
+    packNamesLength = packNamesCapacity = 0;
+}
+
+/**
+ * Checks the trailer of a pack against the size of the pack.
+ *
+ * @return KNI_TRUE if the index and name table lie within the pack
+ */
+static jboolean image_pack_check(const ImagePackTrailer *trailer, long size) {
+    long indexEnd;
+
+    if (memcmp(trailer->magic, imagePackMagic, sizeof(imagePackMagic)) != 0 ||
+            trailer->count < 0 || trailer->namesLength < 0 ||
+            trailer->namesOffset < 0 || trailer->indexOffset < 0 ||
+            (trailer->namesOffset % IMAGE_PACK_WORD_SIZE) != 0 ||
+            (trailer->indexOffset % IMAGE_PACK_WORD_SIZE) != 0) {
+        return KNI_FALSE;
+    }
+
+    indexEnd = trailer->indexOffset +
+        (long)trailer->count * sizeof(ImagePackEntry);
+
+    return (trailer->namesOffset + (long)trailer->namesLength * sizeof(jchar)
+                <= trailer->indexOffset &&
+            indexEnd + (long)sizeof(ImagePackTrailer) == size);
+}
+
+/**
+ * Builds the full path of the pack of the given suite.
+ *
+ * @return MIDP_ERROR_NONE if successful
+ */
+static MIDPError image_pack_path(SuiteIdType suiteId, pcsl_string *path) {
+    StorageIdType storageId;
+    MIDPError errorCode;
+
+    /*
+     * IMPL_NOTE: here is assumed that the image cache is located in
+     * the same storage as the midlet suite. This may not be true.
+     */
+    errorCode = midp_suite_get_suite_storage(suiteId, &storageId);
+    if (errorCode != ALL_OK) {
+        return errorCode;
+    }
+
+    return midp_suite_get_cached_resource_filename(suiteId, storageId,
+                                                   &IMAGE_PACK_NAME, path);
+}
+
+#if ENABLE_IMAGE_CACHE_MMAP
+
+/**
+ * Maps the whole pack read-only. The mapping is shared with every other
+ * process that maps the same pack.
+ *
+ * @return KNI_TRUE if the pack was mapped
+ */
+static jboolean image_pack_map(const pcsl_string *path, ImagePack *pack) {
+    const jbyte *fileName = pcsl_string_get_utf8_data(path);
+    const ImagePackTrailer *trailer;
+    struct stat st;
+    void *base;
+    int fd;
+
+    if (fileName == NULL) {
+        return KNI_FALSE;
+    }
+    fd = open((const char*)fileName, O_RDONLY);
+    pcsl_string_release_utf8_data(fileName, path);
+    if (fd < 0) {
+        return KNI_FALSE;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(ImagePackTrailer)) {
+        close(fd);
+        return KNI_FALSE;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return KNI_FALSE;
+    }
+
+    trailer = (const ImagePackTrailer*)
+        ((unsigned char*)base + st.st_size - sizeof(ImagePackTrailer));
+    if (!image_pack_check(trailer, st.st_size)) {
+        REPORT_WARN(LC_LOWUI, "Warning: image cache is corrupted\n");
+        munmap(base, st.st_size);
+        return KNI_FALSE;
+    }
+
+    pack->base = (unsigned char*)base;
+    pack->size = st.st_size;
+    pack->count = trailer->count;
+    pack->index = (const ImagePackEntry*)(pack->base + trailer->indexOffset);
+    pack->names = (const jchar*)(pack->base + trailer->namesOffset);
+    pack->namesLength = trailer->namesLength;
+
+    return KNI_TRUE;
+}
+
+#else
+
+/**
+ * Reads the index and the name table of the pack into memory, images
+ * are read from the pack when they are loaded.
+ *
+ * @return KNI_TRUE if the index was read
+ */
+static jboolean image_pack_map(const pcsl_string *path, ImagePack *pack) {
+    ImagePackTrailer trailer;
+    char *errmsg = NULL;
+    unsigned char *buffer = NULL;
+    long size;
+    long indexSize;
+    long namesSize;
+    jboolean status = KNI_FALSE;
+    int file;
+
+    file = storage_open(&errmsg, path, OPEN_READ);
+    if (errmsg != NULL) {
+        storageFreeError(errmsg);
+        return KNI_FALSE;
+    }
+
+    do {
+        size = storageSizeOf(&errmsg, file);
+        if (errmsg != NULL || size < (long)sizeof(trailer)) {
+            break;
+        }
+
+        storagePosition(&errmsg, file, size - sizeof(trailer));
+        if (errmsg != NULL || storageRead(&errmsg, file, (char*)&trailer,
+                sizeof(trailer)) != (long)sizeof(trailer)) {
+            break;
+        }
+
+        if (!image_pack_check(&trailer, size)) {
+            REPORT_WARN(LC_LOWUI, "Warning: image cache is corrupted\n");
+            break;
+        }
+
+        /* The name table is followed by the index, both word aligned */
+        namesSize = trailer.indexOffset - trailer.namesOffset;
+        indexSize = trailer.count * sizeof(ImagePackEntry);
+        buffer = midpMalloc(namesSize + indexSize);
+        if (buffer == NULL) {
+            break;
+        }
+
+        storagePosition(&errmsg, file, trailer.namesOffset);
+        if (errmsg != NULL || storageRead(&errmsg, file, (char*)buffer,
+                namesSize + indexSize) != namesSize + indexSize) {
+            break;
+        }
+
+        pack->base = NULL;
+        pack->size = size;
+        pack->count = trailer.count;
+        pack->index = (const ImagePackEntry*)(buffer + namesSize);
+        pack->names = (const jchar*)buffer;
+        pack->namesLength = trailer.namesLength;
+        pack->indexBuffer = buffer;
+        buffer = NULL;
+        status = KNI_TRUE;
+    } while (0);
+
+    if (errmsg != NULL) {
+        storageFreeError(errmsg);
+    }
+    midpFree(buffer);
+    storageClose(&errmsg, file);
+    if (errmsg != NULL) {
+        storageFreeError(errmsg);
+    }
+
+    return status;
+}
+
+#endif /* ENABLE_IMAGE_CACHE_MMAP */
+
+/**
+ * Returns the pack of the given suite, opening it on first use.
+ *
+ * @return the pack, or NULL if the suite has no usable pack
+ */
+static ImagePack *image_pack_get(SuiteIdType suiteId) {
+    ImagePack *pack;
+    pcsl_string path;
+
+    for (pack = openedPacks; pack != NULL; pack = pack->next) {
+        if (pack->suiteId == suiteId) {
+            return pack;
+        }
+    }
+
+    if (image_pack_path(suiteId, &path) != ALL_OK) {
+        return NULL;
+    }
+
+    pack = (ImagePack*)midpMalloc(sizeof(ImagePack));
+    if (pack != NULL) {
+        memset(pack, 0, sizeof(ImagePack));
+        if (image_pack_map(&path, pack)) {
+            pack->suiteId = suiteId;
+            pack->next = openedPacks;
+            openedPacks = pack;
+        } else {
+            midpFree(pack);
+            pack = NULL;
+        }
+    }
+
+    pcsl_string_free(&path);
+
+    return pack;
+}
+
+/**
+ * Forgets the opened pack of the given suite, so that the next load
+ * opens the pack file again. Called when the cache is recreated.
+ * <p>
+ * IMPL_NOTE: a mapped pack is not unmapped since immutable images
+ * created from it may still refer to its pixels; the old file is already
+ * deleted so only its address space is held until the process exits.
+ */
+static void image_pack_forget(SuiteIdType suiteId) {
+    ImagePack **link;
+
+    for (link = &openedPacks; *link != NULL; link = &(*link)->next) {
+        ImagePack *pack = *link;
+        if (pack->suiteId == suiteId) {
+            *link = pack->next;
+            if (pack->base == NULL) {
+                midpFree(pack->indexBuffer);
+                midpFree(pack);
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Looks an image up in the index of a pack.
+ *
+ * @param pack the opened pack
+ * @param resName the image resource name, may start with a slash
+ * @return the index entry, or NULL if the image is not in the pack
+ */
+static const ImagePackEntry *image_pack_find(const ImagePack *pack,
+                                             const pcsl_string *resName) {
+    const ImagePackEntry *found = NULL;
+    const jchar *name;
+    const jchar *key;
+    jsize length;
+    jint hash;
+    int lo = 0;
+    int hi = pack->count;
+
+    name = pcsl_string_get_utf16_data(resName);
+    if (name == NULL) {
+        return NULL;
+    }
+    key = name;
+    length = pcsl_string_utf16_length(resName);
+
+    /* If resource starts with slash, remove it */
+    if (length > 0 && key[0] == '/') {
+        key++;
+        length--;
+    }
+
+    hash = image_pack_hash(key, length);
+
+    /* Find the first entry with the hash, then compare the names */
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (pack->index[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < pack->count && pack->index[lo].hash == hash; lo++) {
+        const ImagePackEntry *e = &pack->index[lo];
+        /* A corrupted entry must not point outside of the name table */
+        if (e->nameOffset < 0 || e->nameLength < 0 ||
+                e->nameOffset + (long)e->nameLength > pack->namesLength) {
+            continue;
+        }
+        if (e->nameLength == length &&
+                memcmp(pack->names + e->nameOffset, key,
+                       length * sizeof(jchar)) == 0) {
+            if (e->dataOffset >= 0 && e->dataLength > 0 &&
+                    e->dataOffset + (long)e->dataLength <= pack->size) {
+                found = e;
+            }
+            break;
+        }
+    }
+
+    pcsl_string_release_utf16_data(name, resName);
+
+    return found;
+}
+
 /**
  * Tests if JAR entry is a PNG or JPEG image, by name extension
  */
@@ -137,7 +715,7 @@ static jboolean image_filter(const pcsl_string * entry) {
 }
 
 /**
- * Loads PNG or JPEG image from JAR, decodes it and writes as native
+ * Loads PNG or JPEG image from JAR, decodes it and appends it to the pack
  */
 static jboolean image_cache_action(const pcsl_string * entry) {
     unsigned char *pngBufPtr = NULL;
@@ -147,6 +725,10 @@ static jboolean image_cache_action(const pcsl_string * entry) {
     jboolean status = KNI_FALSE;
 
     do {
+        if (packFailed) {
+            break;
+        }
+
         pngBufLen = midpGetJarEntry(handle, entry, &pngBufPtr);
         if (pngBufLen < 0) {
             break;
@@ -157,23 +739,21 @@ static jboolean image_cache_action(const pcsl_string * entry) {
             break;
         }
 
-        /* Check if we can store this file in the remaining storage space */
-        if (remainingSpace - IMAGE_CACHE_THRESHOLD < (long)nativeBufLen) {
+        /*
+         * Check if we can store this image in the remaining storage space,
+         * counting the alignment padding in front of it
+         */
+        if (remainingSpace - IMAGE_CACHE_THRESHOLD <
+                image_pack_align(cachedDataSize, nativeBufLen) +
+                    (long)nativeBufLen) {
             break;
         }
 
-        /* write native buffer to persistent store */
         /* status = KNI_TRUE on success */
-        status = storeFileToCache(globalSuiteId, globalStorageId, entry,
-                                   nativeBufPtr, nativeBufLen);
+        status = image_pack_append(entry, nativeBufPtr, nativeBufLen);
 
     } while (0);
 
-    if (status != KNI_FALSE) {
-        remainingSpace -= nativeBufLen;
-        cachedDataSize += nativeBufLen;
-    }
-
     if (nativeBufPtr != NULL) {
         midpFree(nativeBufPtr);
     }
@@ -218,8 +798,8 @@ static int loadAndCacheJarFileEntries(const pcsl_string * jarFileName,
 
 /**
  * Creates a cache of natives images by iterating over all png and jpeg images
- * in the jar file, loading each one, decoding it into native, and caching it
- * persistent store.
+ * in the jar file, loading each one, decoding it into native, and writing
+ * them all to the suite's image pack in persistent store.
  *
  * @param suiteId The suite ID
  * @param storageId ID of the storage where to create the cache
@@ -229,6 +809,8 @@ static int loadAndCacheJarFileEntries(const pcsl_string * jarFileName,
 void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
                       jint* pOutDataSize) {
     pcsl_string jarFileName;
+    pcsl_string packFileName;
+    char* errmsg = NULL;
     int result;
     jint errorCode;
 
@@ -244,12 +826,21 @@ void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
     globalStorageId = storageId;
 
     cachedDataSize = 0;
-    
+    packFailed = KNI_FALSE;
+
+    if (pOutDataSize != NULL) {
+        *pOutDataSize = 0;
+    }
+
+    /* Images of the old cache must not be found any more */
+    image_pack_forget(suiteId);
+
     /*
      * First, blow away any existing cache. Note: when a suite is
      * removed, midp_remove_suite() removes all files associated with
      * a suite, including the cache, so we don't have to do it
-     * explicitly.
+     * explicitly. The old pack is unlinked rather than truncated, so
+     * a process that still maps it is not affected.
      */
     deleteFileCache(suiteId, storageId);
 
@@ -263,18 +854,49 @@ void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
         return;
     }
 
+    errorCode = midp_suite_get_cached_resource_filename(suiteId, storageId,
+                                                        &IMAGE_PACK_NAME,
+                                                        &packFileName);
+    if (errorCode != MIDP_ERROR_NONE) {
+        pcsl_string_free(&jarFileName);
+        return;
+    }
+
+    packHandle = storage_open(&errmsg, &packFileName, OPEN_READ_WRITE_TRUNCATE);
+    if (errmsg != NULL) {
+        REPORT_WARN1(LC_LOWUI, "Warning: could not open image cache; %s\n",
+                     errmsg);
+        storageFreeError(errmsg);
+        pcsl_string_free(&packFileName);
+        pcsl_string_free(&jarFileName);
+        return;
+    }
+
     result = loadAndCacheJarFileEntries(&jarFileName,
         (jboolean (*)(const pcsl_string *))&image_filter,
         (jboolean (*)(const pcsl_string *))&image_cache_action);
 
+    if (result == 1 && packCount > 0) {
+        image_pack_finish();
+    }
+
+    storageClose(&errmsg, packHandle);
+    if (errmsg != NULL) {
+        storageFreeError(errmsg);
+    }
+    packHandle = -1;
+
     /* If something went wrong then clean up anything that was created */
-    if (result != 1) {
+    if (result != 1 || packFailed) {
         REPORT_WARN1(LC_LOWUI,
             "Warning: image cache could not be created; Error: %d\n",
             result);
         deleteFileCache(suiteId, storageId);
-        if (pOutDataSize != NULL) {
-            *pOutDataSize = 0;
+    } else if (packCount == 0) {
+        /* No image was cached, don't leave an empty pack behind */
+        storage_delete_file(&errmsg, &packFileName);
+        if (errmsg != NULL) {
+            storageFreeError(errmsg);
         }
     } else {
         if (pOutDataSize != NULL) {
@@ -282,6 +904,8 @@ void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
         }
     }
 
+    image_pack_free_index();
+    pcsl_string_free(&packFileName);
     pcsl_string_free(&jarFileName);
 }
 
@@ -310,7 +934,100 @@ void moveImageCache(SuiteIdType suiteId, StorageIdType storageIdFrom,
  */
 int loadImageFromCache(SuiteIdType suiteId, const pcsl_string * resName,
                        unsigned char **bufPtr) {
+    const ImagePackEntry *entry;
+    ImagePack *pack;
+    pcsl_string path;
+    char *errmsg = NULL;
+    int len = -1;
+    int file;
+
+    if (suiteId == UNUSED_SUITE_ID || pcsl_string_is_null(resName)) {
+        return len;
+    }
 
-    return loadFileFromCache(suiteId, resName, bufPtr);
+    pack = image_pack_get(suiteId);
+    if (pack == NULL) {
+        return len;
+    }
+
+    entry = image_pack_find(pack, resName);
+    if (entry == NULL) {
+        return len;
+    }
+
+    *bufPtr = midpMalloc(entry->dataLength);
+    if (*bufPtr == NULL) {
+        return len;
+    }
+
+    if (pack->base != NULL) {
+        memcpy(*bufPtr, pack->base + entry->dataOffset, entry->dataLength);
+        return entry->dataLength;
+    }
+
+    if (image_pack_path(suiteId, &path) != ALL_OK) {
+        midpFree(*bufPtr);
+        return len;
+    }
+
+    file = storage_open(&errmsg, &path, OPEN_READ);
+    pcsl_string_free(&path);
+    if (errmsg != NULL) {
+        REPORT_WARN1(LC_LOWUI,"Warning: could not load cached image; %s\n",
+                     errmsg);
+        storageFreeError(errmsg);
+        midpFree(*bufPtr);
+        return len;
+    }
+
+    storagePosition(&errmsg, file, entry->dataOffset);
+    if (errmsg == NULL && storageRead(&errmsg, file, (char*)*bufPtr,
+            entry->dataLength) == entry->dataLength) {
+        len = entry->dataLength;
+    } else {
+        midpFree(*bufPtr);
+    }
+    if (errmsg != NULL) {
+        storageFreeError(errmsg);
+    }
+
+    storageClose(&errmsg, file);
+    if (errmsg != NULL) {
+        storageFreeError(errmsg);
+    }
+
+    return len;
 }
 
+/**
+ * Returns a native image from cache in place, if present and the
+ * platform maps the image pack.
+ *
+ * @param suiteId    The suite id
+ * @param resName    The image resource name
+ * @param **bufPtr   Pointer where the address of the image is stored
+ * @return           -1 if failed, else length of the image
+ */
+int mapImageFromCache(SuiteIdType suiteId, const pcsl_string * resName,
+                      unsigned char **bufPtr) {
+    const ImagePackEntry *entry;
+    ImagePack *pack;
+
+    if (suiteId == UNUSED_SUITE_ID || pcsl_string_is_null(resName)) {
+        return -1;
+    }
+
+    pack = image_pack_get(suiteId);
+    if (pack == NULL || pack->base == NULL) {
+        return -1;
+    }
+
+    entry = image_pack_find(pack, resName);
+    if (entry == NULL) {
+        return -1;
+    }
+
+    *bufPtr = pack->base + entry->dataOffset;
+
+    return entry->dataLength;
+}
@@ -42,6 +42,9 @@ static int makeCodeTable(InflaterState *state,
 
 static int inflateHuffman(InflaterState *state, int fixedHuffman);
 static int inflateStored(InflaterState *state);
+static int inflateBlocks(InflaterState *state, FileObj* fileObj,
+                         HeapManObj* heapManObj, int compLen);
+static int flushWindow(InflaterState *state, unsigned char *outBuffer);
 
 #define INFLATER_EXTRA_BYTES 4
 
@@ -73,16 +76,85 @@ static int inflateStored(InflaterState *state);
 int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
                 unsigned char* decompBuffer, int decompLen,
                 int bufferIsAHandle) {
-    /* The macros LOAD_IN, LOAD_OUT,etc. use a variable called "state" */
     InflaterState stateStruct;
     InflaterState* state = &stateStruct;
-    int result = 0;
 
     state->outBuffer = decompBuffer;
     state->outOffset = 0;
     state->outLength = decompLen;
     state->outBufferIsAHandle = bufferIsAHandle;
 
+    state->sink = NULL;
+    state->sinkState = NULL;
+    state->outFlushed = 0;
+    state->outDiscarded = 0;
+    state->outTotal = decompLen;
+
+    return inflateBlocks(state, fileObj, heapManObj, compLen);
+}
+
+/**
+ * Inflates the data in a file, passing the output to a sink function as
+ * it is produced.
+ * <p>
+ * The window is filled like the output buffer of inflateData, but as a
+ * ring: when it is full, its unseen part is handed to the sink and
+ * output continues at its start, overwriting the oldest bytes. Back
+ * references reach at most INFLATE_HISTORY_SIZE bytes back, so nothing
+ * they need is lost and no history has to be moved.</p>
+ *
+ * @param fileObj File object for reading the compressed data with the
+ *                current file position set to the beginning of the data
+ * @param heapManObj Heap manager object for temp data
+ * @param compLen Length of the compressed data
+ * @param window scratch buffer of at least INFLATE_MIN_WINDOW_SIZE bytes
+ * @param windowLen size of the window
+ * @param decompLen Expected length of the uncompressed data
+ * @param sink function receiving the output
+ * @param sinkState passed to sink
+ *
+ * @return 0 for success else an error status
+ */
+int inflateDataStream(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
+                      unsigned char* window, int windowLen, int decompLen,
+                      InflateSinkFunction sink, void* sinkState) {
+    InflaterState stateStruct;
+    InflaterState* state = &stateStruct;
+    int result;
+
+    if (windowLen < INFLATE_MIN_WINDOW_SIZE) {
+        return OUT_OF_MEMORY_ERROR;
+    }
+
+    state->outBuffer = window;
+    state->outOffset = 0;
+    state->outLength = windowLen;
+    state->outBufferIsAHandle = 0;
+
+    state->sink = sink;
+    state->sinkState = sinkState;
+    state->outFlushed = 0;
+    state->outDiscarded = 0;
+    state->outTotal = decompLen;
+
+    result = inflateBlocks(state, fileObj, heapManObj, compLen);
+    if (result == 0 && state->outOffset > state->outFlushed) {
+        result = sink(sinkState, window + state->outFlushed,
+                      (int)(state->outOffset - state->outFlushed));
+    }
+
+    return result;
+}
+
+/**
+ * Inflates all the deflate blocks of the input into the output set up
+ * in the state by inflateData or inflateDataStream.
+ */
+static int inflateBlocks(InflaterState *state, FileObj* fileObj,
+                         HeapManObj* heapManObj, int compLen) {
+    /* The macros LOAD_IN, LOAD_OUT,etc. use a variable called "state" */
+    int result = 0;
+
     state->fileState = fileObj->state;
     state->getBytes = fileObj->read;
 
@@ -138,7 +210,7 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
                 break;
             }
 
-            if (state->outOffset != state->outLength) {
+            if (state->outDiscarded + state->outOffset != state->outTotal) {
                 result = INFLATE_OUTPUT_BIT_ERROR;
                 break;
             }
@@ -151,6 +223,32 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
     return result;
 }
 
+/**
+ * Hands the output not yet seen by the sink over to it. When the ring
+ * is full, output continues at its start.
+ */
+static int flushWindow(InflaterState *state, unsigned char *outBuffer) {
+    unsigned long outOffset = state->outOffset;
+    int result;
+
+    if (outOffset > state->outFlushed) {
+        result = state->sink(state->sinkState,
+                             outBuffer + state->outFlushed,
+                             (int)(outOffset - state->outFlushed));
+        if (result != 0) {
+            return result;
+        }
+    }
+
+    state->outFlushed = outOffset;
+    if (outOffset == state->outLength) {
+        state->outDiscarded += outOffset;
+        state->outOffset = 0;
+        state->outFlushed = 0;
+    }
+    return 0;
+}
+
 static int inflateStored(InflaterState *state) {
     DECLARE_IN_VARIABLES
     DECLARE_OUT_VARIABLES
@@ -171,7 +269,7 @@ static int inflateStored(InflaterState *state) {
         return INFLATE_BAD_LENGTH_FIELD;
     } else if (inRemaining < len) {
         return INFLATE_INPUT_OVERFLOW;
-    } else if (outOffset + len > outLength) {
+    } else if (state->outDiscarded + outOffset + len > state->outTotal) {
         return INFLATE_OUTPUT_OVERFLOW;
     } else {
         int count;
@@ -183,12 +281,27 @@ static int inflateStored(InflaterState *state) {
         }
 
         while (len > 0) {
+            if (outOffset == outLength) {
+                /* streaming, the ring is full */
+                int error;
+                STORE_OUT;
+                error = flushWindow(state, outBuffer);
+                if (error != 0) {
+                    return error;
+                }
+                LOAD_OUT;
+            }
+
             if (state->inflateBufferCount > 0) {
                 /* we have data buffered, copy it first */
+                count = state->inflateBufferCount <= len ?
+                    state->inflateBufferCount : len;
+                if ((unsigned long)count > outLength - outOffset) {
+                    count = outLength - outOffset;
+                }
                 memcpy(&outBuffer[outOffset],
                        &(state->inflateBuffer[state->inflateBufferIndex]),
-                       (count = (state->inflateBufferCount <= len ?
-                                 state->inflateBufferCount : len)));
+                       count);
                 len -= count;
                 (state->inflateBufferCount) -= count;
                 (state->inflateBufferIndex) += count;
@@ -196,7 +309,7 @@ static int inflateStored(InflaterState *state) {
                 inRemaining -= count;
             }
 
-            if (len > 0) {
+            if (len > 0 && outOffset < outLength) {
                 /* need more, refill the buffer */
                 outBuffer[outOffset++] = (unsigned char)(NEXTBYTE);
                 len--;
@@ -256,6 +369,16 @@ static int inflateHuffman(InflaterState *state, int fixedHuffman) {
             break;
         }
 
+        if (outOffset == outLength && state->sink != NULL) {
+            /* streaming, the ring is full */
+            STORE_OUT;
+            error = flushWindow(state, outBuffer);
+            if (error != 0) {
+                break;
+            }
+            LOAD_OUT;
+        }
+
         NEEDBITS(MAX_BITS + MAX_ZIP_EXTRA_LENGTH_BITS);
 
         if (fixedHuffman) {
@@ -287,7 +410,7 @@ static int inflateHuffman(InflaterState *state, int fixedHuffman) {
         }
 
         if (litxlen <= 255) {
-            if (outOffset < outLength) {
+            if (state->outDiscarded + outOffset < state->outTotal) {
                 outBuffer[outOffset] = litxlen;
                 outOffset++;
             } else {
@@ -329,12 +452,35 @@ static int inflateHuffman(InflaterState *state, int fixedHuffman) {
             distance += NEXTBITS(moreBits);
             DUMPBITS(moreBits);
 
-            if (outOffset < distance) {
+            if (state->outDiscarded + outOffset < distance) {
                 error = INFLATE_COPY_UNDERFLOW;
                 break;
-            } else if (outOffset + length > outLength) {
+            } else if (state->outDiscarded + outOffset + length >
+                       state->outTotal) {
                 error = INFLATE_OUTPUT_OVERFLOW;
                 break;
+            } else if (state->sink != NULL) {
+                /* streaming, both ends of the copy may wrap the ring */
+                unsigned long prev = (outOffset >= distance) ?
+                    outOffset - distance : outOffset + outLength - distance;
+                while (length > 0) {
+                    if (outOffset == outLength) {
+                        STORE_OUT;
+                        error = flushWindow(state, outBuffer);
+                        if (error != 0) {
+                            break;
+                        }
+                        LOAD_OUT;
+                    }
+                    outBuffer[outOffset++] = outBuffer[prev++];
+                    if (prev == outLength) {
+                        prev = 0;
+                    }
+                    length--;
+                }
+                if (error != 0) {
+                    break;
+                }
             } else {
                 unsigned long prev = outOffset - distance;
                 unsigned long end = outOffset + length;
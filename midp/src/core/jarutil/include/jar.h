@@ -309,6 +309,55 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
                 unsigned char* decompBuffer, int decompLen,
                 int bufferIsAHandle);
 
+/**
+ * Number of most recent output bytes a deflate stream can refer back to.
+ */
+#define INFLATE_HISTORY_SIZE 32768
+
+/**
+ * Smallest window that can be given to inflateDataStream: the window is
+ * used as a ring, so it only has to hold the history.
+ */
+#define INFLATE_MIN_WINDOW_SIZE INFLATE_HISTORY_SIZE
+
+/**
+ * Receives the next piece of output of inflateDataStream.
+ *
+ * @param state the sinkState given to inflateDataStream
+ * @param data decompressed bytes, only valid during the call
+ * @param len number of bytes at data
+ *
+ * @return 0 to continue inflating, or a non-zero status to stop, which
+ *         is then returned from inflateDataStream
+ */
+typedef int (*InflateSinkFunction)(void* state, unsigned char* data,
+                                   int len);
+
+/**
+ * Inflates the data in a file, passing the output to a sink function as
+ * it is produced instead of storing all of it. Only the window, which
+ * holds the data back references may still point to, has to be in
+ * memory at once.
+ * <p>
+ * The same NOTE as for inflateData applies.</p>
+ *
+ * @param fileObj File object for reading the compressed data with the
+ *                current file position set to the beginning of the data
+ * @param heapManObj Heap object for temp data
+ * @param compLen Length of the compressed data
+ * @param window scratch buffer of at least INFLATE_MIN_WINDOW_SIZE bytes,
+ *               larger windows mean fewer and bigger pieces for the sink
+ * @param windowLen size of the window
+ * @param decompLen Expected length of the uncompressed data
+ * @param sink function receiving the output
+ * @param sinkState passed to sink
+ *
+ * @return 0 for success else an error status
+ */
+int inflateDataStream(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
+                      unsigned char* window, int windowLen, int decompLen,
+                      InflateSinkFunction sink, void* sinkState);
+
 /**
  * @name Inflate errors.
  * @{
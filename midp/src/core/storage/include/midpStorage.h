@@ -280,6 +280,18 @@ void storageWrite(char** ppszError, int handle, char* buffer, long length);
  */
 void storageCommitWrite(char** ppszError, int handle);
 
+/**
+ * Forces the writes made so far to stable storage, so that they
+ * survive a power loss. Slower than storageCommitWrite(); meant for
+ * write-ahead journals and similar durability points.
+ *
+ * @param ppszError pointer to a string that will hold an error message
+ *        if there is a problem, or null if the function is
+ *        successful (This function sets <tt>ppszError</tt>'s value.)
+ * @param handle handle to the open native-storage file
+ */
+void storageSync(char** ppszError, int handle);
+
 /**
  * Changes the read/write position in the given open native-storage
  * file to the given position.
@@ -589,6 +589,28 @@ storageCommitWrite(char** ppszError, int handle) {
     *ppszError = NULL;
 }
 
+/*
+ * Force pending writes to stable storage
+ *
+ * If not successful *ppszError will set to point to an error string,
+ * on success it will be set to NULL.
+ */
+void
+storageSync(char** ppszError, int handle) {
+    int status;
+
+    REPORT_INFO1(LC_CORE, "trying to sync file handle %d\n", handle);
+
+    status = pcsl_file_sync((void *)handle);
+
+    if (status < 0) {
+        *ppszError = getLastError("storageSync()");
+        return;
+    }
+
+    *ppszError = NULL;
+}
+
 /*
  * Change the read/write position of an open file in storage.
  * The position is a number of bytes from beginning of the file.
@@ -38,6 +38,9 @@
 #include <suspend_resume.h>
 #include <pcsl_network.h>
 #include <midpCompoundEvents.h>
+#include <midpMalloc.h>
+
+#include <string.h>
 
 #if (ENABLE_JSR_120 || ENABLE_JSR_205)
 #include <wmaInterface.h>
@@ -56,6 +59,83 @@ static MidpReentryData newSignal;
 static MidpEvent newMidpEvent;
 static MidpEvent newCompMidpEvent;
 
+/** The index has to be rebuilt before the next lookup */
+#define BLOCKED_INDEX_STALE   0
+/** The index matches the blocked threads of the current call */
+#define BLOCKED_INDEX_BUILT   1
+/** The index could not be allocated, blocked threads are scanned */
+#define BLOCKED_INDEX_NONE    2
+
+/**
+ * Index of the blocked threads by (waitingFor, descriptor) pair. A single
+ * system check can report many ready sockets, the index lets each of them
+ * find its thread without scanning the whole list. The first
+ * blockedIndexCapacity entries are the bucket heads, the next ones link
+ * the threads of a bucket, both hold a thread number plus one or 0.
+ * It is built by the first lookup in a midp_check_events() call, since
+ * the list of blocked threads is valid during that call only.
+ */
+static int* blockedIndex = NULL;
+static int blockedIndexCapacity = 0;
+static int blockedIndexState = BLOCKED_INDEX_STALE;
+
+/** Bucket of the threads waiting for a signal on a descriptor */
+static int
+blockedIndexBucket(unsigned int waitingFor, int descriptor) {
+    unsigned int hash = ((unsigned int)descriptor * 0x9E3779B1U) ^ waitingFor;
+
+    hash ^= hash >> 16;
+    return (int)(hash & (unsigned int)(blockedIndexCapacity - 1));
+}
+
+/**
+ * Build the index of blocked threads.
+ * Returns BLOCKED_INDEX_BUILT, or BLOCKED_INDEX_NONE if out of memory.
+ */
+static int
+buildBlockedIndex(JVMSPI_BlockedThreadInfo *blocked_threads,
+                  int blocked_threads_count) {
+    int i;
+    int* links;
+    MidpReentryData* pThreadReentryData;
+
+    if (blockedIndex == NULL || blocked_threads_count > blockedIndexCapacity) {
+        int capacity = 16;
+        int* index;
+
+        while (capacity < blocked_threads_count) {
+            capacity <<= 1;
+        }
+        index = (int*)midpMalloc(2 * capacity * sizeof (int));
+        if (index == NULL) {
+            return BLOCKED_INDEX_NONE;
+        }
+        if (blockedIndex != NULL) {
+            midpFree(blockedIndex);
+        }
+        blockedIndex = index;
+        blockedIndexCapacity = capacity;
+    }
+
+    memset(blockedIndex, 0, blockedIndexCapacity * sizeof (int));
+    links = blockedIndex + blockedIndexCapacity;
+
+    /* Keep the list order in buckets, the first matching thread wins */
+    for (i = blocked_threads_count - 1; i >= 0; i--) {
+        pThreadReentryData =
+            (MidpReentryData*)(blocked_threads[i].reentry_data);
+
+        if (pThreadReentryData != NULL) {
+            int bucket = blockedIndexBucket(pThreadReentryData->waitingFor,
+                                            pThreadReentryData->descriptor);
+            links[i] = blockedIndex[bucket];
+            blockedIndex[bucket] = i + 1;
+        }
+    }
+
+    return BLOCKED_INDEX_BUILT;
+}
+
 /**
  * Unblock a Java thread.
  * Returns 1 if a thread was unblocked, otherwise 0.
@@ -75,55 +155,61 @@ eventUnblockJavaThread(
      * to be revisited.
      */
     int i;
+    int* link;
     MidpReentryData* pThreadReentryData;
 
-    for (i = 0; i < blocked_threads_count; i++) {
+    if (blockedIndexState == BLOCKED_INDEX_STALE) {
+        blockedIndexState =
+            buildBlockedIndex(blocked_threads, blocked_threads_count);
+    }
+
+    if (blockedIndexState == BLOCKED_INDEX_NONE) {
+        for (i = 0; i < blocked_threads_count; i++) {
+            pThreadReentryData =
+                (MidpReentryData*)(blocked_threads[i].reentry_data);
+
+            if (pThreadReentryData != NULL 
+                    && pThreadReentryData->descriptor == descriptor 
+                    && pThreadReentryData->waitingFor == (midpSignalType)waitingFor) {
+                pThreadReentryData->status = status;
+                midp_thread_unblock(blocked_threads[i].thread_id);
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    link = &blockedIndex[blockedIndexBucket(waitingFor, descriptor)];
+    while (*link != 0) {
+        i = *link - 1;
         pThreadReentryData =
             (MidpReentryData*)(blocked_threads[i].reentry_data);
 
-        if (pThreadReentryData != NULL 
-                && pThreadReentryData->descriptor == descriptor 
+        if (pThreadReentryData->descriptor == descriptor 
                 && pThreadReentryData->waitingFor == (midpSignalType)waitingFor) {
+            /* Unblocked thread must not be found by other signals */
+            *link = blockedIndex[blockedIndexCapacity + i];
             pThreadReentryData->status = status;
             midp_thread_unblock(blocked_threads[i].thread_id);
             return 1;
         }
+        link = &blockedIndex[blockedIndexCapacity + i];
     }
 
     return 0;
 }
 
 /**
- * This function is called by the VM periodically. It has to check if
- * any of the blocked threads are ready for execution, and call
- * SNI_UnblockThread() on those threads that are ready.
+ * Handle the signal stored in newSignal and newMidpEvent.
  *
  * @param blocked_threads Array of blocked threads
  * @param blocked_threads_count Number of threads in blocked_threads array
- * @param timeout Values for the paramater:
- *                >0 = Block until an event happens, or until <timeout> 
- *                     milliseconds has elapsed.
- *                 0 = Check the events sources but do not block. Return to the
- *                     caller immediately regardless of the status of the event
- *                     sources.
- *                -1 = Do not timeout. Block until an event happens.
+ * @param timeout timeout of the current midp_check_events() call
  */
-void midp_check_events(JVMSPI_BlockedThreadInfo *blocked_threads,
-		       int blocked_threads_count,
-		       jlong timeout) {
-    if (midp_waitWhileSuspended()) {
-        /* System has been requested to resume. Returning control to VM
-         * to perform java-side resume routines. Timeout may be too long
-         * here or even -1, thus do not check other events this time.
-         */
-        return;
-    }
-
-    newSignal.waitingFor = 0;
-    newSignal.pResult = NULL;
-    MIDP_EVENT_INITIALIZE(newMidpEvent);
-
-    checkForSystemSignal(&newSignal, &newMidpEvent, timeout);
+static void
+handleSystemSignal(JVMSPI_BlockedThreadInfo *blocked_threads,
+                   int blocked_threads_count, jlong timeout) {
+    (void)timeout;
 
     switch (newSignal.waitingFor) {
 #if ENABLE_JAVA_DEBUGGER
@@ -187,6 +273,27 @@ void midp_check_events(JVMSPI_BlockedThreadInfo *blocked_threads,
         break;
 
     case HOST_NAME_LOOKUP_SIGNAL:
+#if (ENABLE_JSR_120 || ENABLE_JSR_205)
+        if (jsr120_check_signal(newSignal.waitingFor, newSignal.descriptor, newSignal.status))
+            /* The lookup belongs to WMA. */;
+        else
+#endif
+        if (eventUnblockJavaThread(blocked_threads,
+                                   blocked_threads_count, newSignal.waitingFor,
+                                   newSignal.descriptor,
+                                   newSignal.status))
+            /* Processing is done in eventUnblockJavaThread. */;
+#ifdef PCSL_NETWORK_LOOKUP_ABANDON
+        else {
+            /*
+             * The thread that started the lookup is gone, so nobody
+             * will finish it.
+             */
+            pcsl_network_lookup_abandon((void*)newSignal.descriptor);
+        }
+#endif
+        break;
+
     case NETWORK_WRITE_SIGNAL:
 #if (ENABLE_JSR_120 || ENABLE_JSR_205)
         if (!jsr120_check_signal(newSignal.waitingFor, newSignal.descriptor, newSignal.status))
@@ -333,6 +440,56 @@ void midp_check_events(JVMSPI_BlockedThreadInfo *blocked_threads,
     } /* switch */
 }
 
+/**
+ * This function is called by the VM periodically. It has to check if
+ * any of the blocked threads are ready for execution, and call
+ * SNI_UnblockThread() on those threads that are ready.
+ *
+ * @param blocked_threads Array of blocked threads
+ * @param blocked_threads_count Number of threads in blocked_threads array
+ * @param timeout Values for the paramater:
+ *                >0 = Block until an event happens, or until <timeout> 
+ *                     milliseconds has elapsed.
+ *                 0 = Check the events sources but do not block. Return to the
+ *                     caller immediately regardless of the status of the event
+ *                     sources.
+ *                -1 = Do not timeout. Block until an event happens.
+ */
+void midp_check_events(JVMSPI_BlockedThreadInfo *blocked_threads,
+		       int blocked_threads_count,
+		       jlong timeout) {
+    if (midp_waitWhileSuspended()) {
+        /* System has been requested to resume. Returning control to VM
+         * to perform java-side resume routines. Timeout may be too long
+         * here or even -1, thus do not check other events this time.
+         */
+        return;
+    }
+
+    newSignal.waitingFor = 0;
+    newSignal.pResult = NULL;
+    MIDP_EVENT_INITIALIZE(newMidpEvent);
+
+    checkForSystemSignal(&newSignal, &newMidpEvent, timeout);
+
+    /* Blocked threads index is valid during this call only */
+    blockedIndexState = BLOCKED_INDEX_STALE;
+
+    for (;;) {
+        handleSystemSignal(blocked_threads, blocked_threads_count, timeout);
+
+        /* Handle all signals detected by the same system check */
+        newSignal.waitingFor = 0;
+        newSignal.pResult = NULL;
+        MIDP_EVENT_INITIALIZE(newMidpEvent);
+        if (!checkForQueuedSystemSignal(&newSignal, &newMidpEvent)) {
+            break;
+        }
+        /* The queued signals are already received, do not block on them */
+        timeout = 0;
+    }
+}
+
 /**
  * Runs the VM in either master or slave mode depending on the
  * platform. It does not return until the VM is finished. In slave mode
@@ -65,6 +65,21 @@ extern void checkForSystemSignal(MidpReentryData* pNewSignal,
                                  MidpEvent* pNewMidpEvent,
                                  jlong timeout);
 
+/**
+ * Ports that detect several ready signals with a single system check
+ * queue them, and this function returns them one by one. It is called
+ * after checkForSystemSignal() until it returns KNI_FALSE, and must not
+ * block or check the system again, since the blocked threads given to
+ * the VM event check are only valid until it returns.
+ *
+ * @param pNewSignal     reentry data of the next queued signal
+ * @param pNewMidpEvent  native MIDP event of the next queued signal
+ *
+ * @return KNI_TRUE if a queued signal was returned, KNI_FALSE otherwise
+ */
+extern jboolean checkForQueuedSystemSignal(MidpReentryData* pNewSignal,
+                                           MidpEvent* pNewMidpEvent);
+
 #ifdef __cplusplus
 }
 #endif
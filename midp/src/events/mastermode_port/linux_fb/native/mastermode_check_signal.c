@@ -50,6 +50,17 @@
 #include "mastermode_check_signal.h"
 #include "mastermode_handle_signal.h"
 
+/**
+ * Bluetooth sockets are kept only in a list, so the persistent epoll set
+ * can be used just when they are not built in.
+ */
+#if PCSL_SOCKET_EPOLL && !defined(ENABLE_JSR_82_SOCK)
+#define MASTERMODE_EPOLL 1
+#include <sys/epoll.h>
+#else
+#define MASTERMODE_EPOLL 0
+#endif
+
 /* Forward declarations */
 static jboolean checkForSocketPointerAndKeyboardSignal(MidpReentryData* pNewSignal,
     MidpEvent* pNewMidpEvent, jlong timeout64);
@@ -68,6 +79,261 @@ fCheckForSignal checkForSignal[] = {
 int checkForSignalNum =
     sizeof(checkForSignal) / sizeof(fCheckForSignal);
 
+#if MASTERMODE_EPOLL
+
+/** Maximal number of ready sockets fetched by a single check */
+#define MAX_READY_SOCKETS 32
+
+/** Maximal number of completed host name lookups fetched by a single check */
+#define MAX_READY_LOOKUPS 8
+
+/** Kinds of the ready signal sources */
+#define READY_KEYBOARD  1
+#define READY_POINTER   2
+#define READY_HANDLE    3
+
+/** Signal source found ready and not handled yet */
+typedef struct _ReadySignal {
+    int kind;                   /* Keyboard, pointer or handle */
+    midpSignalType waitingFor;  /* Handle signal type */
+    int descriptor;             /* Ready socket or host name lookup */
+} ReadySignal;
+
+/**
+ * Queue of the signal sources reported by the last epoll_wait() call.
+ * Every socket is queued at most once per direction, keyboard and pointer
+ * are queued first to keep their priority.
+ */
+static ReadySignal readySignals[2 * MAX_READY_SOCKETS + MAX_READY_LOOKUPS + 2];
+static int readyHead = 0;
+static int readyCount = 0;
+
+/**
+ * Epoll set watching keyboard, pointer, the set of registered sockets
+ * and completion of host name lookups
+ */
+static int inputEventsFd = -1;
+static int watchedKeyboardFd = -1;
+static int watchedMouseFd = -1;
+static int watchedSocketsFd = -1;
+static int watchedLookupFd = -1;
+
+/**
+ * Keep the descriptor watched by the input epoll set up to date.
+ *
+ * @param pWatchedFd        IN/OUT descriptor currently in the set
+ * @param fd                IN  descriptor that should be in the set
+ */
+static void watchDescriptor(int* pWatchedFd, int fd) {
+    struct epoll_event event;
+
+    if (*pWatchedFd == fd) {
+        return;
+    }
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (*pWatchedFd != -1) {
+        (void)epoll_ctl(inputEventsFd, EPOLL_CTL_DEL, *pWatchedFd, &event);
+    }
+    *pWatchedFd = -1;
+    if (fd != -1 && epoll_ctl(inputEventsFd, EPOLL_CTL_ADD, fd, &event) == 0) {
+        *pWatchedFd = fd;
+    }
+}
+
+/**
+ * Prepare the input epoll set.
+ *
+ * @return KNI_TRUE if the set can be used, KNI_FALSE to fall back to select()
+ */
+static jboolean setupInputEvents() {
+    int socketsFd = GetSocketEventsFd();
+
+    if (socketsFd == -1) {
+        return KNI_FALSE;
+    }
+    if (inputEventsFd == -1) {
+        inputEventsFd = epoll_create(4);
+        if (inputEventsFd == -1) {
+            return KNI_FALSE;
+        }
+    }
+
+    watchDescriptor(&watchedKeyboardFd, fbapp_get_keyboard_fd());
+    watchDescriptor(&watchedMouseFd, fbapp_get_mouse_fd());
+    watchDescriptor(&watchedSocketsFd, socketsFd);
+    watchDescriptor(&watchedLookupFd, pcsl_network_lookup_fd());
+
+    return watchedSocketsFd != -1 ? KNI_TRUE : KNI_FALSE;
+}
+
+/** Add a ready signal source to the queue */
+static void queueReadySignal(int kind, midpSignalType waitingFor,
+        int descriptor) {
+    ReadySignal* ready = &readySignals[readyCount++];
+    ready->kind = kind;
+    ready->waitingFor = waitingFor;
+    ready->descriptor = descriptor;
+}
+
+/** Queue signals of completed host name lookups */
+static void queueReadyLookups() {
+    int i;
+    void* handle;
+
+    for (i = 0; i < MAX_READY_LOOKUPS; i++) {
+        handle = pcsl_network_lookup_done();
+        if (handle == NULL) {
+            break;
+        }
+        queueReadySignal(READY_HANDLE, HOST_NAME_LOOKUP_SIGNAL, (int)handle);
+    }
+}
+
+/**
+ * Queue signals of all ready sockets. Peer hang up and socket errors are
+ * reported to the threads waiting for read or write, as select() does.
+ */
+static void queueReadySockets() {
+    struct epoll_event events[MAX_READY_SOCKETS];
+    int i, num_ready;
+
+    num_ready = epoll_wait(watchedSocketsFd, events, MAX_READY_SOCKETS, 0);
+    for (i = 0; i < num_ready; i++) {
+        const SocketHandle* socket = (const SocketHandle*)events[i].data.ptr;
+        unsigned int ev = events[i].events;
+
+        if (ev & EPOLLPRI) {
+            queueReadySignal(READY_HANDLE, NETWORK_EXCEPTION_SIGNAL,
+                             (int)socket);
+            continue;
+        }
+        if ((socket->check_flags & CHECK_READ) &&
+                (ev & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            queueReadySignal(READY_HANDLE, NETWORK_READ_SIGNAL, (int)socket);
+        }
+        if ((socket->check_flags & CHECK_WRITE) &&
+                (ev & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+            queueReadySignal(READY_HANDLE, NETWORK_WRITE_SIGNAL, (int)socket);
+        }
+    }
+}
+
+/**
+ * Handle the next queued ready signal source.
+ *
+ * @param pNewSignal        OUT reentry data to unblock threads waiting for a signal
+ * @param pNewMidpEvent     OUT a native MIDP event to be stored to Java event queue
+ *
+ * @return KNI_TRUE if a queued signal was handled, KNI_FALSE if queue is empty
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal,
+    MidpEvent* pNewMidpEvent) {
+
+    ReadySignal* ready;
+
+    if (readyHead >= readyCount) {
+        readyHead = readyCount = 0;
+        return KNI_FALSE;
+    }
+
+    ready = &readySignals[readyHead++];
+    switch (ready->kind) {
+    case READY_KEYBOARD:
+        REPORT_INFO(LC_CORE, "[checkForQueuedSignal] keyboard signal detected");
+        handleKey(pNewSignal, pNewMidpEvent);
+        break;
+    case READY_POINTER:
+        REPORT_INFO(LC_CORE, "[checkForQueuedSignal] pointer signal detected");
+        handlePointer(pNewSignal, pNewMidpEvent);
+        break;
+    default:
+        REPORT_INFO(LC_CORE, "[checkForQueuedSignal] network signal detected");
+        pNewSignal->descriptor = ready->descriptor;
+        pNewSignal->waitingFor = ready->waitingFor;
+        break;
+    }
+    return KNI_TRUE;
+}
+
+/**
+ * Wait for socket & pointer & keyboard system signals in the input epoll
+ * set. All the sources found ready are queued, the first one is handled
+ * right away and the rest are handed out by checkForQueuedSignal(), so
+ * a single wakeup serves every ready source.
+ *
+ * @param pNewSignal        OUT reentry data to unblock threads waiting for a signal
+ * @param pNewMidpEvent     OUT a native MIDP event to be stored to Java event queue
+ * @param timeout64         IN  >0 the time system can be blocked waiting for a signal
+ *                              =0 don't block the system, check for signals instantly
+ *                              <0 block the system until a signal received
+ *
+ * @return KNI_TRUE if signal received, KNI_FALSE otherwise
+ */
+static jboolean waitForInputEvents(MidpReentryData* pNewSignal,
+    MidpEvent* pNewMidpEvent, jlong timeout64) {
+
+    struct epoll_event events[4];
+    int i, num_ready, timeout;
+    jboolean keyboard = KNI_FALSE;
+    jboolean pointer = KNI_FALSE;
+    jboolean sockets = KNI_FALSE;
+    jboolean lookups = KNI_FALSE;
+
+    if (timeout64 < 0) {
+        timeout = -1;
+    } else if (timeout64 > 0x7fffffff) {
+        timeout = 0x7fffffff;
+    } else {
+        timeout = (int)timeout64;
+    }
+
+    readyHead = readyCount = 0;
+    num_ready = epoll_wait(inputEventsFd, events, 4, timeout);
+
+    for (i = 0; i < num_ready; i++) {
+        if (events[i].data.fd == watchedKeyboardFd) {
+            keyboard = KNI_TRUE;
+        } else if (events[i].data.fd == watchedMouseFd) {
+            pointer = KNI_TRUE;
+        } else if (events[i].data.fd == watchedSocketsFd) {
+            sockets = KNI_TRUE;
+        } else if (events[i].data.fd == watchedLookupFd) {
+            lookups = KNI_TRUE;
+        }
+    }
+
+    if (keyboard) {
+        queueReadySignal(READY_KEYBOARD, 0, 0);
+    }
+    if (pointer) {
+        queueReadySignal(READY_POINTER, 0, 0);
+    }
+    if (lookups) {
+        queueReadyLookups();
+    }
+    if (sockets) {
+        queueReadySockets();
+    }
+
+    return checkForQueuedSignal(pNewSignal, pNewMidpEvent);
+}
+
+#else
+
+/**
+ * See mastermode_check_signal.h for definition.
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal,
+    MidpEvent* pNewMidpEvent) {
+
+    (void)pNewSignal;
+    (void)pNewMidpEvent;
+    return KNI_FALSE;
+}
+
+#endif /* MASTERMODE_EPOLL */
+
 /**
  * Check and handle socket & pointer & keyboard system signals.
  * The function groups signals that can be checked with a single system call.
@@ -92,12 +358,19 @@ static jboolean checkForSocketPointerAndKeyboardSignal(MidpReentryData* pNewSign
 
     int mouse_fd = fbapp_get_mouse_fd();
     int keyboard_fd = fbapp_get_keyboard_fd();
+    int lookup_fd = pcsl_network_lookup_fd();
 
     const SocketHandle* socketsList   = GetRegisteredSocketHandles();
 #ifdef ENABLE_JSR_82_SOCK
     const SocketHandle* btSocketsList = GetRegisteredBtSocketHandles();
 #endif /* ENABLE_JSR_82_SOCK */
 
+#if MASTERMODE_EPOLL
+    if (setupInputEvents()) {
+        return waitForInputEvents(pNewSignal, pNewMidpEvent, timeout64);
+    }
+#endif /* MASTERMODE_EPOLL */
+
     FD_ZERO(&read_fds);
     FD_ZERO(&write_fds);
     FD_ZERO(&except_fds);
@@ -118,6 +391,13 @@ static jboolean checkForSocketPointerAndKeyboardSignal(MidpReentryData* pNewSign
             num_fds = mouse_fd + 1;
         }
     }
+    if (lookup_fd != -1) {
+        /* Set host name lookups completion descriptor for select */
+        FD_SET(lookup_fd, &read_fds);
+        if (num_fds <= lookup_fd) {
+            num_fds = lookup_fd + 1;
+        }
+    }
 
     /* Set the sockets to be checked during select */
     setSockets(socketsList, &read_fds, &write_fds, &except_fds, &num_fds);
@@ -150,6 +430,11 @@ static jboolean checkForSocketPointerAndKeyboardSignal(MidpReentryData* pNewSign
             /* Handle pointer event */
             REPORT_INFO(LC_CORE, "[checkForSocketPointerAndKeyboardSignal] pointer signal detected");
             handlePointer(pNewSignal, pNewMidpEvent);
+        } else if (lookup_fd != -1 && FD_ISSET(lookup_fd, &read_fds)) {
+            /* Handle completed host name lookup */
+            REPORT_INFO(LC_CORE, "[checkForSocketPointerAndKeyboardSignal] host name lookup signal detected");
+            pNewSignal->descriptor = (int)pcsl_network_lookup_done();
+            pNewSignal->waitingFor = HOST_NAME_LOOKUP_SIGNAL;
         } else {
             REPORT_INFO(LC_CORE, "[checkForSocketPointerAndKeyboardSignal] socket signal detected");
             handleSockets(socketsList,
@@ -69,6 +69,18 @@ typedef jboolean (*fCheckForSignal)(/*OUT*/ MidpReentryData* pNewSignal,
 jboolean checkForPendingSignals(/*OUT*/ MidpReentryData* pNewSignal,
     /*OUT*/ MidpEvent* pNewMidpEvent, jlong currentTime);
 
+/**
+ * Handle the next signal source found ready together with the one
+ * reported by the last check, without checking the system again.
+ *
+ * @param pNewSignal        reentry data to unblock threads waiting for a signal
+ * @param pNewMidpEvent     a native MIDP event to be stored to Java event queue
+ *
+ * @return KNI_TRUE if a queued signal was handled, KNI_FALSE if queue is empty
+ */
+jboolean checkForQueuedSignal(/*OUT*/ MidpReentryData* pNewSignal,
+    /*OUT*/ MidpEvent* pNewMidpEvent);
+
 /** Static list of registered system signal checkers */
 extern fCheckForSignal checkForSignal[];
 
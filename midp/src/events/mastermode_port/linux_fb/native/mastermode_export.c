@@ -84,3 +84,13 @@ void checkForSystemSignal(MidpReentryData* pNewSignal,
         checkForAllSignals(pNewSignal, pNewMidpEvent, timeout);
     }
 }
+
+/*
+ * Returns the next signal received together with the one returned by
+ * the last checkForSystemSignal() call, see midp_mastermode_port.h.
+ */
+jboolean checkForQueuedSystemSignal(MidpReentryData* pNewSignal,
+    MidpEvent* pNewMidpEvent) {
+
+    return checkForQueuedSignal(pNewSignal, pNewMidpEvent);
+}
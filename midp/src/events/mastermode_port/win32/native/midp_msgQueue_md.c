@@ -116,3 +116,15 @@ void checkForSystemSignal(MidpReentryData* pNewSignal,
         }
     } while (timeout > 0);
 }
+
+/*
+ * Returns the next signal received together with the one returned by
+ * the last checkForSystemSignal() call. This port reports a single signal
+ * per check, so there is never a queued one.
+ */
+jboolean checkForQueuedSystemSignal(MidpReentryData* pNewSignal,
+                                    MidpEvent* pNewMidpEvent) {
+    (void)pNewSignal;
+    (void)pNewMidpEvent;
+    return KNI_FALSE;
+}
@@ -63,6 +63,13 @@ extern void fbapp_finalize();
  */
 extern void fbapp_refresh(int hardwareId, int x, int y, int w, int h);
 
+/**
+ * Refresh all areas updated by one paint. The areas are given as
+ * x1, y1, x2, y2 quadruples, count of them.
+ */
+extern void fbapp_refresh_regions(int hardwareId, const int *regions,
+                                  int count);
+
 /**
  * Invert screen orientation flag
  */
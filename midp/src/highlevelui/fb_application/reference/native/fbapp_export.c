@@ -224,6 +224,41 @@ void fbapp_refresh(int hardwareId, int x1, int y1, int x2, int y2) {
     }
 }
 
+/**
+ * Bridge function to request a repaint of all areas updated by one
+ * paint. The areas are presented together, so the frame buffer can
+ * merge them and flip pages once per paint.
+ *
+ * @param regions x1, y1, x2, y2 corners of the areas to refresh
+ * @param count number of areas
+ */
+void fbapp_refresh_regions(int hardwareId, const int *regions, int count) {
+    int *clipped = (int *)midpMalloc(count * 4 * sizeof(int));
+    int i;
+
+    if (clipped == NULL) {
+        // Still correct, just presented area by area
+        for (i = 0; i < count; i++, regions += 4) {
+            fbapp_refresh(hardwareId, regions[0], regions[1],
+                          regions[2], regions[3]);
+        }
+        return;
+    }
+
+    memcpy(clipped, regions, count * 4 * sizeof(int));
+    for (i = 0; i < count * 4; i += 4) {
+        clipRect(hardwareId, &clipped[i], &clipped[i + 1],
+                 &clipped[i + 2], &clipped[i + 3]);
+    }
+
+    if (!reverse_orientation) {
+        refreshScreenRegionsNormal(clipped, count);
+    } else {
+        refreshScreenRegionsRotated(clipped, count);
+    }
+    midpFree(clipped);
+}
+
 /**
  * Map MIDP keycode value into proper MIDP event parameters
  * and platform signal attributes to unblock Java threads
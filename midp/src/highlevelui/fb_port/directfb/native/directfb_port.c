@@ -112,6 +112,22 @@ void refreshScreenRotated(int x1, int y1, int x2, int y2) {
     (void)y1; (void)y2;
 }
 
+/** Refresh all areas updated by one paint, one after another */
+void refreshScreenRegionsNormal(const int *regions, int count) {
+    int i;
+    for (i = 0; i < count; i++, regions += 4) {
+        refreshScreenNormal(regions[0], regions[1], regions[2], regions[3]);
+    }
+}
+
+/** Refresh all areas of rotated screen updated by one paint */
+void refreshScreenRegionsRotated(const int *regions, int count) {
+    int i;
+    for (i = 0; i < count; i++, regions += 4) {
+        refreshScreenRotated(regions[0], regions[1], regions[2], regions[3]);
+    }
+}
+
 /** Free allocated resources and restore system state */
 void finalizeFrameBuffer() {
     directfbapp_finalize();
@@ -0,0 +1,256 @@
+/*
+ *   
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Native unit tests of the frame buffer refresh logic. They run against
+ * a regular file named by FRAMEBUFFER, which fb_port maps instead of a
+ * device and pages through like one, and check after every frame that
+ * the visible page of the file matches the screen buffer.
+ */
+
+#if ENABLE_NUTS_FRAMEWORK
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <midpNUTS.h>
+#include <midp_logging.h>
+#include <gxj_putpixel.h>
+#include <gxj_screen_buffer.h>
+#include <fbport_export.h>
+#include "fb_port.h"
+
+/** Geometry of the tested screen, even as copyRect* expects it */
+#define TEST_WIDTH  64
+#define TEST_HEIGHT 48
+
+/** Number of frames painted with random areas */
+#define TEST_RANDOM_FRAMES 50
+
+static char* testFullRefresh_m = "testFbFullRefresh";
+static char* testDistantAreas_m = "testFbDistantAreas";
+static char* testSingleAreas_m = "testFbSingleAreas";
+static char* testRandomFrames_m = "testFbRandomFrames";
+
+/** Whether the stand-in file has been set up already */
+static int initialized = 0;
+
+/** Color used for the next painted area */
+static gxj_pixel_type nextColor = 1;
+
+/** Set up the screen buffer and a frame buffer stand-in file once */
+static int setUp() {
+    char path[] = "/tmp/fbPortTestXXXXXX";
+    int fd;
+
+    if (initialized) {
+        return 0;
+    }
+
+    fd = mkstemp(path);
+    if (fd < 0) {
+        REPORT_ERROR(LC_HIGHUI, "Can't create frame buffer file\n");
+        return -1;
+    }
+    close(fd);
+
+    setenv("FRAMEBUFFER", path, 1);
+    initScreenBuffer(TEST_WIDTH, TEST_HEIGHT);
+    initFrameBuffer();
+    // The file stays mapped and open until the process exits
+    unlink(path);
+
+    if (fb.pages != 2) {
+        REPORT_ERROR(LC_HIGHUI, "Stand-in file is not paged\n");
+        return -1;
+    }
+
+    initialized = 1;
+    return 0;
+}
+
+/** Fill an area of the screen buffer with a color not used before */
+static void paint(int x1, int y1, int x2, int y2) {
+    gxj_pixel_type *p = gxj_system_screen_buffer.pixelData;
+    int x, y;
+
+    for (y = y1; y < y2; y++) {
+        for (x = x1; x < x2; x++) {
+            p[y * TEST_WIDTH + x] = nextColor;
+        }
+    }
+    nextColor++;
+}
+
+/**
+ * Check the visible page of the stand-in file, read through the file
+ * rather than the mapping, against the screen buffer.
+ */
+static int visiblePageMatches() {
+    static gxj_pixel_type page[TEST_WIDTH * TEST_HEIGHT];
+
+    if (pread(fb.fd, page, sizeof(page), fb.front * fb.pagesize) !=
+            (ssize_t)sizeof(page)) {
+        REPORT_ERROR(LC_HIGHUI, "Can't read frame buffer file\n");
+        return 0;
+    }
+    if (memcmp(page, gxj_system_screen_buffer.pixelData, sizeof(page))) {
+        REPORT_ERROR1(LC_HIGHUI, "Page %d differs from screen buffer\n",
+                      fb.front);
+        return 0;
+    }
+    return 1;
+}
+
+/** Paint and present one frame made of the given areas */
+static int presentAndCheck(int *regions, int count) {
+    int front = fb.front;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        paint(regions[i * 4], regions[i * 4 + 1],
+              regions[i * 4 + 2], regions[i * 4 + 3]);
+    }
+    refreshScreenRegionsNormal(regions, count);
+
+    if (fb.front == front) {
+        REPORT_ERROR(LC_HIGHUI, "Frame did not flip pages\n");
+        return 0;
+    }
+    return visiblePageMatches();
+}
+
+/** A full screen refresh shows the whole screen buffer */
+static int testFullRefresh(void) {
+    int area[4] = { 0, 0, TEST_WIDTH, TEST_HEIGHT };
+
+    if (setUp() != 0) {
+        return -1;
+    }
+    return presentAndCheck(area, 1) ? 0 : -1;
+}
+
+/**
+ * A status bar and a sprite at opposite ends of the screen are
+ * presented by one flip, and every later frame still shows them.
+ */
+static int testDistantAreas(void) {
+    int frame1[8] = { 0, 0, TEST_WIDTH, 4,  50, 40, 58, 46 };
+    int frame2[8] = { 2, 1, 10, 3,          52, 42, 60, 48 };
+    int frame3[4] = { 20, 20, 30, 30 };
+
+    if (setUp() != 0) {
+        return -1;
+    }
+    if (!presentAndCheck(frame1, 2) ||
+            !presentAndCheck(frame2, 2) ||
+            !presentAndCheck(frame3, 1) ||
+            !presentAndCheck(frame3, 1)) {
+        return -1;
+    }
+    return 0;
+}
+
+/** Frames refreshed through the single area entry points */
+static int testSingleAreas(void) {
+    int i;
+
+    if (setUp() != 0) {
+        return -1;
+    }
+    for (i = 0; i < 4; i++) {
+        int front = fb.front;
+        int x = i * 14;
+        paint(x, i * 10, x + 7, i * 10 + 9);
+        refreshScreenNormal(x, i * 10, x + 7, i * 10 + 9);
+        if (fb.front == front || !visiblePageMatches()) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Frames of random areas, more of them than the damage list holds,
+ * so that the overflow merging is exercised too.
+ */
+static int testRandomFrames(void) {
+    int regions[(FB_MAX_DAMAGE_RECTS * 2) * 4];
+    int frame, i;
+
+    if (setUp() != 0) {
+        return -1;
+    }
+    srand(40);
+    for (frame = 0; frame < TEST_RANDOM_FRAMES; frame++) {
+        int count = 1 + rand() % (FB_MAX_DAMAGE_RECTS * 2);
+        for (i = 0; i < count; i++) {
+            int x1 = rand() % TEST_WIDTH;
+            int y1 = rand() % TEST_HEIGHT;
+            regions[i * 4] = x1;
+            regions[i * 4 + 1] = y1;
+            regions[i * 4 + 2] = x1 + 1 + rand() % (TEST_WIDTH - x1);
+            regions[i * 4 + 3] = y1 + 1 + rand() % (TEST_HEIGHT - y1);
+        }
+        if (!presentAndCheck(regions, count)) {
+            REPORT_ERROR1(LC_HIGHUI, "Random frame %d is wrong\n", frame);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Registers the frame buffer tests.
+ *
+ * @return number of tests registered in total
+ */
+int registerFbPortTests() {
+    if (!register_test(testFullRefresh_m, testFullRefresh)) {
+        REPORT_WARN1(LC_HIGHUI, "Registration of test %s failed.\n",
+                     testFullRefresh_m);
+    }
+
+    if (!register_test(testDistantAreas_m, testDistantAreas)) {
+        REPORT_WARN1(LC_HIGHUI, "Registration of test %s failed.\n",
+                     testDistantAreas_m);
+    }
+
+    if (!register_test(testSingleAreas_m, testSingleAreas)) {
+        REPORT_WARN1(LC_HIGHUI, "Registration of test %s failed.\n",
+                     testSingleAreas_m);
+    }
+
+    if (!register_test(testRandomFrames_m, testRandomFrames)) {
+        REPORT_WARN1(LC_HIGHUI, "Registration of test %s failed.\n",
+                     testRandomFrames_m);
+    }
+    return get_num_tests();
+}
+
+#endif /* ENABLE_NUTS_FRAMEWORK */
@@ -41,6 +41,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /* The following is needed for accessing /dev/fb */
 #include <linux/fb.h>
@@ -96,6 +97,15 @@ int getMouseFd() {
 /** System offscreen buffer */
 gxj_screen_buffer gxj_system_screen_buffer;
 
+/** The frame buffer in use */
+FbDevice fb;
+
+/**
+ * Areas of the screen the back page is missing compared to the front
+ * one. Only used when page flipping is enabled.
+ */
+static FbDamage backDamage;
+
 static struct termios origTermData;
 static struct termios termdata;
 
@@ -182,13 +192,73 @@ static void restoreConsole() {
     }
 }
 
+/**
+ * Sets up a regular file as a frame buffer stand-in. The file is sized
+ * to hold two 16-bit pages of the screen buffer geometry and is updated
+ * exactly like the device memory would be, page flipping included, which
+ * makes the refresh logic testable without a display.
+ */
+static void initFileFrameBuffer(int fd) {
+    fb.depth = 16;
+    fb.width = gxj_system_screen_buffer.width;
+    fb.height= gxj_system_screen_buffer.height;
+    fb.lstep = fb.width * sizeof(gxj_pixel_type);
+    fb.xoff  = 0;
+    fb.yoff  = 0;
+    fb.mapsize = 2 * fb.lstep * fb.height;
+    fb.pages = 2;
+    fb.isFile = 1;
+
+    if (ftruncate(fd, fb.mapsize) != 0) {
+        PERROR("sizing frame buffer file");
+        exit(1);
+    }
+}
+
+/**
+ * Makes the virtual screen twice as high as the visible one so that
+ * its two halves can be presented alternately with FBIOPAN_DISPLAY.
+ * Leaves fb.pages at 1 if the driver can not do it.
+ */
+static void initPageFlipping(int fd, struct fb_fix_screeninfo *finfo,
+                             struct fb_var_screeninfo *vinfo) {
+    struct fb_var_screeninfo flip = *vinfo;
+
+    if (flip.yres_virtual < 2 * flip.yres) {
+        flip.yres_virtual = 2 * flip.yres;
+        if (ioctl(fd, FBIOPUT_VSCREENINFO, &flip) ||
+            ioctl(fd, FBIOGET_VSCREENINFO, &flip) ||
+            ioctl(fd, FBIOGET_FSCREENINFO, finfo) ||
+            flip.yres_virtual < 2 * flip.yres) {
+            return;
+        }
+    }
+
+    if (finfo->smem_len < 2 * flip.yres * finfo->line_length) {
+        return;
+    }
+
+    flip.yoffset = 0;
+    if (ioctl(fd, FBIOPAN_DISPLAY, &flip)) {
+        return;
+    }
+
+    *vinfo = flip;
+    fb.pages = 2;
+}
+
 /** Inits frame buffer device */
 void initFrameBuffer() {
     struct fb_fix_screeninfo finfo;
     struct fb_var_screeninfo vinfo;
-    const char *dev = "/dev/fb0";
+    struct stat st;
+    const char *dev = getenv("FRAMEBUFFER");
+    unsigned char *mem;
     int fd;
-    int dw, w, dh, h;
+
+    if (dev == NULL) {
+        dev = "/dev/fb0";
+    }
 
     fd = open(dev, O_RDWR | O_SYNC);
     if (fd < 0) {
@@ -196,56 +266,130 @@ void initFrameBuffer() {
         exit(1);
     }
 
+    fb.fd = fd;
+    fb.pages = 1;
+    fb.front = 0;
+    fb.isFile = 0;
+    backDamage.count = 0;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        initFileFrameBuffer(fd);
+    } else {
 #ifdef VESA_NO_BLANKING
-    if (linuxFbDeviceType == LINUX_FB_OMAP730) {
-        // Disable the screen from powering down
-        ioctl(fd, FBIOBLANK, VESA_NO_BLANKING);
-    }
+        if (linuxFbDeviceType == LINUX_FB_OMAP730) {
+            // Disable the screen from powering down
+            ioctl(fd, FBIOBLANK, VESA_NO_BLANKING);
+        }
 #endif
 
-    if (ioctl(fd, FBIOGET_FSCREENINFO, &finfo) ||
-        ioctl(fd, FBIOGET_VSCREENINFO, &vinfo)) {
-        PERROR("reading /dev/fb0");
-        exit(1);
-    }
+        if (ioctl(fd, FBIOGET_FSCREENINFO, &finfo) ||
+            ioctl(fd, FBIOGET_VSCREENINFO, &vinfo)) {
+            PERROR("reading framebuffer info");
+            exit(1);
+        }
 
-    fb.depth = vinfo.bits_per_pixel;
-    fb.lstep = finfo.line_length;
-    fb.xoff  = vinfo.xoffset;
-    fb.yoff  = vinfo.yoffset;
-    fb.width = vinfo.xres;
-    fb.height= vinfo.yres;
+        initPageFlipping(fd, &finfo, &vinfo);
+
+        fb.depth = vinfo.bits_per_pixel;
+        fb.lstep = finfo.line_length;
+        fb.xoff  = vinfo.xoffset;
+        fb.yoff  = vinfo.yoffset;
+        fb.width = vinfo.xres;
+        fb.height= vinfo.yres;
+        fb.mapsize = finfo.smem_len;
+    }
 
     if (fb.depth != 16) {
         fprintf(stderr, "Supports only 16-bit, 5:6:5 display\n");
         exit(1);
     }
 
-    dw = w = vinfo.xres;
-    dh = h = vinfo.yres;
-
     fb.dataoffset = fb.yoff * fb.lstep + fb.xoff * fb.depth / 8;
-    fb.mapsize = finfo.smem_len;
+    fb.pagesize = fb.height * fb.lstep;
 
-    fb.data = (unsigned short *)mmap(0, fb.mapsize,
+    mem = (unsigned char *)mmap(0, fb.mapsize,
         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    fb.data += fb.dataoffset;
 
-    if ((int)fb.data == -1) {
-        PERROR("mapping /dev/fb0");
+    if (mem == (unsigned char *)MAP_FAILED) {
+        PERROR("mapping framebuffer");
         exit(1);
-    } else {
-      /* IMPL_NOTE - CDC disabled.*/
-#if 0 /* Don't draw into the screen area outside of the main midp window. */
-        int n;
-        gxj_pixel_type *p = fb.data;
-        gxj_pixel_type color =
-            (gxj_pixel_type)GXJ_RGB2PIXEL(0xa0, 0xa0, 0x80);
-        for (n = w * h; n > 0; n--) {
-            *p ++ = color;
+    }
+    fb.data = (unsigned short *)(mem + fb.dataoffset);
+
+    // The back page holds whatever was left in video memory, and
+    // damage based updates would never repaint all of it. Start it
+    // as a copy of the visible page.
+    if (fb.pages > 1) {
+        memcpy((unsigned char *)fb.data + fb.pagesize, fb.data, fb.pagesize);
+    }
+}
+
+/** Return pointer to the first pixel of the given frame buffer page */
+static gxj_pixel_type *getPage(int page) {
+    return (gxj_pixel_type *)((unsigned char *)fb.data + page * fb.pagesize);
+}
+
+/** Compute the cost of copying the area, see FB_DAMAGE_ROW_COST */
+static int getRectCost(const FbRect *r) {
+    int h = r->y2 - r->y1;
+    return (r->x2 - r->x1 + FB_DAMAGE_ROW_COST) * h;
+}
+
+/** Compute the bounding box of two areas */
+static void unionRect(FbRect *dst, const FbRect *a, const FbRect *b) {
+    dst->x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    dst->y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    dst->x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    dst->y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+}
+
+/**
+ * Add an area to the damage list. The area is merged with a listed one
+ * whenever copying their bounding box costs no more than copying them
+ * separately. If the list is full, the area is merged with the listed
+ * one that makes the bounding box grow the least.
+ */
+static void addDamage(FbDamage *damage, const FbRect *area) {
+    FbRect r = *area;
+    FbRect u;
+    int i;
+
+    if (r.x1 >= r.x2 || r.y1 >= r.y2) {
+        return;
+    }
+
+    for (i = 0; i < damage->count; i++) {
+        unionRect(&u, &r, &damage->rects[i]);
+        if (getRectCost(&u) <=
+                getRectCost(&r) + getRectCost(&damage->rects[i])) {
+            r = u;
+            damage->rects[i] = damage->rects[--damage->count];
+            /* the grown area may now absorb ones checked before */
+            i = -1;
         }
-#endif
     }
+
+    if (damage->count == FB_MAX_DAMAGE_RECTS) {
+        int best = 0;
+        int bestGrowth = 0;
+
+        for (i = 0; i < damage->count; i++) {
+            int growth;
+            unionRect(&u, &r, &damage->rects[i]);
+            growth = getRectCost(&u) - getRectCost(&damage->rects[i]);
+            if (i == 0 || growth < bestGrowth) {
+                best = i;
+                bestGrowth = growth;
+            }
+        }
+
+        unionRect(&u, &r, &damage->rects[best]);
+        damage->rects[best] = damage->rects[--damage->count];
+        addDamage(damage, &u);
+        return;
+    }
+
+    damage->rects[damage->count++] = r;
 }
 
 /**
@@ -258,6 +402,13 @@ void reverseScreenOrientation() {
     // resize event, the artefacts from the old screen content can appear.
     // That's why the buffer content is not preserved.
     gxj_rotate_screen_buffer(KNI_FALSE);
+
+    // Areas tracked for the back page are in the old orientation,
+    // bring the back page up to date instead of translating them.
+    if (fb.pages > 1) {
+        memcpy(getPage(1 - fb.front), getPage(fb.front), fb.pagesize);
+        backDamage.count = 0;
+    }
 }
 
 /** Initialize frame buffer video device */
@@ -269,13 +420,16 @@ void connectFrameBuffer() {
 
 /** Clear screen content */
 void clearScreen() {
-    int n;
-    gxj_pixel_type *p = fb.data;
+    int n, page;
     gxj_pixel_type color =
 	(gxj_pixel_type)GXJ_RGB2PIXEL(0xa0, 0xa0, 0x80);
-    for (n = fb.width * fb.height; n > 0; n--) {
-	    *p ++ = color;
+    for (page = 0; page < fb.pages; page++) {
+        gxj_pixel_type *p = getPage(page);
+        for (n = fb.width * fb.height; n > 0; n--) {
+	        *p ++ = color;
+        }
     }
+    backDamage.count = 0;
 }
 
 /**
@@ -324,10 +478,9 @@ int getScreenY(int screenRotated) {
     return y;
 }
 
-/** Refresh screen from offscreen buffer */
-void refreshScreenNormal(int x1, int y1, int x2, int y2) {
+/** Copy area of offscreen buffer to the given frame buffer page */
+static void copyRectNormal(gxj_pixel_type *dst, int x1, int y1, int x2, int y2) {
     gxj_pixel_type *src = gxj_system_screen_buffer.pixelData;
-    gxj_pixel_type *dst = (gxj_pixel_type*)fb.data;
     int srcWidth, srcHeight;
     int dstWidth = fb.width;
     int dstHeight = fb.height;
@@ -459,11 +612,10 @@ static void simple_copy_rotated(short *src, short *dst, int x1, int y1, int x2,
 }
 #endif /* ENABLE_FAST_COPY_ROTATED */
 
-/** Refresh rotated screen with offscreen buffer content */
-void refreshScreenRotated(int x1, int y1, int x2, int y2) {
+/** Copy area of offscreen buffer to the given page with rotation */
+static void copyRectRotated(gxj_pixel_type *dst, int x1, int y1, int x2, int y2) {
 
     gxj_pixel_type *src = gxj_system_screen_buffer.pixelData;
-    gxj_pixel_type *dst = (gxj_pixel_type*)fb.data;
     int srcWidth, srcHeight;
     int dstWidth = fb.width;
     int dstHeight = fb.height;
@@ -515,8 +667,113 @@ void refreshScreenRotated(int x1, int y1, int x2, int y2) {
 #endif
 }
 
+/**
+ * Make the given page visible. The stand-in file has no display to
+ * scan it out, so for it the page just becomes the front one.
+ *
+ * @return 0 on success, -1 if the driver refused to pan
+ */
+static int showPage(int page) {
+    struct fb_var_screeninfo vinfo;
+
+    if (fb.isFile) {
+        return 0;
+    }
+    if (ioctl(fb.fd, FBIOGET_VSCREENINFO, &vinfo) == 0) {
+        vinfo.yoffset = page * fb.height;
+        if (ioctl(fb.fd, FBIOPAN_DISPLAY, &vinfo) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Bring the areas drawn by one paint up to date. The areas are first
+ * merged per the cost model of addDamage. Without page flipping they
+ * are copied straight into the visible page. Otherwise they are copied
+ * into the back page along with whatever that page is still missing
+ * from the previous frame, and the back page is then made visible,
+ * once for the whole frame.
+ *
+ * @param copyRect copies an area of the screen buffer into a page
+ * @param regions x1, y1, x2, y2 corners of the areas
+ * @param count number of areas
+ */
+static void presentFrame(void (*copyRect)(gxj_pixel_type *, int, int, int, int),
+                         const int *regions, int count) {
+    FbDamage frame;
+    FbRect *r;
+    int back;
+    int i;
+
+    frame.count = 0;
+    for (i = 0; i < count; i++, regions += 4) {
+        FbRect area;
+        area.x1 = regions[0];
+        area.y1 = regions[1];
+        area.x2 = regions[2];
+        area.y2 = regions[3];
+        addDamage(&frame, &area);
+    }
+
+    if (fb.pages > 1) {
+        back = 1 - fb.front;
+        for (i = 0; i < frame.count; i++) {
+            addDamage(&backDamage, &frame.rects[i]);
+        }
+        for (i = 0; i < backDamage.count; i++) {
+            r = &backDamage.rects[i];
+            copyRect(getPage(back), r->x1, r->y1, r->x2, r->y2);
+        }
+
+        if (showPage(back) == 0) {
+            // The page just hidden lacks only what this frame drew
+            fb.front = back;
+            backDamage = frame;
+            return;
+        }
+
+        // Panning stopped working, keep drawing into the visible page
+        PERROR("FBIOPAN_DISPLAY");
+        fb.pages = 1;
+    }
+
+    for (i = 0; i < frame.count; i++) {
+        r = &frame.rects[i];
+        copyRect(getPage(fb.front), r->x1, r->y1, r->x2, r->y2);
+    }
+}
+
+/** Refresh screen from offscreen buffer */
+void refreshScreenNormal(int x1, int y1, int x2, int y2) {
+    int area[4];
+    area[0] = x1; area[1] = y1; area[2] = x2; area[3] = y2;
+    presentFrame(copyRectNormal, area, 1);
+}
+
+/** Refresh rotated screen with offscreen buffer content */
+void refreshScreenRotated(int x1, int y1, int x2, int y2) {
+    int area[4];
+    area[0] = x1; area[1] = y1; area[2] = x2; area[3] = y2;
+    presentFrame(copyRectRotated, area, 1);
+}
+
+/** Refresh all areas updated by one paint from offscreen buffer */
+void refreshScreenRegionsNormal(const int *regions, int count) {
+    presentFrame(copyRectNormal, regions, count);
+}
+
+/** Refresh all areas of rotated screen updated by one paint */
+void refreshScreenRegionsRotated(const int *regions, int count) {
+    presentFrame(copyRectRotated, regions, count);
+}
+
 /** Frees allocated resources and restore system state */
 void finalizeFrameBuffer() {
+    if (fb.pages > 1 && fb.front != 0) {
+        showPage(0);
+    }
     gxj_free_screen_buffer();
     restoreConsole();
 }
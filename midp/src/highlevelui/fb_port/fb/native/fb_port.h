@@ -36,7 +36,32 @@
 extern "C" {
 #endif
 
-struct {
+/** Maximal number of damage rectangles tracked at once */
+#define FB_MAX_DAMAGE_RECTS 8
+
+/**
+ * Per-row cost of copying a rectangle, expressed in pixels. It accounts
+ * for the memcpy setup and pointer arithmetic done for every copied row,
+ * and makes tall thin rectangles relatively more expensive.
+ */
+#define FB_DAMAGE_ROW_COST  16
+
+/** Screen area in screen buffer coordinates, [x1, x2) x [y1, y2) */
+typedef struct {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} FbRect;
+
+/** Bounded list of screen areas that are yet to be copied */
+typedef struct {
+    int count;
+    FbRect rects[FB_MAX_DAMAGE_RECTS];
+} FbDamage;
+
+/** Geometry and state of the mapped frame buffer */
+typedef struct {
     unsigned short *data;
     int width;
     int height;
@@ -46,7 +71,18 @@ struct {
     int yoff;
     int dataoffset;
     int mapsize;
-} fb;
+    int fd;        /**< open frame buffer device or stand-in file */
+    int pages;     /**< 2 if page flipping is used, 1 otherwise */
+    int front;     /**< index of the page being scanned out */
+    int pagesize;  /**< distance between pages in bytes */
+    int isFile;    /**< stand-in file, its pages are flipped in memory only */
+} FbDevice;
+
+/** The frame buffer in use */
+extern FbDevice fb;
+
+/** Open and map the device named by FRAMEBUFFER, /dev/fb0 by default */
+void initFrameBuffer();
 
 #ifdef __cplusplus
 }
@@ -65,6 +65,10 @@ extern void refreshScreenNormal(int x1, int y1, int x2, int y2);
 /** Refresh rotated screen with offscreen bufer content */
 extern void refreshScreenRotated(int x1, int y1, int x2, int y2);
 
+extern void refreshScreenRegionsNormal(const int *regions, int count);
+
+extern void refreshScreenRegionsRotated(const int *regions, int count);
+
 /** Return file descriptor of keyboard device, or -1 in none */
 extern int getKeyboardFd();
 
@@ -255,6 +255,14 @@ void refreshScreenNormal(int x1, int y1, int x2, int y2) {
     hdr->is_dirty = 1;
 }
 
+/** Refresh all areas updated by one paint, one after another */
+void refreshScreenRegionsNormal(const int *regions, int count) {
+    int i;
+    for (i = 0; i < count; i++, regions += 4) {
+        refreshScreenNormal(regions[0], regions[1], regions[2], regions[3]);
+    }
+}
+
 /** Refresh rotated screen with offscreen bufer content */
 void refreshScreenRotated(int x1, int y1, int x2, int y2) {
 
@@ -307,6 +315,14 @@ void refreshScreenRotated(int x1, int y1, int x2, int y2) {
     hdr->is_dirty = 1;
 }
 
+/** Refresh all areas of rotated screen updated by one paint */
+void refreshScreenRegionsRotated(const int *regions, int count) {
+    int i;
+    for (i = 0; i < count; i++, regions += 4) {
+        refreshScreenRotated(regions[0], regions[1], regions[2], regions[3]);
+    }
+}
+
 /** Frees native reources allocated for frame buffer */
 void finalizeFrameBuffer() {
     gxj_free_screen_buffer();
@@ -51,6 +51,12 @@ extern "C" {
  */
 void lcdlf_refresh(int hardwareId, int x, int y, int w, int h);
 
+/**
+ * Refresh all areas updated by one paint. The areas are given as
+ * x1, y1, x2, y2 quadruples, count of them.
+ */
+void lcdlf_refresh_regions(int hardwareId, const int *regions, int count);
+
 /**
  * Change screen orientation flag
  */
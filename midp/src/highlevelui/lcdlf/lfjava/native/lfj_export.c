@@ -46,6 +46,13 @@ void lcdlf_refresh(int hardwareId, int x, int y, int w, int h) {
   lfjport_refresh(hardwareId, x, y, w, h);
 }
 
+/**
+ * Refresh all areas updated by one paint.
+ */
+void lcdlf_refresh_regions(int hardwareId, const int *regions, int count) {
+  lfjport_refresh_regions(hardwareId, regions, count);
+}
+
 /**
  * Change screen orientation flag
  */
@@ -46,6 +46,17 @@ void lcdlf_refresh(int hardwareId, int x, int y, int w, int h) {
   lfpport_refresh(hardwareId, x, y, w, h);
 }
 
+/**
+ * Refresh all areas updated by one paint, one after another.
+ */
+void lcdlf_refresh_regions(int hardwareId, const int *regions, int count) {
+  int i;
+  for (i = 0; i < count; i++, regions += 4) {
+    lfpport_refresh(hardwareId, regions[0], regions[1],
+                    regions[2], regions[3]);
+  }
+}
+
 /**
  * Change screen orientation flag
  */
@@ -260,6 +260,20 @@ public class DisplayDevice {
 	refresh0(hardwareId, displayId, x1, y1, x2, y2); 
     }
 
+    /**
+     * Redraw all portions of the display updated by one paint.
+     * The device may present them together, which is cheaper than
+     * presenting each of them on its own.
+     *
+     * @param displayId The display ID associated with this Display
+     * @param regions x1, y1, x2, y2 corners of the portions, four
+     *                array elements per portion
+     * @param count number of portions
+     */
+    public void refresh(int displayId, int[] regions, int count) {
+	refreshRegions0(hardwareId, displayId, regions, count);
+    }
+
     /**
      * Sets full screen on the device.
      * @param mode The new screen size mode to be set. True if all
@@ -313,6 +327,8 @@ public class DisplayDevice {
     private native boolean reverseOrientation0(int hardwareId);
     private native void refresh0(int hardwareId, int displayId,
                                  int x1, int y1, int x2, int y2);
+    private native void refreshRegions0(int hardwareId, int displayId,
+                                        int[] regions, int count);
     private native void setFullScreen0(int hardwareId, int displayId, boolean mode);
     private native boolean directFlush0(int hardwareId, Graphics graphics, 
 					Image offscreen_buffer, int height);
@@ -40,6 +40,19 @@
 #include <gxapi_graphics.h>
 #include <imgapi_image.h>
 
+/** Tells the VM that the screen is about to change */
+static void hintVisualOutput() {
+#ifdef JVM_HINT_VISUAL_OUTPUT
+#if ENABLE_ISOLATES
+    int taskid = JVM_CurrentIsolateID();
+#else
+    int taskid = 0;
+#endif
+    // Make interpretation log less aggresive.
+    JVM_SetHint(taskid, JVM_HINT_VISUAL_OUTPUT, 0);
+#endif
+}
+
 /**
  * Calls platform specific function to redraw a portion of the display.
  * <p>
@@ -66,17 +79,7 @@ KNIDECL(com_sun_midp_lcdui_DisplayDevice_refresh0) {
     jint displayId = KNI_GetParameterAsInt(2);
     jint hardwareId = KNI_GetParameterAsInt(1);
 
-#ifdef JVM_HINT_VISUAL_OUTPUT
-    {
-#if ENABLE_ISOLATES
-        int taskid = JVM_CurrentIsolateID();
-#else
-        int taskid = 0;
-#endif
-        // Make interpretation log less aggresive.
-        JVM_SetHint(taskid, JVM_HINT_VISUAL_OUTPUT, 0);
-    }
-#endif
+    hintVisualOutput();
 
     if (midpHasForeground(displayId)) {
       // Paint only if this is the foreground MIDlet
@@ -86,6 +89,47 @@ KNIDECL(com_sun_midp_lcdui_DisplayDevice_refresh0) {
     KNI_ReturnVoid();
 }
 
+/**
+ * Calls platform specific function to redraw all portions of the
+ * display updated by one paint.
+ * <p>
+ * Java declaration:
+ * <pre>
+ *     refreshRegions0(II[II)V
+ * </pre>
+ * Java parameters:
+ * <pre>
+ *   hardwareId The display hardware ID associated with the Display Device
+ *   displayId The display ID associated with the Display object
+ *   regions   x1, y1, x2, y2 corners of the portions
+ *   count     Number of portions
+ * </pre>
+ */
+KNIEXPORT KNI_RETURNTYPE_VOID
+KNIDECL(com_sun_midp_lcdui_DisplayDevice_refreshRegions0) {
+    int count = KNI_GetParameterAsInt(4);
+    jint displayId = KNI_GetParameterAsInt(2);
+    jint hardwareId = KNI_GetParameterAsInt(1);
+
+    KNI_StartHandles(1);
+    KNI_DeclareHandle(regions);
+
+    KNI_GetParameterAsObject(3, regions);
+
+    hintVisualOutput();
+
+    if (midpHasForeground(displayId) && count > 0 &&
+            KNI_GetArrayLength(regions) >= count * 4) {
+        // Paint only if this is the foreground MIDlet
+        SNI_BEGIN_RAW_POINTERS;
+        lcdlf_refresh_regions(hardwareId, (int *)JavaIntArray(regions), count);
+        SNI_END_RAW_POINTERS;
+    }
+
+    KNI_EndHandles();
+    KNI_ReturnVoid();
+}
+
 /**
  *
  * Calls platform specific function to set display area 
@@ -52,6 +52,12 @@ extern "C" {
  */
 void lfjport_refresh(int hardwareId, int x, int y, int w, int h);
 
+/**
+ * Refresh all areas updated by one paint. The areas are given as
+ * x1, y1, x2, y2 quadruples, count of them.
+ */
+void lfjport_refresh_regions(int hardwareId, const int *regions, int count);
+
 
 /**
  * Change screen orientation flag
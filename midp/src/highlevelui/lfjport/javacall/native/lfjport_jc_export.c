@@ -69,6 +69,23 @@ void lfjport_refresh(int hardwareId, int x1, int y1, int x2, int y2)
     jcapp_refresh (hardwareId, x1, y1, x2, y2);
 }
 
+/**
+ * Bridge function to request a repaint of all areas updated
+ * by one paint. The areas are refreshed one after another.
+ *
+ * @param hardwareId unique id of hardware display
+ * @param regions x1, y1, x2, y2 corners of the areas to refresh
+ * @param count number of areas
+ */
+void lfjport_refresh_regions(int hardwareId, const int *regions, int count)
+{
+    int i;
+    for (i = 0; i < count; i++, regions += 4) {
+        lfjport_refresh(hardwareId, regions[0], regions[1],
+                        regions[2], regions[3]);
+    }
+}
+
 /**
  * Porting API function to update scroll bar.
  *
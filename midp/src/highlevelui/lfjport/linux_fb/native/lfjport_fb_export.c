@@ -74,6 +74,19 @@ void lfjport_refresh(int hardwareId, int x1, int y1, int x2, int y2)
   fbapp_refresh(hardwareId, x1, y1, x2, y2);
 }
 
+/**
+ * Bridge function to request a repaint of all areas updated
+ * by one paint. The areas are presented together.
+ *
+ * @param hardwareId unique id of hardware display
+ * @param regions x1, y1, x2, y2 corners of the areas to refresh
+ * @param count number of areas
+ */
+void lfjport_refresh_regions(int hardwareId, const int *regions, int count)
+{
+  fbapp_refresh_regions(hardwareId, regions, count);
+}
+
 /**
  * Bridge function to change screen orientation flag
  */
@@ -0,0 +1,399 @@
+/*
+ *  
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Native unit tests of the putpixel kernels. Every vector kernel set
+ * this CPU can run is checked pixel for pixel against the reference:
+ * gxj_alpha_composition() for blending, GXJ_RGB24TORGB16() for opaque
+ * pixels, and plain loops for fills and the eight image transforms.
+ */
+
+#if ENABLE_NUTS_FRAMEWORK
+
+#include <string.h>
+
+#include <midpNUTS.h>
+#include <midp_logging.h>
+#include <gxapi_constants.h>
+
+#include "gxj_intern_simd.h"
+
+extern void create_transformed_imageregion(gxj_screen_buffer* src,
+                                           gxj_screen_buffer* dest,
+                                           jint src_x, jint src_y,
+                                           jint width, jint height,
+                                           jint transform);
+
+/** Longest row tested, covers every vector width plus a tail */
+#define TEST_ROW 80
+
+/** Largest image side used for the transforms */
+#define TEST_SIDE 41
+
+static char* testBlend_m = "testGxjBlendMatchesAlphaComposition";
+static char* testOpaque_m = "testGxjOpaqueRow";
+static char* testPixelSet_m = "testGxjPixelSet";
+static char* testReverse_m = "testGxjReverse";
+static char* testTranspose_m = "testGxjTranspose";
+static char* testTransforms_m = "testGxjSpriteTransforms";
+
+/** State of the pseudo random generator, fixed for repeatable runs */
+static unsigned int seed = 1;
+
+static unsigned int nextRandom() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) ^ (seed << 15);
+}
+
+/**
+ * Reports a mismatch between a kernel and the reference.
+ *
+ * @return -1, to be returned by the test
+ */
+static int mismatch(const char *test, const gxj_pixel_kernels *kernels,
+                    int index) {
+    REPORT_ERROR2(LC_LOWUI, "%s: %s kernels differ from the reference",
+                  test, kernels->name);
+    REPORT_ERROR1(LC_LOWUI, " at %d\n", index);
+    return -1;
+}
+
+/**
+ * Blends rows of every alpha value onto random pixels at every start
+ * alignment and row length, and compares each pixel with what the
+ * scalar code writes for it.
+ */
+static int testBlend(void) {
+    static jint src[TEST_ROW * 4];
+    static gxj_pixel_type dst[TEST_ROW * 4 + 16];
+    static gxj_pixel_type ref[TEST_ROW * 4 + 16];
+    int isa, i, offset, width, round;
+
+    for (isa = 0; isa < GXJ_KERNELS_COUNT; isa++) {
+        const gxj_pixel_kernels *kernels = gxj_get_pixel_kernels(isa);
+        if (kernels == NULL) {
+            continue;
+        }
+
+        for (round = 0; round < 64; round++) {
+            /* all 256 alpha values, every few rounds with 0/255 runs */
+            for (i = 0; i < TEST_ROW * 4; i++) {
+                unsigned int a = (i + round * 7) & 0xFF;
+                if ((round & 3) == 1) {
+                    a = (i / 8 + round) & 1 ? 0xFF : 0;
+                } else if ((round & 3) == 2 && (i / 16) & 1) {
+                    a = 0;
+                }
+                src[i] = (jint)((a << 24) | (nextRandom() & 0xFFFFFF));
+            }
+            for (i = 0; i < TEST_ROW * 4 + 16; i++) {
+                dst[i] = ref[i] = (gxj_pixel_type)nextRandom();
+            }
+
+            offset = round & 15;
+            width = (round * 37) % (TEST_ROW * 4 - 15);
+            kernels->draw_rgb_row_alpha(dst + offset, src, width);
+
+            for (i = 0; i < width; i++) {
+                unsigned char As = (unsigned char)((unsigned int)src[i] >> 24);
+                if (As == 0xFF) {
+                    ref[offset + i] = GXJ_RGB24TORGB16(src[i]);
+                } else if (As != 0) {
+                    ref[offset + i] =
+                        gxj_alpha_composition(src[i], ref[offset + i], As);
+                }
+            }
+            for (i = 0; i < TEST_ROW * 4 + 16; i++) {
+                if (dst[i] != ref[i]) {
+                    return mismatch(testBlend_m, kernels, i);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Converts opaque rows and compares them with GXJ_RGB24TORGB16() */
+static int testOpaque(void) {
+    static jint src[TEST_ROW];
+    static gxj_pixel_type dst[TEST_ROW + 16];
+    int isa, i, offset, width;
+
+    for (isa = 0; isa < GXJ_KERNELS_COUNT; isa++) {
+        const gxj_pixel_kernels *kernels = gxj_get_pixel_kernels(isa);
+        if (kernels == NULL) {
+            continue;
+        }
+
+        for (width = 0; width <= TEST_ROW; width++) {
+            offset = width & 7;
+            for (i = 0; i < TEST_ROW; i++) {
+                src[i] = (jint)nextRandom();
+            }
+            memset(dst, 0x5A, sizeof(dst));
+            kernels->draw_rgb_row(dst + offset, src, width);
+
+            for (i = 0; i < TEST_ROW + 16; i++) {
+                gxj_pixel_type expected = 0x5A5A;
+                if (i >= offset && i < offset + width) {
+                    expected = GXJ_RGB24TORGB16(src[i - offset]);
+                }
+                if (dst[i] != expected) {
+                    return mismatch(testOpaque_m, kernels, i);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Fills runs at every alignment and checks nothing around them */
+static int testPixelSet(void) {
+    static gxj_pixel_type dst[TEST_ROW + 32];
+    int isa, i, offset, count;
+
+    for (isa = 0; isa < GXJ_KERNELS_COUNT; isa++) {
+        const gxj_pixel_kernels *kernels = gxj_get_pixel_kernels(isa);
+        if (kernels == NULL) {
+            continue;
+        }
+
+        for (offset = 0; offset < 16; offset++) {
+            for (count = 0; count <= TEST_ROW; count++) {
+                memset(dst, 0, sizeof(dst));
+                kernels->pixel_set(dst + offset, 0xBEEF, count);
+
+                for (i = 0; i < TEST_ROW + 32; i++) {
+                    gxj_pixel_type expected =
+                        (i >= offset && i < offset + count) ? 0xBEEF : 0;
+                    if (dst[i] != expected) {
+                        return mismatch(testPixelSet_m, kernels, i);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Reverses pixel and alpha rows of every length */
+static int testReverse(void) {
+    static gxj_pixel_type src[TEST_ROW];
+    static gxj_pixel_type dst[TEST_ROW + 1];
+    static gxj_alpha_type asrc[TEST_ROW];
+    static gxj_alpha_type adst[TEST_ROW + 1];
+    int isa, i, count;
+
+    for (isa = 0; isa < GXJ_KERNELS_COUNT; isa++) {
+        const gxj_pixel_kernels *kernels = gxj_get_pixel_kernels(isa);
+        if (kernels == NULL) {
+            continue;
+        }
+
+        for (count = 0; count <= TEST_ROW; count++) {
+            for (i = 0; i < TEST_ROW; i++) {
+                src[i] = (gxj_pixel_type)nextRandom();
+                asrc[i] = (gxj_alpha_type)nextRandom();
+            }
+            memset(dst, 0, sizeof(dst));
+            memset(adst, 0, sizeof(adst));
+            kernels->reverse_pixels(dst, src, count);
+            kernels->reverse_alpha(adst, asrc, count);
+
+            for (i = 0; i < count; i++) {
+                if (dst[i] != src[count - 1 - i] ||
+                        adst[i] != asrc[count - 1 - i]) {
+                    return mismatch(testReverse_m, kernels, i);
+                }
+            }
+            if (dst[count] != 0 || adst[count] != 0) {
+                return mismatch(testReverse_m, kernels, count);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Transposes blocks of every shape up to TEST_SIDE, both directions */
+static int testTranspose(void) {
+    static gxj_pixel_type src[TEST_SIDE * TEST_SIDE];
+    static gxj_pixel_type dst[TEST_SIDE * TEST_SIDE];
+    static gxj_alpha_type asrc[TEST_SIDE * TEST_SIDE];
+    static gxj_alpha_type adst[TEST_SIDE * TEST_SIDE];
+    int isa, i, x, y, width, height, flip;
+
+    for (i = 0; i < TEST_SIDE * TEST_SIDE; i++) {
+        src[i] = (gxj_pixel_type)nextRandom();
+        asrc[i] = (gxj_alpha_type)nextRandom();
+    }
+
+    for (isa = 0; isa < GXJ_KERNELS_COUNT; isa++) {
+        const gxj_pixel_kernels *kernels = gxj_get_pixel_kernels(isa);
+        if (kernels == NULL) {
+            continue;
+        }
+
+        for (width = 1; width <= TEST_SIDE; width += 3) {
+            for (height = 1; height <= TEST_SIDE; height += 2) {
+                for (flip = 0; flip < 2; flip++) {
+                    /* flip walks the destination rows bottom up */
+                    int dstStride = flip ? -TEST_SIDE : TEST_SIDE;
+                    int dstStart = flip ? (width - 1) * TEST_SIDE : 0;
+
+                    memset(dst, 0, sizeof(dst));
+                    memset(adst, 0, sizeof(adst));
+                    kernels->transpose_pixels(dst + dstStart, dstStride,
+                                              src, TEST_SIDE, width, height);
+                    kernels->transpose_alpha(adst + dstStart, dstStride,
+                                             asrc, TEST_SIDE, width, height);
+
+                    for (y = 0; y < height; y++) {
+                        for (x = 0; x < width; x++) {
+                            int d = dstStart + x * dstStride + y;
+                            if (dst[d] != src[y * TEST_SIDE + x] ||
+                                    adst[d] != asrc[y * TEST_SIDE + x]) {
+                                return mismatch(testTranspose_m, kernels,
+                                                y * TEST_SIDE + x);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Runs create_transformed_imageregion() with every kernel set for all
+ * eight Sprite transforms and compares the result with the transform
+ * applied one pixel at a time.
+ */
+static int testTransforms(void) {
+    static gxj_pixel_type pixels[TEST_SIDE * TEST_SIDE];
+    static gxj_alpha_type alpha[TEST_SIDE * TEST_SIDE];
+    static gxj_pixel_type outPixels[TEST_SIDE * TEST_SIDE];
+    static gxj_alpha_type outAlpha[TEST_SIDE * TEST_SIDE];
+    const gxj_pixel_kernels *saved = GXJ_KERNELS();
+    gxj_screen_buffer src;
+    gxj_screen_buffer dest;
+    int isa, i, x, y, transform, result = 0;
+    /* a region with vector sized and ragged sides, off the origin */
+    const int srcX = 3, srcY = 2, width = 35, height = 19;
+
+    for (i = 0; i < TEST_SIDE * TEST_SIDE; i++) {
+        pixels[i] = (gxj_pixel_type)nextRandom();
+        alpha[i] = (gxj_alpha_type)nextRandom();
+    }
+    memset(&src, 0, sizeof(src));
+    src.width = TEST_SIDE;
+    src.height = TEST_SIDE;
+    src.pixelData = pixels;
+    src.alphaData = alpha;
+
+    for (isa = 0; isa < GXJ_KERNELS_COUNT && result == 0; isa++) {
+        const gxj_pixel_kernels *kernels = gxj_get_pixel_kernels(isa);
+        if (kernels == NULL) {
+            continue;
+        }
+        gxj_kernels = kernels;
+
+        for (transform = 0; transform < 8 && result == 0; transform++) {
+            memset(&dest, 0, sizeof(dest));
+            dest.pixelData = outPixels;
+            dest.alphaData = outAlpha;
+            create_transformed_imageregion(&src, &dest, srcX, srcY,
+                                           width, height, transform);
+
+            for (y = 0; y < height && result == 0; y++) {
+                for (x = 0; x < width; x++) {
+                    int dx = (transform & TRANSFORM_X_FLIP) ?
+                        width - 1 - x : x;
+                    int dy = (transform & TRANSFORM_Y_FLIP) ?
+                        height - 1 - y : y;
+                    int s = (srcY + y) * TEST_SIDE + srcX + x;
+                    int d = (transform & TRANSFORM_INVERTED_AXES) ?
+                        dx * height + dy : dy * width + dx;
+
+                    if (outPixels[d] != pixels[s] || outAlpha[d] != alpha[s]) {
+                        REPORT_ERROR1(LC_LOWUI, "transform %d: ", transform);
+                        result = mismatch(testTransforms_m, kernels, d);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    gxj_kernels = saved;
+    return result;
+}
+
+/**
+ * Registers the putpixel kernel tests.
+ *
+ * @return number of tests registered in total
+ */
+int registerGxjSimdTests() {
+    if (!register_test(testBlend_m, testBlend)) {
+        REPORT_WARN1(LC_LOWUI, "Registration of test %s failed.\n",
+                     testBlend_m);
+    }
+
+    if (!register_test(testOpaque_m, testOpaque)) {
+        REPORT_WARN1(LC_LOWUI, "Registration of test %s failed.\n",
+                     testOpaque_m);
+    }
+
+    if (!register_test(testPixelSet_m, testPixelSet)) {
+        REPORT_WARN1(LC_LOWUI, "Registration of test %s failed.\n",
+                     testPixelSet_m);
+    }
+
+    if (!register_test(testReverse_m, testReverse)) {
+        REPORT_WARN1(LC_LOWUI, "Registration of test %s failed.\n",
+                     testReverse_m);
+    }
+
+    if (!register_test(testTranspose_m, testTranspose)) {
+        REPORT_WARN1(LC_LOWUI, "Registration of test %s failed.\n",
+                     testTranspose_m);
+    }
+
+    if (!register_test(testTransforms_m, testTransforms)) {
+        REPORT_WARN1(LC_LOWUI, "Registration of test %s failed.\n",
+                     testTransforms_m);
+    }
+    return get_num_tests();
+}
+
+#endif /* ENABLE_NUTS_FRAMEWORK */
@@ -33,6 +33,7 @@
 #include "gxj_intern_graphics.h"
 #include "gxj_intern_putpixel.h"
 #include "gxj_intern_image.h"
+#include "gxj_intern_simd.h"
 
 #if ENABLE_BOUNDS_CHECKS
 #include <gxapi_graphics.h>
@@ -128,63 +129,11 @@ gx_copy_area(const jshort *clip,
 		   x_src, y_src, 0);
 }
 
-/* 
- * For A in [0..0xffff] 
- *
- *        A / 255 == A / 256 + ((A / 256) + (A % 256) + 1) / 256
- *
- */
-#define div(x)  (((x) >> 8) + ((((x) >> 8) + ((x) & 0xff) + 1) >> 8))
-
-static unsigned short alphaComposition(jint src, 
-                                       unsigned short dst, 
-                                       unsigned char As) {
-  unsigned char Rs = (unsigned char)(src >> 16);
-  unsigned char Rd = (unsigned char)
-    ((((dst & 0xF800) << 5) | (dst & 0xE000)) >> 13);
-  int pRr = ((int)Rs - Rd) * As + Rd * 0xff;
-  unsigned char Rr = 
-    (unsigned char)( div(pRr) );
-
-  unsigned char Gs = (unsigned char)(src >> 8);
-  unsigned char Gd = (unsigned char)
-    (((dst & 0x07E0) >> 3) | ((dst & 0x0600) >> 9));
-  int pGr = ((int)Gs - Gd) * As + Gd * 0xff;
-  unsigned char Gr = 
-    (unsigned char)( div(pGr) );
-
-  unsigned char Bs = (unsigned char)(src);
-  unsigned char Bd = (unsigned char)
-    ((dst & 0x001F) << 3) | ((dst & 0x001C) >> 2);
-  int pBr = ((int)Bs - Bd) * As + Bd * 0xff;
-  unsigned char Br = 
-    (unsigned char)( div(pBr) );
-
-  /* compose RGB from separate color components */
-  return ((Rr & 0xF8) << 8) + ((Gr & 0xFC) << 3) + (Br >> 3);
-}
-
-
 #if (UNDER_CE)
 extern void asm_draw_rgb(jint* src, int srcSpan, unsigned short* dst,
     int dstSpan, int width, int height);
 #endif
 
-#define SRC_PIXEL_TO_DEST_WITH_ALPHA(pSrc, pDest) \
-        src = *pSrc++;  \
-        As = src >> 26; \
-        if (As == 0x3F) {   \
-            *pDest = GXJ_RGB24TORGB16(src);  \
-        } else if (As != 0) {   \
-            *pDest = alphaComposition(src, *pDest, (unsigned char)As);   \
-        }   \
-        pDest++
-
-#define SRC_PIXEL_TO_DEST(pSrc, pDest) \
-        src = *pSrc++;  \
-        *pDest = GXJ_RGB24TORGB16(src); \
-        pDest++
-
 /** Draw image in RGB format */
 void
 gx_draw_rgb(const jshort *clip,
@@ -275,7 +224,7 @@ gx_draw_rgb(const jshort *clip,
 
 	    CHECK_PTR_CLIP(sbuf, pdst);
 
-	    *pdst = alphaComposition(src, *pdst, As);
+	    *pdst = gxj_alpha_composition(src, *pdst, As);
 	  } while (++pdst < pdst_stop);
 
 	  psrc += psrc_delta;
@@ -285,77 +234,29 @@ gx_draw_rgb(const jshort *clip,
     }
 #else
     {
-        const unsigned int width16 = width & 0xFFFFFFF0;
-        const unsigned int widthRemain = width & 0xF;
-        unsigned int col;
-        
         gxj_pixel_type * pdst = &sbuf->pixelData[y * sbufWidth + x];
         jint * psrc = &rgbData[offset];
-        int pdst_delta = sbufWidth - width;
-        int psrc_delta = scanlen - width;
         gxj_pixel_type * pdst_end = pdst + height * sbufWidth;
-        unsigned int  src;
-        unsigned char As;
 
-        if (pdst_delta < 0 || psrc_delta < 0) {
+        if (sbufWidth < width || scanlen < width) {
             return;
         }
 
         if (processAlpha) {
+            void (*draw_row)(gxj_pixel_type *, const jint *, int) =
+                GXJ_KERNELS()->draw_rgb_row_alpha;
             do {
-                for (col = width16; col != 0; col -= 16) {
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                }
-                
-                for (col = widthRemain; col != 0; col--) {
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                }
-                
-                psrc += psrc_delta;
-                pdst += pdst_delta;
+                draw_row(pdst, psrc, width);
+                psrc += scanlen;
+                pdst += sbufWidth;
             } while (pdst < pdst_end);
         } else {
+            void (*draw_row)(gxj_pixel_type *, const jint *, int) =
+                GXJ_KERNELS()->draw_rgb_row;
             do {
-                for (col = width16; col != 0; col -= 16) {
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                }
-                
-                for (col = widthRemain; col != 0; col--) {
-                    SRC_PIXEL_TO_DEST(psrc,pdst);
-                }
-
-                psrc += psrc_delta;
-                pdst += pdst_delta;
+                draw_row(pdst, psrc, width);
+                psrc += scanlen;
+                pdst += sbufWidth;
             } while (pdst < pdst_end);
         }
     }
@@ -430,12 +331,8 @@ extern void fast_pixel_set(unsigned * mem, unsigned value, int number_of_pixels)
 #else
 void fast_pixel_set(unsigned * mem, unsigned value, int number_of_pixels)
 {
-   int i;
-   gxj_pixel_type* pBuf = (gxj_pixel_type*)mem;
-
-   for (i = 0; i < number_of_pixels; ++i) {
-      *(pBuf + i) = (gxj_pixel_type)value;
-   }
+   GXJ_KERNELS()->pixel_set((gxj_pixel_type*)mem, (gxj_pixel_type)value,
+                            number_of_pixels);
 }
 #endif
 
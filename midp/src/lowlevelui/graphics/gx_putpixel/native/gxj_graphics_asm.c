@@ -361,7 +361,18 @@ void unclipped_blit(unsigned short *dstRaster, int dstSpan,
     done:
     }
 #else
+  /*
+   * Portable version: one memcpy() per scanline, or a single one when
+   * the scanlines are contiguous. The C library copies with the widest
+   * loads and stores the target has (SSE2 on x86, NEON on ARMv7), so
+   * unlike the gx_draw_rgb row kernels there is no hand-written SSE2 or
+   * NEON loop here; it would only duplicate memcpy().
+   */
   dstSpan >>= 1; srcSpan >>= 1;
+  if ((height > 1) && ((width>>1) == srcSpan) && (srcSpan == dstSpan)) {
+    width = (dstSpan<<1) * height;
+    height = 1;
+  }
   if (((unsigned int)dstRaster | (unsigned int)srcRaster | 
        dstSpan<<1 | srcSpan<<1) & 0x2) {
     for ( ; height > 0; height--) {
@@ -409,11 +420,6 @@ void unclipped_blit(unsigned short *dstRaster, int dstSpan,
         }
       }
     } else {
-      /* single memcpy optimization */
-      if (((width>>1) == srcSpan) && (srcSpan == dstSpan)) {
-        width = (dstSpan<<1) * height;
-        height = 1;
-      }
       for ( ; height > 0; height -= 1) {
         CHECK_PTR_CLIP(dst, dstRaster); CHECK_PTR_CLIP(dst, dstRaster+(width>>1)-1);
 #ifdef USE_RT_MEMCPY_W
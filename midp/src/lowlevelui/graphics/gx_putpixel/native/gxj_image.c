@@ -39,6 +39,7 @@
 #include "gxj_intern_graphics.h"
 #include "gxj_intern_image.h"
 #include "gxj_intern_putpixel.h"
+#include "gxj_intern_simd.h"
 
 static void clipped_blit(gxj_screen_buffer* dst, int dstX, int dstY,
 			 gxj_screen_buffer* src, const jshort *clip);
@@ -208,16 +209,12 @@ clipped_blit(gxj_screen_buffer* dst, int dstX, int dstY, gxj_screen_buffer* src,
 void
 create_transformed_imageregion(gxj_screen_buffer* src, gxj_screen_buffer* dest, jint src_x, jint src_y,
                              jint width, jint height, jint transform) {
-  int srcX;
-  int srcY;
   int xStart;
   int yStart;
   int xIncr;
   int yIncr;
-  int destX;
-  int destY;
-  int yCounter;
-  int xCounter;
+  int srcStride = src->width;
+  const gxj_pixel_kernels *kernels = GXJ_KERNELS();
 
   /* set dimensions of image being created,
      depending on transform */
@@ -245,35 +242,54 @@ create_transformed_imageregion(gxj_screen_buffer* src, gxj_screen_buffer* dest,
     xIncr = +1;
   }
 
-  for (srcY = src_y, destY = yStart, yCounter = 0;
-       yCounter < height;
-       srcY++, destY+=yIncr, yCounter++) {
+  if (transform & TRANSFORM_INVERTED_AXES) {
+    /*
+     * Source column x becomes destination row xStart + x * xIncr.
+     * Walking the source rows bottom up for a Y flip makes every
+     * destination row a plain transposed column, so all four
+     * rotations are one block transpose with signed strides.
+     */
+    int srcOffset = (src_y + yStart) * srcStride + src_x;
+    int dstOffset = xStart * dest->width;
+
+    kernels->transpose_pixels(dest->pixelData + dstOffset,
+                              xIncr * dest->width,
+                              src->pixelData + srcOffset,
+                              yIncr * srcStride, width, height);
+    if (src->alphaData != NULL) {
+      kernels->transpose_alpha(dest->alphaData + dstOffset,
+                               xIncr * dest->width,
+                               src->alphaData + srcOffset,
+                               yIncr * srcStride, width, height);
+    }
+  } else {
+    int yCounter;
 
-    int srcYwidth = srcY * src->width;
-    int destYwidth = destY * dest->width;
+    /* rows keep their pixels together, an X flip reverses them */
+    for (yCounter = 0; yCounter < height; yCounter++) {
+      int srcOffset = (src_y + yCounter) * srcStride + src_x;
+      int dstOffset = (yStart + yCounter * yIncr) * dest->width;
+      gxj_pixel_type *pSrc = src->pixelData + srcOffset;
+      gxj_pixel_type *pDst = dest->pixelData + dstOffset;
 
-    for (srcX = src_x, destX = xStart, xCounter = 0;
-         xCounter < width;
-         srcX++, destX+=xIncr, xCounter++) {
+      if (xIncr == 1) {
+        memcpy(pDst, pSrc, width * sizeof(gxj_pixel_type));
+      } else {
+        kernels->reverse_pixels(pDst, pSrc, width);
+      }
 
-      if ( transform & TRANSFORM_INVERTED_AXES ) {
-          dest->pixelData[destX * dest->width + destY] =
-            src->pixelData[srcYwidth /*srcY*src->width*/ + srcX];
-        if (src->alphaData != NULL) {
-            dest->alphaData[destX * dest->width + destY] =
-                src->alphaData[srcYwidth /*srcY*src->width*/ + srcX];
-        }
+      if (src->alphaData != NULL) {
+        gxj_alpha_type *aSrc = src->alphaData + srcOffset;
+        gxj_alpha_type *aDst = dest->alphaData + dstOffset;
 
-      } else {
-        dest->pixelData[destYwidth /*destY * dest->width*/ + destX] =
-                   src->pixelData[srcYwidth /*srcY*src->width*/ + srcX];
-        if (src->alphaData != NULL) {
-            dest->alphaData[destYwidth /*destY * dest->width*/ + destX] =
-                src->alphaData[srcYwidth /*srcY*src->width*/ + srcX];
+        if (xIncr == 1) {
+          memcpy(aDst, aSrc, width * sizeof(gxj_alpha_type));
+        } else {
+          kernels->reverse_alpha(aDst, aSrc, width);
         }
       }
-    } /*for x*/
-  } /* for y */
+    } /* for y */
+  }
 }
 
 /**
@@ -0,0 +1,129 @@
+/*
+ *  
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_INTERN_SIMD_H_
+#define _GXJ_INTERN_SIMD_H_
+
+#include <kni.h>
+#include <gxj_putpixel.h>
+
+/**
+ * @file
+ *
+ * Row kernels for the putpixel primitives. Every kernel exists in a
+ * plain C version, which is the reference, and in vector versions
+ * that produce the same pixels. On x86 built with GCC 4.9 or later
+ * (or clang) the SSE2 and AVX2 versions are all compiled in and the
+ * best one the CPU supports is picked at run time through CPUID. On
+ * little-endian ARM with NEON the NEON versions are picked at compile
+ * time.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Instruction sets a kernel table can be built for */
+#define GXJ_KERNELS_SCALAR 0
+#define GXJ_KERNELS_SSE2   1
+#define GXJ_KERNELS_AVX2   2
+#define GXJ_KERNELS_NEON   3
+#define GXJ_KERNELS_COUNT  4
+
+/** Pixel kernels for one instruction set */
+typedef struct _gxj_pixel_kernels {
+    /** Name of the instruction set */
+    const char *name;
+
+    /** Convert width opaque ARGB8888 pixels to 565 */
+    void (*draw_rgb_row)(gxj_pixel_type *dst, const jint *src, int width);
+
+    /** Blend width ARGB8888 pixels onto 565 pixels */
+    void (*draw_rgb_row_alpha)(gxj_pixel_type *dst, const jint *src,
+                               int width);
+
+    /** Set count pixels to the same value */
+    void (*pixel_set)(gxj_pixel_type *dst, gxj_pixel_type pixel, int count);
+
+    /** dst[i] = src[count - 1 - i] for count pixels */
+    void (*reverse_pixels)(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                           int count);
+
+    /** dst[i] = src[count - 1 - i] for count alpha values */
+    void (*reverse_alpha)(gxj_alpha_type *dst, const gxj_alpha_type *src,
+                          int count);
+
+    /**
+     * dst[x * dstStride + y] = src[y * srcStride + x] for a width by
+     * height block of pixels. Strides are in pixels and may be
+     * negative.
+     */
+    void (*transpose_pixels)(gxj_pixel_type *dst, int dstStride,
+                             const gxj_pixel_type *src, int srcStride,
+                             int width, int height);
+
+    /** transpose_pixels() for alpha values */
+    void (*transpose_alpha)(gxj_alpha_type *dst, int dstStride,
+                            const gxj_alpha_type *src, int srcStride,
+                            int width, int height);
+} gxj_pixel_kernels;
+
+/** Kernels in use, NULL until gxj_select_pixel_kernels() has run */
+extern const gxj_pixel_kernels *gxj_kernels;
+
+/**
+ * Picks the fastest kernels this CPU supports and makes them the
+ * ones in use.
+ *
+ * @return the kernels now in use
+ */
+const gxj_pixel_kernels *gxj_select_pixel_kernels(void);
+
+/**
+ * Returns the kernels for an instruction set.
+ *
+ * @param isa one of the GXJ_KERNELS_* values
+ * @return the kernels, or NULL if they are not built in or this CPU
+ *         cannot run them
+ */
+const gxj_pixel_kernels *gxj_get_pixel_kernels(int isa);
+
+/** Kernels in use, selected on first use */
+#define GXJ_KERNELS() \
+    (gxj_kernels != NULL ? gxj_kernels : gxj_select_pixel_kernels())
+
+/**
+ * Blend one ARGB8888 pixel onto a 565 pixel with the given alpha.
+ * This is the reference every blending kernel must match.
+ */
+unsigned short gxj_alpha_composition(jint src, unsigned short dst,
+                                     unsigned char As);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GXJ_INTERN_SIMD_H_ */
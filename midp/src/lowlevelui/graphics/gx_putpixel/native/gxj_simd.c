@@ -0,0 +1,952 @@
+/*
+ *  
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#include <kni.h>
+#include <midp_logging.h>
+
+#include "gxj_intern_simd.h"
+
+/**
+ * @file
+ *
+ * Scalar and vector versions of the putpixel row kernels, and the
+ * selection of the set to use.
+ */
+
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+/* target attributes let SSE2 and AVX2 code live in one i386 build */
+#define GXJ_SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#define GXJ_TARGET_SSE2 __attribute__((target("sse2")))
+#define GXJ_TARGET_AVX2 __attribute__((target("avx2")))
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && \
+      !defined(__ARM_BIG_ENDIAN)
+#define GXJ_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* 
+ * For A in [0..0xffff] 
+ *
+ *        A / 255 == A / 256 + ((A / 256) + (A % 256) + 1) / 256
+ *
+ */
+#define div(x)  (((x) >> 8) + ((((x) >> 8) + ((x) & 0xff) + 1) >> 8))
+
+unsigned short gxj_alpha_composition(jint src, 
+                                     unsigned short dst, 
+                                     unsigned char As) {
+  unsigned char Rs = (unsigned char)(src >> 16);
+  unsigned char Rd = (unsigned char)
+    ((((dst & 0xF800) << 5) | (dst & 0xE000)) >> 13);
+  int pRr = ((int)Rs - Rd) * As + Rd * 0xff;
+  unsigned char Rr = 
+    (unsigned char)( div(pRr) );
+
+  unsigned char Gs = (unsigned char)(src >> 8);
+  unsigned char Gd = (unsigned char)
+    (((dst & 0x07E0) >> 3) | ((dst & 0x0600) >> 9));
+  int pGr = ((int)Gs - Gd) * As + Gd * 0xff;
+  unsigned char Gr = 
+    (unsigned char)( div(pGr) );
+
+  unsigned char Bs = (unsigned char)(src);
+  unsigned char Bd = (unsigned char)
+    ((dst & 0x001F) << 3) | ((dst & 0x001C) >> 2);
+  int pBr = ((int)Bs - Bd) * As + Bd * 0xff;
+  unsigned char Br = 
+    (unsigned char)( div(pBr) );
+
+  /* compose RGB from separate color components */
+  return ((Rr & 0xF8) << 8) + ((Gr & 0xFC) << 3) + (Br >> 3);
+}
+
+#define SRC_PIXEL_TO_DEST_WITH_ALPHA(pSrc, pDest) \
+        src = *pSrc++;  \
+        As = src >> 24; \
+        if (As == 0xFF) {   \
+            *pDest = GXJ_RGB24TORGB16(src);  \
+        } else if (As != 0) {   \
+            *pDest = gxj_alpha_composition(src, *pDest, (unsigned char)As); \
+        }   \
+        pDest++
+
+#define SRC_PIXEL_TO_DEST(pSrc, pDest) \
+        src = *pSrc++;  \
+        *pDest = GXJ_RGB24TORGB16(src); \
+        pDest++
+
+/*
+ * Scalar kernels. They are the reference for the vector kernels,
+ * which call them for the pixels left over after the last full
+ * vector.
+ */
+
+static void draw_rgb_row_c(gxj_pixel_type *pdst, const jint *psrc,
+                           int width) {
+    unsigned int src;
+
+    for (; width >= 16; width -= 16) {
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+    }
+
+    for (; width > 0; width--) {
+        SRC_PIXEL_TO_DEST(psrc, pdst);
+    }
+}
+
+static void draw_rgb_row_alpha_c(gxj_pixel_type *pdst, const jint *psrc,
+                                 int width) {
+    unsigned int src;
+    unsigned int As;
+
+    for (; width >= 16; width -= 16) {
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+    }
+
+    for (; width > 0; width--) {
+        SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
+    }
+}
+
+static void pixel_set_c(gxj_pixel_type *pBuf, gxj_pixel_type pixel,
+                        int count) {
+    /* align to 4 bytes, then store two pixels at a time */
+    if (count > 0 && ((unsigned long)pBuf & 2) != 0) {
+        *pBuf++ = pixel;
+        count--;
+    }
+    {
+        unsigned int *pWord = (unsigned int *)pBuf;
+        unsigned int pair = ((unsigned int)pixel << 16) | pixel;
+        for (; count >= 8; count -= 8) {
+            pWord[0] = pair;
+            pWord[1] = pair;
+            pWord[2] = pair;
+            pWord[3] = pair;
+            pWord += 4;
+        }
+        for (; count >= 2; count -= 2) {
+            *pWord++ = pair;
+        }
+        pBuf = (gxj_pixel_type *)pWord;
+    }
+
+    for (; count > 0; count--) {
+        *pBuf++ = pixel;
+    }
+}
+
+static void reverse_pixels_c(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                             int count) {
+    const gxj_pixel_type *p = src + count;
+
+    while (p != src) {
+        *dst++ = *--p;
+    }
+}
+
+static void reverse_alpha_c(gxj_alpha_type *dst, const gxj_alpha_type *src,
+                            int count) {
+    const gxj_alpha_type *p = src + count;
+
+    while (p != src) {
+        *dst++ = *--p;
+    }
+}
+
+static void transpose_pixels_c(gxj_pixel_type *dst, int dstStride,
+                               const gxj_pixel_type *src, int srcStride,
+                               int width, int height) {
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        gxj_pixel_type *pDst = dst + y;
+        for (x = 0; x < width; x++) {
+            *pDst = src[x];
+            pDst += dstStride;
+        }
+        src += srcStride;
+    }
+}
+
+static void transpose_alpha_c(gxj_alpha_type *dst, int dstStride,
+                              const gxj_alpha_type *src, int srcStride,
+                              int width, int height) {
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        gxj_alpha_type *pDst = dst + y;
+        for (x = 0; x < width; x++) {
+            *pDst = src[x];
+            pDst += dstStride;
+        }
+        src += srcStride;
+    }
+}
+
+static const gxj_pixel_kernels kernels_c = {
+    "C",
+    draw_rgb_row_c,
+    draw_rgb_row_alpha_c,
+    pixel_set_c,
+    reverse_pixels_c,
+    reverse_alpha_c,
+    transpose_pixels_c,
+    transpose_alpha_c
+};
+
+#if GXJ_SIMD_X86
+
+/*
+ * SSE2 kernels, eight 565 pixels per 16-byte vector.
+ */
+
+/** Convert four ARGB8888 pixels to 565, one per 32-bit lane */
+GXJ_TARGET_SSE2
+static __m128i sse2_argb_to_565(__m128i s) {
+    __m128i r = _mm_srli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x00F80000)), 8);
+    __m128i g = _mm_srli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x0000FC00)), 5);
+    __m128i b = _mm_srli_epi32(_mm_and_si128(s, _mm_set1_epi32(0x000000F8)), 3);
+    __m128i v = _mm_or_si128(r, _mm_or_si128(g, b));
+
+    /* sign extend so the saturating pack keeps all 16 bits */
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+/** Per 16-bit lane version of div() above */
+GXJ_TARGET_SSE2
+static __m128i sse2_div255(__m128i x) {
+    __m128i h = _mm_srli_epi16(x, 8);
+    __m128i l = _mm_and_si128(x, _mm_set1_epi16(0xFF));
+    return _mm_add_epi16(h, _mm_srli_epi16(
+        _mm_add_epi16(_mm_add_epi16(h, l), _mm_set1_epi16(1)), 8));
+}
+
+/**
+ * gxj_alpha_composition() for eight pixels. The blend is computed as
+ * s*A + d*(255-A), which equals (s-d)*A + d*255 but never leaves
+ * the unsigned 16-bit range.
+ */
+GXJ_TARGET_SSE2
+static __m128i sse2_blend_565(__m128i s0, __m128i s1, __m128i d) {
+    const __m128i ff = _mm_set1_epi32(0xFF);
+    __m128i As = _mm_packs_epi32(_mm_srli_epi32(s0, 24),
+                                 _mm_srli_epi32(s1, 24));
+    __m128i Ad = _mm_sub_epi16(_mm_set1_epi16(0xFF), As);
+    __m128i Rs = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 16), ff),
+                                 _mm_and_si128(_mm_srli_epi32(s1, 16), ff));
+    __m128i Gs = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 8), ff),
+                                 _mm_and_si128(_mm_srli_epi32(s1, 8), ff));
+    __m128i Bs = _mm_packs_epi32(_mm_and_si128(s0, ff),
+                                 _mm_and_si128(s1, ff));
+    __m128i Rd = _mm_or_si128(
+        _mm_srli_epi16(_mm_and_si128(d, _mm_set1_epi16((short)0xF800)), 8),
+        _mm_srli_epi16(d, 13));
+    __m128i Gd = _mm_or_si128(
+        _mm_srli_epi16(_mm_and_si128(d, _mm_set1_epi16(0x07E0)), 3),
+        _mm_srli_epi16(_mm_and_si128(d, _mm_set1_epi16(0x0600)), 9));
+    __m128i Bd = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(d, _mm_set1_epi16(0x001F)), 3),
+        _mm_srli_epi16(_mm_and_si128(d, _mm_set1_epi16(0x001C)), 2));
+    __m128i Rr = sse2_div255(_mm_add_epi16(_mm_mullo_epi16(Rs, As),
+                                           _mm_mullo_epi16(Rd, Ad)));
+    __m128i Gr = sse2_div255(_mm_add_epi16(_mm_mullo_epi16(Gs, As),
+                                           _mm_mullo_epi16(Gd, Ad)));
+    __m128i Br = sse2_div255(_mm_add_epi16(_mm_mullo_epi16(Bs, As),
+                                           _mm_mullo_epi16(Bd, Ad)));
+
+    return _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(Rr, _mm_set1_epi16(0xF8)), 8),
+        _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(Gr, _mm_set1_epi16(0xFC)), 3),
+            _mm_srli_epi16(Br, 3)));
+}
+
+/** Reverse the order of eight 16-bit lanes */
+GXJ_TARGET_SSE2
+static __m128i sse2_reverse_epi16(__m128i v) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/**
+ * Transpose an 8x8 block of 16-bit values held one row per vector.
+ * The unpacks work within 128-bit lanes, so the AVX2 version below
+ * is the same sequence on 256-bit vectors.
+ */
+#define TRANSPOSE_8X8_EPI16(V, unpacklo16, unpackhi16, unpacklo32, \
+                            unpackhi32, unpacklo64, unpackhi64, r) \
+    do { \
+        V b0 = unpacklo16(r[0], r[1]), b1 = unpackhi16(r[0], r[1]); \
+        V b2 = unpacklo16(r[2], r[3]), b3 = unpackhi16(r[2], r[3]); \
+        V b4 = unpacklo16(r[4], r[5]), b5 = unpackhi16(r[4], r[5]); \
+        V b6 = unpacklo16(r[6], r[7]), b7 = unpackhi16(r[6], r[7]); \
+        V c0 = unpacklo32(b0, b2), c1 = unpackhi32(b0, b2); \
+        V c2 = unpacklo32(b1, b3), c3 = unpackhi32(b1, b3); \
+        V c4 = unpacklo32(b4, b6), c5 = unpackhi32(b4, b6); \
+        V c6 = unpacklo32(b5, b7), c7 = unpackhi32(b5, b7); \
+        r[0] = unpacklo64(c0, c4); r[1] = unpackhi64(c0, c4); \
+        r[2] = unpacklo64(c1, c5); r[3] = unpackhi64(c1, c5); \
+        r[4] = unpacklo64(c2, c6); r[5] = unpackhi64(c2, c6); \
+        r[6] = unpacklo64(c3, c7); r[7] = unpackhi64(c3, c7); \
+    } while (0)
+
+/** Transpose one 8x8 block of pixels, see transpose_pixels() */
+GXJ_TARGET_SSE2
+static void sse2_transpose_tile(gxj_pixel_type *dst, int dstStride,
+                                const gxj_pixel_type *src, int srcStride) {
+    __m128i r[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        r[i] = _mm_loadu_si128((const __m128i *)(src + i * srcStride));
+    }
+    TRANSPOSE_8X8_EPI16(__m128i, _mm_unpacklo_epi16, _mm_unpackhi_epi16,
+                        _mm_unpacklo_epi32, _mm_unpackhi_epi32,
+                        _mm_unpacklo_epi64, _mm_unpackhi_epi64, r);
+    for (i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i *)(dst + i * dstStride), r[i]);
+    }
+}
+
+/** Transpose one 8x8 block of alpha values */
+GXJ_TARGET_SSE2
+static void sse2_transpose_alpha_tile(gxj_alpha_type *dst, int dstStride,
+                                      const gxj_alpha_type *src,
+                                      int srcStride) {
+    __m128i r[8];
+    __m128i b0, b1, b2, b3, c0, c1, c2, c3, d[4];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        r[i] = _mm_loadl_epi64((const __m128i *)(src + i * srcStride));
+    }
+    b0 = _mm_unpacklo_epi8(r[0], r[1]);
+    b1 = _mm_unpacklo_epi8(r[2], r[3]);
+    b2 = _mm_unpacklo_epi8(r[4], r[5]);
+    b3 = _mm_unpacklo_epi8(r[6], r[7]);
+    c0 = _mm_unpacklo_epi16(b0, b1);
+    c1 = _mm_unpackhi_epi16(b0, b1);
+    c2 = _mm_unpacklo_epi16(b2, b3);
+    c3 = _mm_unpackhi_epi16(b2, b3);
+    /* each vector now holds two columns of eight values */
+    d[0] = _mm_unpacklo_epi32(c0, c2);
+    d[1] = _mm_unpackhi_epi32(c0, c2);
+    d[2] = _mm_unpacklo_epi32(c1, c3);
+    d[3] = _mm_unpackhi_epi32(c1, c3);
+    for (i = 0; i < 4; i++) {
+        _mm_storel_epi64((__m128i *)(dst + (2 * i) * dstStride), d[i]);
+        _mm_storel_epi64((__m128i *)(dst + (2 * i + 1) * dstStride),
+                         _mm_unpackhi_epi64(d[i], d[i]));
+    }
+}
+
+GXJ_TARGET_SSE2
+static void draw_rgb_row_sse2(gxj_pixel_type *pdst, const jint *psrc,
+                              int width) {
+    for (; width >= 8; width -= 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)psrc);
+        __m128i s1 = _mm_loadu_si128((const __m128i *)(psrc + 4));
+        _mm_storeu_si128((__m128i *)pdst,
+                         _mm_packs_epi32(sse2_argb_to_565(s0),
+                                         sse2_argb_to_565(s1)));
+        psrc += 8;
+        pdst += 8;
+    }
+
+    draw_rgb_row_c(pdst, psrc, width);
+}
+
+GXJ_TARGET_SSE2
+static void draw_rgb_row_alpha_sse2(gxj_pixel_type *pdst, const jint *psrc,
+                                    int width) {
+    for (; width >= 8; width -= 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)psrc);
+        __m128i s1 = _mm_loadu_si128((const __m128i *)(psrc + 4));
+        __m128i a = _mm_or_si128(_mm_srli_epi32(s0, 24),
+                                 _mm_srli_epi32(s1, 24));
+        /* fully transparent runs leave the destination untouched */
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, _mm_setzero_si128()))
+                != 0xFFFF) {
+            __m128i d = _mm_loadu_si128((const __m128i *)pdst);
+            _mm_storeu_si128((__m128i *)pdst, sse2_blend_565(s0, s1, d));
+        }
+        psrc += 8;
+        pdst += 8;
+    }
+
+    draw_rgb_row_alpha_c(pdst, psrc, width);
+}
+
+GXJ_TARGET_SSE2
+static void pixel_set_sse2(gxj_pixel_type *pBuf, gxj_pixel_type pixel,
+                           int count) {
+    __m128i v = _mm_set1_epi16((short)pixel);
+
+    /* align to 16 bytes, then store eight pixels at a time */
+    for (; count > 0 && ((unsigned long)pBuf & 15) != 0; count--) {
+        *pBuf++ = pixel;
+    }
+    for (; count >= 16; count -= 16) {
+        _mm_store_si128((__m128i *)pBuf, v);
+        _mm_store_si128((__m128i *)(pBuf + 8), v);
+        pBuf += 16;
+    }
+    for (; count >= 8; count -= 8) {
+        _mm_store_si128((__m128i *)pBuf, v);
+        pBuf += 8;
+    }
+
+    pixel_set_c(pBuf, pixel, count);
+}
+
+GXJ_TARGET_SSE2
+static void reverse_pixels_sse2(gxj_pixel_type *dst,
+                                const gxj_pixel_type *src, int count) {
+    const gxj_pixel_type *p = src + count;
+
+    for (; p - src >= 8; dst += 8) {
+        p -= 8;
+        _mm_storeu_si128((__m128i *)dst, sse2_reverse_epi16(
+            _mm_loadu_si128((const __m128i *)p)));
+    }
+
+    reverse_pixels_c(dst, src, p - src);
+}
+
+GXJ_TARGET_SSE2
+static void reverse_alpha_sse2(gxj_alpha_type *dst,
+                               const gxj_alpha_type *src, int count) {
+    const gxj_alpha_type *p = src + count;
+
+    for (; p - src >= 16; dst += 16) {
+        __m128i v;
+        p -= 16;
+        v = _mm_loadu_si128((const __m128i *)p);
+        /* swap the bytes of each 16-bit lane, then reverse the lanes */
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)dst, sse2_reverse_epi16(v));
+    }
+
+    reverse_alpha_c(dst, src, p - src);
+}
+
+GXJ_TARGET_SSE2
+static void transpose_pixels_sse2(gxj_pixel_type *dst, int dstStride,
+                                  const gxj_pixel_type *src, int srcStride,
+                                  int width, int height) {
+    int x, y;
+
+    for (y = 0; y + 8 <= height; y += 8) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            sse2_transpose_tile(dst + x * dstStride + y, dstStride,
+                                src + y * srcStride + x, srcStride);
+        }
+        transpose_pixels_c(dst + x * dstStride + y, dstStride,
+                           src + y * srcStride + x, srcStride,
+                           width - x, 8);
+    }
+
+    transpose_pixels_c(dst + y, dstStride, src + y * srcStride, srcStride,
+                       width, height - y);
+}
+
+GXJ_TARGET_SSE2
+static void transpose_alpha_sse2(gxj_alpha_type *dst, int dstStride,
+                                 const gxj_alpha_type *src, int srcStride,
+                                 int width, int height) {
+    int x, y;
+
+    for (y = 0; y + 8 <= height; y += 8) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            sse2_transpose_alpha_tile(dst + x * dstStride + y, dstStride,
+                                      src + y * srcStride + x, srcStride);
+        }
+        transpose_alpha_c(dst + x * dstStride + y, dstStride,
+                          src + y * srcStride + x, srcStride,
+                          width - x, 8);
+    }
+
+    transpose_alpha_c(dst + y, dstStride, src + y * srcStride, srcStride,
+                      width, height - y);
+}
+
+static const gxj_pixel_kernels kernels_sse2 = {
+    "SSE2",
+    draw_rgb_row_sse2,
+    draw_rgb_row_alpha_sse2,
+    pixel_set_sse2,
+    reverse_pixels_sse2,
+    reverse_alpha_sse2,
+    transpose_pixels_sse2,
+    transpose_alpha_sse2
+};
+
+/*
+ * AVX2 kernels, sixteen 565 pixels per 32-byte vector. The 256-bit
+ * pack and unpack instructions work within each 128-bit half, so
+ * sources are regrouped with permutes to keep the pixels in order.
+ */
+
+GXJ_TARGET_AVX2
+static __m256i avx2_argb_to_565(__m256i s) {
+    __m256i r = _mm256_srli_epi32(
+        _mm256_and_si256(s, _mm256_set1_epi32(0x00F80000)), 8);
+    __m256i g = _mm256_srli_epi32(
+        _mm256_and_si256(s, _mm256_set1_epi32(0x0000FC00)), 5);
+    __m256i b = _mm256_srli_epi32(
+        _mm256_and_si256(s, _mm256_set1_epi32(0x000000F8)), 3);
+    __m256i v = _mm256_or_si256(r, _mm256_or_si256(g, b));
+
+    return _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+}
+
+GXJ_TARGET_AVX2
+static __m256i avx2_div255(__m256i x) {
+    __m256i h = _mm256_srli_epi16(x, 8);
+    __m256i l = _mm256_and_si256(x, _mm256_set1_epi16(0xFF));
+    return _mm256_add_epi16(h, _mm256_srli_epi16(
+        _mm256_add_epi16(_mm256_add_epi16(h, l), _mm256_set1_epi16(1)), 8));
+}
+
+/**
+ * sse2_blend_565() for sixteen pixels. s0 holds pixels 0-3 and 8-11,
+ * s1 holds pixels 4-7 and 12-15, so the packs come out in order.
+ */
+GXJ_TARGET_AVX2
+static __m256i avx2_blend_565(__m256i s0, __m256i s1, __m256i d) {
+    const __m256i ff = _mm256_set1_epi32(0xFF);
+    __m256i As = _mm256_packs_epi32(_mm256_srli_epi32(s0, 24),
+                                    _mm256_srli_epi32(s1, 24));
+    __m256i Ad = _mm256_sub_epi16(_mm256_set1_epi16(0xFF), As);
+    __m256i Rs = _mm256_packs_epi32(
+        _mm256_and_si256(_mm256_srli_epi32(s0, 16), ff),
+        _mm256_and_si256(_mm256_srli_epi32(s1, 16), ff));
+    __m256i Gs = _mm256_packs_epi32(
+        _mm256_and_si256(_mm256_srli_epi32(s0, 8), ff),
+        _mm256_and_si256(_mm256_srli_epi32(s1, 8), ff));
+    __m256i Bs = _mm256_packs_epi32(_mm256_and_si256(s0, ff),
+                                    _mm256_and_si256(s1, ff));
+    __m256i Rd = _mm256_or_si256(
+        _mm256_srli_epi16(
+            _mm256_and_si256(d, _mm256_set1_epi16((short)0xF800)), 8),
+        _mm256_srli_epi16(d, 13));
+    __m256i Gd = _mm256_or_si256(
+        _mm256_srli_epi16(_mm256_and_si256(d, _mm256_set1_epi16(0x07E0)), 3),
+        _mm256_srli_epi16(_mm256_and_si256(d, _mm256_set1_epi16(0x0600)), 9));
+    __m256i Bd = _mm256_or_si256(
+        _mm256_slli_epi16(_mm256_and_si256(d, _mm256_set1_epi16(0x001F)), 3),
+        _mm256_srli_epi16(_mm256_and_si256(d, _mm256_set1_epi16(0x001C)), 2));
+    __m256i Rr = avx2_div255(_mm256_add_epi16(_mm256_mullo_epi16(Rs, As),
+                                              _mm256_mullo_epi16(Rd, Ad)));
+    __m256i Gr = avx2_div255(_mm256_add_epi16(_mm256_mullo_epi16(Gs, As),
+                                              _mm256_mullo_epi16(Gd, Ad)));
+    __m256i Br = avx2_div255(_mm256_add_epi16(_mm256_mullo_epi16(Bs, As),
+                                              _mm256_mullo_epi16(Bd, Ad)));
+
+    return _mm256_or_si256(
+        _mm256_slli_epi16(_mm256_and_si256(Rr, _mm256_set1_epi16(0xF8)), 8),
+        _mm256_or_si256(
+            _mm256_slli_epi16(_mm256_and_si256(Gr, _mm256_set1_epi16(0xFC)),
+                              3),
+            _mm256_srli_epi16(Br, 3)));
+}
+
+/** Reverse the order of sixteen 16-bit lanes */
+GXJ_TARGET_AVX2
+static __m256i avx2_reverse_epi16(__m256i v) {
+    const __m256i m = _mm256_setr_epi8(
+        14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+        14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, m),
+                                    _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/** Reverse the order of thirty-two bytes */
+GXJ_TARGET_AVX2
+static __m256i avx2_reverse_epi8(__m256i v) {
+    const __m256i m = _mm256_setr_epi8(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, m),
+                                    _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/**
+ * Transpose an 8 row by 16 column block of pixels: the low halves
+ * hold the left 8x8 block and the high halves the right one.
+ */
+GXJ_TARGET_AVX2
+static void avx2_transpose_tile(gxj_pixel_type *dst, int dstStride,
+                                const gxj_pixel_type *src, int srcStride) {
+    __m256i r[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        r[i] = _mm256_loadu_si256((const __m256i *)(src + i * srcStride));
+    }
+    TRANSPOSE_8X8_EPI16(__m256i, _mm256_unpacklo_epi16,
+                        _mm256_unpackhi_epi16, _mm256_unpacklo_epi32,
+                        _mm256_unpackhi_epi32, _mm256_unpacklo_epi64,
+                        _mm256_unpackhi_epi64, r);
+    for (i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i *)(dst + i * dstStride),
+                         _mm256_castsi256_si128(r[i]));
+        _mm_storeu_si128((__m128i *)(dst + (i + 8) * dstStride),
+                         _mm256_extracti128_si256(r[i], 1));
+    }
+}
+
+GXJ_TARGET_AVX2
+static void draw_rgb_row_avx2(gxj_pixel_type *pdst, const jint *psrc,
+                              int width) {
+    for (; width >= 16; width -= 16) {
+        __m256i p0 = _mm256_loadu_si256((const __m256i *)psrc);
+        __m256i p1 = _mm256_loadu_si256((const __m256i *)(psrc + 8));
+        __m256i s0 = _mm256_permute2x128_si256(p0, p1, 0x20);
+        __m256i s1 = _mm256_permute2x128_si256(p0, p1, 0x31);
+        _mm256_storeu_si256((__m256i *)pdst,
+                            _mm256_packs_epi32(avx2_argb_to_565(s0),
+                                               avx2_argb_to_565(s1)));
+        psrc += 16;
+        pdst += 16;
+    }
+
+    draw_rgb_row_sse2(pdst, psrc, width);
+}
+
+GXJ_TARGET_AVX2
+static void draw_rgb_row_alpha_avx2(gxj_pixel_type *pdst, const jint *psrc,
+                                    int width) {
+    for (; width >= 16; width -= 16) {
+        __m256i p0 = _mm256_loadu_si256((const __m256i *)psrc);
+        __m256i p1 = _mm256_loadu_si256((const __m256i *)(psrc + 8));
+        __m256i a = _mm256_or_si256(_mm256_srli_epi32(p0, 24),
+                                    _mm256_srli_epi32(p1, 24));
+        /* fully transparent runs leave the destination untouched */
+        if (!_mm256_testz_si256(a, a)) {
+            __m256i s0 = _mm256_permute2x128_si256(p0, p1, 0x20);
+            __m256i s1 = _mm256_permute2x128_si256(p0, p1, 0x31);
+            __m256i d = _mm256_loadu_si256((const __m256i *)pdst);
+            _mm256_storeu_si256((__m256i *)pdst, avx2_blend_565(s0, s1, d));
+        }
+        psrc += 16;
+        pdst += 16;
+    }
+
+    draw_rgb_row_alpha_sse2(pdst, psrc, width);
+}
+
+GXJ_TARGET_AVX2
+static void pixel_set_avx2(gxj_pixel_type *pBuf, gxj_pixel_type pixel,
+                           int count) {
+    __m256i v = _mm256_set1_epi16((short)pixel);
+
+    /* align to 32 bytes, then store sixteen pixels at a time */
+    for (; count > 0 && ((unsigned long)pBuf & 31) != 0; count--) {
+        *pBuf++ = pixel;
+    }
+    for (; count >= 32; count -= 32) {
+        _mm256_store_si256((__m256i *)pBuf, v);
+        _mm256_store_si256((__m256i *)(pBuf + 16), v);
+        pBuf += 32;
+    }
+    for (; count >= 16; count -= 16) {
+        _mm256_store_si256((__m256i *)pBuf, v);
+        pBuf += 16;
+    }
+
+    pixel_set_c(pBuf, pixel, count);
+}
+
+GXJ_TARGET_AVX2
+static void reverse_pixels_avx2(gxj_pixel_type *dst,
+                                const gxj_pixel_type *src, int count) {
+    const gxj_pixel_type *p = src + count;
+
+    for (; p - src >= 16; dst += 16) {
+        p -= 16;
+        _mm256_storeu_si256((__m256i *)dst, avx2_reverse_epi16(
+            _mm256_loadu_si256((const __m256i *)p)));
+    }
+
+    reverse_pixels_sse2(dst, src, p - src);
+}
+
+GXJ_TARGET_AVX2
+static void reverse_alpha_avx2(gxj_alpha_type *dst,
+                               const gxj_alpha_type *src, int count) {
+    const gxj_alpha_type *p = src + count;
+
+    for (; p - src >= 32; dst += 32) {
+        p -= 32;
+        _mm256_storeu_si256((__m256i *)dst, avx2_reverse_epi8(
+            _mm256_loadu_si256((const __m256i *)p)));
+    }
+
+    reverse_alpha_sse2(dst, src, p - src);
+}
+
+GXJ_TARGET_AVX2
+static void transpose_pixels_avx2(gxj_pixel_type *dst, int dstStride,
+                                  const gxj_pixel_type *src, int srcStride,
+                                  int width, int height) {
+    int x, y;
+
+    for (y = 0; y + 8 <= height; y += 8) {
+        for (x = 0; x + 16 <= width; x += 16) {
+            avx2_transpose_tile(dst + x * dstStride + y, dstStride,
+                                src + y * srcStride + x, srcStride);
+        }
+        transpose_pixels_sse2(dst + x * dstStride + y, dstStride,
+                              src + y * srcStride + x, srcStride,
+                              width - x, 8);
+    }
+
+    transpose_pixels_c(dst + y, dstStride, src + y * srcStride, srcStride,
+                       width, height - y);
+}
+
+/* alpha planes are half the size of the pixels, 8x8 tiles do */
+static const gxj_pixel_kernels kernels_avx2 = {
+    "AVX2",
+    draw_rgb_row_avx2,
+    draw_rgb_row_alpha_avx2,
+    pixel_set_avx2,
+    reverse_pixels_avx2,
+    reverse_alpha_avx2,
+    transpose_pixels_avx2,
+    transpose_alpha_sse2
+};
+
+/** Value of the XCR0 register, which tells what state the OS saves */
+static unsigned int read_xcr0(void) {
+    unsigned int eax, edx;
+
+    /* xgetbv, spelled out for assemblers that do not know it */
+    __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"
+                         : "=a" (eax), "=d" (edx) : "c" (0));
+    (void)edx;
+    return eax;
+}
+
+/**
+ * Finds the best instruction set of this CPU through CPUID.
+ *
+ * @return GXJ_KERNELS_AVX2, GXJ_KERNELS_SSE2 or GXJ_KERNELS_SCALAR
+ */
+static int cpu_kernels(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & bit_SSE2)) {
+        return GXJ_KERNELS_SCALAR;
+    }
+
+    /* AVX2 also needs the OS to save the upper halves of YMM */
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX) &&
+            (read_xcr0() & 6) == 6 && __get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ebx & bit_AVX2) {
+            return GXJ_KERNELS_AVX2;
+        }
+    }
+
+    return GXJ_KERNELS_SSE2;
+}
+
+#endif /* GXJ_SIMD_X86 */
+
+#if GXJ_SIMD_NEON
+
+/*
+ * NEON kernels, eight 565 pixels per 16-byte vector. The image
+ * transforms use the scalar kernels.
+ */
+
+/** Pack separate 8-bit R, G and B channels into eight 565 pixels */
+static uint16x8_t neon_rgb_to_565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t r16 = vshll_n_u8(vand_u8(r, vdup_n_u8(0xF8)), 8);
+    uint16x8_t g16 = vshll_n_u8(vand_u8(g, vdup_n_u8(0xFC)), 3);
+    uint16x8_t b16 = vmovl_u8(vshr_n_u8(b, 3));
+    return vorrq_u16(r16, vorrq_u16(g16, b16));
+}
+
+/** Per 16-bit lane version of div() above, narrowed to 8 bits */
+static uint8x8_t neon_div255(uint16x8_t x) {
+    uint16x8_t h = vshrq_n_u16(x, 8);
+    uint16x8_t l = vandq_u16(x, vdupq_n_u16(0xFF));
+    return vmovn_u16(vaddq_u16(h, vshrq_n_u16(
+        vaddq_u16(vaddq_u16(h, l), vdupq_n_u16(1)), 8)));
+}
+
+/** gxj_alpha_composition() for eight pixels */
+static uint16x8_t neon_blend_565(uint8x8x4_t s, uint16x8_t d) {
+    uint8x8_t As = s.val[3];
+    uint8x8_t Ad = vsub_u8(vdup_n_u8(0xFF), As);
+    uint8x8_t Rd = vmovn_u16(vorrq_u16(
+        vshrq_n_u16(vandq_u16(d, vdupq_n_u16(0xF800)), 8),
+        vshrq_n_u16(d, 13)));
+    uint8x8_t Gd = vmovn_u16(vorrq_u16(
+        vshrq_n_u16(vandq_u16(d, vdupq_n_u16(0x07E0)), 3),
+        vshrq_n_u16(vandq_u16(d, vdupq_n_u16(0x0600)), 9)));
+    uint8x8_t Bd = vmovn_u16(vorrq_u16(
+        vshlq_n_u16(vandq_u16(d, vdupq_n_u16(0x001F)), 3),
+        vshrq_n_u16(vandq_u16(d, vdupq_n_u16(0x001C)), 2)));
+    uint8x8_t Rr = neon_div255(vmlal_u8(vmull_u8(s.val[2], As), Rd, Ad));
+    uint8x8_t Gr = neon_div255(vmlal_u8(vmull_u8(s.val[1], As), Gd, Ad));
+    uint8x8_t Br = neon_div255(vmlal_u8(vmull_u8(s.val[0], As), Bd, Ad));
+
+    return neon_rgb_to_565(Rr, Gr, Br);
+}
+
+static void draw_rgb_row_neon(gxj_pixel_type *pdst, const jint *psrc,
+                              int width) {
+    for (; width >= 8; width -= 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)psrc);
+        vst1q_u16(pdst, neon_rgb_to_565(s.val[2], s.val[1], s.val[0]));
+        psrc += 8;
+        pdst += 8;
+    }
+
+    draw_rgb_row_c(pdst, psrc, width);
+}
+
+static void draw_rgb_row_alpha_neon(gxj_pixel_type *pdst, const jint *psrc,
+                                    int width) {
+    for (; width >= 8; width -= 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)psrc);
+        uint64_t a = vget_lane_u64(vreinterpret_u64_u8(s.val[3]), 0);
+        /* fully transparent runs leave the destination untouched */
+        if (a != 0) {
+            vst1q_u16(pdst, neon_blend_565(s, vld1q_u16(pdst)));
+        }
+        psrc += 8;
+        pdst += 8;
+    }
+
+    draw_rgb_row_alpha_c(pdst, psrc, width);
+}
+
+static void pixel_set_neon(gxj_pixel_type *pBuf, gxj_pixel_type pixel,
+                           int count) {
+    uint16x8_t v = vdupq_n_u16(pixel);
+
+    /* align to 16 bytes, then store eight pixels at a time */
+    for (; count > 0 && ((unsigned long)pBuf & 15) != 0; count--) {
+        *pBuf++ = pixel;
+    }
+    for (; count >= 8; count -= 8) {
+        vst1q_u16(pBuf, v);
+        pBuf += 8;
+    }
+
+    pixel_set_c(pBuf, pixel, count);
+}
+
+static const gxj_pixel_kernels kernels_neon = {
+    "NEON",
+    draw_rgb_row_neon,
+    draw_rgb_row_alpha_neon,
+    pixel_set_neon,
+    reverse_pixels_c,
+    reverse_alpha_c,
+    transpose_pixels_c,
+    transpose_alpha_c
+};
+
+#endif /* GXJ_SIMD_NEON */
+
+const gxj_pixel_kernels *gxj_kernels = NULL;
+
+const gxj_pixel_kernels *gxj_get_pixel_kernels(int isa) {
+    switch (isa) {
+    case GXJ_KERNELS_SCALAR:
+        return &kernels_c;
+#if GXJ_SIMD_X86
+    case GXJ_KERNELS_SSE2:
+        return cpu_kernels() >= GXJ_KERNELS_SSE2 ? &kernels_sse2 : NULL;
+    case GXJ_KERNELS_AVX2:
+        return cpu_kernels() >= GXJ_KERNELS_AVX2 ? &kernels_avx2 : NULL;
+#endif
+#if GXJ_SIMD_NEON
+    case GXJ_KERNELS_NEON:
+        return &kernels_neon;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+const gxj_pixel_kernels *gxj_select_pixel_kernels(void) {
+    const gxj_pixel_kernels *kernels = &kernels_c;
+
+#if GXJ_SIMD_X86
+    kernels = gxj_get_pixel_kernels(cpu_kernels());
+#elif GXJ_SIMD_NEON
+    kernels = &kernels_neon;
+#endif
+
+    REPORT_INFO1(LC_LOWUI, "Using %s pixel kernels\n", kernels->name);
+
+    /* every caller picks the same set, so a race here is harmless */
+    gxj_kernels = kernels;
+    return kernels;
+}
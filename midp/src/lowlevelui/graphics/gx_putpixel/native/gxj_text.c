@@ -40,6 +40,38 @@
 #define LEFT_TO_RIGHT    1
 #define RIGHT_TO_LEFT   -1
 
+/** Number of glyphs kept expanded, must be a power of two */
+#define GLYPH_CACHE_SIZE   128
+/** Largest font cell the glyph cache handles */
+#define GLYPH_MAX_WIDTH    32
+#define GLYPH_MAX_HEIGHT   32
+/** Largest number of foreground spans in a cached glyph */
+#define GLYPH_MAX_SPANS    48
+
+/** Glyph cache entry states */
+#define GLYPH_EMPTY        0
+#define GLYPH_CACHED       1
+#define GLYPH_UNCACHEABLE  2
+
+/**
+ * A glyph expanded into horizontal runs of foreground pixels. Row r of
+ * the glyph is made of spans rowFirst[r] .. rowFirst[r+1]-1, each one
+ * covering columns [spans[i][0], spans[i][1]). Rows outside
+ * [top, bottom) have no foreground pixels at all.
+ */
+typedef struct {
+    pfontbitmap* pfonts;
+    jchar code;
+    unsigned char state;
+    unsigned char top;
+    unsigned char bottom;
+    unsigned char rowFirst[GLYPH_MAX_HEIGHT + 1];
+    unsigned char spans[GLYPH_MAX_SPANS][2];
+} GlyphCacheEntry;
+
+/** Direct-mapped cache of expanded glyphs, indexed by character code */
+static GlyphCacheEntry glyphCache[GLYPH_CACHE_SIZE];
+
 
 /**
  * @file
@@ -70,7 +102,7 @@ static pfontbitmap selectFontBitmap(jchar c, pfontbitmap* pfonts) {
  * putpixel primitive character drawing.
  */
 const unsigned char BitMask[8] = {0x80,0x40,0x20,0x10,0x8,0x4,0x2,0x1};
-static void drawChar(gxj_screen_buffer *sbuf, jchar c0,
+static void drawCharBits(gxj_screen_buffer *sbuf, jchar c0,
 		     gxj_pixel_type pixelColor, int x, int y,
 		     int xSource, int ySource, int xLimit, int yLimit,
 		     pfontbitmap* pfonts,
@@ -212,6 +244,148 @@ static void drawChar(gxj_screen_buffer *sbuf, jchar c0,
 #endif
 }
 
+/**
+ * Expand the bitmap of a character into foreground spans. The entry
+ * is marked uncacheable if the font cell or the number of spans does
+ * not fit, in which case the character is drawn from the bitmap.
+ */
+static void expandGlyph(GlyphCacheEntry* e, jchar c0, pfontbitmap* pfonts,
+                        int fontWidth, int fontHeight) {
+    unsigned char const * fontbitmap =
+        selectFontBitmap(c0,pfonts) + FONT_DATA;
+    jchar const c = (c0 & 0xff) -
+        fontbitmap[FONT_CODE_FIRST_LOW-FONT_DATA];
+    unsigned long mapLen =
+        ((fontbitmap[FONT_CODE_LAST_LOW-FONT_DATA]
+        - fontbitmap[FONT_CODE_FIRST_LOW-FONT_DATA]
+        + 1) * fontWidth * fontHeight + 7) >> 3;
+    unsigned long const firstPixelIndex =
+        (unsigned long)c * fontHeight * fontWidth;
+    unsigned char const * const mapend = fontbitmap + mapLen;
+    int nSpans = 0;
+    int row;
+    int col;
+
+    e->pfonts = pfonts;
+    e->code = c0;
+    e->state = GLYPH_UNCACHEABLE;
+    e->top = (unsigned char)fontHeight;
+    e->bottom = 0;
+
+    if (fontWidth > GLYPH_MAX_WIDTH || fontHeight > GLYPH_MAX_HEIGHT) {
+        return;
+    }
+
+    for (row = 0; row < fontHeight; row++) {
+        int spanStart = -1;
+
+        e->rowFirst[row] = (unsigned char)nSpans;
+        /* the extra column closes a span running to the cell edge */
+        for (col = 0; col <= fontWidth; col++) {
+            int isSet = 0;
+            if (col < fontWidth) {
+                unsigned long pixelIndex =
+                    firstPixelIndex + row * fontWidth + col;
+                unsigned char const * p = fontbitmap + (pixelIndex >> 3);
+                isSet = p < mapend && (*p & BitMask[pixelIndex & 7]) != 0;
+            }
+
+            if (isSet && spanStart < 0) {
+                spanStart = col;
+            } else if (!isSet && spanStart >= 0) {
+                if (nSpans == GLYPH_MAX_SPANS) {
+                    return;
+                }
+                e->spans[nSpans][0] = (unsigned char)spanStart;
+                e->spans[nSpans][1] = (unsigned char)col;
+                nSpans++;
+                spanStart = -1;
+            }
+        }
+
+        if (e->rowFirst[row] != nSpans) {
+            if (row < e->top) {
+                e->top = (unsigned char)row;
+            }
+            e->bottom = (unsigned char)(row + 1);
+        }
+    }
+    e->rowFirst[fontHeight] = (unsigned char)nSpans;
+    e->state = GLYPH_CACHED;
+}
+
+/** Fill a horizontal run of pixels using word stores where possible */
+static void drawSpan(gxj_pixel_type *dest, int len,
+                     gxj_pixel_type pixelColor) {
+    if (len >= 3) {
+        unsigned int pair = ((unsigned int)pixelColor << 16) | pixelColor;
+        unsigned int *destWord;
+
+        if (((unsigned long)dest & 2) != 0) {
+            *dest++ = pixelColor;
+            len--;
+        }
+        for (destWord = (unsigned int *)dest; len >= 2; len -= 2) {
+            *destWord++ = pair;
+        }
+        dest = (gxj_pixel_type *)destWord;
+    }
+    for (; len > 0; len--) {
+        *dest++ = pixelColor;
+    }
+}
+
+/**
+ * Draw the character in the clipped part [xSource, xLimit) x
+ * [ySource, yLimit) of its cell, which lands at (x, y) in the buffer.
+ * Uses the glyph cache, falling back to drawCharBits() for glyphs the
+ * cache can not hold.
+ */
+static void drawChar(gxj_screen_buffer *sbuf, jchar c0,
+		     gxj_pixel_type pixelColor, int x, int y,
+		     int xSource, int ySource, int xLimit, int yLimit,
+		     pfontbitmap* pfonts,
+		     int fontWidth, int fontHeight) {
+    GlyphCacheEntry* e = &glyphCache[c0 & (GLYPH_CACHE_SIZE - 1)];
+    int destWidth = sbuf->width;
+    gxj_pixel_type *rowDest;
+    int row;
+    int rowLimit;
+
+    if (e->state == GLYPH_EMPTY || e->code != c0 || e->pfonts != pfonts) {
+        expandGlyph(e, c0, pfonts, fontWidth, fontHeight);
+    }
+    if (e->state != GLYPH_CACHED) {
+        drawCharBits(sbuf, c0, pixelColor, x, y, xSource, ySource,
+                     xLimit, yLimit, pfonts, fontWidth, fontHeight);
+        return;
+    }
+
+    row = (ySource > e->top) ? ySource : e->top;
+    rowLimit = (yLimit < e->bottom) ? yLimit : e->bottom;
+
+    /* rowDest points to column 0 of the glyph cell, which may be
+       left of the clip when xSource > 0 */
+    rowDest = sbuf->pixelData + (y + row - ySource) * destWidth + x - xSource;
+
+    for (; row < rowLimit; row++, rowDest += destWidth) {
+        int i;
+        for (i = e->rowFirst[row]; i < e->rowFirst[row + 1]; i++) {
+            int from = e->spans[i][0];
+            int to = e->spans[i][1];
+            if (from < xSource) {
+                from = xSource;
+            }
+            if (to > xLimit) {
+                to = xLimit;
+            }
+            if (from < to) {
+                drawSpan(rowDest + from, to - from, pixelColor);
+            }
+        }
+    }
+}
+
 /*
  * @file
  *
@@ -161,6 +161,25 @@ int img_load_imagedata_from_raw_buffer(KNIDECLARGS jobject imageData,
     return status;
 }
 
+/**
+ * Load Java ImageData instance with image data in RAW format.
+ * Image data is provided in a read-only native buffer that stays
+ * valid for the life of the process. Platform images always own
+ * their pixels, so this is the same as loading from a raw buffer.
+ *
+ * @param imageData Java ImageData object to be loaded with image data
+ * @param buffer pointer to native buffer with raw image data
+ * @param length length of the raw image data in the buffer
+ *
+ * @return KNI_TRUE in the case ImageData is successfully loaded with
+ *    raw image data, otherwise KNI_FALSE.
+ */
+int img_load_imagedata_from_mapped_buffer(KNIDECLARGS jobject imageData,
+    unsigned char *buffer, int length) {
+    return img_load_imagedata_from_raw_buffer(KNIPASSARGS
+        imageData, buffer, length);
+}
+
 /**
  * Creates a copy of the specified <tt>ImageData</tt> and stores the
  * copied image in this object.
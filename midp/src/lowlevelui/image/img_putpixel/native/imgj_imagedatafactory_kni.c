@@ -447,6 +447,65 @@ int img_load_imagedata_from_raw_buffer(KNIDECLARGS jobject imageData,
     return status;
 }
 
+/**
+ * Load Java ImageData instance with image data in RAW format.
+ * Image data is provided in a read-only native buffer that stays
+ * valid for the life of the process. The ImageData refers to the
+ * pixels in place, the same way as romized images do.
+ *
+ * @param imageData Java ImageData object to be loaded with image data
+ * @param buffer pointer to native buffer with raw image data
+ * @param length length of the raw image data in the buffer
+ *
+ * @return KNI_TRUE in the case ImageData is successfully loaded with
+ *    raw image data, otherwise KNI_FALSE.
+ */
+int img_load_imagedata_from_mapped_buffer(KNIDECLARGS jobject imageData,
+    unsigned char *buffer, int length) {
+
+    int imageSize;
+    int pixelSize, alphaSize;
+    imgdcd_image_buffer_raw *rawBuffer = (imgdcd_image_buffer_raw *)buffer;
+    java_imagedata *midpImageData;
+
+    if (rawBuffer == NULL) {
+        REPORT_ERROR(LC_LOWUI, "Null raw image buffer is provided");
+        return KNI_FALSE;
+    }
+
+    /** Check header */
+    if (memcmp(rawBuffer->header, imgdcd_raw_header, 4) != 0) {
+        REPORT_ERROR(LC_LOWUI, "Unexpected raw image type");
+        return KNI_FALSE;
+    }
+
+    imageSize = rawBuffer->width * rawBuffer->height;
+    pixelSize = sizeof(PIXEL) * imageSize;
+    alphaSize = 0;
+    if (rawBuffer->hasAlpha) {
+        alphaSize = sizeof(ALPHA) * imageSize;
+    }
+
+    /** Check data array length */
+    if ((unsigned int)length !=
+        (offsetof(imgdcd_image_buffer_raw, data)
+            + pixelSize + alphaSize)) {
+        REPORT_ERROR(LC_LOWUI, "Raw image is corrupted");
+        return KNI_FALSE;
+    }
+
+    midpImageData = IMGAPI_GET_IMAGEDATA_PTR(imageData);
+
+    midpImageData->width = (jint)rawBuffer->width;
+    midpImageData->height = (jint)rawBuffer->height;
+
+    midpImageData->nativePixelData = (jint)rawBuffer->data;
+    midpImageData->nativeAlphaData = rawBuffer->hasAlpha ?
+        (jint)(rawBuffer->data + pixelSize) : 0;
+
+    return KNI_TRUE;
+}
+
 /**
  * Loads the <tt>ImageData</tt> with the given raw data array.
  * The array consists of raw image data including header info.
@@ -57,6 +57,22 @@ extern "C" {
 int img_load_imagedata_from_raw_buffer(KNIDECLARGS jobject imageData,
     unsigned char *buffer, int length);
 
+/**
+ * Load Java ImageData instance with image data in RAW format.
+ * Image data is provided in a read-only native buffer that stays
+ * valid for the life of the process, so the ImageData may refer to
+ * the pixels in place instead of copying them into the Java heap.
+ *
+ * @param imageData Java ImageData object to be loaded with image data
+ * @param buffer pointer to native buffer with raw image data
+ * @param length length of the raw image data in the buffer
+ *
+ * @return KNI_TRUE in the case ImageData is successfully loaded with
+ *    raw image data, otherwise KNI_FALSE.
+ */
+int img_load_imagedata_from_mapped_buffer(KNIDECLARGS jobject imageData,
+    unsigned char *buffer, int length);
+
 #ifdef __cplusplus
 }
 #endif
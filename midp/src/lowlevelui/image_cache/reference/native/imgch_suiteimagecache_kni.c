@@ -72,15 +72,23 @@ KNIDECL(javax_microedition_lcdui_SuiteImageCacheImpl_loadAndCreateImmutableImage
 
     suiteId = KNI_GetParameterAsInt(2);
 
-    len = loadImageFromCache(suiteId, &resName, &rawBuffer);
+    len = mapImageFromCache(suiteId, &resName, &rawBuffer);
     if (len != -1 && rawBuffer != NULL) {
-        /* image is found in cache */
-        status = img_load_imagedata_from_raw_buffer(KNIPASSARGS
+        /* image is mapped for the life of the process, use it in place */
+        status = img_load_imagedata_from_mapped_buffer(KNIPASSARGS
             imageData, rawBuffer, len);
+    } else {
+        rawBuffer = NULL;
+        len = loadImageFromCache(suiteId, &resName, &rawBuffer);
+        if (len != -1 && rawBuffer != NULL) {
+            /* image is found in cache */
+            status = img_load_imagedata_from_raw_buffer(KNIPASSARGS
+                imageData, rawBuffer, len);
+        }
+
+        midpFree(rawBuffer);
     }
 
-    midpFree(rawBuffer);
-
     RELEASE_PCSL_STRING_PARAMETER
 
     KNI_EndHandles();
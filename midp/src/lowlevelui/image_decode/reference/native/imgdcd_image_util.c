@@ -341,8 +341,12 @@ static int decode_jpeg_image(char* inData, int inDataLen,
     void *info = JPEG_To_RGB_init();
     if (info) {
         int width, height;
-        if (JPEG_To_RGB_decodeHeader(info, inData, inDataLen,
-            &width, &height) != 0) {
+        /*
+         * Let the IDCT reduce an image larger than the buffer, so that
+         * a thumbnail costs a fraction of a full decode.
+         */
+        if (JPEG_To_RGB_decodeHeaderScaled(info, inData, inDataLen,
+            outDataWidth, outDataHeight, &width, &height) != 0) {
             if ((width < outDataWidth) || (height < outDataHeight)) {
                 /*
                  * TBD:
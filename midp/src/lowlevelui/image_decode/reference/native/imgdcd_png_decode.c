@@ -46,6 +46,13 @@
 
 #define freeBytes(p) pcsl_mem_free((p))
 
+/**
+ * Size of the inflate window used to decode images row by row. Images
+ * whose decompressed data is not larger than this are inflated in one
+ * go instead.
+ */
+#define PNG_STREAM_WINDOW_SIZE INFLATE_MIN_WINDOW_SIZE
+
 typedef struct _pngData {
       signed int   width;
       signed int   height;
@@ -79,6 +86,8 @@ static unsigned long readPalette(imageSrcPtr, long, pngData *,
 static unsigned long readTransPal(imageSrcPtr, long, pngData *,
                                   unsigned char *, unsigned long);
 static bool handleImageData(unsigned char *, int, imageDstPtr, pngData *);
+static bool handleImageDataStream(FileObj *, HeapManObj *, int,
+                                  imageDstPtr, pngData *);
 static unsigned long getInt(imageSrcPtr);
 static unsigned long skip(imageSrcPtr, int, unsigned long);
 static bool getChunk(imageSrcPtr, unsigned long *, long *);
@@ -407,10 +416,18 @@ PNGdecodeImage_real(imageSrcPtr src, imageDstPtr dst,
 
             src->seek(src, startPos);    /* reset to the first IDAT_CHUNK */
 
-            decompBuf = (unsigned char*)pcsl_mem_malloc(decompLen);
-            if (decompBuf == NULL) {
-                OK = FALSE;
-		goto done;
+            /*
+             * Large images are inflated, unfiltered and converted a row
+             * at a time, see handleImageDataStream.
+             */
+            if (decompLen > PNG_STREAM_WINDOW_SIZE) {
+                decompBuf = NULL;
+            } else {
+                decompBuf = (unsigned char*)pcsl_mem_malloc(decompLen);
+                if (decompBuf == NULL) {
+                    OK = FALSE;
+                    goto done;
+                }
             }
 
             /*
@@ -431,16 +448,25 @@ PNGdecodeImage_real(imageSrcPtr src, imageDstPtr dst,
             heapManObj.free = freeFunction;
             heapManObj.addrFromHandle = addrFromHandleFunction;
 
-            /* subtract 4 bytes from compLen -- it's the ZLIB trailer */
-            if (inflateData(&fileObj, &heapManObj, compLen - 4,
-                             decompBuf, decompLen, 0) != 0) {
-                freeBytes(decompBuf);
-		goto formaterror;
-	    }
+            if (decompBuf == NULL) {
+                /* subtract 4 bytes from compLen -- it's the ZLIB trailer */
+                OK = handleImageDataStream(&fileObj, &heapManObj,
+                                           compLen - 4, dst, &data);
+                if (!OK) {
+                    goto formaterror;
+                }
+            } else {
+                /* subtract 4 bytes from compLen -- it's the ZLIB trailer */
+                if (inflateData(&fileObj, &heapManObj, compLen - 4,
+                                 decompBuf, decompLen, 0) != 0) {
+                    freeBytes(decompBuf);
+                    goto formaterror;
+                }
 
-            OK = handleImageData(decompBuf, decompLen, dst, &data);
+                OK = handleImageData(decompBuf, decompLen, dst, &data);
 
-            freeBytes(decompBuf);
+                freeBytes(decompBuf);
+            }
             src->seek(src, lastGoodPos);
         } else if (chunkType == IEND_CHUNK) {
             /* shouldn't happen because getChunk checks for this! */
@@ -1485,13 +1511,75 @@ unpack4(unsigned char *dst,
 }
 
 
+/** Number of bytes per pixel of scanlines passed to sendPixels */
+static int
+getScanlinePixelSize(pngData *data)
+{
+    return ((data->colorType & (CT_PALETTE | CT_COLOR)) ? 3 : 1) +
+           (((data->colorType & CT_ALPHA) || (data->trans != NULL))
+            ? 1 : 0 );
+}
+
+/**
+ * Checks if unfiltered rows are already in the format sendPixels takes,
+ * i.e. 8 bit Palette or 8 bit RGB/gs without transparency
+ */
+static bool
+canSendRowsDirect(pngData *data)
+{
+    return (data->depth == 8) &&
+           ( (data->colorType & CT_PALETTE) || (data->trans == NULL) );
+}
+
+/**
+ * Builds the even rows of an interlaced image from the unfiltered data
+ * of passes 1 to 6 and sends them to the destination.
+ */
+static void
+sendEvenRows(imageDstPtr dst, pngData *data, unsigned char **passes,
+             unsigned char *scanline)
+{
+    int y;
+
+    for (y = 0; y < data->height; y += 2) {
+        switch (y & 6) {
+        case 2:
+        case 6:
+            unpack2(scanline, passes[4] + 1, passes[5] + 1, data);
+            passes[4] += data->lineBytes[4];
+            passes[5] += data->lineBytes[5];
+            break;
+
+        case 4:
+            unpack3(scanline,
+                    passes[2] + 1, passes[5] + 1, passes[3] + 1,
+                    data);
+            passes[2] += data->lineBytes[2];
+            passes[5] += data->lineBytes[5];
+            passes[3] += data->lineBytes[3];
+            break;
+
+        case 0:
+            unpack4(scanline,
+                    passes[0] + 1, passes[5] + 1,
+                    passes[3] + 1, passes[1] + 1,
+                    data);
+            passes[0] += data->lineBytes[0];
+            passes[5] += data->lineBytes[5];
+            passes[3] += data->lineBytes[3];
+            passes[1] += data->lineBytes[1];
+            break;
+        }
+
+        dst->sendPixels(dst, y, scanline, data->colorType);
+    }
+}
+
 static bool
 handleImageData(unsigned char *pixels, int pixelsLength,
                 imageDstPtr dst, pngData *data)
 {
-    int pixelSize = ((data->colorType & (CT_PALETTE | CT_COLOR)) ? 3 : 1) +
-                    (((data->colorType & CT_ALPHA) || (data->trans != NULL)) 
-		     ? 1 : 0 );
+    int pixelSize = getScanlinePixelSize(data);
     int rgba = data->colorType;
 
     int sendDirect = FALSE;
@@ -1518,10 +1606,7 @@ handleImageData(unsigned char *pixels, int pixelsLength,
         passes[6] = pixels;
     }
 
-    if ( (data->depth == 8) &&
-         ( (data->colorType & CT_PALETTE) || (data->trans == NULL) ) ) {
-      /* if data is in the desired format
-         i.e. 8 bit Palette or 8 bit RGB/gs without transparency*/
+    if (canSendRowsDirect(data)) {
         sendDirect = TRUE;
     } else if (scanline == NULL) {
         scanline = (unsigned char *) pcsl_mem_malloc(data->width * pixelSize);
@@ -1530,48 +1615,21 @@ handleImageData(unsigned char *pixels, int pixelsLength,
         }
     }
 
-    for (y = 0; y < data->height; ++y) {
-        if ((y & 1) || !data->interlace) {
-            if (sendDirect) {
-                dst->sendPixels(dst, y, passes[6] + 1, rgba);
-            } else {
-                unpack1(scanline, passes[6] + 1, data);
-                dst->sendPixels(dst, y, scanline, rgba);
-            }
+    if (data->interlace) {
+        sendEvenRows(dst, data, passes, scanline);
+    }
 
-            passes[6] += data->lineBytes[6];
+    /* pass 7 holds the odd rows of an interlaced image, whole rows */
+    for (y = data->interlace ? 1 : 0; y < data->height;
+         y += data->interlace ? 2 : 1) {
+        if (sendDirect) {
+            dst->sendPixels(dst, y, passes[6] + 1, rgba);
         } else {
-            switch (y & 6) {
-            case 2:
-            case 6:
-                unpack2(scanline, passes[4] + 1, passes[5] + 1, data);
-                passes[4] += data->lineBytes[4];
-                passes[5] += data->lineBytes[5];
-                break;
-
-            case 4:
-                unpack3(scanline,
-                        passes[2] + 1, passes[5] + 1, passes[3] + 1,
-                        data);
-                passes[2] += data->lineBytes[2];
-                passes[5] += data->lineBytes[5];
-                passes[3] += data->lineBytes[3];
-                break;
-
-            case 0:
-                unpack4(scanline,
-                        passes[0] + 1, passes[5] + 1,
-                        passes[3] + 1, passes[1] + 1,
-                        data);
-                passes[0] += data->lineBytes[0];
-                passes[5] += data->lineBytes[5];
-                passes[3] += data->lineBytes[3];
-                passes[1] += data->lineBytes[1];
-                break;
-            }
-
+            unpack1(scanline, passes[6] + 1, data);
             dst->sendPixels(dst, y, scanline, rgba);
         }
+
+        passes[6] += data->lineBytes[6];
     }
 
     if (scanline != NULL) {
@@ -1582,6 +1640,197 @@ handleImageData(unsigned char *pixels, int pixelsLength,
 }
 
 
+/** State of the inflate sink used by handleImageDataStream */
+typedef struct _pngRowSink {
+    pngData       *data;
+    imageDstPtr    dst;
+    unsigned char *row;       /* row being collected, filter type first */
+    unsigned char *prevRow;   /* previous unfiltered row of the pass or NULL */
+    unsigned char *spareRow;  /* buffer for the row after this one */
+    unsigned char *scanline;  /* buffer for unpacked pixels or NULL */
+    bool           direct;    /* pass 7 rows are sent without unpacking */
+    unsigned int   rowFill;   /* bytes collected into row */
+    unsigned char *passes[7]; /* passes 1 to 6 of an interlaced image */
+    unsigned char *passEnd;   /* end of the current pass 1 to 6 */
+} pngRowSink;
+
+/**
+ * Moves the sink on to the next non-empty pass of an interlaced image.
+ * Once passes 1 to 6 are complete, the even rows are sent and pass 7
+ * rows are collected in the row buffers.
+ */
+static void
+pngRowSinkNextPass(pngRowSink *sink, unsigned char *rows)
+{
+    pngData *data = sink->data;
+
+    do {
+        data->pass++;
+    } while (data->pass < 6 && data->passSize[data->pass] == 0);
+
+    sink->prevRow = NULL;
+    if (data->pass < 6) {
+        sink->passEnd = sink->row + data->passSize[data->pass];
+    } else {
+        sendEvenRows(sink->dst, data, sink->passes, sink->scanline);
+        sink->row = rows;
+        sink->spareRow = rows + data->lineBytes[6];
+    }
+}
+
+/**
+ * Inflate sink that cuts the image data into rows and unfilters every
+ * row as soon as it is complete. Rows of the last pass, which is the
+ * only pass of a non-interlaced image, are sent to the destination
+ * right away. Rows of the earlier passes of an interlaced image stay
+ * in place until all of the even rows can be built.
+ */
+static int
+pngRowSinkWrite(void *p, unsigned char *bytes, int len)
+{
+    pngRowSink *sink = (pngRowSink *)p;
+    pngData *data = sink->data;
+
+    while (len > 0) {
+        unsigned int n = data->lineBytes[data->pass];
+        unsigned int count = n - sink->rowFill;
+        unsigned char *row;
+
+        if (count > (unsigned int)len) {
+            count = len;
+        }
+        memcpy(sink->row + sink->rowFill, bytes, count);
+        sink->rowFill += count;
+        bytes += count;
+        len -= count;
+
+        if (sink->rowFill < n) {
+            break;
+        }
+
+        row = sink->row;
+        applyFilter(row[0], row + 1, n - 1,
+                    sink->prevRow, data->bytesPerPixel);
+        sink->rowFill = 0;
+
+        if (data->pass < 6) {
+            /* the row stays in the buffer of passes 1 to 6 */
+            sink->prevRow = row + 1;
+            sink->row += n;
+            if (sink->row == sink->passEnd) {
+                pngRowSinkNextPass(sink, sink->spareRow);
+            }
+            continue;
+        }
+
+        if (data->y >= data->height) {
+            return INFLATE_OUTPUT_OVERFLOW;
+        }
+
+        if (sink->direct) {
+            sink->dst->sendPixels(sink->dst, data->y, row + 1,
+                                  data->colorType);
+        } else {
+            unpack1(sink->scanline, row + 1, data);
+            sink->dst->sendPixels(sink->dst, data->y, sink->scanline,
+                                  data->colorType);
+        }
+        data->y += data->interlace ? 2 : 1;
+
+        /* this row is the reference for the next one */
+        sink->row = sink->spareRow;
+        sink->spareRow = row;
+        sink->prevRow = row + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Decodes an image without keeping all of its data in memory. The IDAT
+ * stream is inflated through a fixed size window and each row is
+ * unfiltered while it is still in the cache. Rows of a non-interlaced
+ * image and the odd rows of an interlaced one are converted and sent
+ * right away, so only passes 1 to 6, about half of the data of an
+ * interlaced image, are ever kept.
+ */
+static bool
+handleImageDataStream(FileObj *fileObj, HeapManObj *heapManObj, int compLen,
+                      imageDstPtr dst, pngData *data)
+{
+    unsigned int n = data->lineBytes[6];
+    unsigned int earlySize = 0;
+    unsigned char *window;
+    unsigned char *rows;
+    unsigned char *early = NULL;
+    pngRowSink sink;
+    bool OK = FALSE;
+    int i;
+
+    sink.direct = canSendRowsDirect(data);
+    sink.scanline = NULL;
+    if (data->interlace) {
+        for (i = 0; i < 6; ++i) {
+            earlySize += data->passSize[i];
+        }
+        early = (unsigned char *)pcsl_mem_malloc(earlySize);
+    }
+    if (!sink.direct || data->interlace) {
+        sink.scanline = (unsigned char *)pcsl_mem_malloc(
+            data->width * getScanlinePixelSize(data));
+    }
+    window = (unsigned char *)pcsl_mem_malloc(PNG_STREAM_WINDOW_SIZE);
+    rows = (unsigned char *)pcsl_mem_malloc(2 * n);
+
+    if (window != NULL && rows != NULL &&
+            (early != NULL || !data->interlace) &&
+            (sink.scanline != NULL || (sink.direct && !data->interlace))) {
+        sink.data = data;
+        sink.dst = dst;
+        sink.rowFill = 0;
+        sink.prevRow = NULL;
+
+        if (data->interlace) {
+            sink.passes[0] = early;
+            for (i = 1; i < 6; ++i) {
+                sink.passes[i] = sink.passes[i - 1] + data->passSize[i - 1];
+            }
+            /* pass 1 always holds the top left pixel */
+            data->pass = 0;
+            data->y = 1;
+            sink.row = early;
+            sink.spareRow = rows;
+            sink.passEnd = early + data->passSize[0];
+        } else {
+            data->pass = 6;
+            data->y = 0;
+            sink.row = rows;
+            sink.spareRow = rows + n;
+        }
+
+        OK = inflateDataStream(fileObj, heapManObj, compLen,
+                               window, PNG_STREAM_WINDOW_SIZE,
+                               earlySize + data->passSize[6],
+                               pngRowSinkWrite, &sink) == 0;
+    }
+
+    if (sink.scanline != NULL) {
+        freeBytes(sink.scanline);
+    }
+    if (early != NULL) {
+        freeBytes(early);
+    }
+    if (rows != NULL) {
+        freeBytes(rows);
+    }
+    if (window != NULL) {
+        freeBytes(window);
+    }
+
+    return OK;
+}
+
+
 static unsigned long
 getInt(imageSrcPtr src)
 {
@@ -92,6 +92,14 @@ extern char* getApplicationDir(char *cmd);
 
 extern int registerFileInstallerTests();
 
+#if ENABLE_FB_PORT_TESTS
+extern int registerFbPortTests();
+#endif
+
+#if ENABLE_GXJ_SIMD_TESTS
+extern int registerGxjSimdTests();
+#endif
+
 int main(int argc, char* argv[]) {
 
     int max_number_of_tests = 0;
@@ -132,10 +140,22 @@ int main(int argc, char* argv[]) {
      */
 /*************************FILE INSTALLER TESTS HERE *************************/
 /* we can put here some ifdef or if to choose which sub tests to run */    
-    if (registerFileInstallerTests() > 0) {
+    registerFileInstallerTests();
+/****************************************************************************/
+/*************************FRAME BUFFER TESTS HERE ***************************/
+#if ENABLE_FB_PORT_TESTS
+    registerFbPortTests();
+#endif
+/****************************************************************************/
+/*************************PUTPIXEL KERNEL TESTS HERE ************************/
+#if ENABLE_GXJ_SIMD_TESTS
+    registerGxjSimdTests();
+#endif
+/****************************************************************************/
+
+    if (get_num_tests() > 0) {
         run_tests();  /* run the tests */
     }
-/****************************************************************************/
     
     /* Finalize test frame work */
     finalize_nuts();
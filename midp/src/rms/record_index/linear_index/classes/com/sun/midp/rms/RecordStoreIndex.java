@@ -105,6 +105,13 @@ class RecordStoreIndex {
     /** the initial record offset cache capacity */
     private static final int INITIAL_CACHE_CAPACITY = 0x20;
 
+    /**
+     * Offset of the first block that may be free. All the blocks from
+     * DB_HEADER_SIZE up to this offset hold records, so free block
+     * searches resume here instead of scanning them again.
+     */
+    private int firstFreeOffset = AbstractRecordStoreImpl.DB_HEADER_SIZE;
+
     /**
      * Constructor for creating an index object for the given Record Store.
      *
@@ -364,8 +371,12 @@ class RecordStoreIndex {
         int targetSize = RecordStoreUtil.
             calculateBlockSize(RecordStoreUtil.getInt(header, 4));
         int currentId = 0;
-        int currentOffset = AbstractRecordStoreImpl.DB_HEADER_SIZE;
+        int currentOffset;
         int currentSize = 0;
+        boolean freeSeen = false;
+
+        ensureIndexValidity();
+        currentOffset = firstFreeOffset;
 
         if (Logging.REPORT_LEVEL <= Logging.INFORMATION) {
             Logging.report(Logging.INFORMATION, LogChannels.LC_RMS,
@@ -397,6 +408,12 @@ class RecordStoreIndex {
                                " currentSize = " + currentSize);
             }
 
+            if (currentId < 0 && !freeSeen) {
+                // the blocks skipped so far all hold records
+                firstFreeOffset = currentOffset;
+                freeSeen = true;
+            }
+
             // check for a free block big enough to hold the data
             if (currentId < 0 && currentSize >= targetSize) {
                 if (Logging.REPORT_LEVEL <= Logging.INFORMATION) {
@@ -413,9 +430,28 @@ class RecordStoreIndex {
             currentOffset += currentSize;
         }
 
+        if (!freeSeen) {
+            firstFreeOffset = currentOffset;
+        }
+
         return 0;
     }
 
+    /**
+     * Returns the free block with the lowest offset in the db file.
+     *
+     * @param header receives the header of the free block found
+     *
+     * @exception IOException if there is an error accessing the db file
+     *
+     * @return the offset in the db file of the block found, 0 if none
+     */
+    int getFirstFreeBlock(byte[] header) throws IOException {
+        // every free block is at least as large as its header
+        RecordStoreUtil.putInt(0, header, 4);
+        return getFreeBlock(header);
+    }
+
     /**
      * Updates the index of the given block and its offset.
      *
@@ -442,6 +478,9 @@ class RecordStoreIndex {
         ensureIndexValidity();
 
         int recordId = RecordStoreUtil.getInt(header, 0);
+        if (recordId < 0 && blockOffset < firstFreeOffset) {
+            firstFreeOffset = blockOffset;
+        }
         if (null != recordIdOffsets) {
             recordIdOffsets.setElementAt(blockOffset, recordId);
         }
@@ -476,6 +515,12 @@ class RecordStoreIndex {
         if (null != recordIdOffsets) {
             recordIdOffsets.LastSeenOffset = recordIdOffsets.NO_OFFSET;
         }
+
+        // the blocks after it move up and the file may shrink, keep
+        // firstFreeOffset on a block boundary below them
+        if (blockOffset < firstFreeOffset) {
+            firstFreeOffset = blockOffset;
+        }
     }
 
     /**
@@ -534,5 +579,6 @@ class RecordStoreIndex {
      */
     private void invalidateIndex() {
         recordIdOffsets = null;
+        firstFreeOffset = AbstractRecordStoreImpl.DB_HEADER_SIZE;
     }
 }
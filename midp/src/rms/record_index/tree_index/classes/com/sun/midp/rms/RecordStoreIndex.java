@@ -45,7 +45,14 @@ import com.sun.midp.log.LogChannels;
  *      updateBlock()
  *      deleteRecordIndex()
  *      removeBlock()
+ *      recordStoreVersionUpdated()
  *
+ *  The index is kept on disk in the .idx file of the record store as two
+ *  B-trees: recordId to block offset, and free block offset to block size.
+ *  Opening a record store only reads the index header. The header carries
+ *  the record store version the index was last updated for; if it does
+ *  not match the db file, e.g. after a crash, the index is rebuilt from
+ *  the db file once.
  */
 
 class RecordStoreIndex {
@@ -57,7 +64,8 @@ class RecordStoreIndex {
      * 04-07 - Offset to recordId tree root (big endian)
      * 08-11 - Offset to free block tree root (big endian)
      * 12-15 - Offset to the list of free tree blocks (big endian)
-     * 16-xx - Tree Blocks
+     * 16-19 - Record store version the index matches (big endian)
+     * 20-xx - Tree Blocks
      */
 
     /** IDX_SIZE offset */
@@ -72,8 +80,11 @@ class RecordStoreIndex {
     /** IDX_FREE_NODES offset */
     static final int IDX3_FREE_NODE_HEAD = 12;
 
+    /** IDX_VERSION offset */
+    static final int IDX4_VERSION = 16;
+
     /** Size of the index header */
-    static final int IDX_HEADER_SIZE = 16;
+    static final int IDX_HEADER_SIZE = 20;
 
     /** The maximum number of data elements in each  node */
     static final int NODE_ELEMENTS = 8;
@@ -113,26 +124,101 @@ class RecordStoreIndex {
         }
 
         boolean exist =
-          RecordStoreUtil.exists(suiteId, recordStoreName,
+          RecordStoreUtil.exists(RmsEnvironment.getSecureFilenameBase(suiteId),
+                                 recordStoreName,
                                  AbstractRecordStoreFile.IDX_EXTENSION);
 
         idxFile = rs.createIndexFile(suiteId, recordStoreName);
 
-        if (exist) {
-            // load header
-            if (idxFile.read(idxHeader) != IDX_HEADER_SIZE) {
-               throw new IOException("Index file corrupted");
+        // load header
+        if (exist && idxFile.read(idxHeader) == IDX_HEADER_SIZE &&
+                RecordStoreUtil.getInt(idxHeader, IDX4_VERSION) ==
+                    getStoreVersion()) {
+            return;
+        }
+
+        // new, corrupted or out of date index
+        rebuildIndex();
+    }
+
+    /**
+     * Recreates the index from the blocks of the db file.
+     *
+     * @exception IOException if there are any file errors
+     */
+    private void rebuildIndex() throws IOException {
+        if (Logging.REPORT_LEVEL <= Logging.INFORMATION) {
+            Logging.report(Logging.INFORMATION, LogChannels.LC_RMS,
+                           "rebuilding record store index");
+        }
+
+        for (int i = 0; i < IDX_HEADER_SIZE; i++) {
+            idxHeader[i] = 0;
+        }
+        RecordStoreUtil.putInt(IDX_HEADER_SIZE + NODE_SIZE * 2,
+                               idxHeader, IDX0_SIZE);
+        RecordStoreUtil.putInt(IDX_HEADER_SIZE, idxHeader, IDX1_ID_ROOT);
+        RecordStoreUtil.putInt(IDX_HEADER_SIZE + NODE_SIZE,
+                               idxHeader, IDX2_FREE_BLOCK_ROOT);
+        RecordStoreUtil.putInt(-1, idxHeader, IDX4_VERSION);
+        idxFile.truncate(0);
+        idxFile.seek(0);
+        idxFile.write(idxHeader);
+        idxFile.write(nodeBuf);
+        idxFile.write(nodeBuf);
+
+        if (dbFile != null) {
+            byte[] header = new byte[AbstractRecordStoreImpl.BLOCK_HEADER_SIZE];
+            int currentOffset = AbstractRecordStoreImpl.DB_HEADER_SIZE;
+            int dbSize = recordStore.getSize();
+
+            while (currentOffset < dbSize) {
+                dbFile.seek(currentOffset);
+                if (dbFile.read(header) !=
+                        AbstractRecordStoreImpl.BLOCK_HEADER_SIZE) {
+                    throw new IOException("Record store file corrupted");
+                }
+
+                int currentId = RecordStoreUtil.getInt(header, 0);
+                int currentSize = RecordStoreUtil.
+                    calculateBlockSize(RecordStoreUtil.getInt(header, 4));
+
+                if (currentId > 0) {
+                    updateRecordId(currentId, currentOffset);
+                } else {
+                    updateFreeBlock(currentOffset, currentSize);
+                }
+
+                currentOffset += currentSize;
             }
-        } else {
-            RecordStoreUtil.putInt(IDX_HEADER_SIZE + NODE_SIZE * 2,
-                                   idxHeader, IDX0_SIZE);
-            RecordStoreUtil.putInt(IDX_HEADER_SIZE, idxHeader, IDX1_ID_ROOT);
-            RecordStoreUtil.putInt(IDX_HEADER_SIZE + NODE_SIZE,
-                                   idxHeader, IDX2_FREE_BLOCK_ROOT);
-            idxFile.write(idxHeader);
-            idxFile.write(nodeBuf);
-            idxFile.write(nodeBuf);
-            idxFile.commitWrite();
+        }
+
+        recordStoreVersionUpdated(getStoreVersion());
+    }
+
+    /**
+     * Returns the current version of the indexed record store.
+     *
+     * @return the record store version, 0 if it is not available
+     */
+    private int getStoreVersion() {
+        try {
+            return recordStore.getVersion();
+        } catch (Exception e) {
+            return 0;
+        }
+    }
+
+    /**
+     * Rereads the index header, which another MIDlet sharing the record
+     * store may have changed since this one last used the index.
+     *
+     * @exception IOException if there is an error accessing the index file
+     */
+    private void ensureIndexValidity() throws IOException {
+        idxFile.seek(0);
+        if (idxFile.read(idxHeader) != IDX_HEADER_SIZE) {
+            throw new IOException("Index file corrupted");
         }
     }
 
@@ -156,7 +242,8 @@ class RecordStoreIndex {
      *         <code>false</code> otherwise.
      */
     static boolean deleteIndex(int suiteId, String recordStoreName) {
-        return RecordStoreUtil.quietDeleteFile(suiteId,
+        return RecordStoreUtil.quietDeleteFile(
+                                   RmsEnvironment.getSecureFilenameBase(suiteId),
                                    recordStoreName,
                                    AbstractRecordStoreFile.IDX_EXTENSION);
     }
@@ -188,6 +275,8 @@ class RecordStoreIndex {
         int count = 0;
 
         try {
+            ensureIndexValidity();
+
             Node node = new Node(idxFile);
             node.load(getRecordIdRootOffset());
 
@@ -223,18 +312,21 @@ class RecordStoreIndex {
 
         int loc_offset = getBlockOffsetOfRecord(recordId);
 
-        if (loc_offset == 0) {
-            // did not find the recordId
-            throw new InvalidRecordIDException();
-        }
-
         // read the header
         dbFile.seek(loc_offset);
 
         // read the block header
-        if (dbFile.read(header) != AbstractRecordStoreImpl.BLOCK_HEADER_SIZE) {
-            // did not find the recordId
-            throw new InvalidRecordIDException();
+        if (dbFile.read(header) != AbstractRecordStoreImpl.BLOCK_HEADER_SIZE ||
+                RecordStoreUtil.getInt(header, 0) != recordId) {
+            // the index does not match the db file, rebuild it once
+            rebuildIndex();
+
+            loc_offset = getBlockOffsetOfRecord(recordId);
+            dbFile.seek(loc_offset);
+            if (dbFile.read(header) !=
+                    AbstractRecordStoreImpl.BLOCK_HEADER_SIZE) {
+                throw new InvalidRecordIDException();
+            }
         }
 
         return loc_offset;
@@ -253,6 +345,8 @@ class RecordStoreIndex {
     int getBlockOffsetOfRecord(int recordId)
         throws IOException, InvalidRecordIDException {
 
+        ensureIndexValidity();
+
         Node node = new Node(idxFile);
         node.load(getRecordIdRootOffset());
 
@@ -277,8 +371,16 @@ class RecordStoreIndex {
     void updateBlock(int blockOffset, byte[] header) throws IOException {
         int recordId = RecordStoreUtil.getInt(header, 0);
 
+        ensureIndexValidity();
+        beginUpdate();
+
         if (recordId > 0) {
             updateRecordId(recordId, blockOffset);
+            // the block may have been a free one
+            deleteFreeBlock(blockOffset);
+        } else {
+            updateFreeBlock(blockOffset, RecordStoreUtil.
+                calculateBlockSize(RecordStoreUtil.getInt(header, 4)));
         }
     }
 
@@ -313,6 +415,9 @@ class RecordStoreIndex {
      * @exception IOException if there is an error accessing the db index
      */
     void deleteRecordIndex(int recordId) throws IOException {
+        ensureIndexValidity();
+        beginUpdate();
+
         int rootOffset = getRecordIdRootOffset();
         Node node = new Node(idxFile);
         node.load(rootOffset);
@@ -331,47 +436,84 @@ class RecordStoreIndex {
     }
 
     /**
-     * Searches for a free block large enough for the record.
+     * Searches for the smallest free block large enough for the record.
      *
-     * @param header a block header with the size set to the record data size
+     * @param header a block header with the size set to the record data size;
+     *        receives the header of the free block found
      *
      * @exception IOException if there is an error accessing the db file
      *
-     * @return the offset in the db file of the block added
+     * @return the offset in the db file of the block found, 0 if none
      */
     int getFreeBlock(byte[] header) throws IOException {
         int targetSize = RecordStoreUtil.
             calculateBlockSize(RecordStoreUtil.getInt(header, 4));
-        int currentId = 0;
-        int currentOffset = AbstractRecordStoreImpl.DB_HEADER_SIZE;
-        int currentSize = 0;
-
-        // search through the data blocks for a free block that is large enough
-        while (currentOffset < recordStore.getSize()) {
-            // seek to the next offset
-            dbFile.seek(currentOffset);
-
-            // read the block header
-            if (dbFile.read(header) != AbstractRecordStoreImpl.BLOCK_HEADER_SIZE) {
-                // did not find the recordId
-                throw new IOException();
-            }
 
-            currentId = RecordStoreUtil.getInt(header, 0);
-            currentSize = RecordStoreUtil.
-                calculateBlockSize(RecordStoreUtil.getInt(header, 4));
+        ensureIndexValidity();
 
-            // check for a free block big enough to hold the data
-            if (currentId < 0 && currentSize >= targetSize) {
-                // a free block
-                return currentOffset;
-            }
+        Node node = new Node(idxFile);
+        node.load(getFreeBlockRootOffset());
+
+        int[] best = { 0, Integer.MAX_VALUE };
+        findFreeBlock(node, targetSize, best);
+
+        return checkFreeBlock(best[0], targetSize, header);
+    }
+
+    /**
+     * Returns the free block with the lowest offset in the db file.
+     *
+     * @param header receives the header of the free block found
+     *
+     * @exception IOException if there is an error accessing the db file
+     *
+     * @return the offset in the db file of the block found, 0 if none
+     */
+    int getFirstFreeBlock(byte[] header) throws IOException {
+        ensureIndexValidity();
 
-            // added the block size to the currentOffset
-            currentOffset += currentSize;
+        Node node = new Node(idxFile);
+        node.load(getFreeBlockRootOffset());
+
+        // the smallest key is in the leftmost leaf
+        while (node.child[0] > 0) {
+            node.load(node.child[0]);
         }
 
-        return 0;
+        return checkFreeBlock(node.key[0] > 0 ? node.key[0] : 0,
+                              AbstractRecordStoreImpl.BLOCK_HEADER_SIZE,
+                              header);
+    }
+
+    /**
+     * Reads the header of a free block found in the index and checks it
+     * against the db file. Rebuilds the index if they do not match.
+     *
+     * @param loc_offset offset of the block in the db file, 0 for none
+     * @param targetSize the minimum block size
+     * @param header receives the header of the block
+     *
+     * @exception IOException if there is an error accessing the db file
+     *
+     * @return loc_offset, or 0 if the block cannot be used
+     */
+    private int checkFreeBlock(int loc_offset, int targetSize, byte[] header)
+            throws IOException {
+        if (loc_offset == 0) {
+            return 0;
+        }
+
+        dbFile.seek(loc_offset);
+        if (dbFile.read(header) != AbstractRecordStoreImpl.BLOCK_HEADER_SIZE ||
+                RecordStoreUtil.getInt(header, 0) >= 0 ||
+                RecordStoreUtil.calculateBlockSize(
+                    RecordStoreUtil.getInt(header, 4)) < targetSize) {
+            // the index does not match the db file
+            rebuildIndex();
+            return 0;
+        }
+
+        return loc_offset;
     }
 
     /**
@@ -383,6 +525,120 @@ class RecordStoreIndex {
      * @exception IOException if there is an error accessing the db file
      */
     void removeBlock(int blockOffset, byte[] header) throws IOException {
+        ensureIndexValidity();
+        beginUpdate();
+        deleteFreeBlock(blockOffset);
+    }
+
+    /**
+     * Clears the version stamp of the index before the first tree change
+     * of an operation, so that an operation cut short by a crash leaves
+     * an index that the next open rebuilds. recordStoreVersionUpdated()
+     * stamps it again when the operation is complete.
+     *
+     * @exception IOException if there is an error accessing the index file
+     */
+    private void beginUpdate() throws IOException {
+        if (RecordStoreUtil.getInt(idxHeader, IDX4_VERSION) != -1) {
+            RecordStoreUtil.putInt(-1, idxHeader, IDX4_VERSION);
+            idxFile.seek(0);
+            idxFile.write(idxHeader);
+            idxFile.commitWrite();
+        }
+    }
+
+    /**
+     * Stores the version of the record store the index now matches.
+     *
+     * @param newVersion new record store version
+     *
+     * @exception IOException if there is an error accessing the index file
+     */
+    void recordStoreVersionUpdated(int newVersion) throws IOException {
+        RecordStoreUtil.putInt(newVersion, idxHeader, IDX4_VERSION);
+        idxFile.seek(0);
+        idxFile.write(idxHeader);
+        idxFile.commitWrite();
+    }
+
+    /**
+     * Adds the free block at the given offset to the free block tree,
+     * or updates its size.
+     *
+     * @param blockOffset the offset in db file of the free block
+     * @param blockSize the size of the free block, header included
+     *
+     * @exception IOException if there is an error accessing the index file
+     */
+    private void updateFreeBlock(int blockOffset, int blockSize)
+            throws IOException {
+        Node node = new Node(idxFile);
+        node.load(getFreeBlockRootOffset());
+
+        int newOffset = updateKey(node, blockOffset, blockSize);
+
+        if (newOffset > 0) {
+            setFreeBlockRootOffset(newOffset);
+        }
+    }
+
+    /**
+     * Removes the block at the given offset from the free block tree
+     * if it is there.
+     *
+     * @param blockOffset the offset in db file of the block
+     *
+     * @exception IOException if there is an error accessing the index file
+     */
+    private void deleteFreeBlock(int blockOffset) throws IOException {
+        int rootOffset = getFreeBlockRootOffset();
+        Node node = new Node(idxFile);
+        node.load(rootOffset);
+
+        int loc_offset = deleteKey(node, blockOffset);
+
+        if (loc_offset > 0) {
+            freeNode(rootOffset);
+            setFreeBlockRootOffset(loc_offset);
+        }
+    }
+
+    /**
+     * Walks the free block tree starting at the given node and finds the
+     * smallest block that is large enough. The tree is keyed by offset,
+     * so the walk visits every free block, stopping early on an exact
+     * fit; it reads index nodes only, not the db file.
+     *
+     * @param node the root node of the tree to search
+     * @param targetSize the minimum block size
+     * @param best the offset and the size of the best block found so far,
+     *        initially 0 and Integer.MAX_VALUE
+     *
+     * @exception IOException if there is an error accessing the index file
+     */
+    private void findFreeBlock(Node node, int targetSize, int[] best)
+            throws IOException {
+        for (int i = 0; i < NODE_ELEMENTS + 1; i++) {
+            if (node.child[i] > 0) {
+                int parent_offset = node.offset;
+                node.load(node.child[i]);
+                findFreeBlock(node, targetSize, best);
+                if (best[1] == targetSize) {
+                    return;
+                }
+                node.load(parent_offset);
+            }
+            if (node.key[i] <= 0) {
+                break;
+            }
+            if (node.value[i] >= targetSize && node.value[i] < best[1]) {
+                best[0] = node.key[i];
+                best[1] = node.value[i];
+                if (best[1] == targetSize) {
+                    return;
+                }
+            }
+        }
     }
 
 
@@ -0,0 +1,197 @@
+/*
+ *   
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+package com.sun.midp.rms;
+
+import com.sun.midp.i3test.*;
+
+import javax.microedition.rms.*;
+
+/**
+ * Tests the persistent B-tree record index: records must be found
+ * through the index after the store is reopened, and a stale index
+ * file must be rebuilt from the record store.
+ */
+public class TestRecordStoreIndex extends TestCase {
+    final String RECORD_STORE_NAME = "testrmsidx";
+
+    /** Enough records to split the root node several times. */
+    final int NUM_RECORDS = RecordStoreIndex.NODE_ELEMENTS * 6;
+
+    int[] recordIds = new int[NUM_RECORDS];
+
+    /**
+     * Returns the contents stored in the record with the given number.
+     *
+     * @param n number of the record
+     * @return record data
+     */
+    private byte[] getRecordData(int n) {
+        byte[] data = new byte[1 + (n * 7) % 50];
+
+        for (int i = 0; i < data.length; i++) {
+            data[i] = (byte)(n + i);
+        }
+
+        return data;
+    }
+
+    /**
+     * Checks that every record that was not deleted has its own data.
+     *
+     * @param store record store to check
+     * @param deleted records with a number that is a multiple of this
+     *        value must not exist, 0 if no records were deleted
+     */
+    private void checkRecords(RecordStore store, int deleted)
+            throws RecordStoreException {
+        int expected = 0;
+
+        for (int n = 0; n < NUM_RECORDS; n++) {
+            if (deleted != 0 && n % deleted == 0) {
+                boolean notFound = false;
+
+                try {
+                    store.getRecord(recordIds[n]);
+                } catch (InvalidRecordIDException e) {
+                    notFound = true;
+                }
+
+                assertTrue("deleted " + n, notFound);
+                continue;
+            }
+
+            byte[] expect = getRecordData(n);
+            byte[] record = store.getRecord(recordIds[n]);
+            int i = 0;
+
+            if (record.length == expect.length) {
+                for (; i < record.length; i++) {
+                    if (record[i] != expect[i]) {
+                        break;
+                    }
+                }
+            }
+
+            assertEquals("record " + n, expect.length, i);
+            expected++;
+        }
+
+        assertEquals("getNumRecords", expected, store.getNumRecords());
+    }
+
+    /**
+     * Adds records, deletes some of them and finds the rest through
+     * the index after the store is reopened.
+     */
+    private void testReopen() throws RecordStoreException {
+        declare("Records found through the index after reopening");
+
+        RecordStore store = RecordStore.openRecordStore(RECORD_STORE_NAME,
+                                                        true);
+        for (int n = 0; n < NUM_RECORDS; n++) {
+            byte[] data = getRecordData(n);
+            recordIds[n] = store.addRecord(data, 0, data.length);
+        }
+
+        for (int n = 0; n < NUM_RECORDS; n += 3) {
+            store.deleteRecord(recordIds[n]);
+        }
+
+        store.closeRecordStore();
+
+        store = RecordStore.openRecordStore(RECORD_STORE_NAME, false);
+        try {
+            checkRecords(store, 3);
+
+            // free blocks left by the deleted records are reused
+            byte[] data = getRecordData(0);
+            recordIds[0] = store.addRecord(data, 0, data.length);
+            assertEquals("reused", data.length,
+                         store.getRecord(recordIds[0]).length);
+            store.deleteRecord(recordIds[0]);
+        } finally {
+            store.closeRecordStore();
+        }
+    }
+
+    /**
+     * Overwrites the version stamp of the index file, as if the index
+     * had not been committed together with the store, and checks that
+     * the index is rebuilt from the record store when it is reopened.
+     */
+    private void testStaleIndexRebuilt() throws Throwable {
+        declare("Stale index is rebuilt");
+
+        byte[] header = new byte[RecordStoreIndex.IDX_HEADER_SIZE];
+        RecordStoreFile idxFile = new RecordStoreFile(
+            RmsEnvironment.getCallersSuiteId(), RECORD_STORE_NAME,
+            AbstractRecordStoreFile.IDX_EXTENSION);
+
+        try {
+            assertEquals("header", RecordStoreIndex.IDX_HEADER_SIZE,
+                         idxFile.read(header));
+            RecordStoreUtil.putInt(-1, header,
+                                   RecordStoreIndex.IDX4_VERSION);
+            idxFile.seek(0);
+            idxFile.write(header);
+            idxFile.commitWrite();
+        } finally {
+            idxFile.close();
+        }
+
+        RecordStore store = RecordStore.openRecordStore(RECORD_STORE_NAME,
+                                                        false);
+        try {
+            checkRecords(store, 3);
+        } finally {
+            store.closeRecordStore();
+        }
+    }
+
+    /**
+     * Removes the record store and its index.
+     */
+    private void cleanup() {
+        try {
+            RecordStore.deleteRecordStore(RECORD_STORE_NAME);
+        } catch (RecordStoreException e) {
+            // ignore, the store may not exist
+        }
+    }
+
+    /**
+     * Runs all tests.
+     */
+    public void runTests() throws Throwable {
+        cleanup();
+
+        try {
+            testReopen();
+            testStaleIndexRebuilt();
+        } finally {
+            cleanup();
+        }
+    }
+}
@@ -30,6 +30,7 @@
 #include <midpStorage.h> /* IMPL_NOTE: use PCSL File API */
 #include <midp_logging.h>
 #include <midp_properties_port.h>
+#include <midpServices.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -43,12 +44,59 @@
 
 #define UNINITIALIZED_CACHED_VALUE (-1)
 
-/* Cache for a single file */
-static MidpFileCache *mFileCache;
+/*
+ * Number of files cached at once. The tree index keeps the index of a
+ * record store in a separate file, so a store may have two files open.
+ */
+#define MAX_CACHED_FILES 2
+
+/* Caches of the open files, NULL in unused slots */
+static MidpFileCache *mFileCaches[MAX_CACHED_FILES];
 
-/* Cache limit for a single file */
+/* Storage all cached files are on, and its free space */
+static StorageIdType cachedStorageId;
+static jlong cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
+
+/* Cache limit for all cached files together */
 static unsigned int fileCacheLimit = 0;
 
+/* Time window (ms) within which commits of the cached file are grouped */
+static int commitInterval = -1;
+
+/* Journal size that triggers a checkpoint into the cached file */
+static long journalLimit = 0;
+
+/*
+ * Write-ahead journal.
+ *
+ * Every cached file has its own journal. Flushing a cached file first appends all dirty blocks to
+ * "<file>.jnl" as one batch, with one write and one commit, and then
+ * writes the blocks in place without a commit. The journal is truncated
+ * at a checkpoint, after the file itself has been committed. When a file
+ * is opened, any batches left in its journal by a crash are written to
+ * the file again; a torn batch fails its checksum and ends the replay.
+ *
+ * A batch is a MidpJournalBatch header followed by records, each a
+ * MidpJournalRecord header followed by its data.
+ */
+PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(JOURNAL_EXTENSION)
+    {'.', 'j', 'n', 'l', '\0'}
+PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_END(JOURNAL_EXTENSION);
+
+#define JOURNAL_MAGIC 0x4A524D53 /* "JRMS" */
+
+typedef struct _MidpJournalBatch {
+    jint magic;
+    jint length;			/* bytes of records that follow */
+    jint checksum;			/* of the records */
+} MidpJournalBatch;
+
+typedef struct _MidpJournalRecord {
+    jint position;			/* file offset */
+    jint length;			/* size of the data */
+    /* char data[length];		   data */
+} MidpJournalRecord;
+
 /**
  * Test if region 1 that starts from position x1 with size s1
  * overlaps with region 2 that starts from position x2 with
@@ -79,41 +127,324 @@ static int is_include(long x1, long s1, long x2, long s2) {
     return (x1 <= x2 && x1+s1 >= x2+s2);
 }
 
+/** Returns the cache of the file, or NULL if the file is not cached */
+static MidpFileCache* findCache(int handle) {
+    int i;
+
+    for (i = 0; i < MAX_CACHED_FILES; i++) {
+        if (mFileCaches[i] != NULL && mFileCaches[i]->handle == handle) {
+            return mFileCaches[i];
+        }
+    }
+    return NULL;
+}
+
+/** Returns the number of cached files */
+static int countCaches() {
+    int i, n = 0;
+
+    for (i = 0; i < MAX_CACHED_FILES; i++) {
+        if (mFileCaches[i] != NULL) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/** Returns the memory taken by the blocks of all cached files */
+static long totalCacheSize() {
+    long size = 0;
+    int i;
+
+    for (i = 0; i < MAX_CACHED_FILES; i++) {
+        if (mFileCaches[i] != NULL) {
+            size += mFileCaches[i]->size;
+        }
+    }
+    return size;
+}
+
 /**
- * Initializes mFileCache->cachedAvailableSpace with the number
- * of available bytes on the storage defined by mFileCache->storageId.
+ * Computes the checksum of a journal batch (32-bit FNV-1a).
  */
-static void midp_init_cached_free_space() {
-    if (mFileCache) {
-        mFileCache->cachedAvailableSpace = storage_get_free_space(
-            mFileCache->storageId);
+static jint journal_checksum(const unsigned char* data, long length) {
+    unsigned int hash = 2166136261U;
+    long i;
+
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+
+    return (jint)hash;
+}
+
+/**
+ * Writes the batches found in the journal of a file back into the file,
+ * commits the file and deletes the journal.
+ * A journal that cannot be read is kept for the next open.
+ */
+static void journal_replay(int handle, const pcsl_string* journalName) {
+    char* pszError = NULL;
+    unsigned char* buf = NULL;
+    MidpJournalBatch batch;
+    MidpJournalRecord record;
+    long size, pos, end;
+    int replayed = KNI_FALSE;
+    int jh;
+
+    if (!storage_file_exists(journalName)) {
+        return;
+    }
+
+    jh = storage_open(&pszError, journalName, OPEN_READ);
+    if (pszError != NULL) {
+        REPORT_ERROR(LC_RMS, "Cannot open RMS journal");
+        storageFreeError(pszError);
+        return;
+    }
+
+    do {
+        size = storageSizeOf(&pszError, jh);
+        if (pszError != NULL) {
+            break;
+        }
+
+        if (size > 0) {
+            buf = (unsigned char*)midpMalloc(size);
+            if (buf == NULL ||
+                    storageRead(&pszError, jh, (char*)buf, size) != size) {
+                break;
+            }
+        }
+
+        for (pos = 0; pos + (long)sizeof(batch) <= size; pos = end) {
+            memcpy(&batch, buf + pos, sizeof(batch));
+            pos += sizeof(batch);
+            end = pos + batch.length;
+            if (batch.magic != JOURNAL_MAGIC || batch.length < 0 ||
+                    end > size ||
+                    journal_checksum(buf + pos, batch.length) !=
+                        batch.checksum) {
+                /* torn or stale tail: the batch was never committed */
+                break;
+            }
+
+            for (; pos + (long)sizeof(record) <= end; pos += record.length) {
+                memcpy(&record, buf + pos, sizeof(record));
+                pos += sizeof(record);
+                if (record.length < 0 || pos + record.length > end) {
+                    break;
+                }
+                storagePosition(&pszError, handle, record.position);
+                if (pszError == NULL) {
+                    storageWrite(&pszError, handle, (char*)buf + pos,
+                                 record.length);
+                }
+                if (pszError != NULL) {
+                    break;
+                }
+            }
+            if (pszError != NULL) {
+                break;
+            }
+        }
+        if (pszError != NULL) {
+            break;
+        }
+
+        storageSync(&pszError, handle);
+        replayed = (pszError == NULL);
+    } while (0);
+
+    midpFree(buf);
+    storageFreeError(pszError);
+    pszError = NULL;
+
+    storageClose(&pszError, jh);
+    storageFreeError(pszError);
+    pszError = NULL;
+
+    if (!replayed) {
+        REPORT_ERROR(LC_RMS, "Cannot replay RMS journal");
+        return;
+    }
+
+    storage_delete_file(&pszError, journalName);
+    storageFreeError(pszError);
+}
+
+/**
+ * Appends all dirty blocks of a cached file to its journal as one
+ * batch and commits the journal.
+ *
+ * @return KNI_TRUE if the blocks are now safe in the journal,
+ *         KNI_FALSE if they have to be written without it
+ */
+static int journal_append(MidpFileCache* c) {
+    char* pszError = NULL;
+    MidpFileCacheBlock *b;
+    MidpJournalBatch batch;
+    MidpJournalRecord record;
+    char *buf, *p;
+    long length = 0;
+
+    if (pcsl_string_is_null(&c->journalName)) {
+        return KNI_FALSE;
+    }
+
+    for (b = c->blocks; b != NULL; b = b->next) {
+        length += sizeof(MidpJournalRecord) + b->length;
+    }
+
+    buf = (char*)midpMalloc(sizeof(MidpJournalBatch) + length);
+    if (buf == NULL) {
+        return KNI_FALSE;
+    }
+
+    p = buf + sizeof(MidpJournalBatch);
+    for (b = c->blocks; b != NULL; b = b->next) {
+        record.position = b->position;
+        record.length = b->length;
+        memcpy(p, &record, sizeof(record));
+        p += sizeof(record);
+        memcpy(p, DATA(b), b->length);
+        p += b->length;
+    }
+
+    batch.magic = JOURNAL_MAGIC;
+    batch.length = length;
+    batch.checksum = journal_checksum(
+        (unsigned char*)buf + sizeof(MidpJournalBatch), length);
+    memcpy(buf, &batch, sizeof(batch));
+
+    if (c->journalHandle == -1) {
+        c->journalHandle = storage_open(&pszError,
+            &c->journalName, OPEN_READ_WRITE_TRUNCATE);
+        if (pszError != NULL) {
+            c->journalHandle = -1;
+        }
+        c->journalSize = 0;
+    }
+
+    if (pszError == NULL) {
+        storagePosition(&pszError, c->journalHandle,
+                        c->journalSize);
+    }
+    if (pszError == NULL) {
+        storageWrite(&pszError, c->journalHandle, buf,
+                     sizeof(MidpJournalBatch) + length);
+    }
+    if (pszError == NULL) {
+        storageSync(&pszError, c->journalHandle);
+    }
+
+    midpFree(buf);
+
+    if (pszError != NULL) {
+        REPORT_ERROR(LC_RMS, "Cannot write RMS journal");
+        storageFreeError(pszError);
+        return KNI_FALSE;
+    }
+
+    c->journalSize += sizeof(MidpJournalBatch) + length;
+    return KNI_TRUE;
+}
+
+/**
+ * Commits a cached file and empties its journal. Must be done before
+ * the file is written or truncated other than through the journal, so
+ * that a replay never overwrites newer data.
+ */
+static void journal_checkpoint(char** ppszError, MidpFileCache* c) {
+    *ppszError = NULL;
+
+    if (c->journalSize == 0) {
+        return;
+    }
+
+    storageSync(ppszError, c->handle);
+    if (*ppszError == NULL) {
+        storageTruncate(ppszError, c->journalHandle, 0);
+    }
+    if (*ppszError == NULL) {
+        c->journalSize = 0;
     }
 }
 
+/**
+ * Checkpoints a cached file, then closes and deletes its journal.
+ * The journal is kept for replay if the file is being closed and could
+ * not be flushed or checkpointed. A file that stays open is written
+ * around the journal from now on, and a replay would overwrite that
+ * newer data, so its journal is dropped in any case.
+ */
+static void journal_close(MidpFileCache* c, int flushed, int stayOpen) {
+    char* pszError = NULL;
+    int keep;
+
+    if (flushed) {
+        journal_checkpoint(&pszError, c);
+    }
+    keep = !flushed || pszError != NULL;
+    storageFreeError(pszError);
+    pszError = NULL;
+
+    if (c->journalHandle != -1) {
+        char* pszCloseError = NULL;
+        storageClose(&pszCloseError, c->journalHandle);
+        storageFreeError(pszCloseError);
+        c->journalHandle = -1;
+
+        if (keep && stayOpen) {
+            REPORT_ERROR(LC_RMS,
+                "Dropping RMS journal that could not be checkpointed");
+            keep = KNI_FALSE;
+        }
+
+        if (!keep) {
+            storage_delete_file(&pszError, &c->journalName);
+            storageFreeError(pszError);
+        }
+    }
+
+    pcsl_string_free(&c->journalName);
+}
+
+/**
+ * Initializes cachedAvailableSpace with the number
+ * of available bytes on the storage defined by cachedStorageId.
+ */
+static void midp_init_cached_free_space() {
+    cachedAvailableSpace = storage_get_free_space(cachedStorageId);
+}
+
 /* Upon success write, update file position, size and available space */
-static void updateCachedSizes(long lengthWritten) {
-    mFileCache->cachedPosition += lengthWritten;
-    if (mFileCache->cachedPosition > mFileCache->cachedFileSize) {
-        if (mFileCache->cachedAvailableSpace ==
-                UNINITIALIZED_CACHED_VALUE) {
+static void updateCachedSizes(MidpFileCache* c, long lengthWritten) {
+    c->cachedPosition += lengthWritten;
+    if (c->cachedPosition > c->cachedFileSize) {
+        if (cachedAvailableSpace == UNINITIALIZED_CACHED_VALUE) {
             midp_init_cached_free_space();
         }
 
-        mFileCache->cachedAvailableSpace -= mFileCache->cachedPosition -
-                                            mFileCache->cachedFileSize;
-        mFileCache->cachedFileSize = mFileCache->cachedPosition;
+        cachedAvailableSpace -= c->cachedPosition - c->cachedFileSize;
+        c->cachedFileSize = c->cachedPosition;
     }
 }
 
 /* Directly write to storage. File position will be updated also. */
 static
-void uncachedWrite(char** ppszError, int handle, char *buffer, int length) {
+void uncachedWrite(char** ppszError, MidpFileCache* c,
+                   char *buffer, int length) {
     *ppszError = NULL;
-    storagePosition(ppszError, handle, mFileCache->cachedPosition);
+    journal_checkpoint(ppszError, c);
+    if (*ppszError != NULL) {
+        return;
+    }
+    storagePosition(ppszError, c->handle, c->cachedPosition);
     if (*ppszError == NULL) {
-        storageWrite(ppszError, handle, buffer, length);
+        storageWrite(ppszError, c->handle, buffer, length);
         if (*ppszError == NULL) {
-            updateCachedSizes(length);
+            updateCachedSizes(c, length);
         }
     }
 }
@@ -134,43 +465,80 @@ static void initFileCacheLimit() {
     }
 }
 
+/* Initialize the group commit window and the journal checkpoint size
+ * reading RMS_COMMIT_INTERVAL and RMS_JOURNAL_LIMIT properties, using
+ * the constants of the same names as default values.
+ */
+static void initJournalLimits() {
+    if (-1 == commitInterval) {
+        int value = getInternalPropertyInt("RMS_COMMIT_INTERVAL");
+        commitInterval = (0 == value) ? RMS_COMMIT_INTERVAL : value;
+
+        value = getInternalPropertyInt("RMS_JOURNAL_LIMIT");
+        journalLimit = (0 == value) ? RMS_JOURNAL_LIMIT : value;
+    }
+}
+
 /**
- * Flush the cache and stop current file caching.
+ * Flush the cache of the file in the given slot and stop caching it.
  * Seek cached position for the case the file won't be closed after
  * flushing (it's possible if a few files are openned simultaneously).
  */
-static void midp_file_cache_finalize(char **ppszError, int stayOpen) {
+static void midp_file_cache_finalize(char **ppszError, int slot,
+                                     int stayOpen) {
+    MidpFileCache* c = mFileCaches[slot];
     *ppszError = NULL;
 
-    if (mFileCache != NULL) {
-        midp_file_cache_flush(ppszError, mFileCache->handle);
+    if (c != NULL) {
+        midp_file_cache_flush(ppszError, c->handle);
+        journal_close(c, *ppszError == NULL, stayOpen);
         /* Do no seek for the file that is either damaged or to be closed */
         if (*ppszError == NULL && stayOpen) {
-            storagePosition(ppszError, mFileCache->handle,
-                mFileCache->cachedPosition);
+            storagePosition(ppszError, c->handle, c->cachedPosition);
         }
         /* If read is cached, free all read blocks here */
-        midpFree(mFileCache);
-        mFileCache = NULL;
+        midpFree(c);
+        mFileCaches[slot] = NULL;
+    }
+}
+
+/**
+ * Flush all cached files. The first error is reported, the remaining
+ * files are flushed anyway.
+ */
+static void flushAll(char** ppszError) {
+    char* pszError = NULL;
+    int i;
+    *ppszError = NULL;
+
+    for (i = 0; i < MAX_CACHED_FILES; i++) {
+        if (mFileCaches[i] != NULL) {
+            midp_file_cache_flush(&pszError, mFileCaches[i]->handle);
+            if (*ppszError == NULL) {
+                *ppszError = pszError;
+            } else {
+                storageFreeError(pszError);
+            }
+        }
     }
 }
 
 /** A helper function for midp_file_cache_flush(). */
 static
-void midp_file_cache_flush_using_buffer(char** ppszError, int handle,
+void midp_file_cache_flush_using_buffer(char** ppszError, MidpFileCache* c,
                                         char* buf, long bufsize) {
     MidpFileCacheBlock *b; /* current cache block */
     MidpFileCacheBlock *n; /* next cache block */
     MidpFileCacheBlock *q; /* first block not (yet) copied to the buffer,
                               finally, the value to be stored
-                              in mFileCache->blocks */
+                              in c->blocks */
     char *bufPos;          /* first not yet used byte in the write buffer */
     long startPos, endPos; /* positions in the file cached in a series
                               of buffers, from...upto */
     long len;
     *ppszError = NULL;
 
-    while ((b = mFileCache->blocks) != NULL) {
+    while ((b = c->blocks) != NULL) {
 
         if (  NULL != buf
            && NULL != (n = b->next)
@@ -183,7 +551,7 @@ void midp_file_cache_flush_using_buffer(char** ppszError, int handle,
                 /* position in the file */
                 startPos = endPos = b->position;
 
-                b = mFileCache->blocks;
+                b = c->blocks;
                 /* now copy a series of adjacent blocks to the write buffer */
                 do {
                     len = b->length;
@@ -200,55 +568,60 @@ void midp_file_cache_flush_using_buffer(char** ppszError, int handle,
                 /* the cache state has not been modified yet */
 
                 /* now write from the write buffer */
-                storagePosition(ppszError, handle, startPos);
+                storagePosition(ppszError, c->handle, startPos);
                 CHECK_ERROR(*ppszError);
-                storageWrite(ppszError, handle, buf, endPos-startPos);
+                storageWrite(ppszError, c->handle, buf, endPos-startPos);
                 CHECK_ERROR(*ppszError);
 
                 /* write successful, now free the cache blocks */
-                while ( q != (b = mFileCache->blocks)) {
-                    mFileCache->size -= b->length + sizeof(MidpFileCacheBlock);
-                    mFileCache->blocks = b->next;
+                while ( q != (b = c->blocks)) {
+                    c->size -= b->length + sizeof(MidpFileCacheBlock);
+                    c->blocks = b->next;
                         midpFree(b);
                 }
         } else {
-            storagePosition(ppszError, handle, b->position);
+            storagePosition(ppszError, c->handle, b->position);
             CHECK_ERROR(*ppszError);
-            storageWrite(ppszError, handle, DATA(b), b->length);
+            storageWrite(ppszError, c->handle, DATA(b), b->length);
             CHECK_ERROR(*ppszError);
 
-            mFileCache->size -= b->length + sizeof(MidpFileCacheBlock);
-            mFileCache->blocks = b->next;
+            c->size -= b->length + sizeof(MidpFileCacheBlock);
+            c->blocks = b->next;
             midpFree(b);
         }
     }
-    storageCommitWrite(ppszError, handle);
-    CHECK_ERROR(*ppszError);
-
-    /* ASSERT (mFileCache->size == 0) */
-    if (mFileCache->size != 0) {
+    /* ASSERT (c->size == 0) */
+    if (c->size != 0) {
         REPORT_ERROR(LC_RMS, "File cache out of sync");
     }
 }
 
 void midp_file_cache_flush(char** ppszError, int handle) {
+    MidpFileCache* c = findCache(handle);
     char *buf;     /* write buffer */
     long bufsize;  /* its size */
+    int journaled;
     *ppszError = NULL;
 
-    if (mFileCache == NULL || mFileCache->handle != handle
-        || mFileCache->blocks == NULL) {
+    if (c == NULL || c->blocks == NULL) {
         return;
     }
 
+    /* Once the batch is in the journal the in-place writes need no commit */
+    journaled = journal_append(c);
+    if (!journaled) {
+        journal_checkpoint(ppszError, c);
+        CHECK_ERROR(*ppszError);
+    }
+
     /* allocate a buffer, as large as possible, but no larger than the cache */
     /* the buffer will be freed before the function returns */
-    bufsize = mFileCache->size;
+    bufsize = c->size;
     do {
          buf = (char*)midpMalloc(bufsize);
 
          if (buf != NULL) {
-            midp_file_cache_flush_using_buffer(ppszError, handle, buf, bufsize);
+            midp_file_cache_flush_using_buffer(ppszError, c, buf, bufsize);
             midpFree(buf);
             break;
          } else if (bufsize > (signed) (4*sizeof(MidpFileCacheBlock))) {
@@ -259,10 +632,61 @@ void midp_file_cache_flush(char** ppszError, int handle) {
             bufsize >>= 1;
          } else {
             /* failed to allocate buffer of any size */
-            midp_file_cache_flush_using_buffer(ppszError, handle, NULL, 0);
+            midp_file_cache_flush_using_buffer(ppszError, c, NULL, 0);
             break;
          }
     } while(1);
+    CHECK_ERROR(*ppszError);
+
+    c->pendingSince = 0;
+
+    if (!journaled) {
+        storageCommitWrite(ppszError, handle);
+    } else if (c->journalSize >= journalLimit) {
+        journal_checkpoint(ppszError, c);
+    }
+}
+
+int midp_file_cache_commit(char** ppszError, int handle) {
+    jlong oldest = 0;
+    jlong age;
+    int i;
+    *ppszError = NULL;
+
+    /* Writes to a file that is not cached are not grouped */
+    if (findCache(handle) == NULL) {
+        return 0;
+    }
+
+    for (i = 0; i < MAX_CACHED_FILES; i++) {
+        MidpFileCache* c = mFileCaches[i];
+        if (c != NULL && c->blocks != NULL &&
+                (oldest == 0 || c->pendingSince < oldest)) {
+            oldest = c->pendingSince;
+        }
+    }
+    if (oldest == 0) {
+        return 0;
+    }
+
+    /*
+     * Group commit: the flush is deferred while the oldest uncommitted
+     * write is younger than the commit window, so that a burst of
+     * operations reaches storage as one journal batch and one commit
+     * per file. The RMS cache limit bounds the batch size. The caller
+     * must commit again once the returned delay has passed.
+     *
+     * All cached files are flushed together, so the index of a record
+     * store is committed along with the store even though only the
+     * store schedules the commits.
+     */
+    age = midp_getCurrentTime() - oldest;
+    if (commitInterval > 0 && age < commitInterval) {
+        return (int)(commitInterval - age);
+    }
+
+    flushAll(ppszError);
+    return 0;
 }
 
 int midp_file_cache_open(char** ppszError, StorageIdType storageId,
@@ -272,20 +696,53 @@ int midp_file_cache_open(char** ppszError, StorageIdType storageId,
     h = storage_open(ppszError, filename, ioMode);
 
     if (*ppszError == NULL) { /* Open successfully */
-        if (mFileCache == NULL) {
+        pcsl_string journalName = PCSL_STRING_NULL;
+        MidpFileCache* c = NULL;
+        int open = countCaches();
+        int slot;
+
+        /* Redo whatever a crash left in the journal before any access */
+        if (PCSL_STRING_OK ==
+                pcsl_string_cat(filename, &JOURNAL_EXTENSION, &journalName)) {
+            journal_replay(h, &journalName);
+        }
+
+        for (slot = 0; slot < MAX_CACHED_FILES; slot++) {
+            if (mFileCaches[slot] == NULL) {
+                break;
+            }
+        }
+
+        if (slot < MAX_CACHED_FILES &&
+                (open == 0 || cachedStorageId == storageId)) {
+            c = (MidpFileCache *)midpMalloc(sizeof(MidpFileCache));
+        }
+
+        if (c != NULL) {
             initFileCacheLimit();
-            mFileCache = (MidpFileCache *)midpMalloc(sizeof(MidpFileCache));
-            mFileCache->handle = h;
-            mFileCache->size = 0;
-            mFileCache->storageId = storageId;
-            mFileCache->cachedPosition = 0;
-            mFileCache->cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
-            mFileCache->cachedFileSize = storageSizeOf(ppszError, h);
-            mFileCache->blocks = NULL;
+            initJournalLimits();
+            if (open == 0) {
+                cachedStorageId = storageId;
+                cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
+            }
+            c->handle = h;
+            c->size = 0;
+            c->cachedPosition = 0;
+            c->cachedFileSize = storageSizeOf(ppszError, h);
+            c->blocks = NULL;
+            c->journalName = journalName;
+            c->journalHandle = -1;
+            c->journalSize = 0;
+            c->pendingSince = 0;
+            mFileCaches[slot] = c;
         } else {
-            /* More than one file is open. Available space can no longer been
-             * cached. Stop caching completely. */
-            midp_file_cache_finalize(ppszError, KNI_TRUE);
+            pcsl_string_free(&journalName);
+            /* More files are open than can be cached. Available space can
+             * no longer been cached. Stop caching completely. */
+            for (slot = 0; slot < MAX_CACHED_FILES && *ppszError == NULL;
+                     slot++) {
+                midp_file_cache_finalize(ppszError, slot, KNI_TRUE);
+            }
         }
     }
 
@@ -294,11 +751,16 @@ int midp_file_cache_open(char** ppszError, StorageIdType storageId,
 
 void midp_file_cache_close(char** ppszError, int handle) {
     char *pszErrorTmp = NULL;
+    int slot;
     *ppszError = NULL;
 
-    if (mFileCache != NULL && mFileCache->handle == handle) {
-        midp_file_cache_finalize(ppszError, KNI_FALSE);
-        pszErrorTmp = *ppszError;
+    for (slot = 0; slot < MAX_CACHED_FILES; slot++) {
+        if (mFileCaches[slot] != NULL &&
+                mFileCaches[slot]->handle == handle) {
+            midp_file_cache_finalize(ppszError, slot, KNI_FALSE);
+            pszErrorTmp = *ppszError;
+            break;
+        }
     }
 
     storageClose(ppszError, handle);
@@ -311,10 +773,11 @@ void midp_file_cache_close(char** ppszError, int handle) {
 }
 
 void midp_file_cache_seek(char** ppszError, int handle, long position) {
+    MidpFileCache* c = findCache(handle);
     *ppszError = NULL;
 
-    if (position >= 0 && mFileCache != NULL && mFileCache->handle == handle) {
-        mFileCache->cachedPosition = position;
+    if (position >= 0 && c != NULL) {
+        c->cachedPosition = position;
     } else {
         storagePosition(ppszError, handle, position);
     }
@@ -323,6 +786,7 @@ void midp_file_cache_seek(char** ppszError, int handle, long position) {
 void midp_file_cache_write(char** ppszError, int handle,
                            char* buffer, long length) {
 
+    MidpFileCache* c = findCache(handle);
     MidpFileCacheBlock *p, *b;
     *ppszError = NULL;
 
@@ -330,24 +794,24 @@ void midp_file_cache_write(char** ppszError, int handle,
         return;
     }
 
-    if (mFileCache == NULL || mFileCache->handle != handle) {
+    if (c == NULL) {
         storageWrite(ppszError, handle, buffer, length);
         return;
     }
 
     /* Try to cache it */
     p = NULL; /* the block previous to b */
-    b = mFileCache->blocks;
+    b = c->blocks;
 
     while (b != NULL) {
         if (is_overlap(b->position, b->length,
-                       mFileCache->cachedPosition, length)) {
+                       c->cachedPosition, length)) {
             /* Handle simple overriding case */
             if (is_include(b->position, b->length,
-                           mFileCache->cachedPosition, length)) {
-                memcpy(DATA(b) + mFileCache->cachedPosition - b->position,
+                           c->cachedPosition, length)) {
+                memcpy(DATA(b) + c->cachedPosition - b->position,
                         buffer, length);
-                updateCachedSizes(length);
+                updateCachedSizes(c, length);
                 return;
             } else {
                 /* Flush everything out */
@@ -357,7 +821,7 @@ void midp_file_cache_write(char** ppszError, int handle,
                 /* Try to cache this write below */
                 break;
             }
-        } else if (mFileCache->cachedPosition+length <= b->position) {
+        } else if (c->cachedPosition+length <= b->position) {
             /* No match. Try to cache this write below */
             break;
         } else {
@@ -372,13 +836,13 @@ void midp_file_cache_write(char** ppszError, int handle,
 
     /* Never try to cache large write that is bigger than cache limit */
     if (sizeof(MidpFileCacheBlock)+length > fileCacheLimit) {
-        uncachedWrite(ppszError, handle, buffer, length);
+        uncachedWrite(ppszError, c, buffer, length);
         return;
     }
 
     /* If cache is full, flush it before caching new write */
-    if (mFileCache->size+sizeof(MidpFileCacheBlock)+length > fileCacheLimit) {
-        midp_file_cache_flush(ppszError, handle);
+    if (totalCacheSize()+sizeof(MidpFileCacheBlock)+length > fileCacheLimit) {
+        flushAll(ppszError);
         /* Reset previous block pointer after flush */
         p = NULL;
     }
@@ -387,31 +851,36 @@ void midp_file_cache_write(char** ppszError, int handle,
     b = (MidpFileCacheBlock *)midpMalloc(sizeof(MidpFileCacheBlock)+length);
     if (b == NULL) {
         /* Out of memory. Write directly to storage */
-        uncachedWrite(ppszError, handle, buffer, length);
+        uncachedWrite(ppszError, c, buffer, length);
         return;
     }
 
     /* Insert a new cache block (b) between p and p->next */
-    b->position = mFileCache->cachedPosition;
+    b->position = c->cachedPosition;
     b->length = length;
     memcpy(DATA(b), buffer, length);
 
     if (p == NULL) {
         /* inserting in the beginning of the list */
-        b->next = mFileCache->blocks;
-        mFileCache->blocks = b;
+        b->next = c->blocks;
+        c->blocks = b;
     } else {
         /* inserting after p, in the middle of the list */
         b->next = p->next;
         p->next = b;
     }
 
-    mFileCache->size += sizeof(MidpFileCacheBlock)+length;
-    updateCachedSizes(length);
+    c->size += sizeof(MidpFileCacheBlock)+length;
+    updateCachedSizes(c, length);
+
+    if (c->pendingSince == 0) {
+        c->pendingSince = midp_getCurrentTime();
+    }
 }
 
 long midp_file_cache_read(char** ppszError, int handle,
                           char* buffer, long length) {
+    MidpFileCache* c = findCache(handle);
     MidpFileCacheBlock *b;
     long l;
 
@@ -421,24 +890,24 @@ long midp_file_cache_read(char** ppszError, int handle,
         return 0;
     }
 
-    if (mFileCache == NULL || mFileCache->handle != handle) {
+    if (c == NULL) {
         return storageRead(ppszError, handle, buffer, length);
     }
 
     /* See if it is in the cache */
-    b = mFileCache->blocks;
+    b = c->blocks;
 
     while (b != NULL) {
         if (is_overlap(b->position, b->length,
-                        mFileCache->cachedPosition, length)) {
+                        c->cachedPosition, length)) {
             /* Handle simple inclusive case */
             if (is_include(b->position, b->length,
-                           mFileCache->cachedPosition, length)) {
+                           c->cachedPosition, length)) {
                 /* Read from cache */
                 memcpy(buffer,
-                        DATA(b) + mFileCache->cachedPosition - b->position,
+                        DATA(b) + c->cachedPosition - b->position,
                         length);
-                mFileCache->cachedPosition += length;
+                c->cachedPosition += length;
                 return length;
 
             } else {
@@ -447,7 +916,7 @@ long midp_file_cache_read(char** ppszError, int handle,
                 /* Read from file below */
                 break;
             }
-        } else if (mFileCache->cachedPosition+length <= b->position) {
+        } else if (c->cachedPosition+length <= b->position) {
             /* No match. Read from file below */
             break;
         } else {
@@ -457,11 +926,11 @@ long midp_file_cache_read(char** ppszError, int handle,
     } /* end of while (b) */
 
     /* Read from file */
-    storagePosition(ppszError, handle, mFileCache->cachedPosition);
+    storagePosition(ppszError, handle, c->cachedPosition);
     if (*ppszError == NULL) {
         l = storageRead(ppszError, handle, buffer, length);
         if (*ppszError == NULL) {
-            mFileCache->cachedPosition += length;
+            c->cachedPosition += length;
         }
     } else {
         l = 0;
@@ -476,54 +945,76 @@ jlong midp_file_cache_available_space(char** ppszError, int handle,
     jlong availSpace;
     *ppszError = NULL;
 
-    if (mFileCache == NULL) {
+    if (countCaches() == 0) {
         availSpace = storage_get_free_space(storageId);
     } else {
-        if (mFileCache->handle != handle) {
-            /* Flush current cache to storage before query for new space */
-            midp_file_cache_flush(ppszError, mFileCache->handle);
-            mFileCache->storageId = storageId;
-            mFileCache->cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
+        if (findCache(handle) == NULL) {
+            /* Flush current caches to storage before query for new space */
+            flushAll(ppszError);
+            cachedStorageId = storageId;
+            cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
         }
 
-        if (mFileCache->cachedAvailableSpace == UNINITIALIZED_CACHED_VALUE) {
+        if (cachedAvailableSpace == UNINITIALIZED_CACHED_VALUE) {
             midp_init_cached_free_space();
         }
 
-        availSpace = mFileCache->cachedAvailableSpace;
+        availSpace = cachedAvailableSpace;
     }
 
     return availSpace;
 }
 
 long midp_file_cache_sizeof(char** ppszError, int handle) {
+    MidpFileCache* c = findCache(handle);
     *ppszError = NULL;
 
-    if (mFileCache == NULL || mFileCache->handle != handle) {
+    if (c == NULL) {
         return storageSizeOf(ppszError, handle);
     } else {
-        return mFileCache->cachedFileSize;
+        return c->cachedFileSize;
     }
 }
 
 void midp_file_cache_truncate(char** ppszError, int handle, long size) {
+    MidpFileCache* c = findCache(handle);
     *ppszError = NULL;
 
     midp_file_cache_flush(ppszError, handle);
     CHECK_ERROR(*ppszError);
 
+    if (c != NULL) {
+        journal_checkpoint(ppszError, c);
+        CHECK_ERROR(*ppszError);
+    }
+
     storageTruncate(ppszError, handle, size);
 
-    if (*ppszError == NULL && mFileCache != NULL) {
-        if (mFileCache->handle != handle) {
-            mFileCache->cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
+    if (*ppszError == NULL && countCaches() > 0) {
+        if (c == NULL) {
+            cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
         } else {
-            if (mFileCache->cachedAvailableSpace !=
-                    UNINITIALIZED_CACHED_VALUE) {
-                mFileCache->cachedAvailableSpace +=
-                    mFileCache->cachedFileSize - size;
-                mFileCache->cachedFileSize = size;
+            if (cachedAvailableSpace != UNINITIALIZED_CACHED_VALUE) {
+                cachedAvailableSpace += c->cachedFileSize - size;
             }
+            c->cachedFileSize = size;
+        }
+    }
+}
+
+void midp_file_cache_delete(char** ppszError, const pcsl_string* filename) {
+    pcsl_string journalName = PCSL_STRING_NULL;
+    char* pszError = NULL;
+    *ppszError = NULL;
+
+    storage_delete_file(ppszError, filename);
+
+    if (PCSL_STRING_OK ==
+            pcsl_string_cat(filename, &JOURNAL_EXTENSION, &journalName)) {
+        if (storage_file_exists(&journalName)) {
+            storage_delete_file(&pszError, &journalName);
+            storageFreeError(pszError);
         }
+        pcsl_string_free(&journalName);
     }
 }
@@ -41,15 +41,19 @@ typedef struct _MidpFileCacheBlock {
 typedef struct _MidpFileCache {
     int handle;
     int size;
-    StorageIdType storageId;
     long cachedPosition;
     long cachedFileSize;
-    jlong cachedAvailableSpace;
     MidpFileCacheBlock *blocks;
+    pcsl_string journalName;		/* write-ahead journal of the file */
+    int journalHandle;			/* -1 until the first journaled flush */
+    long journalSize;			/* bytes journaled since checkpoint */
+    jlong pendingSince;			/* time of oldest uncommitted write */
 } MidpFileCache;
 
 void midp_file_cache_flush(char** ppszError, int handle);
 
+int midp_file_cache_commit(char** ppszError, int handle);
+
 int midp_file_cache_open(char** ppszError, StorageIdType storageId,
                          const pcsl_string* filename, int ioMode);
 
@@ -70,4 +74,6 @@ long midp_file_cache_sizeof(char** ppszError, int handle);
 
 void midp_file_cache_truncate(char** ppszError, int handle, long size);
 
+void midp_file_cache_delete(char** ppszError, const pcsl_string* filename);
+
 #endif
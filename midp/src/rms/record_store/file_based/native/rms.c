@@ -212,7 +212,7 @@ rmsdb_record_store_delete(char** ppszError,
                 INTERNAL_STORAGE_ID, name_str, extension, &filename_str)) {
         return -2;
     }
-    storage_delete_file(ppszError, &filename_str);
+    midp_file_cache_delete(ppszError, &filename_str);
 
     pcsl_string_free(&filename_str);
 
@@ -638,17 +638,21 @@ recordStoreWrite(char** ppszError, int handle, char* buffer, long length) {
 }
 
 /**
- * Commit pending writes
+ * Commit pending writes. Commits that follow each other within
+ * RMS_COMMIT_INTERVAL are grouped into one journal write.
  *
  * If not successful *ppszError will set to point to an error string,
  * on success it will be set to NULL.
  *
  * @param ppszError where to put an I/O error
  * @param handle handle to record store storage
+ *
+ * @return 0 if the writes were committed, otherwise the number of
+ *         milliseconds after which they have to be committed again
  */
-void
+int
 recordStoreCommitWrite(char** ppszError, int handle) {
-    midp_file_cache_flush(ppszError, handle);
+    return midp_file_cache_commit(ppszError, handle);
 }
 
 /**
@@ -178,13 +178,19 @@ void recordStoreWrite(char** pszError, int handle, char* bytes, long length);
 /**
  * Commits pending writes to the record-store file. If the commit fails,
  * it will pass back an error in the given pointer to a string.
+ * An implementation may defer the commit to group it with the ones
+ * that follow; the caller then has to commit again after the
+ * returned delay.
  *
  * @param pszError pointer to a string that will hold an error message
  *        if there is a problem, or null if the function is
  *        successful (this function sets <tt>ppszError</tt>'s value).
  * @param handle handle to the open record-store file
+ *
+ * @return 0 if the writes were committed, otherwise the delay in
+ *         milliseconds after which they have to be committed again
  */
-void recordStoreCommitWrite(char** pszError, int handle);
+int recordStoreCommitWrite(char** pszError, int handle);
 
 /**
  * Reads from the given open record-store file, and places the results
@@ -31,6 +31,8 @@
 package com.sun.midp.rms;
 
 import java.io.IOException;
+import java.util.Timer;
+import java.util.TimerTask;
 import javax.microedition.rms.*;
 
 import com.sun.midp.security.Permissions;
@@ -70,6 +72,16 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
     /** record store data */
     private RecordStoreFile dbFile;
 
+    /**
+     * Runs the deadline commits of all open record stores; created
+     * with the first deferred commit and shared, so that a write burst
+     * does not start a thread.
+     */
+    private static Timer commitTimer;
+
+    /** commits the writes the file cache deferred into a group commit */
+    private TimerTask commitTask;
+
     /**
      * Deletes the named record store. MIDlet suites are only allowed
      * to delete their own record stores. If the named record store is
@@ -212,7 +224,7 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
                     dbFile.seek(RS1_AUTHMODE);
                     dbFile.write(dbHeaderData, RS1_AUTHMODE, 4);
                     dbHeader.headerUpdated(dbHeaderData);
-                    // dbFile.commitWrite();
+                    commitWrite();
                 } catch (java.io.IOException ioe) {
                     throw new RecordStoreException("error writing record " +
                             "store attributes");
@@ -249,7 +261,10 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
             lockRecordStore();
 
             try {
+                // closing the file commits any deferred writes
+                cancelDeadlineCommit();
                 compactRecords();  // compact before close
+                dbIndex.recordStoreVersionUpdated(getVersion());
                 dbFile.close();
                 dbIndex.close();
             } catch (java.io.IOException ioe) {
@@ -451,7 +466,7 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
                     dbFile.write(dbHeaderData, RS2_NEXT_ID, 3*4+8);
                     dbHeader.headerUpdated(dbHeaderData);
                     dbIndex.recordStoreVersionUpdated(newVersion);
-                    // dbFile.commitWrite();
+                    commitWrite();
                 } catch (java.io.IOException ioe) {
                     throw new RecordStoreException("error writing new record "
                             + "data");
@@ -496,6 +511,9 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
                 // update the db index
                 dbIndex.deleteRecordIndex(recordId);
 
+                // reclaim some of the free space
+                compactRecordsStep();
+
                 // update the db header
                 byte[] dbHeaderData = dbHeader.getHeaderData();
                 RecordStoreUtil.putInt(getNumRecords()-1, dbHeaderData, 
@@ -511,7 +529,7 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
                 dbFile.write(dbHeaderData, RS3_NUM_LIVE, 2*4+8);
                 dbHeader.headerUpdated(dbHeaderData);
                 dbIndex.recordStoreVersionUpdated(newVersion);
-                // dbFile.commitWrite();
+                commitWrite();
 
             } catch (java.io.IOException ioe) {
                 throw new RecordStoreException("error updating file after" +
@@ -698,6 +716,9 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
                     addBlock(recordId, newData, offset, numBytes);
                 }
 
+                // reclaim some of the free space
+                compactRecordsStep();
+
                 // update the db header
                 byte[] dbHeaderData = dbHeader.getHeaderData();
                 int newVersion = getVersion()+1;                
@@ -711,7 +732,7 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
                 dbFile.write(dbHeaderData, RS4_VERSION, 4+8);
                 dbHeader.headerUpdated(dbHeaderData);
                 dbIndex.recordStoreVersionUpdated(newVersion);
-                // dbFile.commitWrite();
+                commitWrite();
             } catch (java.io.IOException ioe) {
                 throw new RecordStoreException("error setting record data");
             } finally {
@@ -893,6 +914,118 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
         }
     }
 
+    /**
+     * Reclaims part of the free space of the record store if it is
+     * fragmented or storage is running low. Finds the first free block
+     * and slides the records that follow it towards the beginning of
+     * <code>dbFile</code>, merging the free blocks it passes, until
+     * <code>RMSConfig.RMS_COMPACT_STEP</code> bytes have been moved. The
+     * space left behind becomes one free block; when it reaches the end of
+     * the file, the file is truncated.
+     *
+     * Unlike <code>compactRecords()</code>, the cost of one step does not
+     * depend on the size of <code>dbFile</code>.
+     *
+     * Warning: it is assumed that this method is only called while being
+     * protected by record store lock.
+     *
+     * @exception IOException if an error occurs during record store
+     *            compaction
+     */
+    private void compactRecordsStep() throws IOException {
+        byte[] dbHeaderData = dbHeader.getHeaderData();
+        int freeSize = RecordStoreUtil.getInt(dbHeaderData, RS7_FREE_SIZE);
+        int dataSize = RecordStoreUtil.getInt(dbHeaderData, RS6_DATA_SIZE);
+
+        if (freeSize == 0 ||
+                (freeSize * 100 < dataSize * RMSConfig.RMS_COMPACT_THRESHOLD &&
+                 getSizeAvailable() >= freeSize)) {
+            // not fragmented enough and there is room to grow
+            return;
+        }
+
+        byte[] header = new byte[BLOCK_HEADER_SIZE];
+
+        // find the first free block
+        int gapOffset = dbIndex.getFirstFreeBlock(header);
+        if (gapOffset == 0) {
+            return;
+        }
+
+        int currentOffset = gapOffset;
+        int moveUpNumBytes = 0;
+        int numMoved = 0;
+        int dbSize = getSize();
+
+        while (currentOffset < dbSize && numMoved < RMSConfig.RMS_COMPACT_STEP) {
+            dbFile.seek(currentOffset);
+            if (dbFile.read(header) != BLOCK_HEADER_SIZE) {
+                throw new IOException();
+            }
+
+            int currentSize =
+                RecordStoreUtil.calculateBlockSize(RecordStoreUtil.getInt(
+                                                   header, 4));
+
+            if (RecordStoreUtil.getInt(header, 0) < 0) {
+                // a free block, merge it into the gap
+                moveUpNumBytes += currentSize;
+                dbIndex.removeBlock(currentOffset, header);
+            } else {
+                // a record data block, move it up
+                for (int n = 0; n < currentSize; ) {
+                    int curRead = currentSize - n;
+                    if (curRead > COMPACT_BUFFER_SIZE) {
+                        curRead = COMPACT_BUFFER_SIZE;
+                    }
+
+                    dbFile.seek(currentOffset + n);
+                    curRead = dbFile.read(compactBuffer, 0, curRead);
+                    if (curRead == -1) {
+                        throw new IOException();
+                    }
+
+                    dbFile.seek(currentOffset + n - moveUpNumBytes);
+                    dbFile.write(compactBuffer, 0, curRead);
+                    n += curRead;
+                }
+
+                dbIndex.updateBlock(currentOffset - moveUpNumBytes, header);
+                numMoved += currentSize;
+            }
+
+            currentOffset += currentSize;
+        }
+
+        gapOffset = currentOffset - moveUpNumBytes;
+
+        if (currentOffset < dbSize) {
+            // leave the gap as a single free block
+            RecordStoreUtil.putInt(-1, header, 0);
+            RecordStoreUtil.putInt(moveUpNumBytes - BLOCK_HEADER_SIZE,
+                                   header, 4);
+            writeBlock(gapOffset, header, null, 0, 0);
+        } else {
+            // the gap reached the end of the file, cut it off
+            RecordStoreUtil.putInt(dataSize - moveUpNumBytes, dbHeaderData,
+                                   RS6_DATA_SIZE);
+            RecordStoreUtil.putInt(freeSize - moveUpNumBytes, dbHeaderData,
+                                   RS7_FREE_SIZE);
+            dbFile.seek(RS6_DATA_SIZE);
+            dbFile.write(dbHeaderData, RS6_DATA_SIZE, 4+4);
+            dbHeader.headerUpdated(dbHeaderData);
+
+            dbFile.truncate(getSize());
+        }
+
+        if (Logging.REPORT_LEVEL <= Logging.INFORMATION) {
+            Logging.report(Logging.INFORMATION, LogChannels.LC_RMS,
+                           "compactRecordsStep, moved " + numMoved +
+                           " bytes, free block of " + moveUpNumBytes +
+                           " bytes at offset " + gapOffset);
+        }
+    }
+
     /**
      * Set the record in the block to the data passed in and adds any remaining
      * space to the free list.
@@ -1120,6 +1253,79 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
         dbIndex.updateBlock(blockOffset, header);
     }
 
+    /**
+     * Commits the writes of the current operation. The file cache may
+     * defer them to group them with the writes that follow; a deadline
+     * commit is then scheduled, so that they reach storage when the
+     * commit window closes even if no other operation comes.
+     * The caller holds recordStoreLock.
+     *
+     * @exception IOException if an error occurs while flushing
+     */
+    private void commitWrite() throws IOException {
+        int delay = dbFile.commitWriteDeferred();
+
+        if (delay > 0 && commitTask == null) {
+            commitTask = new TimerTask() {
+                public void run() {
+                    deadlineCommit();
+                }
+            };
+
+            getCommitTimer().schedule(commitTask, delay);
+        }
+    }
+
+    /**
+     * Runs on the commit timer when the group commit window closes.
+     * Commits the deferred writes, or schedules another deadline if
+     * newer writes moved the window.
+     */
+    private void deadlineCommit() {
+        synchronized (recordStoreLock) {
+            cancelDeadlineCommit();
+            if (dbFile == null) {
+                // closing the file committed the writes
+                return;
+            }
+
+            lockRecordStore();
+            try {
+                commitWrite();
+            } catch (IOException ioe) {
+                if (Logging.REPORT_LEVEL <= Logging.ERROR) {
+                    Logging.report(Logging.ERROR, LogChannels.LC_RMS,
+                                   "deferred commit failed: " + ioe);
+                }
+            } finally {
+                unlockRecordStore();
+            }
+        }
+    }
+
+    /**
+     * Gets the timer shared by the deadline commits of all record stores.
+     *
+     * @return the commit timer
+     */
+    private static synchronized Timer getCommitTimer() {
+        if (commitTimer == null) {
+            commitTimer = new Timer();
+        }
+        return commitTimer;
+    }
+
+    /**
+     * Drops the pending deadline commit.
+     * The caller holds recordStoreLock.
+     */
+    private void cancelDeadlineCommit() {
+        if (commitTask != null) {
+            commitTask.cancel();
+            commitTask = null;
+        }
+    }
+
     /**
      * Locks this record store.
      */
@@ -1225,7 +1431,7 @@ public class RecordStoreImpl implements AbstractRecordStoreImpl {
 
                     // write the header to the file
                     dbFile.write(dbHeaderData);
-                    dbFile.commitWrite();
+                    commitWrite();
                 }
 
                 dbHeader = new RecordStoreSharedDBHeader(suiteId, 
@@ -244,6 +244,45 @@ public class TestRecordStore extends TestCase {
         store.closeRecordStore();
     }
 
+    private void testIncrementalCompaction() throws RecordStoreException {
+        final int RECORD_SIZE = 256;
+        final int NUM_RECORDS = 40;
+        int[] ids = new int[NUM_RECORDS];
+
+        declare("testIncrementalCompaction");
+
+        RecordStore store = RecordStore.openRecordStore(RECORD_STORE_NAME, true);
+
+        for (int i = 0; i < NUM_RECORDS; i++) {
+            ids[i] = store.addRecord(getRandomRecord(RECORD_SIZE),
+                                     0, RECORD_SIZE);
+        }
+
+        int fullSize = store.getSize();
+
+        // Leave every other block free, the store is now half empty
+        for (int i = 0; i < NUM_RECORDS; i += 2) {
+            store.deleteRecord(ids[i]);
+        }
+
+        // Deletes should have reclaimed space without closing the store
+        assertTrue("store not compacted", store.getSize() < fullSize);
+
+        boolean damaged = false;
+        for (int i = 1; i < NUM_RECORDS; i += 2) {
+            byte[] record = store.getRecord(ids[i]);
+            if (record.length != RECORD_SIZE || !isValidRandomRecord(record)) {
+                damaged = true;
+                break;
+            }
+        }
+
+        assertTrue("data is damaged", !damaged);
+        assertEquals(NUM_RECORDS / 2, store.getNumRecords());
+
+        store.closeRecordStore();
+    }
+
     private void cleanup() throws RecordStoreException {
         RecordStore.deleteRecordStore(RECORD_STORE_NAME);
     }
@@ -257,6 +296,8 @@ public class TestRecordStore extends TestCase {
             testEnumeration();
             testCompactRecords();
             cleanup();
+            testIncrementalCompaction();
+            cleanup();
             testSizeLimit();
         } catch (Throwable t) {
             t.printStackTrace();
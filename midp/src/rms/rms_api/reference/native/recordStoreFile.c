@@ -352,20 +352,24 @@ KNIDECL(com_sun_midp_rms_RecordStoreFile_writeBytes) {
  *
  * @param handle
  *
+ * @return 0 if the writes were committed, otherwise the delay in
+ *         milliseconds after which they have to be committed again
+ *
  * @exception IOException if an error occurs while flushing
  *            <code>recordStream</code>.
  */
-KNIEXPORT KNI_RETURNTYPE_VOID
+KNIEXPORT KNI_RETURNTYPE_INT
 KNIDECL(com_sun_midp_rms_RecordStoreFile_commitWrite) {
     int handle = KNI_GetParameterAsInt(1);
     char* pszError;
+    int delay;
 
-    recordStoreCommitWrite(&pszError, handle);
+    delay = recordStoreCommitWrite(&pszError, handle);
     if (pszError != NULL) {
         KNI_ThrowNew(midpIOException, pszError);
         recordStoreFreeError(pszError);
     }
-    KNI_ReturnVoid();
+    KNI_ReturnInt(delay);
 }
 
 /**
@@ -234,6 +234,12 @@ int pcsl_file_commitwrite(void *handle)
     return fflush(handle);
 }
 
+/* Force the data to stable storage */
+int pcsl_file_sync(void *handle)
+{
+    return fflush(handle);
+}
+
 
 /**
  * The rename function updates the filename.
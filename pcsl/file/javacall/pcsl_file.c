@@ -317,6 +317,12 @@ pcsl_file_commitwrite(void *handle) {
     return 0;                   /* not used */
 }
 
+/* Force the data to stable storage; javacall has no sync primitive */
+int
+pcsl_file_sync(void *handle) {
+    return 0;
+}
+
 
 /**
  * Renames the filename.
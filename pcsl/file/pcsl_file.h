@@ -291,6 +291,17 @@ int pcsl_file_exist(const pcsl_string * fileName);
  */
 int pcsl_file_commitwrite(void *handle);
 
+/**
+ * Force the data and the metadata of the file to stable storage, so
+ * that they survive a power loss. This can be much slower than
+ * pcsl_file_commitwrite(); use it only where durability is required,
+ * e.g. for a write-ahead journal.
+ * @param handle identifier of file
+ *               This is the identifier returned by pcsl_file_open()
+ * @return 0 on success, -1 otherwise
+ */
+int pcsl_file_sync(void *handle);
+
 /**
  * Renames file or directory.
  * @param oldName current name
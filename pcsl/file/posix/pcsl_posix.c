@@ -256,6 +256,12 @@ int pcsl_file_commitwrite(void *handle)
     return 0;
 }
 
+/* Force the data to stable storage */
+int pcsl_file_sync(void *handle)
+{
+    return (fsync((int)handle) == 0) ? 0 : -1;
+}
+
 /**
  * The rename function updates the filename.
  */
@@ -270,6 +270,12 @@ int pcsl_file_commitwrite(void *handle)
 	return 0;
 }
 
+/* Force the data to stable storage; RAM storage has none */
+int pcsl_file_sync(void *handle)
+{
+	return 0;
+}
+
 
 /**
  * The rename function updates the filename.
@@ -81,6 +81,188 @@ static jint totalStorageSpace = -1;
 
 unsigned char tempBuf[300];      /* This buffer is used to avoid jvmMalloc and jvmFree */
 
+/*
+ * Hash index over the Name Table, kept in RAM. Each slot holds the
+ * address of one Name Table entity (0 marks an empty slot); collisions
+ * probe the following slots. The index is rebuilt from the Name Table
+ * after it is compacted. If it ever gets too full, lookups fall back to
+ * scanning the Name Table.
+ */
+#ifndef RMFS_NAME_INDEX_SIZE
+#define RMFS_NAME_INDEX_SIZE   512	/* must be a power of two */
+#endif
+
+#define RMFS_NAME_INDEX_MASK   (RMFS_NAME_INDEX_SIZE - 1)
+
+static jint rmfsNameIndex[RMFS_NAME_INDEX_SIZE];
+static jint rmfsNameIndexCount = 0;
+static RMFS_BOOLEAN rmfsNameIndexValid = RMFS_FALSE;
+static RMFS_BOOLEAN rmfsNameIndexFull = RMFS_FALSE;
+
+/* Last known Name Table entity of each file identifier, 0 if unknown */
+static jint rmfsNameByID[256];
+
+jint rmfsBlockGeneration = 0;
+
+/**
+ * FUNCTION:      rmfsHashName()
+ * TYPE:          private operation
+ * OVERVIEW:      Get the Name Table index slot a filename hashes to
+ * INTERFACE:
+ *   parameters:  <const char* filename>
+ *   returns:     <jint slot>
+ *                
+ */
+static jint rmfsHashName(const char *filename)
+{
+  unsigned int hash = 0;
+
+  while (*filename != '\0') {
+    hash = hash * 31 + (uchar) *filename++;
+  }
+
+  return (jint) (hash & RMFS_NAME_INDEX_MASK);
+}
+
+/**
+ * FUNCTION:      rmfsIndexName()
+ * TYPE:          private operation
+ * OVERVIEW:      Add one Name Table entity to the Name Table index
+ * INTERFACE:
+ *   parameters:  <jint entityPos>
+ *   returns:     None
+ *                
+ */
+static void rmfsIndexName(jint entityPos)
+{
+  jint slot;
+
+  if (rmfsNameIndexFull) {
+    return;
+  }
+
+  /* Keep a quarter of the slots empty so that probe sequences stay short */
+  if (rmfsNameIndexCount >= RMFS_NAME_INDEX_SIZE - RMFS_NAME_INDEX_SIZE / 4) {
+#ifdef TRACE_STORAGE
+    printf("Name Table index is full, scanning from now on \n");
+#endif
+    rmfsNameIndexFull = RMFS_TRUE;
+    return;
+  }
+
+  slot = rmfsHashName((char *) (entityPos + sizeof(_RmfsNameTabHdr)));
+  while (rmfsNameIndex[slot] != 0) {
+    slot = (slot + 1) & RMFS_NAME_INDEX_MASK;
+  }
+
+  rmfsNameIndex[slot] = entityPos;
+  rmfsNameIndexCount++;
+}
+
+/**
+ * FUNCTION:      rmfsUnindexName()
+ * TYPE:          private operation
+ * OVERVIEW:      Remove one Name Table entity from the Name Table index
+ *                Entities further along the same probe sequence are moved
+ *                back, so lookups never stop at the emptied slot
+ * INTERFACE:
+ *   parameters:  <jint entityPos>
+ *   returns:     None
+ *                
+ */
+static void rmfsUnindexName(jint entityPos)
+{
+  jint slot;
+  jint next;
+  jint home;
+
+  if (!rmfsNameIndexValid || rmfsNameIndexFull) {
+    return;
+  }
+
+  slot = rmfsHashName((char *) (entityPos + sizeof(_RmfsNameTabHdr)));
+  while (rmfsNameIndex[slot] != entityPos) {
+    if (rmfsNameIndex[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) & RMFS_NAME_INDEX_MASK;
+  }
+
+  rmfsNameIndex[slot] = 0;
+  rmfsNameIndexCount--;
+
+  for (next = (slot + 1) & RMFS_NAME_INDEX_MASK; rmfsNameIndex[next] != 0;
+       next = (next + 1) & RMFS_NAME_INDEX_MASK) {
+    home = rmfsHashName((char *) (rmfsNameIndex[next] +
+				  sizeof(_RmfsNameTabHdr)));
+
+    /* Move the entity back unless its home slot lies in (slot, next] */
+    if (((next - home) & RMFS_NAME_INDEX_MASK) >=
+	((next - slot) & RMFS_NAME_INDEX_MASK)) {
+      rmfsNameIndex[slot] = rmfsNameIndex[next];
+      rmfsNameIndex[next] = 0;
+      slot = next;
+    }
+  }
+}
+
+/**
+ * FUNCTION:      rmfsInvalidateNameIndex()
+ * TYPE:          private operation
+ * OVERVIEW:      Drop the Name Table index after Name Table entities moved
+ *                It is rebuilt by the next lookup
+ * INTERFACE:
+ *   parameters:  None
+ *   returns:     None
+ *                
+ */
+static void rmfsInvalidateNameIndex()
+{
+  rmfsNameIndexValid = RMFS_FALSE;
+  memset(rmfsNameByID, 0, sizeof(rmfsNameByID));
+}
+
+/**
+ * FUNCTION:      rmfsBuildNameIndex()
+ * TYPE:          private operation
+ * OVERVIEW:      Index every entity in the Name Table space
+ * INTERFACE:
+ *   parameters:  None
+ *   returns:     None
+ *                
+ */
+static void rmfsBuildNameIndex()
+{
+  _RmfsNameTabHdrPtr nameTabHdr;
+  jint entityPos = RmfsNameTableEnd;
+
+  memset(rmfsNameIndex, 0, sizeof(rmfsNameIndex));
+  memset(rmfsNameByID, 0, sizeof(rmfsNameByID));
+  rmfsNameIndexCount = 0;
+  rmfsNameIndexFull = RMFS_FALSE;
+  rmfsNameIndexValid = RMFS_TRUE;
+
+  while ((unsigned int)(entityPos + sizeof(_RmfsNameTabHdr)) <=
+	 (unsigned int)RmfsMemoryEnd) {
+    nameTabHdr = (_RmfsNameTabHdrPtr) entityPos;
+
+    if ((entityPos + (jint)sizeof(_RmfsNameTabHdr) + nameTabHdr->nameLen) >
+	RmfsMemoryEnd) {
+      break;
+    }
+
+    rmfsIndexName(entityPos);
+
+    /* Entities nearer the table end are found first by a scan */
+    if ((nameTabHdr->identifier != 0)
+	&& (rmfsNameByID[nameTabHdr->identifier] == 0)) {
+      rmfsNameByID[nameTabHdr->identifier] = entityPos;
+    }
+
+    entityPos += sizeof(_RmfsNameTabHdr) + nameTabHdr->nameLen;
+  }
+}
+
 /**
  * FUNCTION:      ReadDataFromStorage()
  * TYPE:          public operation
@@ -201,6 +383,8 @@ jint rmfsInitialize(jint start, jint size)
     RmfsNameTableEnd = rmfsHdr.nameTableEndPos;
   }
 
+  rmfsInvalidateNameIndex();
+
   /*
      Initialize Open File Table 
    */
@@ -325,6 +509,17 @@ jint searchNameTabByID(char **filename, jint identifier)
 #ifdef TRACE_STORAGE
   printf("searchNameTabByID: identifier %d\n", identifier);
 #endif
+  if ((identifier > 0) && (identifier < 256)
+      && (rmfsNameByID[identifier] >= RmfsNameTableEnd)) {
+    nameTabHdr = (_RmfsNameTabHdrPtr) rmfsNameByID[identifier];
+
+    if (nameTabHdr->identifier == identifier) {
+      strcpy((char *) tempBuf, (char *) (nameTabHdr + 1));
+      *filename = (char *) tempBuf;
+      return rmfsNameByID[identifier];
+    }
+  }
+
   tabLength = RmfsMemoryEnd - RmfsNameTableEnd;
 
   if ((unsigned int)tabLength < sizeof(_RmfsNameTabHdr)) {
@@ -373,6 +568,10 @@ jint searchNameTabByID(char **filename, jint identifier)
       curLength = curLength - sizeof(_RmfsNameTabHdr);
       done = RMFS_TRUE;
 
+      if (identifier < 256) {
+	rmfsNameByID[identifier] = RmfsNameTableEnd + curLength;
+      }
+
       break;
     }
 
@@ -422,6 +621,7 @@ uchar rmfsNewNameTable(const char *filename)
       fileID = RmfsGlobalNameID;
       WriteDataToStorage(&fileID, entityPos + sizeof(uchar),
 			 sizeof(uchar));
+      rmfsNameByID[fileID] = entityPos;
       return fileID;
     }
 
@@ -478,6 +678,11 @@ uchar rmfsNewNameTable(const char *filename)
 
   fileID = nameTab->identifier;
 
+  if (rmfsNameIndexValid) {
+    rmfsIndexName(RmfsNameTableEnd);
+  }
+  rmfsNameByID[fileID] = RmfsNameTableEnd;
+
   return fileID;
 }
 
@@ -504,6 +709,29 @@ jint searchNameTabByString(const char *filename, uchar *identifier)
   printf("searchNameTabByString: filename %s\n", filename);
 #endif
 
+  if (!rmfsNameIndexValid) {
+    rmfsBuildNameIndex();
+  }
+
+  if (!rmfsNameIndexFull) {
+    for (curLength = rmfsHashName(filename);
+	 rmfsNameIndex[curLength] != 0;
+	 curLength = (curLength + 1) & RMFS_NAME_INDEX_MASK) {
+      nameTabHdr = (_RmfsNameTabHdrPtr) rmfsNameIndex[curLength];
+
+      if (strcmp(filename, (char *) (nameTabHdr + 1)) == 0) {
+	*identifier = nameTabHdr->identifier;
+	return rmfsNameIndex[curLength];
+      }
+    }
+
+#ifdef TRACE_STORAGE
+    printf("No entity match \n");
+#endif
+    return -1;
+  }
+
+  curLength = 0;
   tabLength = RmfsMemoryEnd - RmfsNameTableEnd;
 
   if ((unsigned int)tabLength < sizeof(_RmfsNameTabHdr)) {
@@ -737,10 +965,16 @@ RMFS_BOOLEAN delNameTabByID(jint identifier)
   WriteDataToStorage(&nameID, entityPos + sizeof(uchar),
 		     sizeof(uchar));
 
+  if ((identifier < 256) && (rmfsNameByID[identifier] == entityPos)) {
+    rmfsNameByID[identifier] = 0;
+  }
+
   /*
      If the entity is the last Name Table entity, move the RmfsNameTabEnd Pointer 
    */
   if (entityPos == RmfsNameTableEnd) {
+    rmfsUnindexName(entityPos);
+
     lastNameLen = sizeof(_RmfsNameTabHdr) + strlen(filename) + 1;
 
     if(lastNameLen != (lastNameLen / ALIGNMENT_BYTE) * ALIGNMENT_BYTE) {
@@ -806,6 +1040,10 @@ RMFS_BOOLEAN delNameTabByString(const char *filename)
     memset ((void *) (nameTab + 1), 0x00, nameTab->nameLen);
 */
 
+  if (rmfsNameByID[identifier] == entityPos) {
+    rmfsNameByID[identifier] = 0;
+  }
+
   identifier = 0;
   WriteDataToStorage(&identifier, entityPos + sizeof(uchar),
 		     sizeof(uchar));
@@ -816,6 +1054,8 @@ RMFS_BOOLEAN delNameTabByString(const char *filename)
      If the entity is the last Name Table entity, move the RmfsNameTabEnd Pointer 
    */
   if (entityPos == RmfsNameTableEnd) {
+    rmfsUnindexName(entityPos);
+
     nameTabLen =  sizeof(_RmfsNameTabHdr) + strlen(filename) + 1;
     if(nameTabLen != (nameTabLen/ALIGNMENT_BYTE) * ALIGNMENT_BYTE ) { 
       nameTabLen = (nameTabLen/ALIGNMENT_BYTE + 1) * ALIGNMENT_BYTE;
@@ -935,6 +1175,8 @@ jint rmfsTruncateNameTable()
 
   RmfsNameTableEnd = RmfsMemoryEnd - tabLength;
 
+  rmfsInvalidateNameIndex();
+
   // jvmFree (nameTabBuffer);
 
 
@@ -962,6 +1204,8 @@ void rmfsInitDataBlockHdrArray()
 #ifdef TRACE_STORAGE
   printf("rmfsInitDataBlockHdrArray: \n");
 #endif
+  rmfsBlockGeneration++;
+
   memset(rmfsDataBlockHdrArray, 0xFF,
 	 sizeof(_RmfsDataBlockHdr) * MAX_DATABLOCK_NUMBER);
 
@@ -1018,7 +1262,7 @@ rmfsFileAlloc(jint numBytesToAllocate, const char *filename,
   _RmfsBlockHdr nextBlockHdr;
   jint i = 0;
   jint j = 0;
-  jint minsizeDiff = -1;
+  RMFS_BOOLEAN contiguous = RMFS_FALSE;
   uchar fileID = 0;
   jint totalSpace = 0;
   RMFS_BOOLEAN firstBlock = RMFS_TRUE;
@@ -1032,6 +1276,8 @@ rmfsFileAlloc(jint numBytesToAllocate, const char *filename,
   printf("rmfsFileAlloc: numBytes: %d, filename: %s, blockType %d\n",
 	 numBytesToAllocate, filename, blockType);
 #endif
+  rmfsBlockGeneration++;
+
   /*
      When the dataBuffer is NULL, just allocate space for the file, doesn't write data into it 
    */
@@ -1066,10 +1312,11 @@ rmfsFileAlloc(jint numBytesToAllocate, const char *filename,
     }
 
     /*
-       Best Fit Algorithm 
+       Best Fit Algorithm. A free block right behind data of the same file
+       wins over a tighter fit elsewhere, so the file stays sequential.
      */
-    while ((rmfsDataBlockHdrArray[i].flag != 0xFF)
-	   && (i < MAX_DATABLOCK_NUMBER)) {
+    while ((i < MAX_DATABLOCK_NUMBER)
+	   && (rmfsDataBlockHdrArray[i].flag != 0xFF)) {
       /*
          allocating 
        */
@@ -1081,7 +1328,14 @@ rmfsFileAlloc(jint numBytesToAllocate, const char *filename,
 		((rmfsDataBlockHdrArray[i].size != MAX_BLOCKSIZE_4_INSTALL_TEMP) || 
 	        (newBytesToAllocate == MAX_BLOCKSIZE_4_INSTALL_TEMP)))	{
 	  sizeDiff = rmfsDataBlockHdrArray[i].size - newBytesToAllocate;
-	  if ((minSizeDiff == -1) || (sizeDiff < minsizeDiff)) {
+	  if ((i > 0) && (rmfsDataBlockHdrArray[i - 1].identifier == fileID)
+	      && ((rmfsDataBlockHdrArray[i - 1].flag & 0x01) == 0x01)
+	      && (!contiguous || (sizeDiff < minSizeDiff))) {
+	    contiguous = RMFS_TRUE;
+	    minSizeDiff = sizeDiff;
+	    fitBlock = i;
+	  } else if (!contiguous
+		     && ((minSizeDiff == -1) || (sizeDiff < minSizeDiff))) {
 	    minSizeDiff = sizeDiff;
 	    fitBlock = i;
 	  }
@@ -1187,7 +1441,8 @@ rmfsFileAlloc(jint numBytesToAllocate, const char *filename,
       /*
          If the last data block belongs to the same file, just enlarge the file 
        */
-      if ((rmfsDataBlockHdrArray[curDataBlockNum - 1].identifier == fileID)
+      if ((curDataBlockNum > 0)
+	  && (rmfsDataBlockHdrArray[curDataBlockNum - 1].identifier == fileID)
 	  && (rmfsDataBlockHdrArray[curDataBlockNum - 1].next == 0)) {
 	rmfsDataBlockHdrArray[curDataBlockNum - 1].size += newBytesToAllocate;
 	rmfsDataBlockHdrArray[curDataBlockNum - 1].dataSize += fileSize;
@@ -1508,6 +1763,7 @@ jint rmfsFreeDataBlock(jint index)
   printf("rmfsFreeDataBlock: index:  %d; size %d\n", index,
 	 rmfsDataBlockHdrArray[index].size);
 #endif
+  rmfsBlockGeneration++;
 
   if (index >= curDataBlockNum - 1) {
     lastBlock = RMFS_TRUE;
@@ -1699,6 +1955,8 @@ jint rmfsFree(jint start, jint size)
   rmfsHdr.maxFileID = 0;
   RmfsGlobalNameID = 0;
 
+  rmfsInvalidateNameIndex();
+
   WriteDataToStorage(&rmfsHdr, start, sizeof(_RmfsHdr));
 
 
@@ -1765,6 +2023,7 @@ jint rmfsWriteDataToBlock(jint index, const void *buffer, jint size, jint offset
 
   if ((offset + size) > rmfsDataBlockHdrArray[index].dataSize) {
     rmfsDataBlockHdrArray[index].dataSize = offset + size;
+    rmfsBlockGeneration++;
   }
 
   /*
@@ -1814,6 +2073,8 @@ jint rmfsAllocLinkedBlock(jint index, const void *buffer, jint size)
 #ifdef TRACE_STORAGE
   printf("rmfsAllocLinkedBlock: index: %d; size: %d\n", index, size);
 #endif
+  rmfsBlockGeneration++;
+
   fileType = rmfsDataBlockHdrArray[index].flag & 0x3E;
 
   if ((searchNameTabByID
@@ -2095,6 +2356,7 @@ jint rmfsSplitBlock(jint index, jint offset)
 #ifdef TRACE_STORAGE
   printf("rmfsSplitBlock: index: %d; offset: %d\n", index, offset);
 #endif
+  rmfsBlockGeneration++;
 
   if((newBlockSize/ALIGNMENT_BYTE) * ALIGNMENT_BYTE != offset) { 
     newBlockSize = (newBlockSize/ALIGNMENT_BYTE + 1) * ALIGNMENT_BYTE; 
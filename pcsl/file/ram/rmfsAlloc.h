@@ -78,7 +78,10 @@ typedef unsigned char uchar;
 #define MAX_BLOCKSIZE_4_MIDLET_PROR    0x1800	/* 6K bytes */
 #define MAX_BLOCKSIZE_4_INSTALL_TEMP   0xF000	/* 60K bytes */
 
+/* Number of Data Blocks RMFS can track; must not exceed 255 */
+#ifndef MAX_DATABLOCK_NUMBER
 #define   MAX_DATABLOCK_NUMBER   40
+#endif
 
 typedef jboolean RMFS_BOOLEAN;
 
@@ -363,6 +366,12 @@ jint rmfsSearchBlockByPos(uchar *index, jint address);
 
 jint getUsedSpace();
 
+/*
+ * Incremented whenever a Data Block is allocated, freed, split, moved
+ * or gains data, so that per-file extent maps know when to rebuild
+ */
+extern jint rmfsBlockGeneration;
+
 jint getFreeSpace();
 
 #ifdef __cplusplus
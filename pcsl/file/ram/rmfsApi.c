@@ -61,9 +61,96 @@ extern "C"
 
 extern _RmfsDataBlockHdr rmfsDataBlockHdrArray[MAX_DATABLOCK_NUMBER];
 extern jint RmfsNameTableEnd;	/* End Address of RMFS Name Table Space */
+extern jint curDataBlockNum;
 
 _rmfsFileDes fileTab[MAX_OPEN_FILE_NUM];
 
+/**
+ * FUNCTION:      rmfsFindOpenFile()
+ * TYPE:          private operation
+ * OVERVIEW:      Find the Open File Table record of a file descriptor.
+ *                A descriptor is the index of its record in the table.
+ * INTERFACE:
+ *   parameters:  identifier:  file descriptor
+ *
+ *   returns:     index in the Open File Table; < 0 if the file isn't open
+ *                
+ */
+static jint rmfsFindOpenFile(jint identifier)
+{
+  if ((identifier < 0) || (identifier >= MAX_OPEN_FILE_NUM)
+      || (fileTab[identifier].handle != identifier)) {
+    return -1;
+  }
+
+  return identifier;
+}
+
+/**
+ * FUNCTION:      rmfsMapExtents()
+ * TYPE:          private operation
+ * OVERVIEW:      Rebuild the extent map of an open file if any Data Block
+ *                changed since it was built
+ * INTERFACE:
+ *   parameters:  fileDes:  Open File Table record
+ *
+ *   returns:     None
+ *                
+ */
+static void rmfsMapExtents(_rmfsFileDesPtr fileDes)
+{
+  jint i;
+  jint fileEnd = 0;
+
+  if (fileDes->extentGeneration == rmfsBlockGeneration) {
+    return;
+  }
+
+  fileDes->extentCount = 0;
+
+  for (i = 0; i < curDataBlockNum; i++) {
+    if ((rmfsDataBlockHdrArray[i].identifier == fileDes->nameID)
+	&& ((rmfsDataBlockHdrArray[i].flag & 0x01) == 0x01)) {
+      fileEnd += rmfsDataBlockHdrArray[i].dataSize;
+      fileDes->extentBlock[fileDes->extentCount] = (uchar) i;
+      fileDes->extentEnd[fileDes->extentCount] = fileEnd;
+      fileDes->extentCount++;
+    }
+  }
+
+  fileDes->extentGeneration = rmfsBlockGeneration;
+}
+
+/**
+ * FUNCTION:      rmfsFindExtent()
+ * TYPE:          private operation
+ * OVERVIEW:      Find the extent that holds the byte at a file offset
+ * INTERFACE:
+ *   parameters:  fileDes:  Open File Table record with a valid extent map
+ *                offset:   file offset
+ *
+ *   returns:     index in the extent map; < 0 if offset is past the data
+ *                
+ */
+static jint rmfsFindExtent(_rmfsFileDesPtr fileDes, jint offset)
+{
+  jint low = 0;
+  jint high = fileDes->extentCount;
+  jint middle;
+
+  /* The first extent that ends beyond offset */
+  while (low < high) {
+    middle = (low + high) / 2;
+    if (fileDes->extentEnd[middle] > offset) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  return (low < fileDes->extentCount) ? low : -1;
+}
+
 /**
  * FUNCTION:      initFileSystem()
  * TYPE:          public operation
@@ -160,6 +247,8 @@ void rmfsInitOpenFileTab()
     fileTab[i].nameID = 0;
     fileTab[i].offset = 0;
     fileTab[i].size = 0;
+    fileTab[i].extentGeneration = -1;
+    fileTab[i].extentCount = 0;
   }
 
 }
@@ -203,7 +292,7 @@ jint rmfsOpen(const char *filename, jint flags, jint creationMode)
     }
   }
 
-  if (fileIndex >= MAX_OPEN_FILE_NUM) {
+  if (fileIndex < 0) {
 #ifdef TRACE_DEBUG
     printf("Open too much file \n");
 #endif
@@ -212,6 +301,7 @@ jint rmfsOpen(const char *filename, jint flags, jint creationMode)
   }
 
   fileTab[fileIndex].handle = fileIndex;
+  fileTab[fileIndex].extentGeneration = -1;
 
   nameTabAddr = searchNameTabByString(filename, &(fileTab[fileIndex].nameID));
   if ((nameTabAddr < 0) || (fileTab[fileIndex].nameID == 0)) {
@@ -260,10 +350,10 @@ jint rmfsOpen(const char *filename, jint flags, jint creationMode)
 
     // fileTab[fileIndex].size = rmfsDataBlockHdrArray[i].dataSize;
 
-    fileTab[fileIndex].fileType = rmfsDataBlockHdrArray[i].flag & 0x3E;	/* Bit 5, 4, 3, 2, 1 */
-
     if (i == MAX_DATABLOCK_NUMBER) {
       fileTab[fileIndex].fileType = RMFS_NORMAL_FILE;
+    } else {
+      fileTab[fileIndex].fileType = rmfsDataBlockHdrArray[i].flag & 0x3E;	/* Bit 5, 4, 3, 2, 1 */
     }
 
     fileTab[fileIndex].offset = 0;
@@ -472,7 +562,6 @@ jint rmfsOpen(const char *filename, jint flags, jint creationMode)
 jint rmfsClose(jint identifier)
 {
     char fileType;
-  int i;
   signed short index = -1;
   jint nameTabAddr = 0;
   _RmfsNameTabHdrPtr nameTabHdr;
@@ -482,13 +571,7 @@ jint rmfsClose(jint identifier)
   printf("rmfsClose: identifier: %d \n", identifier);
 #endif
 
-  for (i = 0; i <= MAX_OPEN_FILE_NUM; i++) {
-    if (fileTab[i].handle == identifier) {
-      index = i;
-      break;
-    }
-
-  }
+  index = rmfsFindOpenFile(identifier);
 
   if (index < 0) {
     return -1;
@@ -603,14 +686,9 @@ jint rmfsWrite(jint identifier, void *buffer, jint size)
 #endif
   /* Search the File Open Table to find the matched record */
 
-  for (i = 0; i < MAX_OPEN_FILE_NUM; i++) {
-    if (fileTab[i].handle == identifier) {
-      fileIndex = i;
-      break;
-    }
-  }
+  fileIndex = rmfsFindOpenFile(identifier);
 
-  if (i >= MAX_OPEN_FILE_NUM) {
+  if (fileIndex < 0) {
     return -1;
   }
 
@@ -661,11 +739,13 @@ jint rmfsWrite(jint identifier, void *buffer, jint size)
 	  break;
 	}
       }
-      writeSize = remainSize;
-      remainSize = 0;
       prevBlockIndex = i;
     }
   }
+  if (blockIndex == -1) {
+    /* The rest goes to a new block after the last one of the file */
+    writeSize = remainSize;
+  }
 
 #ifdef TRACE_DEBUG
   tty->print_cr("offset: %d; filePos: %d, blockIndex: %d, prevBlock: %d \n",
@@ -742,91 +822,62 @@ jint rmfsWrite(jint identifier, void *buffer, jint size)
  */               
 jint rmfsRead(jint identifier, void *buffer, jint size)
 {
-  int i;
-  jint filePos = 0;
   jint fileIndex = -1;
-  jint blockIndex = -1;
+  jint extent;
   jint readSize = 0;
-  jint blockOffset = 0;
-  jint nextOffset = 0;
-  void *tempPos;
+  jint filePos;
+  jint blockOffset;
+  jint chunkSize;
+  _rmfsFileDesPtr fileDes;
 
 #ifdef TRACE_DEBUG
   printf("rmfsRead: identifer: %d, size: %d \n", identifier, size);
 #endif
   /* Search the File Open Table to find the matched record */
 
-  for (i = 0; i < MAX_OPEN_FILE_NUM; i++) {
-    if (fileTab[i].handle == identifier) {
-      fileIndex = i;
-      break;
-    }
-  }
+  fileIndex = rmfsFindOpenFile(identifier);
 
-  if (i >= MAX_OPEN_FILE_NUM) {
+  if (fileIndex < 0) {
     return -1;
   }
 
+  fileDes = &fileTab[fileIndex];
 
   /* If the file reach the end, stop and return 0 */
-  if (fileTab[fileIndex].offset >= fileTab[fileIndex].size) {
+  if (fileDes->offset >= fileDes->size) {
     return 0;
   }
 
-  for (i = 0; i < MAX_DATABLOCK_NUMBER; i++) {
-    if (rmfsDataBlockHdrArray[i].identifier == fileTab[fileIndex].nameID) {
-
-      filePos += rmfsDataBlockHdrArray[i].dataSize;
-
-      if (filePos > fileTab[fileIndex].offset) {
-	blockOffset =
-	    fileTab[fileIndex].offset - (filePos -
-					 rmfsDataBlockHdrArray[i].dataSize);
-
-	readSize = (filePos - fileTab[fileIndex].offset);
-
-	if (readSize >= size) {
-	  rmfsReadBlock(i, buffer, size, blockOffset);
-	} else {
-	  rmfsReadBlock(i, buffer, readSize, blockOffset);
-	  tempPos = (void *) ((jint) buffer + readSize);
-	}
-
-	blockIndex = i;
-
-	while (readSize < size) {
-	  nextOffset = rmfsDataBlockHdrArray[blockIndex].next;
-
-	  if ((rmfsSearchBlockByPos
-	       ((uchar*) &blockIndex, nextOffset)) < 0) {
-
-	    fileTab[fileIndex].offset += readSize;
-	    return readSize;
-	  }
+  if (size > fileDes->size - fileDes->offset) {
+    size = fileDes->size - fileDes->offset;
+  }
 
-	  readSize += rmfsDataBlockHdrArray[blockIndex].dataSize;
+  /* Locate the Data Block of the current position through the extent map */
+  rmfsMapExtents(fileDes);
 
-	  if (readSize >= size) {
-	    rmfsReadBlock(blockIndex, buffer,
-			  size - (readSize -
-				  rmfsDataBlockHdrArray
-				  [blockIndex].dataSize), 0);
-	    break;
-	  } else {
-	    rmfsReadBlock(blockIndex, buffer,
-			  rmfsDataBlockHdrArray[blockIndex].dataSize, 0);
-	    tempPos = (void *) ((jint) buffer + readSize);
-	  }
-	}
+  for (extent = rmfsFindExtent(fileDes, fileDes->offset);
+       (extent >= 0) && (extent < fileDes->extentCount) && (readSize < size);
+       extent++) {
+    filePos = fileDes->offset + readSize;
+    blockOffset = filePos -
+	((extent == 0) ? 0 : fileDes->extentEnd[extent - 1]);
+    chunkSize = fileDes->extentEnd[extent] - filePos;
 
-	fileTab[fileIndex].offset += size;
-	return size;
-      }
+    if (chunkSize > size - readSize) {
+      chunkSize = size - readSize;
+    }
 
+    if (rmfsReadBlock(fileDes->extentBlock[extent],
+		      (char *) buffer + readSize, chunkSize,
+		      blockOffset) < 0) {
+      break;
     }
+
+    readSize += chunkSize;
   }
 
-  return 0;
+  fileDes->offset += readSize;
+  return readSize;
 }
 
 /**
@@ -857,7 +908,6 @@ jint rmfsRead(jint identifier, void *buffer, jint size)
  */
 jint rmfsLseek(jint identifier, jint offset, jint whence)
 {
-  int i;
   int fileIndex = 0;
   int absoluteOff = 0;
 
@@ -872,23 +922,18 @@ jint rmfsLseek(jint identifier, jint offset, jint whence)
 
   /* Search the File Open Table to find the matched record */
 
-  for (i = 0; i < MAX_OPEN_FILE_NUM; i++) {
-    if (fileTab[i].handle == identifier) {
-      fileIndex = i;
-      break;
-    }
-  }
+  fileIndex = rmfsFindOpenFile(identifier);
 
-  if (i >= MAX_OPEN_FILE_NUM) {
+  if (fileIndex < 0) {
     return -1;
   }
 
   if (whence == PCSL_FILE_SEEK_SET) {
     absoluteOff = offset;
   } else if (whence == PCSL_FILE_SEEK_CUR) {
-    absoluteOff = offset + fileTab[i].offset;
+    absoluteOff = offset + fileTab[fileIndex].offset;
   } else if (whence == PCSL_FILE_SEEK_END) {
-    absoluteOff = offset + fileTab[i].size;
+    absoluteOff = offset + fileTab[fileIndex].size;
   }
 
   fileTab[fileIndex].offset = absoluteOff;
@@ -912,7 +957,6 @@ jint rmfsLseek(jint identifier, jint offset, jint whence)
  */
 jint rmfsFileSize(jint identifier)
 {
-    int i;
     int fileIndex = 0;
 
   /* Search the File Open Table to find the matched record */
@@ -920,14 +964,9 @@ jint rmfsFileSize(jint identifier)
 #ifdef TRACE_DEBUG
   printf("rmfsFileSize: identifer: %d \n", identifier);
 #endif
-  for (i = 0; i < MAX_OPEN_FILE_NUM; i++) {
-    if (fileTab[i].handle == identifier) {
-      fileIndex = i;
-      break;
-    }
-  }
+  fileIndex = rmfsFindOpenFile(identifier);
 
-  if (i >= MAX_OPEN_FILE_NUM) {
+  if (fileIndex < 0) {
     return -1;
   }
 
@@ -961,14 +1000,9 @@ jint rmfsTruncate(jint identifier, jint size)
 #ifdef TRACE_DEBUG
   printf("rmfsTruncate: identifer: %d size: %d\n", identifier, size);
 #endif
-  for (i = 0; i < MAX_OPEN_FILE_NUM; i++) {
-    if (fileTab[i].handle == identifier) {
-      fileIndex = i;
-      break;
-    }
-  }
+  fileIndex = rmfsFindOpenFile(identifier);
 
-  if (i >= MAX_OPEN_FILE_NUM) {
+  if (fileIndex < 0) {
     return -1;
   }
 
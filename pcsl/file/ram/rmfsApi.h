@@ -43,6 +43,7 @@
 #ifndef _RMFSAPI_H_
 #define _RMFSAPI_H_
 
+#include <rmfsAlloc.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,7 +57,15 @@ typedef char* DIR;
  */
 #define MAX_FILENAME_LENGTH 255 /* does not include the zero terminator */
 
-#define MAX_OPEN_FILE_NUM     (10)
+/**
+ * Number of files that can be open at the same time. Platforms that keep
+ * many record stores open can raise it with -DRMFS_MAX_OPEN_FILES=n.
+ */
+#ifndef RMFS_MAX_OPEN_FILES
+#define RMFS_MAX_OPEN_FILES   (10)
+#endif
+
+#define MAX_OPEN_FILE_NUM     RMFS_MAX_OPEN_FILES
 
 typedef struct rmfsFileDescriptor
 {
@@ -69,6 +78,16 @@ typedef struct rmfsFileDescriptor
     jboolean             flags;
     jboolean             createMode;
 
+    /*
+     * Extent map: the Data Blocks of the file in file order, and the
+     * file offset where each of them ends. Valid while extentGeneration
+     * equals rmfsBlockGeneration.
+     */
+    jint                 extentGeneration;
+    jint                 extentCount;
+    uchar                extentBlock[MAX_DATABLOCK_NUMBER];
+    jint                 extentEnd[MAX_DATABLOCK_NUMBER];
+
 } _rmfsFileDes, *_rmfsFileDesPtr;
 
 extern _rmfsFileDes   fileTab[MAX_OPEN_FILE_NUM];
@@ -147,6 +147,12 @@ int pcsl_file_commitwrite(void *handle)
 	return -1;
 }
 
+/* Force the data to stable storage */
+int pcsl_file_sync(void *handle)
+{
+	return -1;
+}
+
 
 /**
  * The rename function updates the filename.
@@ -457,6 +457,108 @@ int testFileReadWrite() {
 
 }
 
+/**
+ * Test reads that span several data blocks of one file. Writes to two
+ * files are interleaved so that each chunk of file1 lands in its own
+ * block, then file1 is read whole, from a position inside a block
+ * across the following block boundaries, and past the end of file.
+ */
+#define MB_CHUNKS     8
+#define MB_CHUNK_SIZE 1000
+
+static unsigned char mbPattern(int pos) {
+    return (unsigned char)((pos * 7 + pos / 251) & 0xff);
+}
+
+void testMultiBlockRead() {
+    void *handle1;
+    void *handle2;
+    unsigned char* chunk;
+    unsigned char* readBuffer;
+    int total = MB_CHUNKS * MB_CHUNK_SIZE;
+    int start = MB_CHUNK_SIZE + MB_CHUNK_SIZE / 2 + 3;
+    int i, j, n;
+    int mismatch;
+
+    chunk = pcsl_mem_malloc(MB_CHUNK_SIZE);
+    assertTrue("Failed to allocate chunk buffer", chunk != NULL);
+    if (chunk == NULL) {
+        return;
+    }
+    readBuffer = pcsl_mem_malloc(total + 16);
+    assertTrue("Failed to allocate read buffer", readBuffer != NULL);
+    if (readBuffer == NULL) {
+        pcsl_mem_free(chunk);
+        return;
+    }
+
+    pcsl_file_open(&file1, PCSL_FILE_O_RDWR | PCSL_FILE_O_TRUNC |
+                   PCSL_FILE_O_CREAT, &handle1);
+    pcsl_file_open(&file2, PCSL_FILE_O_RDWR | PCSL_FILE_O_TRUNC |
+                   PCSL_FILE_O_CREAT, &handle2);
+
+    for (i = 0; i < MB_CHUNKS; i++) {
+        for (j = 0; j < MB_CHUNK_SIZE; j++) {
+            chunk[j] = mbPattern(i * MB_CHUNK_SIZE + j);
+        }
+        n = pcsl_file_write(handle1, chunk, MB_CHUNK_SIZE);
+        assertTrue("Write failure", n == MB_CHUNK_SIZE);
+
+        /* Separate this chunk of file1 from the next one */
+        memset(chunk, 0x55, 100);
+        n = pcsl_file_write(handle2, chunk, 100);
+        assertTrue("Write failure", n == 100);
+    }
+    assertTrue("Wrong file size",
+               pcsl_file_sizeofopenfile(handle1) == total);
+
+    /* The whole file in one read */
+    pcsl_file_seek(handle1, 0, PCSL_FILE_SEEK_SET);
+    n = pcsl_file_read(handle1, readBuffer, total);
+    assertTrue("Whole file read failure", n == total);
+    for (mismatch = 0, i = 0; i < n; i++) {
+        if (readBuffer[i] != mbPattern(i)) {
+            mismatch = 1;
+            break;
+        }
+    }
+    assertTrue("Whole file read has wrong data", !mismatch);
+
+    /* From inside the second block across three boundaries */
+    pcsl_file_seek(handle1, start, PCSL_FILE_SEEK_SET);
+    n = pcsl_file_read(handle1, readBuffer, 3 * MB_CHUNK_SIZE);
+    assertTrue("Read across blocks failure", n == 3 * MB_CHUNK_SIZE);
+    for (mismatch = 0, i = 0; i < n; i++) {
+        if (readBuffer[i] != mbPattern(start + i)) {
+            mismatch = 1;
+            break;
+        }
+    }
+    assertTrue("Read across blocks has wrong data", !mismatch);
+    assertTrue("Wrong position after read",
+               pcsl_file_seek(handle1, 0, PCSL_FILE_SEEK_CUR) ==
+               start + 3 * MB_CHUNK_SIZE);
+
+    /* A read past the end stops at the end */
+    pcsl_file_seek(handle1, total - 10, PCSL_FILE_SEEK_SET);
+    n = pcsl_file_read(handle1, readBuffer, 16);
+    assertTrue("Read past end of file is not clamped", n == 10);
+    for (mismatch = 0, i = 0; i < 10; i++) {
+        if (readBuffer[i] != mbPattern(total - 10 + i)) {
+            mismatch = 1;
+            break;
+        }
+    }
+    assertTrue("Read at end of file has wrong data", !mismatch);
+
+    pcsl_file_close(handle1);
+    pcsl_file_close(handle2);
+    pcsl_file_unlink(&file1);
+    pcsl_file_unlink(&file2);
+    pcsl_mem_free(chunk);
+    pcsl_mem_free(readBuffer);
+}
+
 /**
  * Unit test framework entry point for this set of unit tests.
  *
@@ -478,6 +580,8 @@ void testFile_runTests() {
     status = testFileReadWrite();
     assertTrue("File test failed", (status != -1));
 
+    testMultiBlockRead();
+
     testSizeOf();
 
     testAvailableSpace(TOTALSIZE);
@@ -297,6 +297,12 @@ int pcsl_file_commitwrite(void *handle)
     return _commit((int)handle);
 }
 
+/* Force the data to stable storage */
+int pcsl_file_sync(void *handle)
+{
+    return _commit((int)handle);
+}
+
 
 /**
  * The rename function updates the filename.
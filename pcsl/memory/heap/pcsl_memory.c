@@ -44,6 +44,7 @@
  * <tr><td>free (value of 0 or 1)</td></tr>
  * <tr><td>reserved/<sup>[*]</sup>guardSize</td></tr>
  * <tr><td>size</td></tr>
+ * <tr><td>prevSize (size of the block just below this one)</td></tr>
  * <tr><td><sup>[*]</sup>filename</td></tr>
  * <tr><td><sup>[*]</sup>lineno</td></tr>
  * <tr><td>1 .. size</td></tr>
@@ -53,6 +54,16 @@
  * <p>Items that have the prefix <sup>[*]</sup> are only enabled if memory
  * tracing is enabled.
  *
+ * <p>The size and prevSize fields act as boundary tags: both physical
+ * neighbours of a block can be reached without walking the pool, so a
+ * freed block is coalesced with free neighbours immediately, in constant
+ * time. Free blocks are indexed through links kept in their payload.
+ * Blocks smaller than SMALL_LIMIT bytes sit in one list per 4-byte size
+ * class (an exact fit, or the next non-empty class found through a
+ * bitmap); larger blocks sit in a bitwise trie keyed by size, which gives
+ * the best fit in at most 32 steps. Per-class usage and fragmentation
+ * figures are reported by pcsl_mem_malloc_dump_impl0().
+ *
  * @warning This code is not thread safe.
  */
 
@@ -148,16 +159,14 @@ static void print_alloc(const char* what, const char* filename, int lineno) {
 #define PCSL_TRACE_MEMORY  0
 #endif 
 
-/**
- * If defined as non-zero, memory allocator will use best-fit algorithm.
- * If defined as zero, memory allocator will use first-fit algorithm.
- *
- * When first-fit algorithm is used, Java heap allocation can fail in SVM mode 
- * even though there is enough free memory in the pool (see CR 6735718).
- * This is because first-fit allocation cause bad fragmentation for allocation
- * request patterns typical for SVM mode.
+/*
+ * Free blocks keep the free list links (pointers) in their payload. Where
+ * pointers are 8 bytes the payload is aligned for them, so that the links
+ * are not accessed unaligned.
  */
-#define PCSL_BEST_FIT_ALLOCATION 1
+#if defined(_LP64) || defined(__LP64__) || defined(_WIN64)
+#define PCSL_MEM_POINTER_ALIGNMENT
+#endif
 
 /**
  * Structure to hold memory blocks
@@ -171,6 +180,10 @@ typedef struct _pcslMemStruct {
     char           reserved;
 #endif 
     unsigned int   size;                                    /* size of block */
+    unsigned int   prevSize;        /* size of the previous block in memory */
+#ifdef PCSL_MEM_POINTER_ALIGNMENT
+    unsigned int   pad;          /* keeps the payload 8-byte aligned, too */
+#endif
 #ifdef PCSL_DEBUG
     const char*    filename;         /* filename where allocation took place */
     unsigned int   lineno;        /* line number wehre allocation took place */
@@ -178,15 +191,48 @@ typedef struct _pcslMemStruct {
 #endif
 } _PcslMemHdr, *_PcslMemHdrPtr;
 
+/**
+ * Links stored in the payload of a free block. Blocks in the small
+ * size class lists only use next and prev; blocks in the large block
+ * trie use all fields. Large blocks of equal size share one trie node:
+ * the others are chained to it through next and prev with inTree == 0.
+ *
+ * Allocation uses best fit throughout. First fit was dropped because it
+ * fragments the pool badly for the allocation patterns typical for SVM
+ * mode, where Java heap allocation could fail even though there was
+ * enough free memory in the pool (see CR 6735718).
+ */
+typedef struct _pcslFreeStruct {
+    struct _pcslFreeStruct* next;
+    struct _pcslFreeStruct* prev;
+    struct _pcslFreeStruct* child[2];
+    struct _pcslFreeStruct* parent;
+    int                     inTree;
+} _PcslFreeBlock, *_PcslFreeBlockPtr;
+
+/**
+ * Usage counters kept for every size class
+ */
+typedef struct _pcslMemClassStruct {
+    unsigned int blocks;                         /* blocks currently in use */
+    unsigned int bytes;                           /* bytes currently in use */
+    unsigned int total;         /* allocations served since initialization */
+} _PcslMemClassStats;
+
 /*
  * Default size of pool usable for allocations; in bytes
  */
 #define DEFAULT_POOL_SIZE (8024*1024)
 
 /*
- * Byte boundary for word alignment
+ * Byte boundary for word alignment; pointer alignment where pointers are
+ * wider than a word
  */
+#ifdef PCSL_MEM_POINTER_ALIGNMENT
+#define ALIGNMENT     0x00000007
+#else
 #define ALIGNMENT     0x00000003                  /* Assumes word is 4-bytes */
+#endif
 
 /*
  * Constant to verify a header's validity
@@ -204,6 +250,41 @@ typedef struct _pcslMemStruct {
  */
 #define GUARD_SIZE    4
 
+/*
+ * Blocks below this size are kept in the per-class free lists
+ */
+#define SMALL_LIMIT   256
+
+/*
+ * Number of small size classes; each one is 4 bytes wide
+ */
+#define SMALL_CLASSES (SMALL_LIMIT >> 2)
+
+/*
+ * Size class of a block; all large blocks share the last class
+ */
+#define SIZE_CLASS(size) \
+    ((size) < SMALL_LIMIT ? (int)((size) >> 2) : SMALL_CLASSES)
+
+/*
+ * Smallest payload a block may have, so that it can hold the free list
+ * links once it is released
+ */
+#define MIN_BLOCK_SIZE \
+    ((sizeof(_PcslFreeBlockPtr) * 2 + ALIGNMENT) & ~ALIGNMENT)
+
+/*
+ * Navigation between a block header, its payload and its neighbours
+ */
+#define HDR_TO_FREE(hdr) \
+    ((_PcslFreeBlockPtr)((char*)(hdr) + sizeof(_PcslMemHdr)))
+#define FREE_TO_HDR(blk) \
+    ((_PcslMemHdrPtr)((char*)(blk) - sizeof(_PcslMemHdr)))
+#define NEXT_HDR(hdr) \
+    ((_PcslMemHdrPtr)((char*)(hdr) + sizeof(_PcslMemHdr) + (hdr)->size))
+#define PREV_HDR(hdr) \
+    ((_PcslMemHdrPtr)((char*)(hdr) - sizeof(_PcslMemHdr) - (hdr)->prevSize))
+
 #ifdef PCSL_MEMORY_USE_STATIC
 /* Cannot allocate dynamic memory on the phone. Use static array. */
 static char PcslMemory[DEFAULT_POOL_SIZE];       /* Where PCSL memory starts */
@@ -215,10 +296,43 @@ static char* PcslMemoryStart;                /* Aligned start of PCSL memory */
 static char* PcslMemoryEnd;                                 /* End of memory */
 
 static int PcslMemoryHighWaterMark;
-static int PcslMemoryAllocated;
+static int PcslMemoryAllocated;     /* Bytes in blocks that are in use */
+
+/* Heads of the small size class free lists */
+static _PcslFreeBlockPtr PcslSmallBlocks[SMALL_CLASSES];
+
+/* One bit per small size class, set while its list is not empty */
+static unsigned int PcslSmallBlockMap[(SMALL_CLASSES + 31) >> 5];
+
+/* Root of the large free block trie */
+static _PcslFreeBlockPtr PcslLargeBlocks;
+
+static _PcslMemClassStats PcslMemClassStats[SMALL_CLASSES + 1];
 
 static int pcsl_end_memory(int* count, int* size);
 
+/**
+ * FUNCTION:      block_size()
+ * TYPE:          private operation
+ * OVERVIEW:      Get the size of the block serving an allocation
+ * INTERFACE:
+ *   parameters:  size   number of bytes requested
+ *   returns:     the block size: aligned, with room for the tail guard
+ *                in debug builds and for the free list links
+ */
+static unsigned int
+block_size(unsigned int size) {
+#ifdef PCSL_DEBUG
+    size += GUARD_SIZE;
+#endif
+    size = (size + ALIGNMENT) & ~ALIGNMENT;
+    if (size < MIN_BLOCK_SIZE) {
+        /* the block must be able to hold the free list links later */
+        size = MIN_BLOCK_SIZE;
+    }
+    return size;
+}
+
 static int verify_tail_guard_data(_PcslMemHdrPtr pcslMemoryHdr);
 
 /**
@@ -270,6 +384,9 @@ pcsl_end_memory(int* count, int* size) {
 #endif 
 
         if (pcslMemoryHdr->free != 1) {
+            /* freeing may coalesce, so count the size of the leak first */
+            *count += 1;
+            *size  += pcslMemoryHdr->size;
 
 #ifdef PCSL_DEBUG
             report("WARNING: memory leak: size= %d  address= 0x%p\n",
@@ -279,14 +396,322 @@ pcsl_end_memory(int* count, int* size) {
                         pcslMemoryHdr->filename, pcslMemoryHdr->lineno);
 #endif
             pcsl_mem_free((void*)((char*)pcslMemoryHdr + sizeof(_PcslMemHdr)));
-            *count += 1;
-            *size  += pcslMemoryHdr->size;
         }
     }
     return *count;
 }
 
 
+/**
+ * @internal
+ *
+ * FUNCTION:      next_small_class()
+ * TYPE:          private operation
+ * OVERVIEW:      Find the first non-empty small size class at or above
+ *                 the given one
+ * INTERFACE:
+ *   parameters:  index   size class to start from
+ *   returns:     the size class found, or -1 if all of them are empty
+ *                
+ */
+static int
+next_small_class(int index) {
+    int          word = index >> 5;
+    unsigned int bits = PcslSmallBlockMap[word] & (~0U << (index & 31));
+
+    while (bits == 0) {
+        if (++word >= (int)(sizeof(PcslSmallBlockMap) / sizeof(unsigned int))) {
+            return -1;
+        }
+        bits = PcslSmallBlockMap[word];
+    }
+
+    for (index = word << 5; (bits & 1) == 0; bits >>= 1) {
+        index++;
+    }
+    return index;
+}
+
+/**
+ * @internal
+ *
+ * FUNCTION:      insert_large_block()
+ * TYPE:          private operation
+ * OVERVIEW:      Add a free block to the large block trie. Each level
+ *                 of the trie branches on the next bit of the size, most
+ *                 significant first, so it is never deeper than 32.
+ * INTERFACE:
+ *   parameters:  blk     free block links
+ *                size    size of the block
+ *   returns:     <nothing>
+ *                
+ */
+static void
+insert_large_block(_PcslFreeBlockPtr blk, unsigned int size) {
+    _PcslFreeBlockPtr* slot = &PcslLargeBlocks;
+    _PcslFreeBlockPtr  parent = NULL;
+    _PcslFreeBlockPtr  node;
+    unsigned int       bits = size;
+
+    blk->child[0] = NULL;
+    blk->child[1] = NULL;
+
+    while ((node = *slot) != NULL) {
+        if (FREE_TO_HDR(node)->size == size) {
+            /* chain behind the block of the same size already there */
+            blk->inTree = 0;
+            blk->parent = NULL;
+            blk->prev = node;
+            blk->next = node->next;
+            node->next->prev = blk;
+            node->next = blk;
+            return;
+        }
+        parent = node;
+        slot = &node->child[bits >> 31];
+        bits <<= 1;
+    }
+
+    blk->inTree = 1;
+    blk->parent = parent;
+    blk->next = blk;
+    blk->prev = blk;
+    *slot = blk;
+}
+
+/**
+ * @internal
+ *
+ * FUNCTION:      remove_large_block()
+ * TYPE:          private operation
+ * OVERVIEW:      Take a free block out of the large block trie
+ * INTERFACE:
+ *   parameters:  blk     free block links
+ *   returns:     <nothing>
+ *                
+ */
+static void
+remove_large_block(_PcslFreeBlockPtr blk) {
+    _PcslFreeBlockPtr  repl = NULL;
+    _PcslFreeBlockPtr* slot;
+
+    if (blk->next != blk) {
+        blk->prev->next = blk->next;
+        blk->next->prev = blk->prev;
+        if (!blk->inTree) {
+            return;
+        }
+        /* another block of the same size takes over the trie node */
+        repl = blk->next;
+    } else if (blk->child[0] != NULL || blk->child[1] != NULL) {
+        /* any leaf below the node shares its prefix and can replace it */
+        slot = &blk->child[blk->child[1] != NULL];
+        while ((*slot)->child[0] != NULL || (*slot)->child[1] != NULL) {
+            slot = &(*slot)->child[(*slot)->child[1] != NULL];
+        }
+        repl = *slot;
+        *slot = NULL;
+    }
+
+    if (blk->parent == NULL) {
+        PcslLargeBlocks = repl;
+    } else {
+        blk->parent->child[blk->parent->child[1] == blk] = repl;
+    }
+
+    if (repl != NULL) {
+        repl->inTree = 1;
+        repl->parent = blk->parent;
+        repl->child[0] = blk->child[0];
+        repl->child[1] = blk->child[1];
+        if (repl->child[0] != NULL) {
+            repl->child[0]->parent = repl;
+        }
+        if (repl->child[1] != NULL) {
+            repl->child[1]->parent = repl;
+        }
+    }
+}
+
+/**
+ * @internal
+ *
+ * FUNCTION:      find_large_block()
+ * TYPE:          private operation
+ * OVERVIEW:      Find the smallest block in the large block trie that
+ *                 can hold the given number of bytes
+ * INTERFACE:
+ *   parameters:  size    number of bytes needed
+ *   returns:     the best fitting block, or NULL if there is none
+ *                
+ */
+static _PcslFreeBlockPtr
+find_large_block(unsigned int size) {
+    _PcslFreeBlockPtr node = PcslLargeBlocks;
+    _PcslFreeBlockPtr best = NULL;
+    _PcslFreeBlockPtr larger = NULL;
+    unsigned int      bestSize = 0;
+    unsigned int      bits = size;
+    unsigned int      nodeSize;
+
+    /* follow the path of the size itself */
+    while (node != NULL) {
+        nodeSize = FREE_TO_HDR(node)->size;
+        if (nodeSize >= size && (best == NULL || nodeSize < bestSize)) {
+            best = node;
+            bestSize = nodeSize;
+            if (nodeSize == size) {
+                return best;
+            }
+        }
+        if ((bits >> 31) == 0 && node->child[1] != NULL) {
+            /* every size in there is larger; the deepest such is closest */
+            larger = node->child[1];
+        }
+        node = node->child[bits >> 31];
+        bits <<= 1;
+    }
+
+    /* the smallest size of a subtree lies on its leftmost path */
+    for (node = larger; node != NULL;
+         node = node->child[node->child[0] == NULL]) {
+        nodeSize = FREE_TO_HDR(node)->size;
+        if (best == NULL || nodeSize < bestSize) {
+            best = node;
+            bestSize = nodeSize;
+        }
+    }
+    return best;
+}
+
+/**
+ * @internal
+ *
+ * FUNCTION:      link_free_block()
+ * TYPE:          private operation
+ * OVERVIEW:      Mark a block free and add it to the free block index
+ * INTERFACE:
+ *   parameters:  pcslMemoryHdr   Pointer to memory block header
+ *   returns:     <nothing>
+ *                
+ */
+static void
+link_free_block(_PcslMemHdrPtr pcslMemoryHdr) {
+    _PcslFreeBlockPtr blk = HDR_TO_FREE(pcslMemoryHdr);
+    int               index;
+
+    pcslMemoryHdr->free = 1;
+#ifdef PCSL_DEBUG
+    pcslMemoryHdr->guardSize = 0;
+#endif
+
+    if (pcslMemoryHdr->size >= SMALL_LIMIT) {
+        insert_large_block(blk, pcslMemoryHdr->size);
+        return;
+    }
+
+    index = SIZE_CLASS(pcslMemoryHdr->size);
+    blk->prev = NULL;
+    blk->next = PcslSmallBlocks[index];
+    if (blk->next != NULL) {
+        blk->next->prev = blk;
+    }
+    PcslSmallBlocks[index] = blk;
+    PcslSmallBlockMap[index >> 5] |= 1U << (index & 31);
+}
+
+/**
+ * @internal
+ *
+ * FUNCTION:      unlink_free_block()
+ * TYPE:          private operation
+ * OVERVIEW:      Remove a free block from the free block index
+ * INTERFACE:
+ *   parameters:  pcslMemoryHdr   Pointer to memory block header
+ *   returns:     <nothing>
+ *                
+ */
+static void
+unlink_free_block(_PcslMemHdrPtr pcslMemoryHdr) {
+    _PcslFreeBlockPtr blk = HDR_TO_FREE(pcslMemoryHdr);
+    int               index;
+
+    if (pcslMemoryHdr->size >= SMALL_LIMIT) {
+        remove_large_block(blk);
+        return;
+    }
+
+    index = SIZE_CLASS(pcslMemoryHdr->size);
+    if (blk->next != NULL) {
+        blk->next->prev = blk->prev;
+    }
+    if (blk->prev != NULL) {
+        blk->prev->next = blk->next;
+    } else if ((PcslSmallBlocks[index] = blk->next) == NULL) {
+        PcslSmallBlockMap[index >> 5] &= ~(1U << (index & 31));
+    }
+}
+
+/**
+ * @internal
+ *
+ * FUNCTION:      release_block()
+ * TYPE:          private operation
+ * OVERVIEW:      Return a block that is in use to the free block index,
+ *                 coalescing it with the free blocks next to it
+ * INTERFACE:
+ *   parameters:  pcslMemoryHdr   Pointer to memory block header
+ *   returns:     <nothing>
+ *                
+ */
+static void
+release_block(_PcslMemHdrPtr pcslMemoryHdr) {
+    _PcslMemHdrPtr      nextHdr = NEXT_HDR(pcslMemoryHdr);
+    _PcslMemHdrPtr      prevHdr;
+    _PcslMemClassStats* stats = &PcslMemClassStats[
+                                    SIZE_CLASS(pcslMemoryHdr->size)];
+
+    stats->blocks--;
+    stats->bytes -= pcslMemoryHdr->size;
+    PcslMemoryAllocated -= pcslMemoryHdr->size;
+
+    /*
+     * A header absorbed into its neighbour keeps its magic, its size and
+     * free == 1, so that a second free of it is still reported and
+     * pcsl_end_memory() can step over it.
+     */
+    pcslMemoryHdr->free = 1;
+
+    if ((char*)nextHdr < PcslMemoryEnd && nextHdr->free == 1) {
+        unlink_free_block(nextHdr);
+        pcslMemoryHdr->size += nextHdr->size + sizeof(_PcslMemHdr);
+#if PCSL_TRACE_MEMORY
+        REPORT2("DEBUG: Coalescing blocks 0x%p and 0x%p\n",
+                pcslMemoryHdr, nextHdr);
+#endif
+    }
+
+    if ((char*)pcslMemoryHdr > PcslMemoryStart) {
+        prevHdr = PREV_HDR(pcslMemoryHdr);
+        if (prevHdr->free == 1) {
+            unlink_free_block(prevHdr);
+            prevHdr->size += pcslMemoryHdr->size + sizeof(_PcslMemHdr);
+#if PCSL_TRACE_MEMORY
+            REPORT2("DEBUG: Coalescing blocks 0x%p and 0x%p\n",
+                    prevHdr, pcslMemoryHdr);
+#endif
+            pcslMemoryHdr = prevHdr;
+        }
+    }
+
+    nextHdr = NEXT_HDR(pcslMemoryHdr);
+    if ((char*)nextHdr < PcslMemoryEnd) {
+        nextHdr->prevSize = pcslMemoryHdr->size;
+    }
+    link_free_block(pcslMemoryHdr);
+}
+
+
 /**
  * FUNCTION:      pcsl_mem_initialize_impl0()
  * TYPE:          public operation
@@ -322,10 +747,12 @@ pcsl_mem_initialize_impl0(void *startAddr, int size) {
 #ifndef PCSL_MEMORY_USE_STATIC
 
         /* allocate the chunk of memory to C heap */
-        PcslMemory = (char*)pcsl_heap_allocate_port(size,&size);
+        long allocatedSize;
+        PcslMemory = (char*)pcsl_heap_allocate_port(size, &allocatedSize);
         if (PcslMemory == NULL) {
             return -1;
         }
+        size = (int)allocatedSize;
 
 #endif /* ! PCSL_MEMORY_USE_STATIC */
     }
@@ -338,15 +765,22 @@ pcsl_mem_initialize_impl0(void *startAddr, int size) {
         PcslMemoryStart++;
     }
 
+    memset(PcslSmallBlocks, 0, sizeof(PcslSmallBlocks));
+    memset(PcslSmallBlockMap, 0, sizeof(PcslSmallBlockMap));
+    PcslLargeBlocks = NULL;
+    memset(PcslMemClassStats, 0, sizeof(PcslMemClassStats));
+    PcslMemoryAllocated = 0;
+    PcslMemoryHighWaterMark = 0;
+
     pcslMemoryHdr = (_PcslMemHdrPtr)PcslMemoryStart;
     pcslMemoryHdr->magic = MAGIC;
-    pcslMemoryHdr->free  = 1;
-    pcslMemoryHdr->size  = (PcslMemory - PcslMemoryStart)
-                           + size - sizeof(_PcslMemHdr);
+    pcslMemoryHdr->size  = ((PcslMemory - PcslMemoryStart)
+                            + size - sizeof(_PcslMemHdr)) & ~ALIGNMENT;
+    pcslMemoryHdr->prevSize = 0;
 #ifdef PCSL_DEBUG
     pcslMemoryHdr->guard = GUARD_WORD;
-    pcslMemoryHdr->guardSize = 0;
 #endif
+    link_free_block(pcslMemoryHdr);
     return 0;
 }
 
@@ -404,107 +838,72 @@ pcsl_mem_malloc_impl0(unsigned int size) {
 #endif
     unsigned int   numBytesToAllocate = size;
     void*          loc     = NULL;
-    _PcslMemHdrPtr tempHdr = NULL;
-    char*          temp    = NULL;
-    char*          pcslMemoryPtr;
-    _PcslMemHdrPtr pcslMemoryHdr;
-    _PcslMemHdrPtr fitBlockHdr = NULL;
+    int            index;
+    _PcslMemHdrPtr pcslMemoryHdr = NULL;
+    _PcslFreeBlockPtr fitBlock = NULL;
+    _PcslMemClassStats* stats;
 
 #ifdef PCSL_DEBUG
     int   guardSize = 0;
     void* guardPos = NULL;
     int   i = 0;
-    numBytesToAllocate += GUARD_SIZE;
 #endif
 
-    while ( (numBytesToAllocate & ALIGNMENT) != 0 ) {
-        numBytesToAllocate++;
+    numBytesToAllocate = block_size(size);
+
+    /* find the best fit: small size classes first, then the large blocks */
+    if (numBytesToAllocate < SMALL_LIMIT) {
+        index = next_small_class(SIZE_CLASS(numBytesToAllocate));
+        if (index >= 0) {
+            fitBlock = PcslSmallBlocks[index];
+        }
+    }
+    if (fitBlock == NULL) {
+        fitBlock = find_large_block(numBytesToAllocate);
     }
 
-    /* find a free slot */
-    for (pcslMemoryPtr = PcslMemoryStart;
-         pcslMemoryPtr < PcslMemoryEnd;
-         pcslMemoryPtr += pcslMemoryHdr->size + sizeof(_PcslMemHdr)) {
-        
-        pcslMemoryHdr = (_PcslMemHdrPtr)pcslMemoryPtr;
-        if (pcslMemoryHdr->magic != MAGIC) {
-            REPORT1("ERROR: Memory corruption at 0x%p\n", pcslMemoryPtr); 
-            return((void *) 0);
-        } else {
-            while ( 1 ) {
-                /* coalescing */
-                if (pcslMemoryHdr->free == 1) {
-                    /* if current block is free */
-                    temp = (char*)pcslMemoryHdr;
-                    temp += pcslMemoryHdr->size + sizeof(_PcslMemHdr);
-                    tempHdr = (_PcslMemHdrPtr)temp;
-
-                    if ((temp < PcslMemoryEnd) && 
-                        (tempHdr->free == 1) && (tempHdr->magic == MAGIC)) {
-                        /* and the next block is free too */
-                        /* then coalesce */
-                        pcslMemoryHdr->size += tempHdr->size
-                            + sizeof(_PcslMemHdr);
-#ifdef PCSL_DEBUG
-                        pcslMemoryHdr->guardSize = 0;
-#if PCSL_TRACE_MEMORY
-                        REPORT2("DEBUG: Coalescing blocks 0x%p and 0x%p\n",
-                                pcslMemoryHdr, tempHdr);
-#endif 
-#endif
+    if (fitBlock != NULL) {
+      pcslMemoryHdr = FREE_TO_HDR(fitBlock);
+      if (pcslMemoryHdr->magic != MAGIC || pcslMemoryHdr->free != 1) {
+        REPORT1("ERROR: Memory corruption at 0x%p\n", pcslMemoryHdr);
+        return((void *) 0);
+      }
+      unlink_free_block(pcslMemoryHdr);
 
-                    } else {
-                        break;
-                    }
-                } else {
-                    break;
-                }
-            } /* while */
-
-            /* allocating */
-            if ((pcslMemoryHdr->free == 1) && 
-                (pcslMemoryHdr->size >= numBytesToAllocate)) {
-#if PCSL_BEST_FIT_ALLOCATION
-	      /* Keep looking for the best fit */
-	      if (fitBlockHdr == NULL || 
-		  fitBlockHdr->size > pcslMemoryHdr->size) {
-		fitBlockHdr = pcslMemoryHdr;
-		/* Found exact match */
-		if (pcslMemoryHdr->size == numBytesToAllocate) {
-		  break;
-		}
-	      }
-#else
-	      fitBlockHdr = pcslMemoryHdr;
-	      break;
-#endif
-            } /* end of allocating */
-        } /* end of else */
-    } /* end of for */
-
-    if (fitBlockHdr != NULL) {
-      pcslMemoryHdr = fitBlockHdr;
-      if (pcslMemoryHdr->size > (numBytesToAllocate 
-				 + sizeof(_PcslMemHdr) + 4)) {
+      if (pcslMemoryHdr->size >= (numBytesToAllocate 
+				  + sizeof(_PcslMemHdr) + MIN_BLOCK_SIZE)) {
 	/* split block */
 	_PcslMemHdrPtr nextHdr;
 	nextHdr = (_PcslMemHdrPtr)((char *)pcslMemoryHdr
 				   + numBytesToAllocate
 				   + sizeof(_PcslMemHdr));
 	nextHdr->magic = MAGIC;
-	nextHdr->free = 1;
 	nextHdr->size = pcslMemoryHdr->size 
 	  - numBytesToAllocate 
 	  - sizeof(_PcslMemHdr);
+	nextHdr->prevSize = numBytesToAllocate;
 #ifdef PCSL_DEBUG
 	nextHdr->guard    = GUARD_WORD;
-	nextHdr->guardSize = 0;
 #endif
 	pcslMemoryHdr->size     = numBytesToAllocate;
+	if ((char*)NEXT_HDR(nextHdr) < PcslMemoryEnd) {
+	  NEXT_HDR(nextHdr)->prevSize = nextHdr->size;
+	}
+	link_free_block(nextHdr);
       }
       pcslMemoryHdr->free     = 0;
       loc = (void*)((char*)pcslMemoryHdr + sizeof(_PcslMemHdr));
 
+      stats = &PcslMemClassStats[SIZE_CLASS(pcslMemoryHdr->size)];
+      stats->blocks++;
+      stats->bytes += pcslMemoryHdr->size;
+      stats->total++;
+
+      PcslMemoryAllocated += pcslMemoryHdr->size;
+      if (PcslMemoryAllocated > PcslMemoryHighWaterMark) {
+	PcslMemoryHighWaterMark = PcslMemoryAllocated;
+      }
+
 #ifdef PCSL_DEBUG
       pcslMemoryHdr->guard    = GUARD_WORD;      /* Add head guard */
       pcslMemoryHdr->filename = filename;
@@ -520,10 +919,6 @@ pcsl_mem_malloc_impl0(unsigned int size) {
 	((unsigned char*)guardPos)[i] = GUARD_BYTE;
       }
                 
-      PcslMemoryAllocated += numBytesToAllocate;
-      if (PcslMemoryAllocated > PcslMemoryHighWaterMark) {
-	PcslMemoryHighWaterMark = PcslMemoryAllocated;
-      }
 #if PCSL_TRACE_MEMORY
       report("DEBUG: Requested %d provided %d at 0x%p\n",
 	     numBytesToAllocate, pcslMemoryHdr->size, loc);
@@ -707,7 +1102,7 @@ pcsl_mem_free_impl0(void *ptr, const char *filename, int lineno) {
     if (ptr == NULL) {
         report("WARNING: Attempt to free NULL pointer\n");
         print_alloc("freed", filename, lineno);
-    } else if (((char*)ptr > PcslMemoryEnd) || 
+    } else if (((char*)ptr >= PcslMemoryEnd + sizeof(_PcslMemHdr)) ||
                ((char*)ptr < PcslMemoryStart)) {
         report("ERROR: Attempt to free memory out of scope: 0x%p\n", ptr);
         print_alloc("freed", filename, lineno);
@@ -720,7 +1115,6 @@ pcsl_mem_free_impl0(void *ptr, const char *filename, int lineno) {
             report("ERROR: Attempt to free memory twice: 0x%p\n", ptr);
             print_alloc("freed", filename, lineno);
         } else {
-            PcslMemoryAllocated -= pcslMemoryHdr->size;
             /* The memory block header is valid, now check the guard data */
             if (pcslMemoryHdr->guard != GUARD_WORD) {
                 report("ERROR: Possible memory underrun: 0x%p\n", ptr);
@@ -743,7 +1137,7 @@ pcsl_mem_free_impl0(void *ptr, const char *filename, int lineno) {
             print_alloc("freed", filename, lineno);
 #endif 
 
-            pcslMemoryHdr->free = 1;
+            release_block(pcslMemoryHdr);
         }
     } /* end of else */
 }
@@ -755,14 +1149,14 @@ pcsl_mem_free_impl0(void *ptr) {
     _PcslMemHdrPtr pcslMemoryHdr;
 
     if (ptr == NULL) {
-    } else if (((char*)ptr > PcslMemoryEnd) || 
+    } else if (((char*)ptr >= PcslMemoryEnd + sizeof(_PcslMemHdr)) ||
                ((char*)ptr < PcslMemoryStart)) {
     } else {
         pcslMemoryHdr = (_PcslMemHdrPtr)((char*)ptr -sizeof(_PcslMemHdr));
         if (pcslMemoryHdr->magic != MAGIC) {
         } else if (pcslMemoryHdr->free != 0) {
         } else {
-            pcslMemoryHdr->free = 1;
+            release_block(pcslMemoryHdr);
         }
     } /* end of else */
 }
@@ -828,9 +1222,9 @@ pcsl_mem_get_total_heap_impl0() {
  */
 int
 pcsl_mem_get_free_heap_impl0() {
+#ifdef PCSL_DEBUG
     _PcslMemHdrPtr pcslMemoryHdr;
     char*          pcslMemoryPtr;
-    int            size = 0;
 
     for (pcslMemoryPtr = PcslMemoryStart; 
          pcslMemoryPtr < PcslMemoryEnd;
@@ -838,7 +1232,6 @@ pcsl_mem_get_free_heap_impl0() {
 
         pcslMemoryHdr = (_PcslMemHdrPtr)pcslMemoryPtr;
 
-#ifdef PCSL_DEBUG
         if (pcslMemoryHdr->magic != MAGIC) {
             report("ERROR: Corrupted start of memory header: 0x%p\n", 
                    pcslMemoryPtr);
@@ -858,17 +1251,38 @@ pcsl_mem_get_free_heap_impl0() {
                         pcslMemoryHdr->filename, 
                         pcslMemoryHdr->lineno);
         }
+    }
 #endif
 
-        if (pcslMemoryHdr->free != 1) {
-            size += pcslMemoryHdr->size;
-        }
-    }
-    return (pcsl_mem_get_total_heap_impl0() - size);
+    return (pcsl_mem_get_total_heap_impl0() - PcslMemoryAllocated);
 }
 
 
 /* Set countMemoryLeaksOnly = 0 in order to get more verbose information */
+/**
+ * FUNCTION:      pcsl_mem_get_class_stats_impl0()
+ * TYPE:          public operation
+ * OVERVIEW:      Get the usage counters of the size class serving
+ *                allocations of the given size
+ * INTERFACE:
+ *   parameters:  size         number of bytes of an allocation
+ *                blocks       where to store the blocks in use
+ *                bytes        where to store the bytes in use
+ *                allocations  where to store the allocations served
+ *   returns:     0
+ */
+int
+pcsl_mem_get_class_stats_impl0(unsigned int size, int* blocks, int* bytes,
+                               int* allocations) {
+    _PcslMemClassStats* stats =
+        &PcslMemClassStats[SIZE_CLASS(block_size(size))];
+
+    *blocks = stats->blocks;
+    *bytes = stats->bytes;
+    *allocations = stats->total;
+    return 0;
+}
+
 int pcsl_mem_malloc_dump_impl0(int countMemoryLeaksOnly)
 {
     char *localpcslMallocMemPtr = NULL;
@@ -877,6 +1291,10 @@ int pcsl_mem_malloc_dump_impl0(int countMemoryLeaksOnly)
     _PcslMemHdrPtr localpcslMallocMemHdr = NULL;
 
     int numberOfAllocatedBlocks = 0;
+    int numberOfFreeBlocks = 0;
+    int freeBytes = 0;
+    int largestFreeBlock = 0;
+    int i;
 
     REPORT3("PcslMemory=0x%p PcslMemoryStart=0x%p PcslMemoryEnd=0x%p\n", 
             PcslMemory, PcslMemoryStart, PcslMemoryEnd);
@@ -901,7 +1319,13 @@ int pcsl_mem_malloc_dump_impl0(int countMemoryLeaksOnly)
                                  sizeof(_PcslMemHdr)));
             }
 
-            if (localpcslMallocMemHdr->free != 1) {
+            if (localpcslMallocMemHdr->free == 1) {
+                numberOfFreeBlocks += 1;
+                freeBytes += localpcslMallocMemHdr->size;
+                if ((int)localpcslMallocMemHdr->size > largestFreeBlock) {
+                    largestFreeBlock = localpcslMallocMemHdr->size;
+                }
+            } else {
                 numberOfAllocatedBlocks += 1;
 #ifdef PCSL_DEBUG
                 report("WARNING: memory leak: size=%d  address=0x%p\n",
@@ -915,5 +1339,33 @@ int pcsl_mem_malloc_dump_impl0(int countMemoryLeaksOnly)
             }
         }
     }
+
+    if (countMemoryLeaksOnly == 0) {
+        for (i = 0; i <= SMALL_CLASSES; i++) {
+            if (PcslMemClassStats[i].total == 0) {
+                continue;
+            }
+            if (i < SMALL_CLASSES) {
+                REPORT4("class %d: in use=%d bytes=%d allocations=%d\n",
+                        i << 2, PcslMemClassStats[i].blocks,
+                        PcslMemClassStats[i].bytes,
+                        PcslMemClassStats[i].total);
+            } else {
+                REPORT4("class %d+: in use=%d bytes=%d allocations=%d\n",
+                        SMALL_LIMIT, PcslMemClassStats[i].blocks,
+                        PcslMemClassStats[i].bytes,
+                        PcslMemClassStats[i].total);
+            }
+        }
+
+        /*
+         * Fragmentation is the share of free memory that cannot be
+         * handed out as one block.
+         */
+        REPORT4("free blocks=%d bytes=%d largest=%d fragmentation=%d%%\n",
+                numberOfFreeBlocks, freeBytes, largestFreeBlock,
+                freeBytes == 0 ? 0 :
+                (int)(100 - (largestFreeBlock * 100.0) / freeBytes));
+    }
     return numberOfAllocatedBlocks;
 }
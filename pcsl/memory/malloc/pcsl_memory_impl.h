@@ -104,6 +104,11 @@ extern "C" {
  */
 #define pcsl_mem_malloc_dump_impl(x) (-1)
 
+/**
+ * Gets the usage counters of a size class; not available.
+ */
+#define pcsl_mem_get_class_stats_impl(s, bl, by, a) (-1)
+
 #ifdef __cplusplus
 }
 #endif
@@ -151,6 +151,19 @@ extern "C" {
  *
  * <b>int pcsl_mem_malloc_dump(int countMemoryLeaksOnly); </b>
  *
+ * Gets the usage counters of the size class that serves allocations of
+ * the given size.
+ *
+ * @param  size         number of bytes of an allocation
+ * @param  blocks       receives the number of blocks in use in the class
+ * @param  bytes        receives the number of bytes in use in the class
+ * @param  allocations  receives the number of allocations the class served
+ *
+ * @return  0 on success, or -1 if the information is not available
+ *
+ * <b>int pcsl_mem_get_class_stats(unsigned int size, int* blocks,
+ *                                 int* bytes, int* allocations); </b>
+ *
  * Allocate a memory chunk that can be shrunk, or expanded (up to max_size)
  * The returned pointer is <alignment>-bytes aligned.
  *
@@ -259,6 +272,14 @@ extern "C" {
  */
 #define pcsl_mem_malloc_dump(x)  pcsl_mem_malloc_dump_impl((x))
 
+/**
+ * Gets the usage counters of the size class that serves allocations
+ * of the given size.
+ *
+ */
+#define pcsl_mem_get_class_stats(s, bl, by, a) \
+    pcsl_mem_get_class_stats_impl((s), (bl), (by), (a))
+
 
 /**
  * Allocate a memory chunk that can be shrunk, or expanded (up to max_size)
@@ -147,6 +147,17 @@ int pcsl_mem_malloc_dump_impl0(int countMemoryLeaksOnly) {
     return -1;
 }
 
+/**
+ * Gets the usage counters of the size class that serves allocations
+ * of the given size.
+ *
+ * @return 0 on success, or -1 if the information is not available
+ */
+int pcsl_mem_get_class_stats_impl0(unsigned int size, int* blocks, int* bytes,
+                                   int* allocations) {
+    return -1;
+}
+
 /**
  * Allocates memory from the private PCSL memory pool.
  *
@@ -82,6 +82,20 @@ extern int   pcsl_mem_get_free_heap_impl0();
  */
 int pcsl_mem_malloc_dump_impl0(int countMemoryLeaksOnly);
 
+/**
+ * Gets the usage counters of the size class that serves allocations
+ * of the given size.
+ *
+ * @param size number of bytes of an allocation
+ * @param blocks receives the number of blocks in use in the class
+ * @param bytes receives the number of bytes in use in the class
+ * @param allocations receives the number of allocations the class served
+ *
+ * @return 0 on success, or -1 if the information is not available
+ */
+int pcsl_mem_get_class_stats_impl0(unsigned int size, int* blocks, int* bytes,
+                                   int* allocations);
+
 /**
  * Allocates memory from the private PCSL memory pool.
  * 
@@ -139,6 +153,8 @@ extern void  pcsl_mem_free_impl0(void*);
 #define pcsl_mem_get_total_heap_impl()  pcsl_mem_get_total_heap_impl0()
 #define pcsl_mem_get_free_heap_impl()  pcsl_mem_get_free_heap_impl0()
 #define pcsl_mem_malloc_dump_impl(x)	 pcsl_mem_malloc_dump_impl0((x))
+#define pcsl_mem_get_class_stats_impl(s, bl, by, a) \
+    pcsl_mem_get_class_stats_impl0((s), (bl), (by), (a))
 
 /**
  * Allocates the given number of bytes from the private PCSL memory
@@ -31,6 +31,19 @@
 #define CHECK_WRITE     0x02
 #define CHECK_EXCEPTION 0x04
 
+/**
+ * Besides the list of registered socket handles, Linux builds keep the
+ * registered sockets in a persistent epoll set, so the event loop does not
+ * have to rebuild descriptor sets from the list on every check.
+ */
+#ifndef PCSL_SOCKET_EPOLL
+#ifdef __linux__
+#define PCSL_SOCKET_EPOLL 1
+#else
+#define PCSL_SOCKET_EPOLL 0
+#endif
+#endif
+
 /** SocketHandle data structure stores details about blocking sockets */
 typedef struct _SocketHandle {
   int fd;                       /* The socket that returned EWOULDBLOCK */
@@ -43,6 +56,16 @@ typedef struct _SocketHandle {
  *  @return pointer to head of socket handles list or NULL if empty
  */
 const SocketHandle* GetRegisteredSocketHandles();
+
+#if PCSL_SOCKET_EPOLL
+/** Get epoll descriptor watching the sockets registered for read/write.
+ *  The sockets are added when they are registered for the first check and
+ *  removed when they are unregistered or destroyed, each event carries the
+ *  SocketHandle pointer in its data.ptr field.
+ *  @return epoll descriptor or -1 if it could not be created
+ */
+int GetSocketEventsFd();
+#endif
  
 #endif
 
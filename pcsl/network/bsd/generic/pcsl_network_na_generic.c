@@ -35,6 +35,10 @@
 #include <pcsl_network_na.h>
 #include <pcsl_memory.h>
 
+#if PCSL_SOCKET_EPOLL
+#include <sys/epoll.h>
+#endif
+
 /** Note: We are guaranteed by Protocol Java code that there are no 2
  *  threads performing the same action on the socket, i.e. only one
  *  thread can be registered for reading, so well for writing.
@@ -48,6 +52,67 @@
 /** List of socket handles registered for read/write checks */
 static SocketHandle* rootSocketHandle = NULL;
 
+#if PCSL_SOCKET_EPOLL
+/** Epoll set of the sockets registered for read/write checks */
+static int socketEventsFd = -1;
+
+/** Set once creation of the epoll set has failed, not to retry it */
+static int socketEventsFailed = 0;
+
+/** Create the epoll set on first use */
+static int getSocketEventsFd() {
+    if (socketEventsFd == -1 && !socketEventsFailed) {
+        socketEventsFd = epoll_create(16);
+        if (socketEventsFd == -1) {
+            socketEventsFailed = 1;
+        }
+    }
+    return socketEventsFd;
+}
+
+/**
+ * Bring the epoll registration of a socket in line with its new check flags.
+ * Sockets nobody waits for are kept out of the set, otherwise a hung up
+ * peer would wake the event loop until the socket is closed.
+ */
+static void updateSocketEvents(SocketHandle* handle,
+                               int old_flags, int new_flags) {
+    struct epoll_event event;
+    int epfd = getSocketEventsFd();
+
+    if (epfd == -1 || old_flags == new_flags) {
+        return;
+    }
+
+    event.events = EPOLLPRI;
+    if (new_flags & CHECK_READ) {
+        event.events |= EPOLLIN;
+    }
+    if (new_flags & CHECK_WRITE) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.ptr = handle;
+
+    if (new_flags == 0) {
+        /* The descriptor may be already closed, ignore the result */
+        (void)epoll_ctl(epfd, EPOLL_CTL_DEL, handle->fd, &event);
+    } else if (old_flags == 0) {
+        (void)epoll_ctl(epfd, EPOLL_CTL_ADD, handle->fd, &event);
+    } else {
+        (void)epoll_ctl(epfd, EPOLL_CTL_MOD, handle->fd, &event);
+    }
+}
+
+/**
+ * See pcsl_network_generic.h for definition.
+ */
+int GetSocketEventsFd() {
+    return getSocketEventsFd();
+}
+#else
+#define updateSocketEvents(handle, old_flags, new_flags)
+#endif /* PCSL_SOCKET_EPOLL */
+
 /** We need this method to unblock threads waiting for socket being destroyed */
 extern void NotifySocketStatusChanged(long handle, int waitingFor);
 
@@ -117,8 +182,10 @@ int na_get_fd(void *handle) {
 void na_register_for_read(void *handle) {
     if (handle != NULL) {
         SocketHandle *sh = SOCKET_HANDLE(handle);
+        int old_flags = sh->check_flags;
         sh->check_flags |= CHECK_READ;
         addSocketHandle(sh);
+        updateSocketEvents(sh, old_flags, sh->check_flags);
     }
 }
 
@@ -128,8 +195,10 @@ void na_register_for_read(void *handle) {
 void na_register_for_write(void *handle) {
     if (handle != NULL) {
         SocketHandle *sh = SOCKET_HANDLE(handle);
+        int old_flags = sh->check_flags;
         sh->check_flags |= CHECK_WRITE;
         addSocketHandle(sh);
+        updateSocketEvents(sh, old_flags, sh->check_flags);
     }
 }
 
@@ -139,10 +208,12 @@ void na_register_for_write(void *handle) {
 void na_unregister_for_read(void *handle) {
     if (handle != NULL) {
         SocketHandle *sh = SOCKET_HANDLE(handle);
+        int old_flags = sh->check_flags;
         sh->check_flags &= ~CHECK_READ;
         if (sh->check_flags == 0) {
             removeSocketHandle(sh);
         }
+        updateSocketEvents(sh, old_flags, sh->check_flags);
     }
 }
 
@@ -152,10 +223,12 @@ void na_unregister_for_read(void *handle) {
 void na_unregister_for_write(void *handle) {
     if (handle != NULL) {
         SocketHandle *sh = SOCKET_HANDLE(handle);
+        int old_flags = sh->check_flags;
         sh->check_flags &= ~CHECK_WRITE;
         if (sh->check_flags == 0) {
             removeSocketHandle(sh);
         }
+        updateSocketEvents(sh, old_flags, sh->check_flags);
     }
 }
 
@@ -179,6 +252,7 @@ void na_destroy(void *handle) {
 
         /* Still registered readers/writers should be unblocked */
         if (sh->check_flags != 0) {
+            updateSocketEvents(sh, sh->check_flags, 0);
             sh->status = PCSL_NET_INTERRUPTED;
             if (sh->check_flags & CHECK_READ) {
                 NotifySocketStatusChanged((long)handle, SD_RECV);
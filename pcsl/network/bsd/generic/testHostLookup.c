@@ -0,0 +1,258 @@
+/*
+ *   
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <pcsl_memory.h>
+#include <pcsl_network.h>
+#include <donuts.h>
+
+/** Seconds to wait for a helper thread */
+#define LOOKUP_TIMEOUT 10
+
+/* Provided by the host of the notifier, sockets are not used here */
+void NotifySocketStatusChanged(long handle, int waitingFor) {
+    (void)handle;
+    (void)waitingFor;
+}
+
+/*
+ * Waits for the lookup descriptor and fetches the next completed lookup.
+ * Returns NULL if nothing completes in time.
+ */
+static void* waitLookupDone(int fd) {
+    fd_set readFds;
+    struct timeval timeout;
+    void *handle;
+
+    for (;;) {
+        handle = pcsl_network_lookup_done();
+        if (handle != NULL) {
+            return handle;
+        }
+
+        FD_ZERO(&readFds);
+        FD_SET(fd, &readFds);
+        timeout.tv_sec = LOOKUP_TIMEOUT;
+        timeout.tv_usec = 0;
+        if (select(fd + 1, &readFds, NULL, NULL, &timeout) <= 0) {
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Test that a literal address is converted without a lookup.
+ */
+void testLiteralAddress() {
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len = 0;
+    void *handle = NULL;
+    void *context = NULL;
+    int status;
+
+    status = pcsl_network_gethostbyname_start("127.0.0.1", address,
+                 MAX_ADDR_LENGTH, &len, &handle, &context);
+    assertTrue("literal address not converted", status == PCSL_NET_SUCCESS);
+    assertTrue("wrong literal address", len == 4 && address[0] == 127 &&
+               address[1] == 0 && address[2] == 0 && address[3] == 1);
+}
+
+/*
+ * Test that a host name is resolved by a helper thread once the lookup
+ * descriptor is watched, and that the result is cached.
+ */
+void testAsyncLookup(int fd) {
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len = 0;
+    void *handle = NULL;
+    void *context = NULL;
+    int status;
+
+    status = pcsl_network_gethostbyname_start("localhost", address,
+                 MAX_ADDR_LENGTH, &len, &handle, &context);
+    assertTrue("lookup did not go to a helper thread",
+               status == PCSL_NET_WOULDBLOCK && handle != NULL);
+
+    status = pcsl_network_gethostbyname_finish(address, MAX_ADDR_LENGTH,
+                 &len, handle, context);
+    assertTrue("lookup finished before it was done",
+               status == PCSL_NET_WOULDBLOCK);
+
+    assertTrue("completed lookup not reported",
+               waitLookupDone(fd) == handle);
+
+    status = pcsl_network_gethostbyname_finish(address, MAX_ADDR_LENGTH,
+                 &len, handle, context);
+    assertTrue("localhost not resolved", status == PCSL_NET_SUCCESS);
+    assertTrue("wrong localhost address", len == 4 && address[0] == 127);
+
+    len = 0;
+    handle = NULL;
+    status = pcsl_network_gethostbyname_start("LOCALHOST", address,
+                 MAX_ADDR_LENGTH, &len, &handle, &context);
+    assertTrue("resolved address not cached",
+               status == PCSL_NET_SUCCESS && handle == NULL);
+    assertTrue("wrong cached address", len == 4 && address[0] == 127);
+}
+
+/*
+ * Test that a failed lookup reports an errno value and that an unknown
+ * host is cached too.
+ */
+void testUnknownHost(int fd) {
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len = 0;
+    void *handle = NULL;
+    void *context = NULL;
+    int status;
+    int error;
+
+    status = pcsl_network_gethostbyname_start("nosuchhost.invalid", address,
+                 MAX_ADDR_LENGTH, &len, &handle, &context);
+    assertTrue("lookup did not go to a helper thread",
+               status == PCSL_NET_WOULDBLOCK);
+    assertTrue("completed lookup not reported",
+               waitLookupDone(fd) == handle);
+
+    status = pcsl_network_gethostbyname_finish(address, MAX_ADDR_LENGTH,
+                 &len, handle, context);
+    error = pcsl_network_error(NULL);
+    assertTrue("unknown host resolved", status == PCSL_NET_IOERROR);
+    assertTrue("lookup error is not an errno value", error > 0);
+
+    if (error == ENOENT) {
+        handle = NULL;
+        status = pcsl_network_gethostbyname_start("nosuchhost.invalid",
+                     address, MAX_ADDR_LENGTH, &len, &handle, &context);
+        assertTrue("unknown host not cached",
+                   status == PCSL_NET_IOERROR && handle == NULL);
+        assertTrue("cached lookup error changed",
+                   pcsl_network_error(NULL) == ENOENT);
+    }
+}
+
+/*
+ * Starts a lookup that goes to a helper thread.
+ */
+static void* startLookup(char *hostname) {
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len = 0;
+    void *handle = NULL;
+    void *context = NULL;
+    int status;
+
+    status = pcsl_network_gethostbyname_start(hostname, address,
+                 MAX_ADDR_LENGTH, &len, &handle, &context);
+    assertTrue("lookup did not go to a helper thread",
+               status == PCSL_NET_WOULDBLOCK && handle != NULL);
+    return handle;
+}
+
+/*
+ * Waits until the helper threads free the abandoned lookups, checking
+ * that none of them is reported as completed.
+ */
+static void waitOrphansFreed(int heapBefore) {
+    int i;
+
+    for (i = 0; i < LOOKUP_TIMEOUT * 100; i++) {
+        assertTrue("abandoned lookup reported",
+                   pcsl_network_lookup_done() == NULL);
+        if (pcsl_mem_get_free_heap() == heapBefore) {
+            return;
+        }
+        usleep(10000);
+    }
+    assertTrue("abandoned lookups not freed",
+               pcsl_mem_get_free_heap() == heapBefore);
+}
+
+/*
+ * Test that abandoned lookups are freed whatever state they are in and
+ * are never reported as completed.
+ */
+void testAbandon(int fd) {
+    fd_set readFds;
+    struct timeval timeout;
+    void *handle;
+    int heapBefore;
+
+    heapBefore = pcsl_mem_get_free_heap();
+
+    /* Waiting for a helper thread or being resolved */
+    pcsl_network_lookup_abandon(startLookup("abandon1.invalid"));
+    pcsl_network_lookup_abandon(startLookup("abandon2.invalid"));
+    pcsl_network_lookup_abandon(startLookup("abandon3.invalid"));
+    pcsl_network_lookup_abandon(startLookup("abandon4.invalid"));
+    waitOrphansFreed(heapBefore);
+
+    /* Reported as completed, not finished */
+    handle = startLookup("abandon5.invalid");
+    assertTrue("completed lookup not reported",
+               waitLookupDone(fd) == handle);
+    pcsl_network_lookup_abandon(handle);
+    assertTrue("delivered lookup not freed",
+               pcsl_mem_get_free_heap() == heapBefore);
+
+    /* Completed, not reported yet */
+    handle = startLookup("abandon6.invalid");
+    FD_ZERO(&readFds);
+    FD_SET(fd, &readFds);
+    timeout.tv_sec = LOOKUP_TIMEOUT;
+    timeout.tv_usec = 0;
+    assertTrue("lookup did not complete",
+               select(fd + 1, &readFds, NULL, NULL, &timeout) == 1);
+    pcsl_network_lookup_abandon(handle);
+    assertTrue("completed lookup not freed",
+               pcsl_mem_get_free_heap() == heapBefore);
+    waitOrphansFreed(heapBefore);
+}
+
+/*
+ * Unit test framework entry point for this set of unit tests.
+ */
+void testHostLookup_runTests() {
+    int fd;
+
+    pcsl_mem_initialize(NULL, 0);
+
+    testLiteralAddress();
+
+    fd = pcsl_network_lookup_fd();
+    assertTrue("no lookup descriptor", fd != -1);
+
+    testAsyncLookup(fd);
+    testUnknownHost(fd);
+    testAbandon(fd);
+
+    pcsl_mem_finalize();
+}
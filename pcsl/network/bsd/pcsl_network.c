@@ -40,8 +40,11 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
 
@@ -61,7 +64,7 @@
 #include <pcsl_network_na.h>
 #include <pcsl_network_notifier.h>
 
-int lastError; /* For pcsl_network_error use. */
+int lastError; /* For pcsl_network_error use; always an errno value. */
 
 /**
  * Returns name of network interface which is meant as a primary
@@ -75,11 +78,374 @@ static char *pcsl_network_getMainIFName() {
     return pName ? pName : "eth0";
 }
 
+/*
+ * Host name lookups.
+ *
+ * A lookup can take seconds, and every Java thread runs on the native thread
+ * calling gethostbyname_start, so once the platform event loop watches the
+ * descriptor returned by pcsl_network_lookup_fd() the lookups are resolved
+ * by a few helper threads. The results, including unknown hosts, are kept
+ * in a small cache for a bounded time, since the resolver does not report
+ * the record TTL.
+ */
+
+/** Number of helper threads resolving host names */
+#ifndef PCSL_LOOKUP_THREADS
+#define PCSL_LOOKUP_THREADS 2
+#endif
+
+/** Number of cached host names */
+#ifndef PCSL_LOOKUP_CACHE_SIZE
+#define PCSL_LOOKUP_CACHE_SIZE 32
+#endif
+
+/** Seconds a resolved address is reused */
+#ifndef PCSL_LOOKUP_CACHE_TTL
+#define PCSL_LOOKUP_CACHE_TTL 300
+#endif
+
+/** Seconds an unknown host is remembered */
+#ifndef PCSL_LOOKUP_NEGATIVE_TTL
+#define PCSL_LOOKUP_NEGATIVE_TTL 30
+#endif
+
+/** Host name lookup, its address is the handle given to the caller */
+typedef struct _HostLookup {
+    char hostname[MAX_HOST_LENGTH];
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len;
+    int status;         /* PCSL_NET_WOULDBLOCK until resolved */
+    int error;          /* errno value, see resolveHost() */
+    int delivered;      /* returned by pcsl_network_lookup_done() */
+    int orphaned;       /* nobody will call gethostbyname_finish */
+    struct _HostLookup *next;
+} HostLookup;
+
+/** Cached result of a host name lookup */
+typedef struct _HostCacheEntry {
+    char hostname[MAX_HOST_LENGTH];
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len;
+    int status;         /* PCSL_NET_SUCCESS or PCSL_NET_IOERROR */
+    int error;
+    time_t expires;     /* unused entry if 0 */
+} HostCacheEntry;
+
+/** The cache is accessed by the VM thread only */
+static HostCacheEntry hostCache[PCSL_LOOKUP_CACHE_SIZE];
+
+/** Guards the lookup lists below */
+static pthread_mutex_t lookupMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lookupCond = PTHREAD_COND_INITIALIZER;
+
+/** Lookups waiting for a helper thread, in order of start */
+static HostLookup* pendingLookups = NULL;
+static HostLookup* pendingLookupsTail = NULL;
+
+/** Resolved lookups not fetched by the event loop yet */
+static HostLookup* doneLookups = NULL;
+
+/** Readable while doneLookups is not empty */
+static int lookupPipe[2] = { -1, -1 };
+
+/** Number of running helper threads */
+static int lookupThreads = 0;
+
+/**
+ * Maps a getaddrinfo() result to the errno value reported by
+ * pcsl_network_error(), as for the other network operations. An unknown
+ * host is reported as ENOENT. Must be called on the thread that called
+ * getaddrinfo(), since EAI_SYSTEM leaves the cause in errno.
+ */
+static int lookupErrno(int error) {
+    switch (error) {
+    case 0:
+        return 0;
+    case EAI_NONAME:
+#if defined(EAI_NODATA) && EAI_NODATA != EAI_NONAME
+    case EAI_NODATA:
+#endif
+        return ENOENT;
+    case EAI_AGAIN:
+        return EAGAIN;
+    case EAI_MEMORY:
+        return ENOMEM;
+    case EAI_SYSTEM:
+        return errno;
+    case EAI_FAIL:
+        return EIO;
+    default:
+        return EINVAL;
+    }
+}
+
+/**
+ * Resolves an IPv4 address of the host. This is safe to call from any
+ * thread, unlike gethostbyname().
+ *
+ * @return PCSL_NET_SUCCESS or PCSL_NET_IOERROR, with the errno value of
+ *         the failure in *pError
+ */
+static int resolveHost(const char *hostname, unsigned char *pAddress,
+                       int *pLen, int *pError) {
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    int error;
+
+    memset(&hints, 0, sizeof (hints));
+    hints.ai_family = AF_INET;     /* IMPL NOTE - IPv6 not supported, yet. */
+    hints.ai_socktype = SOCK_STREAM;
+
+    error = getaddrinfo(hostname, NULL, &hints, &result);
+    *pError = lookupErrno(error);
+    if (error != 0 || result == NULL) {
+        if (error == 0) {
+            *pError = ENOENT;
+        }
+        return PCSL_NET_IOERROR;
+    }
+
+    memcpy(pAddress,
+           &((struct sockaddr_in *)result->ai_addr)->sin_addr, 4);
+    *pLen = 4;
+    freeaddrinfo(result);
+    return PCSL_NET_SUCCESS;
+}
+
+/**
+ * Finds a live cache entry for the host.
+ */
+static HostCacheEntry* findCachedHost(const char *hostname, time_t now) {
+    int i;
+
+    for (i = 0; i < PCSL_LOOKUP_CACHE_SIZE; i++) {
+        HostCacheEntry* entry = &hostCache[i];
+        if (entry->expires > now &&
+                strcasecmp(entry->hostname, hostname) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Caches the result of a lookup. Failures other than an unknown host,
+ * e.g. an unreachable name server, are not cached.
+ */
+static void cacheHost(const char *hostname, const unsigned char *pAddress,
+                      int len, int status, int error) {
+    time_t now = time(NULL);
+    HostCacheEntry* entry = findCachedHost(hostname, now);
+    int i;
+
+    if (status != PCSL_NET_SUCCESS && error != ENOENT) {
+        return;
+    }
+
+    if (entry == NULL) {
+        /* Reuse the entry expiring first */
+        entry = &hostCache[0];
+        for (i = 1; i < PCSL_LOOKUP_CACHE_SIZE; i++) {
+            if (hostCache[i].expires < entry->expires) {
+                entry = &hostCache[i];
+            }
+        }
+        strcpy(entry->hostname, hostname);
+    }
+
+    memcpy(entry->address, pAddress, len);
+    entry->len = len;
+    entry->status = status;
+    entry->error = error;
+    entry->expires = now + (status == PCSL_NET_SUCCESS ?
+        PCSL_LOOKUP_CACHE_TTL : PCSL_LOOKUP_NEGATIVE_TTL);
+}
+
+/**
+ * Copies a lookup result to the caller's buffer.
+ */
+static int returnAddress(int status, const unsigned char *pSrc, int len,
+                         int error, unsigned char *pAddress, int maxLen,
+                         int *pLen) {
+    lastError = error;
+    if (status != PCSL_NET_SUCCESS) {
+        return status;
+    }
+    if (len > maxLen) {
+        return PCSL_NET_INVALID;
+    }
+    memcpy(pAddress, pSrc, len);
+    *pLen = len;
+    return PCSL_NET_SUCCESS;
+}
+
+/**
+ * Helper thread body: resolves the pending lookups one by one.
+ */
+static void* lookupThread(void *arg) {
+    HostLookup* lookup;
+    int status;
+
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&lookupMutex);
+        while (pendingLookups == NULL) {
+            pthread_cond_wait(&lookupCond, &lookupMutex);
+        }
+        lookup = pendingLookups;
+        pendingLookups = lookup->next;
+        if (pendingLookups == NULL) {
+            pendingLookupsTail = NULL;
+        }
+        pthread_mutex_unlock(&lookupMutex);
+
+        status = resolveHost(lookup->hostname, lookup->address,
+                             &lookup->len, &lookup->error);
+
+        /*
+         * An orphaned lookup goes to the done list too: it is freed on the
+         * VM thread by pcsl_network_lookup_done(), since the pcsl_mem heap
+         * is not thread safe.
+         */
+        pthread_mutex_lock(&lookupMutex);
+        lookup->status = status;
+        lookup->next = doneLookups;
+        doneLookups = lookup;
+        if (write(lookupPipe[1], "", 1) < 0) {
+            /* A full pipe is readable already */
+        }
+        pthread_mutex_unlock(&lookupMutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * Starts the helper threads on first use.
+ *
+ * @return non-zero if there is a thread to resolve host names
+ */
+static int startLookupThreads(void) {
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (lookupThreads > 0) {
+        return 1;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (lookupThreads < PCSL_LOOKUP_THREADS &&
+           pthread_create(&thread, &attr, lookupThread, NULL) == 0) {
+        lookupThreads++;
+    }
+    pthread_attr_destroy(&attr);
+
+    return lookupThreads > 0;
+}
+
+/**
+ * See pcsl_network_md.h for definition.
+ */
+int pcsl_network_lookup_fd(void) {
+    if (lookupPipe[0] == -1) {
+        if (pipe(lookupPipe) != 0) {
+            lookupPipe[0] = lookupPipe[1] = -1;
+            return -1;
+        }
+        fcntl(lookupPipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(lookupPipe[1], F_SETFL, O_NONBLOCK);
+    }
+    return lookupPipe[0];
+}
+
+/**
+ * See pcsl_network_md.h for definition.
+ *
+ * Orphaned lookups are not returned: their result is cached and they are
+ * freed here.
+ */
+void* pcsl_network_lookup_done(void) {
+    HostLookup* lookup;
+    char buf[32];
+
+    for (;;) {
+        pthread_mutex_lock(&lookupMutex);
+        lookup = doneLookups;
+        if (lookup != NULL) {
+            doneLookups = lookup->next;
+            lookup->delivered = 1;
+        }
+        if (doneLookups == NULL && lookupPipe[0] != -1) {
+            while (read(lookupPipe[0], buf, sizeof (buf)) > 0) {
+            }
+        }
+        pthread_mutex_unlock(&lookupMutex);
+
+        if (lookup == NULL || !lookup->orphaned) {
+            return (void*)lookup;
+        }
+        cacheHost(lookup->hostname, lookup->address, lookup->len,
+                  lookup->status, lookup->error);
+        pcsl_mem_free(lookup);
+    }
+}
+
+/**
+ * Removes the lookup from the list starting at *pList.
+ *
+ * @return non-zero if the lookup was in the list
+ */
+static int unlinkLookup(HostLookup** pList, HostLookup* lookup) {
+    HostLookup* prev = NULL;
+    HostLookup** p;
+
+    for (p = pList; *p != NULL; prev = *p, p = &(*p)->next) {
+        if (*p == lookup) {
+            *p = lookup->next;
+            if (pList == &pendingLookups && pendingLookupsTail == lookup) {
+                pendingLookupsTail = prev;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * See pcsl_network_md.h for definition.
+ */
+void pcsl_network_lookup_abandon(void *handle) {
+    HostLookup* lookup = (HostLookup*)handle;
+    int inProgress;
+
+    if (lookup == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&lookupMutex);
+    inProgress = 0;
+    if (!unlinkLookup(&pendingLookups, lookup) &&
+            !unlinkLookup(&doneLookups, lookup) &&
+            lookup->status == PCSL_NET_WOULDBLOCK) {
+        /* A helper thread is resolving it */
+        lookup->orphaned = 1;
+        inProgress = 1;
+    }
+    pthread_mutex_unlock(&lookupMutex);
+
+    if (!inProgress) {
+        pcsl_mem_free(lookup);
+    }
+}
+
 /**
  * See pcsl_network.h for definition.
- * 
- * Note that this function NEVER returns PCSL_NET_WOULDBLOCK. Therefore, the 
- * finish() function should never be called and does nothing.
+ *
+ * Literal addresses and cached host names are returned at once. Other
+ * names are resolved synchronously, unless the event loop watches for
+ * completed lookups, see pcsl_network_lookup_fd().
  */
 int pcsl_network_gethostbyname_start(
 	char *hostname,
@@ -89,40 +455,64 @@ int pcsl_network_gethostbyname_start(
 	void **pHandle,
 	void **pContext)
 {
-    struct hostent *hp;
-    int realLen;
-
-    (void)pHandle;
-    (void)pContext;
+    struct in_addr literal;
+    HostCacheEntry* entry;
+    HostLookup* lookup;
+    unsigned char address[MAX_ADDR_LENGTH];
+    int len = 0;
+    int error;
+    int status;
 
-    hp = gethostbyname(hostname);
-    lastError = errno;
-    if (NULL == hp) {
+    if (strlen(hostname) >= MAX_HOST_LENGTH) {
+        lastError = ENOENT;
         return PCSL_NET_IOERROR;
     }
 
-    if (hp->h_addrtype == AF_INET) {
-        realLen = 4;	/* IPv4 */
-    } else if (hp->h_addrtype == AF_INET6) {
-        realLen = 16;   /* IMPL NOTE - IPv6 not supported, yet. */
-    } else {
-        return PCSL_NET_IOERROR;
+    if (inet_pton(AF_INET, hostname, &literal) == 1) {
+        return returnAddress(PCSL_NET_SUCCESS, (unsigned char*)&literal, 4,
+                             0, pAddress, maxLen, pLen);
     }
 
-    if (realLen > maxLen) {
-        return PCSL_NET_INVALID;
+    entry = findCachedHost(hostname, time(NULL));
+    if (entry != NULL) {
+        return returnAddress(entry->status, entry->address, entry->len,
+                             entry->error, pAddress, maxLen, pLen);
     }
 
-    memcpy(pAddress, hp->h_addr_list[0], realLen);
-    *pLen = realLen;
-    return PCSL_NET_SUCCESS;
+    if (lookupPipe[0] != -1 && startLookupThreads()) {
+        lookup = (HostLookup*)pcsl_mem_malloc(sizeof (HostLookup));
+        if (lookup != NULL) {
+            strcpy(lookup->hostname, hostname);
+            lookup->len = 0;
+            lookup->status = PCSL_NET_WOULDBLOCK;
+            lookup->error = 0;
+            lookup->delivered = 0;
+            lookup->orphaned = 0;
+            lookup->next = NULL;
+
+            pthread_mutex_lock(&lookupMutex);
+            if (pendingLookupsTail != NULL) {
+                pendingLookupsTail->next = lookup;
+            } else {
+                pendingLookups = lookup;
+            }
+            pendingLookupsTail = lookup;
+            pthread_cond_signal(&lookupCond);
+            pthread_mutex_unlock(&lookupMutex);
+
+            *pHandle = (void*)lookup;
+            *pContext = NULL;
+            return PCSL_NET_WOULDBLOCK;
+        }
+    }
+
+    status = resolveHost(hostname, address, &len, &error);
+    cacheHost(hostname, address, len, status, error);
+    return returnAddress(status, address, len, error, pAddress, maxLen, pLen);
 }
 
 /**
  * See pcsl_network.h for definition.
- *
- * Since the start function never returns PCSL_NET_WOULDBLOCK, this
- * function should never be called.
  */
 int pcsl_network_gethostbyname_finish(
 	unsigned char *pAddress,
@@ -131,13 +521,30 @@ int pcsl_network_gethostbyname_finish(
 	void *handle,
 	void *context)
 {
-    /*
-     * DEBUG:
-     * printf("pcsl_socket_gethostbyname_finish called!\n");
-     */
-    (void)handle;
+    HostLookup* lookup = (HostLookup*)handle;
+    int delivered;
+    int status;
+
     (void)context;
-    return PCSL_NET_INVALID;
+
+    if (lookup == NULL) {
+        return PCSL_NET_INVALID;
+    }
+
+    /* The lookup is freed here, so it must not be in the done list */
+    pthread_mutex_lock(&lookupMutex);
+    delivered = lookup->delivered;
+    pthread_mutex_unlock(&lookupMutex);
+    if (!delivered) {
+        return PCSL_NET_WOULDBLOCK;
+    }
+
+    cacheHost(lookup->hostname, lookup->address, lookup->len,
+              lookup->status, lookup->error);
+    status = returnAddress(lookup->status, lookup->address, lookup->len,
+                           lookup->error, pAddress, maxLen, pLen);
+    pcsl_mem_free(lookup);
+    return status;
 }
 
 /**
@@ -68,6 +68,46 @@ extern "C" {
  */
 #define ENV_VAR_WITH_NETWORK_IF_NAME "MAIN_NETWORK_IF_NAME"
 
+/**
+ * Gets a descriptor that becomes readable when a host name lookup started
+ * by pcsl_network_gethostbyname_start() completes. Host names are resolved
+ * synchronously until a platform event loop asks for this descriptor, so
+ * only an event loop able to watch it should call this function. After
+ * the call, gethostbyname_start may return PCSL_NET_WOULDBLOCK, and the
+ * thread waiting for the lookup should be unblocked with a
+ * HOST_NAME_LOOKUP_SIGNAL for each handle returned by
+ * pcsl_network_lookup_done().
+ *
+ * @return descriptor to watch for read, -1 if lookups stay synchronous
+ */
+extern int pcsl_network_lookup_fd(void);
+
+/**
+ * Gets the handle of the next completed host name lookup. The descriptor
+ * returned by pcsl_network_lookup_fd() stays readable while there are
+ * completed lookups not fetched by this function.
+ *
+ * @return lookup handle as returned by gethostbyname_start, or NULL
+ */
+extern void* pcsl_network_lookup_done(void);
+
+/**
+ * Defined when pcsl_network_lookup_abandon() is available.
+ */
+#define PCSL_NETWORK_LOOKUP_ABANDON
+
+/**
+ * Releases a lookup started by pcsl_network_gethostbyname_start() that
+ * returned PCSL_NET_WOULDBLOCK when no thread will call
+ * pcsl_network_gethostbyname_finish() for it. A lookup still being
+ * resolved is freed once it completes, and its handle is no longer
+ * returned by pcsl_network_lookup_done(). Must be called on the thread
+ * calling pcsl_network_lookup_done().
+ *
+ * @param handle lookup handle, must not be used after the call
+ */
+extern void pcsl_network_lookup_abandon(void *handle);
+
 #ifdef __cplusplus
 }
 #endif